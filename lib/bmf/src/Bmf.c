@@ -67,7 +67,6 @@
 #include <netinet/ip.h> /* struct ip */
 #include <netinet/udp.h> /* struct udphdr */
 #include <unistd.h> /* read(), write() */
-#include <sys/poll.h> /* Daniele Lacamera: Added guard poll for sendto(), needs poll.h */
 
 /* OLSRD includes */
 #include "plugin_util.h" /* set_plugin_int */
@@ -166,14 +165,8 @@ static void ForwardPacket(
   u_int16_t ipPacketLen,
   const char* debugInfo)
 {
-  int nBytesWritten;
   struct sockaddr_ll dest;
 
-  int pollret;
-  struct pollfd guard;
-  guard.fd = intf->capturingSkfd;
-  guard.events = POLLOUT;
-
   /* If the IP packet is a local broadcast packet,
    * update its destination address to match the subnet of the network
    * interface on which the packet is being sent. */
@@ -182,7 +175,7 @@ static void ForwardPacket(
   memset(&dest, 0, sizeof(dest));
   dest.sll_family = AF_PACKET;
   dest.sll_protocol = htons(ETH_P_IP);
-  dest.sll_ifindex = if_nametoindex(intf->ifName);
+  dest.sll_ifindex = intf->ifIndex;
   dest.sll_halen = IFHWADDRLEN;
 
   /* Use all-ones as destination MAC address. When the IP destination is
@@ -193,36 +186,19 @@ static void ForwardPacket(
    * in that case. */
   memset(dest.sll_addr, 0xFF, IFHWADDRLEN);
 
-  /* Daniele Lacamera: poll guard to avoid locking in sendto().
-   * Wait at most 2 polling periods. Since we're running in the context of the main
-   * OLSR thread, we should not wait too long. 2 polling periods is considered a
-   * reasonable time. */
-  pollret = poll (&guard, 1, 2 * olsr_cnf->pollrate * MSEC_PER_SEC);
-  if (pollret <= 0)
-  {
-    BmfPError("sendto() on \"%s\": not ready to send pkt. pollret=%d\n", intf->ifName, pollret);
-
-    /* Apparently the network interface is jammed. Give up. */
-    return;
-  }
-
-  /* Forward the BMF packet via the capturing socket */
-  nBytesWritten = sendto(
-    intf->capturingSkfd,
-    ipPacket,
-    ipPacketLen,
-    0,
-    (struct sockaddr*) &dest,
-    sizeof(dest));
-  if (nBytesWritten != ipPacketLen)
+  /* Forward the BMF packet via the capturing socket. It is queued if the
+   * socket is not writable; the main OLSR thread must not wait for it. */
+  if (BmfSendTo(
+        &intf->captureTx,
+        ipPacket,
+        ipPacketLen,
+        0,
+        (struct sockaddr*) &dest,
+        sizeof(dest)) < 0)
   {
-    BmfPError("sendto() error forwarding pkt on \"%s\"", intf->ifName);
     return;
   }
 
-  /* Increase counter */
-  intf->nBmfPacketsTx++;
-
   OLSR_PRINTF(
     8,
     "%s: --> %s \"%s\"\n",
@@ -330,50 +306,25 @@ static void EncapsulateAndForwardPacket(
 
   for (i = 0; i < nPacketsToSend; i++)
   {
-    int nBytesWritten;
-
-    int pollret;
-    struct pollfd guard;
-    guard.fd = intf->encapsulatingSkfd;
-    guard.events = POLLOUT;
-
     if (sendUnicast == 1)
     {
       /* For unicast, overwrite the local broadcast address which was filled in above */
       forwardTo.sin_addr = bestNeighborLinks.links[i]->neighbor_iface_addr.v4;
     }
 
-    /* Daniele Lacamera: poll guard to avoid locking in sendto().
-     * Wait at most 2 polling periods. Since we're running in the context of the main
-     * OLSR thread, we should not wait too long. 2 polling periods is considered a
-     * reasonable time. */
-    pollret = poll (&guard, 1, 2 * olsr_cnf->pollrate * MSEC_PER_SEC);
-    if (pollret <= 0)
+    /* Forward the BMF packet via the encapsulation socket, or queue it
+     * if the socket is not writable */
+    if (BmfSendTo(
+          &intf->encapsulateTx,
+          encapsulationUdpData,
+          udpDataLen,
+          MSG_DONTROUTE,
+          (struct sockaddr*) &forwardTo,
+          sizeof(forwardTo)) < 0)
     {
-      BmfPError("sendto() on \"%s\": not ready to send pkt. pollret=%d\n", intf->ifName, pollret);
-
       /* Apparently the network interface is jammed. Give up and return. */
       return;
-    }
-
-    /* Forward the BMF packet via the encapsulation socket */
-    nBytesWritten = sendto(
-      intf->encapsulatingSkfd,
-      encapsulationUdpData,
-      udpDataLen,
-      MSG_DONTROUTE,
-      (struct sockaddr*) &forwardTo,
-      sizeof(forwardTo));                   
-
-    /* Evaluate and display result */
-    if (nBytesWritten != udpDataLen)
-    {
-      BmfPError("sendto() error forwarding encapsulated pkt on \"%s\"", intf->ifName);
-      return;
-    } /* if (nBytesWritten != udpDataLen) */
-
-    /* Increase counter */
-    intf->nBmfPacketsTx++;
+    } /* if */
 
     OLSR_PRINTF(
       8,
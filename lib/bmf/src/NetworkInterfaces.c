@@ -1375,6 +1375,177 @@ static int CreateLocalEtherTunTap(void)
   return etfd;
 } /* CreateLocalEtherTunTap */
 
+/* -------------------------------------------------------------------------
+ * Function   : TxRingWritable
+ * Description: Send the packets waiting in a transmit ring, called by the
+ *              scheduler when the socket of the ring is writable
+ * Input      : skfd - the socket of the ring
+ *              data - the transmit ring
+ *              flags - the events of the socket (unused)
+ * Output     : none
+ * Return     : none
+ * Data Used  : none
+ * ------------------------------------------------------------------------- */
+static void TxRingWritable(int skfd, void* data, unsigned int flags __attribute__ ((unused)))
+{
+  struct TBmfTxRing* ring = data;
+
+  while (ring->count > 0)
+  {
+    struct TBmfTxPacket* pkt = &ring->packets[ring->head];
+    ssize_t nBytesWritten = sendto(
+      skfd,
+      pkt->data,
+      pkt->len,
+      pkt->flags | MSG_DONTWAIT,
+      (struct sockaddr*) &pkt->dest,
+      pkt->destLen);
+
+    if (nBytesWritten < 0 && errno == EAGAIN)
+    {
+      /* Still no room, wait for the next writable event */
+      return;
+    }
+
+    if (nBytesWritten == pkt->len)
+    {
+      ring->intf->nBmfPacketsTx++;
+    }
+    else
+    {
+      BmfPError("sendto() error forwarding queued pkt on \"%s\"", ring->intf->ifName);
+      ring->nDropped++;
+    }
+
+    ring->head = (ring->head + 1) % BMF_TX_RING_SIZE;
+    ring->count--;
+  } /* while */
+
+  disable_olsr_socket(skfd, NULL, &TxRingWritable, SP_IMM_WRITE);
+} /* TxRingWritable */
+
+/* -------------------------------------------------------------------------
+ * Function   : InitTxRing
+ * Description: Initialize the transmit ring of a socket
+ * Input      : ring - the transmit ring
+ *              skfd - the socket to send on, or -1 if there is none
+ *              intf - the network interface of the socket
+ * Output     : none
+ * Return     : none
+ * Data Used  : none
+ * Notes      : The socket is registered with the scheduler, but is only
+ *              polled for writing while packets are waiting
+ * ------------------------------------------------------------------------- */
+static void InitTxRing(struct TBmfTxRing* ring, int skfd, struct TBmfInterface* intf)
+{
+  memset(ring, 0, sizeof(*ring));
+  ring->skfd = skfd;
+  ring->intf = intf;
+
+  if (skfd >= 0)
+  {
+    add_olsr_socket(skfd, NULL, &TxRingWritable, ring, 0);
+  }
+} /* InitTxRing */
+
+/* -------------------------------------------------------------------------
+ * Function   : CloseTxRing
+ * Description: Discard the packets of a transmit ring and unregister its
+ *              socket from the scheduler
+ * Input      : ring - the transmit ring
+ * Output     : none
+ * Return     : none
+ * Data Used  : none
+ * ------------------------------------------------------------------------- */
+static void CloseTxRing(struct TBmfTxRing* ring)
+{
+  if (ring->skfd >= 0)
+  {
+    remove_olsr_socket(ring->skfd, NULL, &TxRingWritable);
+  }
+  ring->nDropped += ring->count;
+  ring->count = 0;
+  free(ring->packets);
+  ring->packets = NULL;
+} /* CloseTxRing */
+
+/* -------------------------------------------------------------------------
+ * Function   : BmfSendTo
+ * Description: Send a packet on the socket of a transmit ring without
+ *              blocking. If the kernel has no room for it, the packet
+ *              waits in the ring until the socket is writable.
+ * Input      : ring - the transmit ring
+ *              data - the packet to send
+ *              len - the length of the packet
+ *              flags - flags for sendto()
+ *              dest - the destination of the packet
+ *              destLen - the length of the destination address
+ * Output     : none
+ * Return     : the packet was sent (1), queued (0) or dropped (-1)
+ * Data Used  : none
+ * ------------------------------------------------------------------------- */
+int BmfSendTo(
+  struct TBmfTxRing* ring,
+  const unsigned char* data,
+  u_int16_t len,
+  int flags,
+  const struct sockaddr* dest,
+  socklen_t destLen)
+{
+  struct TBmfTxPacket* pkt;
+
+  assert(destLen <= sizeof(pkt->dest));
+
+  /* Keep the order of the packets: only send directly if none is waiting.
+   * The socket may have become writable before the scheduler noticed. */
+  if (ring->count > 0)
+  {
+    TxRingWritable(ring->skfd, ring, SP_IMM_WRITE);
+  }
+  if (ring->count == 0)
+  {
+    ssize_t nBytesWritten = sendto(ring->skfd, data, len, flags | MSG_DONTWAIT, dest, destLen);
+
+    if (nBytesWritten == len)
+    {
+      ring->intf->nBmfPacketsTx++;
+      return 1;
+    }
+    if (nBytesWritten >= 0 || errno != EAGAIN)
+    {
+      BmfPError("sendto() error forwarding pkt on \"%s\"", ring->intf->ifName);
+      ring->nDropped++;
+      return -1;
+    }
+  }
+
+  if (ring->count == BMF_TX_RING_SIZE)
+  {
+    /* Apparently the network interface is jammed. Give up. */
+    ring->nDropped++;
+    return -1;
+  }
+
+  if (ring->packets == NULL)
+  {
+    ring->packets = olsr_malloc(BMF_TX_RING_SIZE * sizeof(struct TBmfTxPacket), "BMF: TBmfTxPacket");
+  }
+
+  pkt = &ring->packets[(ring->head + ring->count) % BMF_TX_RING_SIZE];
+  memcpy(&pkt->dest, dest, destLen);
+  pkt->destLen = destLen;
+  pkt->flags = flags;
+  pkt->len = len;
+  memcpy(pkt->data, data, len);
+
+  if (ring->count++ == 0)
+  {
+    enable_olsr_socket(ring->skfd, NULL, &TxRingWritable, SP_IMM_WRITE);
+  }
+  ring->nQueued++;
+  return 0;
+} /* BmfSendTo */
+
 /* -------------------------------------------------------------------------
  * Function   : CreateInterface
  * Description: Create a new TBmfInterface object and adds it to the global
@@ -1483,6 +1654,11 @@ static int CreateInterface(
   if (listeningSkfd != -1) {
     add_olsr_socket(listeningSkfd, NULL, BMF_handle_listeningFd, newIf, SP_IMM_READ);
   }
+  InitTxRing(&newIf->captureTx, capturingSkfd, newIf);
+  InitTxRing(&newIf->encapsulateTx, encapsulatingSkfd, newIf);
+
+  /* Look up the interface index once, it is needed for every forwarded packet */
+  newIf->ifIndex = if_nametoindex(ifName);
   /* Copy data into TBmfInterface object */
   newIf->capturingSkfd = capturingSkfd;
   newIf->encapsulatingSkfd = encapsulatingSkfd;
@@ -1720,6 +1896,9 @@ void CloseBmfNetworkInterfaces(void)
     struct TBmfInterface* bmfIf = nextBmfIf;
     nextBmfIf = bmfIf->next;
 
+    CloseTxRing(&bmfIf->captureTx);
+    CloseTxRing(&bmfIf->encapsulateTx);
+
     if (bmfIf->capturingSkfd >= 0)
     {
       close(bmfIf->capturingSkfd);
@@ -1741,13 +1920,15 @@ void CloseBmfNetworkInterfaces(void)
 
     OLSR_PRINTF(
       7,
-      "%s: %s interface \"%s\": RX pkts %d (%d dups); TX pkts %d\n", 
+      "%s: %s interface \"%s\": RX pkts %d (%d dups); TX pkts %d (%d queued, %d dropped)\n", 
       PLUGIN_NAME_SHORT,
       bmfIf->olsrIntf != NULL ? "OLSR" : "non-OLSR",
       bmfIf->ifName,
       bmfIf->nBmfPacketsRx,
       bmfIf->nBmfPacketsRxDup,
-      bmfIf->nBmfPacketsTx);
+      bmfIf->nBmfPacketsTx,
+      bmfIf->captureTx.nQueued + bmfIf->encapsulateTx.nQueued,
+      bmfIf->captureTx.nDropped + bmfIf->encapsulateTx.nDropped);
 
     olsr_printf(
       1,
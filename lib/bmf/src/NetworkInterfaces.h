@@ -55,6 +55,7 @@
 
 /* System includes */
 #include <netinet/in.h> /* struct in_addr */
+#include <sys/socket.h> /* struct sockaddr_storage, socklen_t */
 
 /* OLSR includes */
 #include "olsr_types.h" /* olsr_ip_addr */
@@ -66,6 +67,41 @@
 /* Size of buffer in which packets are received */
 #define BMF_BUFFER_SIZE 2048
 
+/* Number of packets which may wait for a socket to become writable */
+#define BMF_TX_RING_SIZE 32
+
+struct TBmfInterface;
+
+struct TBmfTxPacket
+{
+  struct sockaddr_storage dest;
+  socklen_t destLen;
+  int flags;
+  u_int16_t len;
+  unsigned char data[BMF_BUFFER_SIZE];
+};
+
+/* Transmit ring of a sending socket. Packets wait here while the kernel
+ * has no room for them, and are sent when the scheduler reports the socket
+ * writable again. The main loop never blocks on a congested interface. */
+struct TBmfTxRing
+{
+  int skfd;
+
+  /* The interface whose TX counter is increased */
+  struct TBmfInterface* intf;
+
+  /* BMF_TX_RING_SIZE packets, allocated when the first packet must wait */
+  struct TBmfTxPacket* packets;
+  unsigned int head;
+  unsigned int count;
+
+  /* Number of packets which had to wait, and which were dropped because
+   * the ring was full or sending failed */
+  u_int32_t nQueued;
+  u_int32_t nDropped;
+};
+
 struct TBmfInterface
 {
   /* File descriptor of raw packet socket, used for capturing multicast packets */
@@ -83,6 +119,9 @@ struct TBmfInterface
 
   char ifName[IFNAMSIZ];
 
+  /* Kernel index of the network interface */
+  int ifIndex;
+
   /* OLSRs idea of this network interface. NULL if this interface is not
    * OLSR-enabled. */
   struct interface_olsr * olsrIntf;
@@ -98,6 +137,10 @@ struct TBmfInterface
   u_int32_t nBmfPacketsRxDup;
   u_int32_t nBmfPacketsTx;
 
+  /* Transmit rings of the capturing and the encapsulating socket */
+  struct TBmfTxRing captureTx;
+  struct TBmfTxRing encapsulateTx;
+
   /* Next element in list */
   struct TBmfInterface* next; 
 };
@@ -150,6 +193,13 @@ int CreateBmfNetworkInterfaces(struct interface_olsr * skipThisIntf);
 void CloseBmfNetworkInterfaces(void);
 int AddNonOlsrBmfIf(const char* ifName, void* data, set_plugin_parameter_addon addon);
 int IsNonOlsrBmfIf(const char* ifName);
+int BmfSendTo(
+  struct TBmfTxRing* ring,
+  const unsigned char* data,
+  u_int16_t len,
+  int flags,
+  const struct sockaddr* dest,
+  socklen_t destLen);
 void CheckAndUpdateLocalBroadcast(unsigned char* ipPacket, union olsr_ip_addr* broadAddr);
 void AddMulticastRoute(void);
 void DeleteMulticastRoute(void);
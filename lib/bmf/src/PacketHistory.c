@@ -74,8 +74,10 @@ static struct TDupEntry* PacketHistory[HISTORY_HASH_SIZE];
 
 /* -------------------------------------------------------------------------
  * Function   : GenerateCrc32Table
- * Description: Generate the table of CRC remainders for all possible bytes,
- *              according to CRC-32-IEEE 802.3
+ * Description: Generate the tables of CRC remainders for all possible bytes,
+ *              according to CRC-32-IEEE 802.3. CrcTable[0] holds the
+ *              remainders of one byte, CrcTable[k] those of a byte followed
+ *              by k zero bytes, so that 8 bytes can be processed at once.
  * Input      : none
  * Output     : none
  * Return     : none
@@ -83,7 +85,7 @@ static struct TDupEntry* PacketHistory[HISTORY_HASH_SIZE];
  * ------------------------------------------------------------------------- */
 #define CRC32_POLYNOMIAL 0xedb88320UL /* bit-inverse of 0x04c11db7UL */
 
-static unsigned long CrcTable[256];
+static u_int32_t CrcTable[8][256];
 
 static void GenerateCrc32Table(void)
 {
@@ -103,13 +105,23 @@ static void GenerateCrc32Table(void)
         crc = (crc >> 1);
       }
     }
-    CrcTable[i] = crc;
+    CrcTable[0][i] = crc;
+  } /* for */
+
+  for (i = 0; i < 256; i++)
+  {
+    for (j = 1; j < 8; j++)
+    {
+      crc = CrcTable[j - 1][i];
+      CrcTable[j][i] = (crc >> 8) ^ CrcTable[0][crc & 0xFF];
+    }
   } /* for */
 } /* GenerateCrc32Table */
 
 /* -------------------------------------------------------------------------
  * Function   : CalcCrc32
- * Description: Calculate CRC-32 according to CRC-32-IEEE 802.3
+ * Description: Calculate CRC-32 according to CRC-32-IEEE 802.3, using the
+ *              slice-by-8 algorithm
  * Input      : buffer - the bytes to calculate the CRC value over
  *              len - the number of bytes to calculate the CRC value over
  * Output     : none
@@ -118,12 +130,31 @@ static void GenerateCrc32Table(void)
  * ------------------------------------------------------------------------- */
 static u_int32_t CalcCrc32(unsigned char* buffer, ssize_t len)
 {
-  int i, j;
   u_int32_t crc = 0xffffffffUL;
-  for (i = 0; i < len; i++)
+
+  /* 8 bytes at a time, the bytes are combined in little-endian order
+   * independent of the byte order of the host */
+  while (len >= 8)
+  {
+    u_int32_t low = crc ^ (buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((u_int32_t) buffer[3] << 24));
+
+    crc =
+      CrcTable[7][low & 0xFF] ^
+      CrcTable[6][(low >> 8) & 0xFF] ^
+      CrcTable[5][(low >> 16) & 0xFF] ^
+      CrcTable[4][low >> 24] ^
+      CrcTable[3][buffer[4]] ^
+      CrcTable[2][buffer[5]] ^
+      CrcTable[1][buffer[6]] ^
+      CrcTable[0][buffer[7]];
+    buffer += 8;
+    len -= 8;
+  }
+
+  /* The remaining bytes one at a time */
+  while (len-- > 0)
   {
-    j = ((int) (crc & 0xFF) ^ *buffer++);
-    crc = (crc >> 8) ^ CrcTable[j];
+    crc = (crc >> 8) ^ CrcTable[0][(crc & 0xFF) ^ *buffer++];
   }
   return crc ^ 0xffffffffUL;
 } /* CalcCrc32 */
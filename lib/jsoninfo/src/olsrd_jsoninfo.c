@@ -594,7 +594,7 @@ void ipc_print_topology(struct autobuf *abuf) {
 
         // vertex_node
         abuf_json_ip_address(&json_session, abuf, "lastHopIP", &tc->addr);
-        // cand_tree_node
+        // spf_heap_pos
         abuf_json_float(&json_session, abuf, "pathCost", get_linkcost_scaled(tc->path_cost, true));
         // path_list_node
         // edge_tree
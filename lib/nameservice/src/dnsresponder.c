@@ -0,0 +1,522 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * A minimal DNS responder for the names of the mesh. It answers A, AAAA
+ * and PTR queries over UDP from the names that are also written to the
+ * hosts file, so no DNS server has to reload the file. Queries for other
+ * names get NXDOMAIN, recursion is not offered.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "defs.h"
+#include "olsr.h"
+#include "ipcalc.h"
+#include "scheduler.h"
+
+#include "nameservice.h"
+#include "dnsresponder.h"
+
+/* queries and answers over UDP without EDNS */
+#define DNS_MAX_PACKET 512
+#define DNS_HEADER_SIZE 12
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_PTR 12
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+#define DNS_CLASS_ANY 255
+
+#define DNS_RCODE_FORMERR 1
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_RCODE_NOTIMP 4
+#define DNS_RCODE_REFUSED 5
+
+/* a name with one of its addresses */
+struct dns_record {
+  union olsr_ip_addr ip;
+  char *name;                          /* lower case */
+  uint32_t name_hash;
+  int next_name;                       /* next record in the bucket of the name, -1 at the end */
+  int next_ip;                         /* next record in the bucket of the address */
+};
+
+static struct dns_record *records;
+static int record_count;
+static int record_size;
+
+/* hash buckets of the records by name and by address, rebuilt before a query after changes */
+static int *name_buckets;
+static int *ip_buckets;
+static unsigned int bucket_mask;
+static bool index_dirty;
+
+static int dns_socket = -1;
+
+/* FNV-1a */
+static uint32_t
+dns_hash(const void *data, size_t len)
+{
+  const uint8_t *p = data;
+  uint32_t hash = 2166136261u;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void
+dns_build_index(void)
+{
+  unsigned int buckets = 16;
+  int i;
+
+  while (buckets < 2 * (unsigned int)record_count) {
+    buckets <<= 1;
+  }
+
+  free(name_buckets);
+  free(ip_buckets);
+  name_buckets = olsr_malloc(buckets * sizeof(int), "DNS name buckets");
+  ip_buckets = olsr_malloc(buckets * sizeof(int), "DNS address buckets");
+  memset(name_buckets, 0xff, buckets * sizeof(int));
+  memset(ip_buckets, 0xff, buckets * sizeof(int));
+  bucket_mask = buckets - 1;
+
+  /* insert backwards, so a chain lists the records in the order of the hosts file */
+  for (i = record_count - 1; i >= 0; i--) {
+    unsigned int n = records[i].name_hash & bucket_mask;
+    unsigned int a = dns_hash(&records[i].ip, olsr_cnf->ipsize) & bucket_mask;
+
+    records[i].next_name = name_buckets[n];
+    name_buckets[n] = i;
+    records[i].next_ip = ip_buckets[a];
+    ip_buckets[a] = i;
+  }
+  index_dirty = false;
+}
+
+/**
+ * Removes all names, before the names are added again.
+ */
+void
+dns_responder_clear(void)
+{
+  int i;
+
+  for (i = 0; i < record_count; i++) {
+    free(records[i].name);
+  }
+  record_count = 0;
+  index_dirty = true;
+}
+
+/**
+ * Adds a name, the parts are concatenated.
+ */
+void
+dns_responder_add(const union olsr_ip_addr *ip, const char *prefix, const char *name, const char *suffix)
+{
+  struct dns_record *record;
+  char *p;
+  size_t len;
+
+  if (dns_socket < 0) {
+    return;
+  }
+
+  if (record_count == record_size) {
+    record_size = record_size ? record_size * 2 : 64;
+    records = olsr_realloc(records, record_size * sizeof(*records), "DNS records");
+  }
+  record = &records[record_count++];
+
+  len = strlen(prefix) + strlen(name) + strlen(suffix);
+  record->name = olsr_malloc(len + 1, "DNS name");
+  snprintf(record->name, len + 1, "%s%s%s", prefix, name, suffix);
+  for (p = record->name; *p; p++) {
+    *p = (char)tolower((unsigned char)*p);
+  }
+  record->name_hash = dns_hash(record->name, len);
+  record->ip = *ip;
+
+  index_dirty = true;
+}
+
+/*
+ * Reads the name of the question as a lower case dotted string.
+ * Returns the offset behind the name or -1.
+ */
+static int
+dns_read_qname(const uint8_t *pkt, int len, char *name, size_t size)
+{
+  int off = DNS_HEADER_SIZE;
+  size_t pos = 0;
+
+  while (off < len) {
+    int label = pkt[off++];
+
+    if (label == 0) {
+      name[pos] = '\0';
+      return off;
+    }
+    /* a question has no compression */
+    if (label > 63 || off + label > len || pos + label + 2 > size) {
+      return -1;
+    }
+    if (pos > 0) {
+      name[pos++] = '.';
+    }
+    while (label-- > 0) {
+      name[pos++] = (char)tolower(pkt[off++]);
+    }
+  }
+  return -1;
+}
+
+/* converts a name of in-addr.arpa or ip6.arpa to an address, false for other names */
+static bool
+dns_reverse_name(const char *name, union olsr_ip_addr *ip)
+{
+  size_t len = strlen(name);
+
+  memset(ip, 0, sizeof(*ip));
+  if (olsr_cnf->ip_version == AF_INET) {
+    unsigned int a, b, c, d;
+    char end;
+
+    if (len < 14 || strcmp(name + len - 13, ".in-addr.arpa") != 0) {
+      return false;
+    }
+    if (sscanf(name, "%u.%u.%u.%u.in-addr.arp%c", &d, &c, &b, &a, &end) != 5 || a > 255 || b > 255 || c > 255 || d > 255) {
+      return false;
+    }
+    ip->v4.s_addr = htonl(a << 24 | b << 16 | c << 8 | d);
+    return true;
+  } else {
+    int i;
+
+    /* 32 nibbles with a dot each */
+    if (len != 64 + 8 || strcmp(name + 64, "ip6.arpa") != 0) {
+      return false;
+    }
+    for (i = 0; i < 32; i++) {
+      char c = name[2 * i];
+      int nibble;
+
+      if (name[2 * i + 1] != '.' || !isxdigit((unsigned char)c)) {
+        return false;
+      }
+      nibble = isdigit((unsigned char)c) ? c - '0' : c - 'a' + 10;
+      ip->v6.s6_addr[15 - i / 2] |= (uint8_t)(i % 2 ? nibble << 4 : nibble);
+    }
+    return true;
+  }
+}
+
+/*
+ * Appends an answer for the name of the question. Returns false if it
+ * does not fit, which truncates the answer.
+ */
+static bool
+dns_add_answer(uint8_t *resp, int *len, uint16_t type, const void *rdata, int rdlen)
+{
+  uint8_t *p = resp + *len;
+
+  if (*len + 12 + rdlen > DNS_MAX_PACKET) {
+    resp[2] |= 0x02;
+    return false;
+  }
+
+  /* pointer to the name of the question */
+  p[0] = 0xc0;
+  p[1] = DNS_HEADER_SIZE;
+  p[2] = (uint8_t)(type >> 8);
+  p[3] = (uint8_t)type;
+  p[4] = 0;
+  p[5] = DNS_CLASS_IN;
+  p[6] = 0;
+  p[7] = 0;
+  p[8] = (uint8_t)(DNS_RESPONDER_TTL >> 8);
+  p[9] = (uint8_t)DNS_RESPONDER_TTL;
+  p[10] = (uint8_t)(rdlen >> 8);
+  p[11] = (uint8_t)rdlen;
+  memcpy(p + 12, rdata, rdlen);
+  *len += 12 + rdlen;
+
+  /* count it */
+  if (++resp[7] == 0) {
+    resp[6]++;
+  }
+  return true;
+}
+
+/* encodes a dotted name as labels, returns the length or -1 */
+static int
+dns_encode_name(const char *name, uint8_t *buf, int size)
+{
+  int len = 0;
+
+  while (*name) {
+    const char *dot = strchr(name, '.');
+    int label = dot ? (int)(dot - name) : (int)strlen(name);
+
+    if (label == 0 || label > 63 || len + label + 2 > size) {
+      return -1;
+    }
+    buf[len++] = (uint8_t)label;
+    memcpy(buf + len, name, label);
+    len += label;
+    name += label + (dot ? 1 : 0);
+  }
+  buf[len++] = 0;
+  return len;
+}
+
+/* answers a query, returns the length of the response or 0 to drop the query */
+static int
+dns_answer(const uint8_t *query, int len, uint8_t *resp)
+{
+  char qname[256];
+  union olsr_ip_addr ip;
+  uint16_t qtype, qclass;
+  int off, resp_len;
+  uint8_t rcode = 0;
+  bool found = false;
+  int i;
+
+  if (len < DNS_HEADER_SIZE || (query[2] & 0x80) != 0) {
+    /* not a query */
+    return 0;
+  }
+
+  memset(resp, 0, DNS_HEADER_SIZE);
+  resp[0] = query[0];
+  resp[1] = query[1];
+  /* response, same opcode, authoritative, recursion desired copied */
+  resp[2] = (uint8_t)(0x80 | (query[2] & 0x79) | 0x04);
+  resp_len = DNS_HEADER_SIZE;
+
+  if ((query[2] & 0x78) != 0) {
+    resp[3] = DNS_RCODE_NOTIMP;
+    return resp_len;
+  }
+  if (query[4] != 0 || query[5] != 1 || (off = dns_read_qname(query, len, qname, sizeof(qname))) < 0 || off + 4 > len) {
+    resp[3] = DNS_RCODE_FORMERR;
+    return resp_len;
+  }
+  qtype = (uint16_t)(query[off] << 8 | query[off + 1]);
+  qclass = (uint16_t)(query[off + 2] << 8 | query[off + 3]);
+  off += 4;
+
+  /* the question goes back */
+  memcpy(resp + DNS_HEADER_SIZE, query + DNS_HEADER_SIZE, off - DNS_HEADER_SIZE);
+  resp[5] = 1;
+  resp_len = off;
+
+  if (qclass != DNS_CLASS_IN && qclass != DNS_CLASS_ANY) {
+    resp[3] = DNS_RCODE_REFUSED;
+    return resp_len;
+  }
+
+  /* there is no index before the first hosts file was written */
+  if (index_dirty || name_buckets == NULL) {
+    dns_build_index();
+  }
+
+  if (dns_reverse_name(qname, &ip)) {
+    for (i = ip_buckets[dns_hash(&ip, olsr_cnf->ipsize) & bucket_mask]; i >= 0; i = records[i].next_ip) {
+      if (ipequal(&records[i].ip, &ip)) {
+        uint8_t rdata[256];
+        int rdlen;
+
+        found = true;
+        if (qtype != DNS_TYPE_PTR && qtype != DNS_TYPE_ANY) {
+          break;
+        }
+        /* the first name of an address */
+        rdlen = dns_encode_name(records[i].name, rdata, sizeof(rdata));
+        if (rdlen > 0) {
+          dns_add_answer(resp, &resp_len, DNS_TYPE_PTR, rdata, rdlen);
+          break;
+        }
+      }
+    }
+  } else {
+    uint16_t type = olsr_cnf->ip_version == AF_INET ? DNS_TYPE_A : DNS_TYPE_AAAA;
+    uint32_t hash = dns_hash(qname, strlen(qname));
+
+    for (i = name_buckets[hash & bucket_mask]; i >= 0; i = records[i].next_name) {
+      if (records[i].name_hash == hash && strcmp(records[i].name, qname) == 0) {
+        found = true;
+        if ((qtype == type || qtype == DNS_TYPE_ANY) && !dns_add_answer(resp, &resp_len, type, &records[i].ip, olsr_cnf->ipsize)) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (!found) {
+    rcode = DNS_RCODE_NXDOMAIN;
+  }
+  resp[3] = rcode;
+  return resp_len;
+}
+
+static void
+dns_input(int fd, void *data __attribute__ ((unused)), unsigned int flags __attribute__ ((unused)))
+{
+  uint8_t query[DNS_MAX_PACKET], resp[DNS_MAX_PACKET];
+  union olsr_sockaddr from;
+  socklen_t fromlen;
+  ssize_t len;
+  int resp_len;
+
+  for (;;) {
+    fromlen = sizeof(from);
+    len = recvfrom(fd, query, sizeof(query), 0, &from.in, &fromlen);
+    if (len < 0) {
+      if (errno != EWOULDBLOCK && errno != EINTR) {
+        OLSR_PRINTF(1, "NAME PLUGIN: DNS receive error: %s\n", strerror(errno));
+      }
+      return;
+    }
+
+    resp_len = dns_answer(query, (int)len, resp);
+    if (resp_len > 0 && sendto(fd, resp, resp_len, 0, &from.in, fromlen) < 0) {
+      OLSR_PRINTF(2, "NAME PLUGIN: DNS send error: %s\n", strerror(errno));
+    }
+  }
+}
+
+/**
+ * Opens the socket of the responder.
+ *
+ * @param address address to listen on, the loopback address if zero
+ * @param port UDP port
+ * @return 0 on success, -1 on an error
+ */
+int
+dns_responder_init(const union olsr_ip_addr *address, int port)
+{
+  union olsr_sockaddr addr;
+  socklen_t addrlen;
+  int yes = 1;
+
+  memset(&addr, 0, sizeof(addr));
+  if (olsr_cnf->ip_version == AF_INET) {
+    addr.in4.sin_family = AF_INET;
+    addr.in4.sin_port = htons(port);
+    addr.in4.sin_addr.s_addr = address->v4.s_addr ? address->v4.s_addr : htonl(INADDR_LOOPBACK);
+    addrlen = sizeof(addr.in4);
+  } else {
+    addr.in6.sin6_family = AF_INET6;
+    addr.in6.sin6_port = htons(port);
+    addr.in6.sin6_addr = ipequal(address, &olsr_ip_zero) ? in6addr_loopback : address->v6;
+    addrlen = sizeof(addr.in6);
+  }
+
+  dns_socket = socket(olsr_cnf->ip_version, SOCK_DGRAM, 0);
+  if (dns_socket < 0) {
+    OLSR_PRINTF(0, "NAME PLUGIN: can't create the DNS socket: %s\n", strerror(errno));
+    return -1;
+  }
+  if (setsockopt(dns_socket, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0
+      || bind(dns_socket, &addr.in, addrlen) < 0
+      || fcntl(dns_socket, F_SETFL, fcntl(dns_socket, F_GETFL) | O_NONBLOCK) < 0) {
+    OLSR_PRINTF(0, "NAME PLUGIN: can't bind the DNS socket to port %d: %s\n", port, strerror(errno));
+    close(dns_socket);
+    dns_socket = -1;
+    return -1;
+  }
+
+  index_dirty = true;
+  add_olsr_socket(dns_socket, NULL, &dns_input, NULL, SP_IMM_READ);
+  return 0;
+}
+
+/**
+ * Closes the socket and frees the names.
+ */
+void
+dns_responder_exit(void)
+{
+  if (dns_socket >= 0) {
+    remove_olsr_socket(dns_socket, NULL, &dns_input);
+    close(dns_socket);
+    dns_socket = -1;
+  }
+
+  dns_responder_clear();
+  free(records);
+  records = NULL;
+  record_size = 0;
+  free(name_buckets);
+  free(ip_buckets);
+  name_buckets = ip_buckets = NULL;
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-indent-tabs-mode: t
+ * c-basic-offset: 4
+ * tab-width: 4
+ * End:
+ */
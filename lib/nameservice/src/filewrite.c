@@ -0,0 +1,160 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "defs.h"
+
+#include "filewrite.h"
+
+/* FNV-1a */
+static uint32_t
+file_hash(const char *buf, int len)
+{
+  uint32_t hash = 2166136261u;
+  int i;
+
+  for (i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)buf[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/* writes all of buf, false on an error */
+static bool
+file_write_all(int fd, const char *buf, size_t len)
+{
+  while (len > 0) {
+    ssize_t written = write(fd, buf, len);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    buf += written;
+    len -= (size_t)written;
+  }
+  return true;
+}
+
+/**
+ * Replaces a file with new content, unless the content did not change
+ * since the last call. The file is written to a temporary file next to it
+ * which is then renamed, so readers never see a partial file. A line with
+ * the time of writing is appended to the content, it does not count as a
+ * change.
+ *
+ * @param path the file, nothing is written for an empty path
+ * @param state the state of the file, updated when the file was written
+ * @param content the new content, the timestamp is appended to it
+ * @return 1 if the file was written, 0 if the content did not change
+ *   or there is no file, -1 on an error
+ */
+int
+file_update(const char *path, struct file_state *state, struct autobuf *content)
+{
+  char tmp_path[FILENAME_MAX];
+  uint32_t hash;
+  time_t currtime;
+  int fd;
+
+  if (*path == '\0') {
+    return 0;
+  }
+  hash = file_hash(content->buf, content->len);
+  if (state->valid && state->hash == hash) {
+    return 0;
+  }
+
+  if (time(&currtime) && abuf_appendf(content, "\n### written by olsrd at %s", ctime(&currtime)) < 0) {
+    return -1;
+  }
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    OLSR_PRINTF(2, "NAME PLUGIN: can't create %s: %s\n", tmp_path, strerror(errno));
+    return -1;
+  }
+  if (!file_write_all(fd, content->buf, (size_t)content->len) || fsync(fd) < 0) {
+    OLSR_PRINTF(2, "NAME PLUGIN: can't write %s: %s\n", tmp_path, strerror(errno));
+    close(fd);
+    unlink(tmp_path);
+    return -1;
+  }
+  close(fd);
+
+#ifdef _WIN32
+  /* rename() does not replace an existing file */
+  unlink(path);
+#endif /* _WIN32 */
+  if (rename(tmp_path, path) < 0) {
+    OLSR_PRINTF(2, "NAME PLUGIN: can't rename %s to %s: %s\n", tmp_path, path, strerror(errno));
+    unlink(tmp_path);
+    return -1;
+  }
+
+  state->valid = true;
+  state->hash = hash;
+  return 1;
+}
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-indent-tabs-mode: t
+ * c-basic-offset: 4
+ * tab-width: 4
+ * End:
+ */
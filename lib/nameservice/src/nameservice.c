@@ -76,6 +76,8 @@
 #include "plugin_util.h"
 #include "nameservice.h"
 #include "mapwrite.h"
+#include "filewrite.h"
+#include "dnsresponder.h"
 #include "compat.h"
 
 /* true if plugin has been configured */
@@ -97,6 +99,9 @@ static char my_services_change_script[MAX_FILE + 1];
 static char my_macs_change_script[MAX_FILE + 1];
 static char latlon_in_file[MAX_FILE + 1];
 static char my_latlon_file[MAX_FILE + 1];
+static int my_reload_interval = RELOAD_INTERVAL;
+static int my_dns_port = 0;
+static union olsr_ip_addr my_dns_address;
 float my_lat = 0.0, my_lon = 0.0;
 
 /* the databases (using hashing)
@@ -131,6 +136,16 @@ struct timer_entry *write_file_timer = NULL;
 /* periodic message generation */
 struct timer_entry *msg_gen_timer = NULL;
 
+/* what was written last into the files */
+static struct file_state hosts_file_state;
+static struct file_state services_file_state;
+static struct file_state macs_file_state;
+static struct file_state resolv_file_state;
+
+/* reloads after a change of the hosts file are paced by reload-interval */
+static struct timer_entry *reload_timer = NULL;
+static uint32_t next_reload_time = 0;
+
 /* regular expression to be matched by valid hostnames, compiled in name_init() */
 static regex_t regex_t_name;
 static regmatch_t regmatch_t_name;
@@ -280,6 +295,9 @@ static const struct olsrd_plugin_parameters plugin_parameters[] = {
   { .name = "lat",                    .set_plugin_parameter = &set_nameservice_float,  .data = &my_lat },
   { .name = "lon",                    .set_plugin_parameter = &set_nameservice_float,  .data = &my_lon },
   { .name = "latlon-file",            .set_plugin_parameter = &set_plugin_string,      .data = &my_latlon_file,            .addon = {sizeof(my_latlon_file)} },
+  { .name = "reload-interval",        .set_plugin_parameter = &set_plugin_int,         .data = &my_reload_interval },
+  { .name = "dns-port",               .set_plugin_parameter = &set_plugin_port,        .data = &my_dns_port },
+  { .name = "dns-address",            .set_plugin_parameter = &set_plugin_ipaddress,   .data = &my_dns_address },
   { .name = "latlon-infile",          .set_plugin_parameter = &set_plugin_string,      .data = &latlon_in_file,            .addon = {sizeof(latlon_in_file)} },
   { .name = "dns-server",             .set_plugin_parameter = &set_nameservice_server, .data = &my_forwarders,             .addon = {NAME_FORWARDER} },
   { .name = "name",                   .set_plugin_parameter = &set_nameservice_name,   .data = &my_names,                  .addon = {NAME_HOST} },
@@ -339,6 +357,11 @@ name_init(void)
   /* periodic message generation */
   msg_gen_timer = olsr_start_timer(my_interval * MSEC_PER_SEC, EMISSION_JITTER, OLSR_TIMER_PERIODIC, &olsr_namesvc_gen, NULL, 0);
 
+  /* serve the names without a hosts file */
+  if (my_dns_port != 0 && dns_responder_init(&my_dns_address, my_dns_port) < 0) {
+    my_dns_port = 0;
+  }
+
   return 1;
 }
 
@@ -505,6 +528,11 @@ name_destructor(void)
 
   olsr_stop_timer(write_file_timer);
   olsr_stop_timer(msg_gen_timer);
+  olsr_stop_timer(reload_timer);
+
+  if (my_dns_port != 0) {
+    dns_responder_exit();
+  }
 
   regfree(&regex_t_name);
   regfree(&regex_t_service);
@@ -1058,8 +1086,70 @@ send_sighup_to_pidfile(char *pid_file)
 }
 #endif /* _WIN32 */
 
+/**
+ * Signals the name server and runs the name-change-script after the
+ * hosts file changed.
+ */
+static void
+name_reload(void *context __attribute__ ((unused)))
+{
+  reload_timer = NULL;
+  next_reload_time = GET_TIMESTAMP(my_reload_interval * MSEC_PER_SEC);
+
+#ifndef _WIN32
+  if (*my_sighup_pid_file)
+    send_sighup_to_pidfile(my_sighup_pid_file);
+#endif /* _WIN32 */
+
+  // Executes my_name_change_script after writing the hosts file
+  if (my_name_change_script[0] != '\0') {
+    if (system(my_name_change_script) != -1) {
+      OLSR_PRINTF(2, "NAME PLUGIN: Name changed, %s executed\n", my_name_change_script);
+    } else {
+      OLSR_PRINTF(2, "NAME PLUGIN: WARNING! Failed to execute %s on hosts change\n", my_name_change_script);
+    }
+  }
+}
+
+/*
+ * Reloads at most once per reload-interval, a change within the
+ * interval is reloaded when it ends.
+ */
+static void
+name_schedule_reload(void)
+{
+  if (reload_timer) {
+    /* the pending reload covers this change */
+    return;
+  }
+
+  if (next_reload_time != 0 && !TIMED_OUT(next_reload_time)) {
+    reload_timer = olsr_start_timer(TIME_DUE(next_reload_time), 0, OLSR_TIMER_ONESHOT, &name_reload, NULL, 0);
+    return;
+  }
+
+  name_reload(NULL);
+}
+
+/* adds a line to the hosts file and the name to the DNS responder */
+static void
+hosts_add_name(struct autobuf *hosts, const union olsr_ip_addr *ip, const char *prefix, const char *name, const char *comment)
+{
+  struct ipaddr_str strbuf;
+
+  olsr_ip_to_string(&strbuf, ip);
+  OLSR_PRINTF(6, "%s\t%s%s%s\t# %s\n", strbuf.buf, prefix, name, my_suffix, comment);
+
+  abuf_appendf(hosts, "%s\t%s%s%s\t# %s\n", strbuf.buf, prefix, name, my_suffix, comment);
+  if (my_dns_port != 0) {
+    dns_responder_add(ip, prefix, name, my_suffix);
+  }
+}
+
 /**
  * write names to a file in /etc/hosts compatible format
+ *
+ * The file is built in memory and only replaced if the names changed.
  */
 void
 write_hosts_file(void)
@@ -1068,10 +1158,11 @@ write_hosts_file(void)
   struct name_entry *name;
   struct db_entry *entry;
   struct list_node *list_head, *list_node;
-  FILE *hosts;
+  struct autobuf hosts;
   FILE *add_hosts;
-  int c = 0;
-  time_t currtime;
+  char buf[1024];
+  size_t len;
+  int ret;
 
 #ifdef MID_ENTRIES
   struct mid_address *alias;
@@ -1082,17 +1173,19 @@ write_hosts_file(void)
 
   OLSR_PRINTF(2, "NAME PLUGIN: writing hosts file\n");
 
-  hosts = fopen(my_hosts_file, "w");
-  if (hosts == NULL) {
+  if (abuf_init(&hosts, 0) < 0) {
     OLSR_PRINTF(2, "NAME PLUGIN: cant write hosts file\n");
     return;
   }
+  if (my_dns_port != 0) {
+    dns_responder_clear();
+  }
 
-  fprintf(hosts, "### this /etc/hosts file is overwritten regularly by olsrd\n");
-  fprintf(hosts, "### do not edit\n\n");
+  abuf_puts(&hosts, "### this /etc/hosts file is overwritten regularly by olsrd\n");
+  abuf_puts(&hosts, "### do not edit\n\n");
 
-  fprintf(hosts, "127.0.0.1\tlocalhost\n");
-  fprintf(hosts, "::1\t\tlocalhost\n\n");
+  abuf_puts(&hosts, "127.0.0.1\tlocalhost\n");
+  abuf_puts(&hosts, "::1\t\tlocalhost\n\n");
 
   // copy content from additional hosts filename
   if (my_add_hosts[0] != '\0') {
@@ -1100,17 +1193,16 @@ write_hosts_file(void)
     if (add_hosts == NULL) {
       OLSR_PRINTF(2, "NAME PLUGIN: cant open additional hosts file\n");
     } else {
-      fprintf(hosts, "### contents from '%s' ###\n\n", my_add_hosts);
-      while ((c = getc(add_hosts)) != EOF)
-        putc(c, hosts);
+      abuf_appendf(&hosts, "### contents from '%s' ###\n\n", my_add_hosts);
+      while ((len = fread(buf, 1, sizeof(buf), add_hosts)) > 0)
+        abuf_memcpy(&hosts, buf, len);
       fclose(add_hosts);
     }
-    fprintf(hosts, "\n### olsr names ###\n\n");
+    abuf_puts(&hosts, "\n### olsr names ###\n\n");
   }
   // write own names
   for (name = my_names; name != NULL; name = name->next) {
-    struct ipaddr_str strbuf;
-    fprintf(hosts, "%s\t%s%s\t# myself\n", olsr_ip_to_string(&strbuf, &name->ip), name->name, my_suffix);
+    hosts_add_name(&hosts, &name->ip, "", name->name, "myself");
   }
 
   // write received names
@@ -1121,28 +1213,24 @@ write_hosts_file(void)
       entry = list2db(list_node);
 
       for (name = entry->names; name != NULL; name = name->next) {
-        struct ipaddr_str strbuf1, strbuf2;
-        OLSR_PRINTF(6, "%s\t%s%s\t#%s\n", olsr_ip_to_string(&strbuf1, &name->ip), name->name, my_suffix,
-                    olsr_ip_to_string(&strbuf2, &entry->originator));
+        struct ipaddr_str strbuf;
+        olsr_ip_to_string(&strbuf, &entry->originator);
 
-        fprintf(hosts, "%s\t%s%s\t# %s\n", olsr_ip_to_string(&strbuf1, &name->ip), name->name, my_suffix,
-                olsr_ip_to_string(&strbuf2, &entry->originator));
+        hosts_add_name(&hosts, &name->ip, "", name->name, strbuf.buf);
 
 #ifdef MID_ENTRIES
         // write mid entries
         if ((alias = mid_lookup_aliases(&name->ip)) != NULL) {
           unsigned short mid_num = 1;
           char mid_prefix[MID_MAXLEN];
+          char comment[sizeof(strbuf.buf) + 16];
 
           while (alias != NULL) {
             // generate mid prefix
             sprintf(mid_prefix, MID_PREFIX, mid_num);
+            snprintf(comment, sizeof(comment), "%s (mid #%i)", strbuf.buf, mid_num);
 
-            OLSR_PRINTF(6, "%s\t%s%s%s\t# %s (mid #%i)\n", olsr_ip_to_string(&strbuf1, &alias->alias), mid_prefix, name->name,
-                        my_suffix, olsr_ip_to_string(&strbuf2, &entry->originator), mid_num);
-
-            fprintf(hosts, "%s\t%s%s%s\t# %s (mid #%i)\n", olsr_ip_to_string(&strbuf1, &alias->alias), mid_prefix, name->name,
-                    my_suffix, olsr_ip_to_string(&strbuf2, &entry->originator), mid_num);
+            hosts_add_name(&hosts, &alias->alias, mid_prefix, name->name, comment);
 
             alias = alias->next_alias;
             mid_num++;
@@ -1153,25 +1241,19 @@ write_hosts_file(void)
     }
   }
 
-  if (time(&currtime)) {
-    fprintf(hosts, "\n### written by olsrd at %s", ctime(&currtime));
+  ret = file_update(my_hosts_file, &hosts_file_state, &hosts);
+  abuf_free(&hosts);
+  if (ret < 0) {
+    /* try again later */
+    olsr_start_write_file_timer();
+    return;
   }
 
-  fclose(hosts);
-
-#ifndef _WIN32
-  if (*my_sighup_pid_file)
-    send_sighup_to_pidfile(my_sighup_pid_file);
-#endif /* _WIN32 */
   name_table_changed = false;
-
-  // Executes my_name_change_script after writing the hosts file
-  if (my_name_change_script[0] != '\0') {
-    if (system(my_name_change_script) != -1) {
-      OLSR_PRINTF(2, "NAME PLUGIN: Name changed, %s executed\n", my_name_change_script);
-    } else {
-      OLSR_PRINTF(2, "NAME PLUGIN: WARNING! Failed to execute %s on hosts change\n", my_name_change_script);
-    }
+  if (ret > 0) {
+    name_schedule_reload();
+  } else {
+    OLSR_PRINTF(2, "NAME PLUGIN: hosts unchanged\n");
   }
 }
 
@@ -1192,26 +1274,25 @@ write_services_file(bool writemacs)
   struct name_entry *name;
   struct db_entry *entry;
   struct list_node *list_head, *list_node;
-  FILE *file;
-  time_t currtime;
+  struct autobuf file;
+  int ret;
 
   if ((writemacs && !mac_table_changed) || (!writemacs && !service_table_changed))
     return;
 
   OLSR_PRINTF(2, "NAME PLUGIN: writing %s file\n", writemacs ? "macs" : "services");
 
-  file = fopen(writemacs ? my_macs_file : my_services_file, "w");
-  if (file == NULL) {
+  if (abuf_init(&file, 0) < 0) {
     OLSR_PRINTF(2, "NAME PLUGIN: cant write %s\n", writemacs ? my_macs_file : my_services_file);
     return;
   }
 
-  fprintf(file, "### this file is overwritten regularly by olsrd\n");
-  fprintf(file, "### do not edit\n\n");
+  abuf_puts(&file, "### this file is overwritten regularly by olsrd\n");
+  abuf_puts(&file, "### do not edit\n\n");
 
   // write own services or macs
   for (name = writemacs ? my_macs : my_services; name != NULL; name = name->next) {
-    fprintf(file, "%s\t# my own %s\n", name->name, writemacs ? "mac" : "service");
+    abuf_appendf(&file, "%s\t# my own %s\n", name->name, writemacs ? "mac" : "service");
   }
 
   // write received services or macs
@@ -1226,20 +1307,22 @@ write_services_file(bool writemacs)
         OLSR_PRINTF(6, "%s\t", name->name);
         OLSR_PRINTF(6, "\t#%s\n", olsr_ip_to_string(&strbuf, &entry->originator));
 
-        fprintf(file, "%s\t", name->name);
-        fprintf(file, "\t#%s\n", olsr_ip_to_string(&strbuf, &entry->originator));
+        abuf_appendf(&file, "%s\t\t#%s\n", name->name, olsr_ip_to_string(&strbuf, &entry->originator));
       }
     }
   }
 
-  if (time(&currtime)) {
-    fprintf(file, "\n### written by olsrd at %s", ctime(&currtime));
+  ret = file_update(writemacs ? my_macs_file : my_services_file, writemacs ? &macs_file_state : &services_file_state, &file);
+  abuf_free(&file);
+  if (ret < 0) {
+    /* try again later */
+    olsr_start_write_file_timer();
+    return;
   }
 
-  fclose(file);
   if (writemacs) {
     // Executes my_macs_change_script after writing the macs file
-    if (my_macs_change_script[0] != '\0') {
+    if (ret > 0 && my_macs_change_script[0] != '\0') {
       if (system(my_macs_change_script) != -1) {
         OLSR_PRINTF(2, "NAME PLUGIN: Service changed, %s executed\n", my_macs_change_script);
       } else {
@@ -1250,7 +1333,7 @@ write_services_file(bool writemacs)
   }
   else {
     // Executes my_services_change_script after writing the services file
-    if (my_services_change_script[0] != '\0') {
+    if (ret > 0 && my_services_change_script[0] != '\0') {
       if (system(my_services_change_script) != -1) {
         OLSR_PRINTF(2, "NAME PLUGIN: Service changed, %s executed\n", my_services_change_script);
       } else {
@@ -1261,40 +1344,45 @@ write_services_file(bool writemacs)
   }
 }
 
+/* a nameserver with the route to it, which may be the route to its network */
+struct nameserver {
+  struct rt_entry *route;
+  union olsr_ip_addr ip;
+};
+
 /**
- * Sort the nameserver pointer array.
+ * Sort the nameserver array.
  *
  * fresh entries are at the beginning of the array and
  * the best entry is at the end of the array.
  */
 static void
-select_best_nameserver(struct rt_entry **rt)
+select_best_nameserver(struct nameserver *ns)
 {
   int nameserver_idx;
-  struct rt_entry *rt1, *rt2;
+  struct nameserver ns1;
 
   for (nameserver_idx = 0; nameserver_idx < NAMESERVER_COUNT; nameserver_idx++) {
 
-    rt1 = rt[nameserver_idx];
-    rt2 = rt[nameserver_idx + 1];
+    ns1 = ns[nameserver_idx];
 
     /*
-     * compare the next two pointers in the array.
-     * if the second pointer is NULL then percolate it up.
+     * compare the next two routes in the array.
+     * if the second route is NULL then percolate it up.
      */
-    if (!rt2 || olsr_cmp_rt(rt1, rt2)) {
+    if (!ns[nameserver_idx + 1].route || olsr_cmp_rt(ns1.route, ns[nameserver_idx + 1].route)) {
 #ifndef NODEBUG
       struct ipaddr_str strbuf;
       struct lqtextbuffer lqbuffer;
 #endif /* NODEBUG */
       /*
-       * first is better, swap the pointers.
+       * first is better, swap the entries.
        */
-      OLSR_PRINTF(6, "NAME PLUGIN: nameserver %s, cost %s\n", olsr_ip_to_string(&strbuf, &rt1->rt_dst.prefix),
-                  get_linkcost_text(rt1->rt_best->rtp_metric.cost, true, &lqbuffer));
+      OLSR_PRINTF(6, "NAME PLUGIN: nameserver %s, cost %s\n", olsr_ip_to_string(&strbuf, &ns1.ip),
+                  get_linkcost_text(ns1.route->rt_best->rtp_metric.cost, true, &lqbuffer));
 
-      rt[nameserver_idx] = rt2;
-      rt[nameserver_idx + 1] = rt1;
+      ns[nameserver_idx] = ns[nameserver_idx + 1];
+      ns[nameserver_idx + 1] = ns1;
     }
   }
 }
@@ -1311,16 +1399,15 @@ write_resolv_file(void)
   struct db_entry *entry;
   struct list_node *list_head, *list_node;
   struct rt_entry *route;
-  static struct rt_entry *nameserver_routes[NAMESERVER_COUNT + 1];
-  FILE *resolv;
+  static struct nameserver nameservers[NAMESERVER_COUNT + 1];
+  struct autobuf resolv;
   int i = 0;
-  time_t currtime;
 
   if (!forwarder_table_changed || my_forwarders != NULL || my_resolv_file[0] == '\0')
     return;
 
-  /* clear the array of 3+1 nameserver routes */
-  memset(nameserver_routes, 0, sizeof(nameserver_routes));
+  /* clear the array of 3+1 nameservers */
+  memset(nameservers, 0, sizeof(nameservers));
 
   for (hash = 0; hash < HASHSIZE; hash++) {
     list_head = &forwarder_list[hash];
@@ -1333,7 +1420,8 @@ write_resolv_file(void)
         struct ipaddr_str strbuf;
         struct lqtextbuffer lqbuffer;
 #endif /* NODEBUG */
-        route = olsr_lookup_routing_table(&name->ip);
+        /* the nameserver may be part of an announced network */
+        route = olsr_lookup_routing_table_lpm(&name->ip);
 
         OLSR_PRINTF(6, "NAME PLUGIN: check route for nameserver %s %s", olsr_ip_to_string(&strbuf, &name->ip),
                     route ? "suceeded" : "failed");
@@ -1342,49 +1430,47 @@ write_resolv_file(void)
           continue;
 
         /* enqueue it on the head of list */
-        *nameserver_routes = route;
+        nameservers[0].route = route;
+        nameservers[0].ip = name->ip;
         OLSR_PRINTF(6, "NAME PLUGIN: found nameserver %s, cost %s", olsr_ip_to_string(&strbuf, &name->ip),
                     get_linkcost_text(route->rt_best->rtp_metric.cost, true, &lqbuffer));
 
         /* find the closet one */
-        select_best_nameserver(nameserver_routes);
+        select_best_nameserver(nameservers);
       }
     }
   }
 
   /* if there is no best route we are done */
-  if (nameserver_routes[NAMESERVER_COUNT] == NULL)
+  if (nameservers[NAMESERVER_COUNT].route == NULL)
     return;
 
   /* write to file */
   OLSR_PRINTF(2, "NAME PLUGIN: try to write to resolv file\n");
-  resolv = fopen(my_resolv_file, "w");
-  if (resolv == NULL) {
+  if (abuf_init(&resolv, 0) < 0) {
     OLSR_PRINTF(2, "NAME PLUGIN: can't write resolv file\n");
     return;
   }
-  fprintf(resolv, "### this file is overwritten regularly by olsrd\n");
-  fprintf(resolv, "### do not edit\n\n");
+  abuf_puts(&resolv, "### this file is overwritten regularly by olsrd\n");
+  abuf_puts(&resolv, "### do not edit\n\n");
 
   for (i = NAMESERVER_COUNT; i >= 0; i--) {
     struct ipaddr_str strbuf;
 
-    route = nameserver_routes[i];
-
-    OLSR_PRINTF(2, "NAME PLUGIN: nameserver_routes #%d %p\n", i, route);
+    OLSR_PRINTF(2, "NAME PLUGIN: nameserver_routes #%d %p\n", i, nameservers[i].route);
 
-    if (!route) {
+    if (!nameservers[i].route) {
       continue;
     }
 
-    OLSR_PRINTF(2, "NAME PLUGIN: nameserver %s\n", olsr_ip_to_string(&strbuf, &route->rt_dst.prefix));
-    fprintf(resolv, "nameserver %s\n", olsr_ip_to_string(&strbuf, &route->rt_dst.prefix));
+    /* the route may lead to the network of the nameserver, print its own address */
+    OLSR_PRINTF(2, "NAME PLUGIN: nameserver %s\n", olsr_ip_to_string(&strbuf, &nameservers[i].ip));
+    abuf_appendf(&resolv, "nameserver %s\n", olsr_ip_to_string(&strbuf, &nameservers[i].ip));
   }
-  if (time(&currtime)) {
-    fprintf(resolv, "\n### written by olsrd at %s", ctime(&currtime));
+  if (file_update(my_resolv_file, &resolv_file_state, &resolv) >= 0) {
+    forwarder_table_changed = false;
   }
-  fclose(resolv);
-  forwarder_table_changed = false;
+  abuf_free(&resolv);
 }
 
 /**
@@ -76,6 +76,7 @@
 #define EMISSION_INTERVAL	120     /* seconds */
 #define EMISSION_JITTER         25      /* percent */
 #define NAME_VALID_TIME		1800    /* seconds */
+#define RELOAD_INTERVAL         10      /* seconds */
 #define NAMESERVER_COUNT        3
 
 #define NAME_PROTOCOL_VERSION	1
@@ -76,6 +76,7 @@
 #include "link_set.h"           /* get_best_link_to_neighbor() */
 #include "net_olsr.h"           /* ipequal */
 #include "parser.h"
+#include "scheduler.h"          /* now_times, olsr_start_timer() */
 
 /* plugin includes */
 #include "NetworkInterfaces.h"  /* NonOlsrInterface,
@@ -96,10 +97,19 @@ int P2pdDuplicateTimeout           = P2PD_VALID_TIME;
 /* List of UDP destination address and port information */
 struct UdpDestPort *                 UdpDestPortList = NULL;
 
-/* List of filter entries to check for duplicate messages
+/* Table of filter entries to check for duplicate messages
  */
-struct node *                        dupFilterHead = NULL;
-struct node *                        dupFilterTail = NULL;
+static struct DupFilterEntry         dupFilter[P2PD_DUP_CAPACITY];
+
+/* Number of live entries stored in each time bucket, indexed modulo
+ * P2PD_DUP_BUCKETS, and the current bucket
+ */
+static uint32_t                      dupFilterCount[P2PD_DUP_BUCKETS];
+static uint32_t                      dupFilterBucket = 0;
+
+struct DupFilterStats                DupFilterStats;
+
+static struct timer_entry *          dupFilterStatsTimer = NULL;
 
 bool is_broadcast(const struct sockaddr_in addr);
 bool is_multicast(const struct sockaddr_in addr);
@@ -291,124 +301,168 @@ int HighestSkfd = -1;
 fd_set InputSet;
 
 /* -------------------------------------------------------------------------
- * Function   : p2pd_message_seen
- * Description: Check whether the current message has been seen before
- * Input      : head - start of the list to check for the message
- *              tail - end of the list to check for the message
- *              m    - message to check for in the list
+ * Function   : p2pd_dup_advance
+ * Description: Move the filter to the time bucket of now, the entries of
+ *              the buckets which fell out of the ring are expired
+ * Input      : none
  * Output     : none
- * Return     : true if message was found, false otherwise
- * Data Used  : P2pdDuplicateTimeout
+ * Return     : the current time bucket
+ * Data Used  : P2pdDuplicateTimeout, dupFilterCount, dupFilterBucket
  * ------------------------------------------------------------------------- */
-bool
-p2pd_message_seen(struct node **head, struct node **tail, union olsr_message *m)
+static uint32_t
+p2pd_dup_advance(void)
 {
-  struct node * curr;
-  time_t now;
-
-  now = time(NULL);
-
-  // Check whether any entries have aged
-  curr = *head;
-  while (curr) {
-    struct DupFilterEntry *filter;
-    struct node * next = curr->next; // Save the current pointer since curr may
-                                     // be destroyed
-
-    filter = (struct DupFilterEntry*)curr->data;
-
-    if ((filter->creationtime + P2pdDuplicateTimeout) < now)
-      remove_node(head, tail, curr, true);
-
-    // Skip to the next element
-    curr = next;
-  }
-
-  // Now check whether there are any duplicates
-  for (curr = *head; curr; curr = curr->next) {
-    struct DupFilterEntry *filter = (struct DupFilterEntry*)curr->data;
-
-    if (olsr_cnf->ip_version == AF_INET) {
-      if (filter->address.v4.s_addr == m->v4.originator &&
-          filter->msgtype == m->v4.olsr_msgtype &&
-          filter->seqno == m->v4.seqno) {
-          return true;
-      }
-    } else /* if (olsr_cnf->ip_version == AF_INET6) */ {
-      if (memcmp(filter->address.v6.s6_addr,
-                 m->v6.originator.s6_addr,
-                 sizeof(m->v6.originator.s6_addr)) == 0 &&
-          filter->msgtype == m->v6.olsr_msgtype &&
-          filter->seqno == m->v6.seqno) {
-          return true;
-      }
+  uint32_t bucketMsec, current;
+
+  /* The ring spans at least the duplicate timeout */
+  bucketMsec = (uint32_t)P2pdDuplicateTimeout * MSEC_PER_SEC / (P2PD_DUP_BUCKETS - 1);
+  if (bucketMsec == 0)
+    bucketMsec = 1;
+  current = now_times / bucketMsec;
+
+  if (current - dupFilterBucket >= P2PD_DUP_BUCKETS) {
+    /* All buckets expired, also catches the clock wrapping */
+    memset(dupFilterCount, 0, sizeof(dupFilterCount));
+    DupFilterStats.entries = 0;
+  } else {
+    while (dupFilterBucket != current) {
+      dupFilterBucket++;
+      DupFilterStats.entries -= dupFilterCount[dupFilterBucket % P2PD_DUP_BUCKETS];
+      dupFilterCount[dupFilterBucket % P2PD_DUP_BUCKETS] = 0;
     }
   }
-
-  return false;
+  dupFilterBucket = current;
+  return current;
 }
 
 /* -------------------------------------------------------------------------
- * Function   : p2pd_store_message
- * Description: Store a new message in the duplicate message check list
- * Input      : head - start of the list to add the message to
- *              tail - end of the list to add the message to
- *              m    - message to add to the list
+ * Function   : p2pd_dup_hash
+ * Description: Hash the key of a duplicate filter entry
+ * Input      : addr    - originator of the message
+ *              msgtype - type of the message
+ *              seqno   - sequence number of the message
  * Output     : none
- * Return     : nothing
- * Data Used  : none
+ * Return     : hash value
+ * Data Used  : olsr_cnf
  * ------------------------------------------------------------------------- */
-void
-p2pd_store_message(struct node **head, struct node **tail, union olsr_message *m)
+static uint32_t
+p2pd_dup_hash(const union olsr_ip_addr *addr, uint8_t msgtype, uint16_t seqno)
 {
-  time_t now;
+  uint32_t hash = ((uint32_t)msgtype << 16) | seqno;
+  unsigned int i;
 
-  // Store a message into the database
-  struct DupFilterEntry *new_dup = calloc(1, sizeof(struct DupFilterEntry));
-  if (new_dup == NULL) {
-    OLSR_PRINTF(1, "%s: Out of memory\n", PLUGIN_NAME_SHORT);
-    return;
-  }
+  for (i = 0; i < olsr_cnf->ipsize; i += sizeof(uint32_t)) {
+    uint32_t word;
 
-  now = time(NULL);
-
-  new_dup->creationtime = now;
-  if (olsr_cnf->ip_version == AF_INET) {
-    new_dup->address.v4.s_addr = m->v4.originator;
-    new_dup->msgtype           = m->v4.olsr_msgtype;
-    new_dup->seqno             = m->v4.seqno;
-  } else /* if (olsr_cnf->ip_version == AF_INET6) */ {
-    memcpy(new_dup->address.v6.s6_addr,
-           m->v6.originator.s6_addr,
-           sizeof(m->v6.originator.s6_addr));
-    new_dup->msgtype           = m->v6.olsr_msgtype;
-    new_dup->seqno             = m->v6.seqno;
+    memcpy(&word, (const uint8_t *)addr + i, sizeof(word));
+    hash = (hash * 0x9e3779b1) ^ word;
   }
 
-  // Add the element to the head of the list
-  append_node(head, tail, new_dup);
+  /* Mix all bits into the low ones used as index */
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  return hash ^ (hash >> 16);
 }
 
 /* -------------------------------------------------------------------------
  * Function   : p2pd_is_duplicate_message
- * Description: Check whether the specified message is a duplicate
- * Input      : msg - message to check for in the list of duplicate messages
+ * Description: Check whether the specified message is a duplicate, and
+ *              store it in the filter if it is not
+ * Input      : msg - message to check for in the duplicate filter
  * Output     : none
  * Return     : true if message was found, false otherwise
- * Data Used  : none
+ * Data Used  : dupFilter, DupFilterStats
+ * Notes      : The message is searched in P2PD_DUP_PROBES slots behind its
+ *              hash. If none of them is free the oldest entry is replaced.
  * ------------------------------------------------------------------------- */
 bool
 p2pd_is_duplicate_message(union olsr_message *msg)
 {
-  if(p2pd_message_seen(&dupFilterHead, &dupFilterTail, msg)) {
-    return true;
+  union olsr_ip_addr originator;
+  struct DupFilterEntry *victim = NULL;
+  uint32_t current, hash;
+  uint16_t seqno;
+  uint8_t msgtype;
+  int probe;
+
+  memset(&originator, 0, sizeof(originator));
+  if (olsr_cnf->ip_version == AF_INET) {
+    originator.v4.s_addr = msg->v4.originator;
+    msgtype = msg->v4.olsr_msgtype;
+    seqno = msg->v4.seqno;
+  } else /* if (olsr_cnf->ip_version == AF_INET6) */ {
+    memcpy(originator.v6.s6_addr, msg->v6.originator.s6_addr, sizeof(msg->v6.originator.s6_addr));
+    msgtype = msg->v6.olsr_msgtype;
+    seqno = msg->v6.seqno;
+  }
+
+  current = p2pd_dup_advance();
+  hash = p2pd_dup_hash(&originator, msgtype, seqno);
+  DupFilterStats.lookups++;
+
+  for (probe = 0; probe < P2PD_DUP_PROBES; probe++) {
+    struct DupFilterEntry *entry = &dupFilter[(hash + probe) & (P2PD_DUP_CAPACITY - 1)];
+    bool alive = entry->used && current - entry->bucket < P2PD_DUP_BUCKETS;
+
+    if (!alive) {
+      /* Remember the first free slot, but keep looking for the message */
+      if (victim == NULL || victim->used) {
+        victim = entry;
+        victim->used = 0;
+      }
+      continue;
+    }
+
+    if (entry->seqno == seqno && entry->msgtype == msgtype
+        && memcmp(&entry->address, &originator, olsr_cnf->ipsize) == 0) {
+      DupFilterStats.hits++;
+      return true;
+    }
+
+    if (victim == NULL || (victim->used && current - entry->bucket > current - victim->bucket))
+      victim = entry;
+  }
+
+  if (victim->used) {
+    /* All probed slots are in use, drop the oldest entry */
+    dupFilterCount[victim->bucket % P2PD_DUP_BUCKETS]--;
+    DupFilterStats.entries--;
+    DupFilterStats.evictions++;
   }
 
-  p2pd_store_message(&dupFilterHead, &dupFilterTail, msg);
+  victim->address = originator;
+  victim->msgtype = msgtype;
+  victim->seqno = seqno;
+  victim->bucket = current;
+  victim->used = 1;
+  dupFilterCount[current % P2PD_DUP_BUCKETS]++;
+  DupFilterStats.entries++;
 
   return false;
 }
 
+/* -------------------------------------------------------------------------
+ * Function   : p2pd_print_filter_stats
+ * Description: Print occupancy and hit rate of the duplicate filter
+ * Input      : context - unused, for use as timer callback
+ * Output     : none
+ * Return     : none
+ * Data Used  : DupFilterStats
+ * ------------------------------------------------------------------------- */
+void
+p2pd_print_filter_stats(void *context __attribute__ ((unused)))
+{
+  p2pd_dup_advance();
+
+  OLSR_PRINTF(2, "%s: duplicate filter %u/%u entries, %u lookups, %u hits (%u%%), %u evictions\n",
+              PLUGIN_NAME_SHORT, DupFilterStats.entries, P2PD_DUP_CAPACITY,
+              DupFilterStats.lookups, DupFilterStats.hits,
+              DupFilterStats.lookups ? (unsigned int)((uint64_t)DupFilterStats.hits * 100 / DupFilterStats.lookups) : 0,
+              DupFilterStats.evictions);
+}
+
 /* -------------------------------------------------------------------------
  * Function   : olsr_parser
  * Description: Function to be passed to the parser engine. This function
@@ -889,6 +943,9 @@ InitP2pd(struct interface_olsr *skipThisIntf)
   //Creates captures sockets and register them to the OLSR scheduler
   CreateNonOlsrNetworkInterfaces(skipThisIntf);
 
+  dupFilterStatsTimer = olsr_start_timer(P2PD_STATS_INTERVAL * MSEC_PER_SEC, 0, OLSR_TIMER_PERIODIC,
+                                         &p2pd_print_filter_stats, NULL, NULL);
+
   return 0;
 }                               /* InitP2pd */
 
@@ -903,6 +960,10 @@ InitP2pd(struct interface_olsr *skipThisIntf)
 void
 CloseP2pd(void)
 {
+  if (dupFilterStatsTimer != NULL) {
+    olsr_stop_timer(dupFilterStatsTimer);
+    dupFilterStatsTimer = NULL;
+  }
   CloseNonOlsrNetworkInterfaces();
 }
 
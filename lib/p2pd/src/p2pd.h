@@ -71,12 +71,30 @@
 /* Forward declaration of OLSR interface type */
 struct interface_olsr;
 
+/* Duplicate message filter: a fixed size open addressing table keyed
+ * on (originator, msgtype, seqno). Entries expire with the time bucket
+ * they were stored in, P2PD_DUP_BUCKETS buckets span P2pdDuplicateTimeout.
+ */
+#define P2PD_DUP_CAPACITY         8192  /* entries, power of 2 */
+#define P2PD_DUP_PROBES           8     /* slots searched per message */
+#define P2PD_DUP_BUCKETS          16    /* time buckets kept alive */
+
+/* Seconds between two prints of the filter statistics */
+#define P2PD_STATS_INTERVAL       60
+
 struct DupFilterEntry {
-  int                            ip_version;
   union olsr_ip_addr             address;
   uint16_t                       seqno;
   uint8_t                        msgtype;
-  time_t                         creationtime;
+  uint8_t                        used;
+  uint32_t                       bucket;      /* time bucket of insertion */
+};
+
+struct DupFilterStats {
+  uint32_t                       lookups;
+  uint32_t                       hits;        /* duplicates found */
+  uint32_t                       entries;     /* live entries */
+  uint32_t                       evictions;   /* live entries overwritten */
 };
 
 struct UdpDestPort {
@@ -92,6 +110,7 @@ extern int HighestSkfd;
 extern fd_set InputSet;
 extern struct UdpDestPort * UdpDestPortList;
 extern struct DuplicateFilterEntry * FilterList;
+extern struct DupFilterStats DupFilterStats;
 
 void DoP2pd(int sd, void *x, unsigned int y);
 void P2pdPError(const char *format, ...) __attribute__ ((format(printf, 1, 2)));
@@ -104,9 +123,8 @@ bool InUdpDestPortList(int ip_version, union olsr_ip_addr *addr, uint16_t port);
 int SetP2pdTtl(const char *value, void *data __attribute__ ((unused)), set_plugin_parameter_addon addon __attribute__ ((unused)));
 int SetP2pdUseHashFilter(const char *value, void *data __attribute__ ((unused)), set_plugin_parameter_addon addon __attribute__ ((unused)));
 int SetP2pdUseTtlDecrement(const char *value, void *data __attribute__ ((unused)), set_plugin_parameter_addon addon __attribute__ ((unused)));
-bool p2pd_message_seen(struct node **head, struct node **tail, union olsr_message *m);
-void p2pd_store_message(struct node **head, struct node **tail, union olsr_message *m);
 bool p2pd_is_duplicate_message(union olsr_message *msg);
+void p2pd_print_filter_stats(void *context);
 
 void olsr_p2pd_gen(unsigned char *packet, int len);
 
@@ -0,0 +1,300 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+/*
+ * Benchmark of the de-duplication list: feeds synthetic position messages
+ * through isInDeDupList/addToDeDup the way the plugin does, for a number of
+ * list depths, and checks every answer against a linear scan of the list.
+ */
+
+#include "dedup.h"
+
+/* OLSR includes */
+#include "olsr.h"
+#include "olsr_cfg.h"
+
+/* System includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the plugin is linked against olsrd, the benchmark provides what dedup.c uses */
+static struct olsrd_config config;
+struct olsrd_config *olsr_cnf = &config;
+
+void *olsr_malloc(size_t size, const char *id) {
+	void * p = calloc(1, size);
+
+	if (p == NULL) {
+		fprintf(stderr, "%s: out of memory\n", id);
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+/** the depths that are measured when none is given */
+static const unsigned long long defaultDepths[] = { 16, 256, 4096, 65536 };
+
+static double wallTime(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/**
+ Generate the messages: every originator counts up its own sequence number,
+ and a part of the messages are copies of recent messages, as flooding
+ delivers them more than once.
+
+ @param messages
+ The array to fill
+ @param count
+ The number of messages
+ @param originators
+ The number of originators
+ @param duplicates
+ The percentage of duplicates
+ */
+static void generateMessages(union olsr_message * messages, unsigned long count, unsigned int originators,
+		unsigned int duplicates) {
+	uint16_t * seqnos = olsr_malloc(originators * sizeof(uint16_t), "seqnos");
+	unsigned long i;
+
+	for (i = 0; i < originators; i++) {
+		seqnos[i] = (uint16_t) random();
+	}
+
+	memset(messages, 0, count * sizeof(union olsr_message));
+	for (i = 0; i < count; i++) {
+		union olsr_message * m = &messages[i];
+
+		if ((i > 0) && ((unsigned int) (random() % 100) < duplicates)) {
+			/* a copy of one of the last 64 messages */
+			unsigned long back = 1 + (unsigned long) random() % (i < 64 ? i : 64);
+			*m = messages[i - back];
+		} else {
+			unsigned int o = (unsigned int) random() % originators;
+
+			if (olsr_cnf->ip_version == AF_INET) {
+				m->v4.originator = htonl(0x0a000001 + o);
+				m->v4.seqno = htons(seqnos[o]++);
+			} else {
+				m->v6.originator.s6_addr[0] = 0xfd;
+				m->v6.originator.s6_addr[14] = (uint8_t) (o >> 8);
+				m->v6.originator.s6_addr[15] = (uint8_t) o;
+				m->v6.seqno = htons(seqnos[o]++);
+			}
+		}
+	}
+
+	free(seqnos);
+}
+
+/**
+ Look up a message in the list by scanning it from newest to oldest, as the
+ list did before it had an index
+
+ @return
+ - true when the message is already in the list
+ - false otherwise
+ */
+static bool scanDeDupList(DeDupList * deDupList, union olsr_message * olsrMessage) {
+	unsigned long long index = deDupList->newestEntryIndex;
+	unsigned long long count;
+
+	for (count = deDupList->entriesCount; count > 0; count--) {
+		DeDupEntry * entry = &deDupList->entries[index];
+
+		if (olsr_cnf->ip_version == AF_INET) {
+			if ((entry->seqno == olsrMessage->v4.seqno)
+					&& (memcmp(&entry->originator.v4, &olsrMessage->v4.originator, sizeof(entry->originator.v4)) == 0)) {
+				return true;
+			}
+		} else {
+			if ((entry->seqno == olsrMessage->v6.seqno)
+					&& (memcmp(&entry->originator.v6, &olsrMessage->v6.originator, sizeof(entry->originator.v6)) == 0)) {
+				return true;
+			}
+		}
+		index = (index + 1) % deDupList->entriesMaxCount;
+	}
+
+	return false;
+}
+
+/**
+ Run the messages through a list of the given depth
+
+ @return
+ The number of answers that differ from the linear scan
+ */
+static unsigned long runDepth(union olsr_message * messages, unsigned long count, unsigned long long depth) {
+	DeDupList deDupList;
+	unsigned long i, duplicates = 0, mismatches = 0;
+	double hashTime, scanTime;
+
+	/* the plugin: drop a message that is in the list, add the others */
+	memset(&deDupList, 0, sizeof(deDupList));
+	if (!initDeDupList(&deDupList, depth)) {
+		fprintf(stderr, "Could not create a list of depth %llu\n", depth);
+		exit(EXIT_FAILURE);
+	}
+	hashTime = wallTime();
+	for (i = 0; i < count; i++) {
+		if (isInDeDupList(&deDupList, &messages[i])) {
+			duplicates++;
+		} else {
+			addToDeDup(&deDupList, &messages[i]);
+		}
+	}
+	hashTime = wallTime() - hashTime;
+	destroyDeDupList(&deDupList);
+
+	/* the same with the linear scan */
+	if (!initDeDupList(&deDupList, depth)) {
+		fprintf(stderr, "Could not create a list of depth %llu\n", depth);
+		exit(EXIT_FAILURE);
+	}
+	scanTime = wallTime();
+	for (i = 0; i < count; i++) {
+		if (!scanDeDupList(&deDupList, &messages[i])) {
+			addToDeDup(&deDupList, &messages[i]);
+		}
+	}
+	scanTime = wallTime() - scanTime;
+	destroyDeDupList(&deDupList);
+
+	/* both have to give the same answers */
+	if (!initDeDupList(&deDupList, depth)) {
+		fprintf(stderr, "Could not create a list of depth %llu\n", depth);
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < count; i++) {
+		bool inList = scanDeDupList(&deDupList, &messages[i]);
+
+		if (inList != isInDeDupList(&deDupList, &messages[i])) {
+			mismatches++;
+		}
+		if (!inList) {
+			addToDeDup(&deDupList, &messages[i]);
+		}
+	}
+	destroyDeDupList(&deDupList);
+
+	printf("%10llu %10lu %12.1f %12.1f %10lu\n", depth, duplicates, hashTime * 1e9 / count, scanTime * 1e9 / count,
+			mismatches);
+	return mismatches;
+}
+
+static void usage(void) {
+	printf("Usage: dedupBench [-n messages] [-o originators] [-r duplicate percentage] [-s seed] [-6] [depth ...]\n");
+}
+
+int main(int argc, char *argv[]) {
+	union olsr_message * messages;
+	unsigned long count = 100000, mismatches = 0;
+	unsigned int originators = 200, duplicates = 50;
+	unsigned int seed = 1;
+	int opt;
+
+	config.ip_version = AF_INET;
+	config.ipsize = sizeof(struct in_addr);
+
+	while ((opt = getopt(argc, argv, "n:o:r:s:6h")) != -1) {
+		switch (opt) {
+			case 'n':
+				count = strtoul(optarg, NULL, 0);
+				break;
+			case 'o':
+				originators = (unsigned int) strtoul(optarg, NULL, 0);
+				break;
+			case 'r':
+				duplicates = (unsigned int) strtoul(optarg, NULL, 0);
+				break;
+			case 's':
+				seed = (unsigned int) strtoul(optarg, NULL, 0);
+				break;
+			case '6':
+				config.ip_version = AF_INET6;
+				config.ipsize = sizeof(struct in6_addr);
+				break;
+			case 'h':
+				usage();
+				return EXIT_SUCCESS;
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+	if ((count == 0) || (originators == 0) || (originators > 0xffff) || (duplicates > 100)) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	srandom(seed);
+	messages = olsr_malloc(count * sizeof(union olsr_message), "messages");
+	generateMessages(messages, count, originators, duplicates);
+
+	printf("%lu %s messages from %u originators, %u%% sent again\n", count,
+			olsr_cnf->ip_version == AF_INET ? "IPv4" : "IPv6", originators, duplicates);
+	printf("%10s %10s %12s %12s %10s\n", "Depth", "Duplicates", "Hash(ns)", "Scan(ns)", "Mismatches");
+
+	if (optind < argc) {
+		for (; optind < argc; optind++) {
+			mismatches += runDepth(messages, count, strtoull(argv[optind], NULL, 0));
+		}
+	} else {
+		size_t i;
+
+		for (i = 0; i < sizeof(defaultDepths) / sizeof(defaultDepths[0]); i++) {
+			mismatches += runDepth(messages, count, defaultDepths[i]);
+		}
+	}
+
+	free(messages);
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -52,6 +52,7 @@
 
 /* System includes */
 #include <assert.h>
+#include <stdint.h>
 
 /* Defines */
 
@@ -60,6 +61,123 @@
 #define WRAPINDEX(x, i)		((i) % LISTSIZE(x)) /* always valid for i>=0 */
 #define INCOMINGINDEX(x)	WRAPINDEX(x, (NEWESTINDEX(x) + LISTSIZE(x) - 1)) /* always valid */
 
+#define NEXTSLOT(x, i)		(((i) + 1) & (x)->indexMask)
+
+/**
+ Fill a de-duplication entry from a message
+
+ @param entry
+ The entry to fill
+ @param olsrMessage
+ The message
+ */
+static void messageToEntry(DeDupEntry * entry, union olsr_message *olsrMessage) {
+	memset(entry, 0, sizeof(DeDupEntry));
+	if (olsr_cnf->ip_version == AF_INET) {
+		entry->seqno = olsrMessage->v4.seqno;
+		entry->originator.v4.s_addr = olsrMessage->v4.originator;
+	} else {
+		entry->seqno = olsrMessage->v6.seqno;
+		entry->originator.v6 = olsrMessage->v6.originator;
+	}
+}
+
+/**
+ Determine whether two de-duplication entries are equal
+
+ @param a
+ The first entry
+ @param b
+ The second entry
+
+ @return
+ - true when the entries are equal
+ - false otherwise
+ */
+static bool entriesEqual(const DeDupEntry * a, const DeDupEntry * b) {
+	return (a->seqno == b->seqno) && (memcmp(&a->originator, &b->originator, olsr_cnf->ipsize) == 0);
+}
+
+/**
+ Hash a de-duplication entry (FNV-1a)
+
+ @param deDupList
+ The de-duplication list
+ @param entry
+ The entry
+
+ @return
+ The slot in the hash index where probing for the entry starts
+ */
+static unsigned long long entrySlot(DeDupList * deDupList, const DeDupEntry * entry) {
+	const uint8_t * p = (const uint8_t *) &entry->originator;
+	uint32_t hash = 2166136261u;
+	size_t i;
+
+	hash = (hash ^ (entry->seqno & 0xff)) * 16777619u;
+	hash = (hash ^ (entry->seqno >> 8)) * 16777619u;
+	for (i = 0; i < olsr_cnf->ipsize; i++) {
+		hash = (hash ^ p[i]) * 16777619u;
+	}
+
+	return hash & deDupList->indexMask;
+}
+
+/**
+ Add an entry of the de-duplication list to the hash index
+
+ @param deDupList
+ The de-duplication list
+ @param entryIndex
+ The index of the entry in the list
+ */
+static void addToIndex(DeDupList * deDupList, unsigned long long entryIndex) {
+	unsigned long long slot = entrySlot(deDupList, &deDupList->entries[entryIndex]);
+
+	while (deDupList->index[slot] != 0) {
+		slot = NEXTSLOT(deDupList, slot);
+	}
+	deDupList->index[slot] = entryIndex + 1;
+}
+
+/**
+ Remove an entry of the de-duplication list from the hash index. The entries
+ that follow it in the probe sequence are moved back, so lookups never have to
+ skip deleted slots.
+
+ @param deDupList
+ The de-duplication list
+ @param entryIndex
+ The index of the entry in the list
+ */
+static void removeFromIndex(DeDupList * deDupList, unsigned long long entryIndex) {
+	unsigned long long slot = entrySlot(deDupList, &deDupList->entries[entryIndex]);
+	unsigned long long next;
+
+	while (deDupList->index[slot] != entryIndex + 1) {
+		assert(deDupList->index[slot] != 0);
+		slot = NEXTSLOT(deDupList, slot);
+	}
+
+	next = slot;
+	for (;;) {
+		unsigned long long home;
+
+		next = NEXTSLOT(deDupList, next);
+		if (deDupList->index[next] == 0) {
+			break;
+		}
+
+		/* the entry in next can move to slot unless its home lies cyclically in (slot, next] */
+		home = entrySlot(deDupList, &deDupList->entries[deDupList->index[next] - 1]);
+		if (((next - home) & deDupList->indexMask) >= ((next - slot) & deDupList->indexMask)) {
+			deDupList->index[slot] = deDupList->index[next];
+			slot = next;
+		}
+	}
+	deDupList->index[slot] = 0;
+}
+
 /**
  Initialise the de-duplication list: allocate memory for the entries and
  reset fields.
@@ -76,6 +194,8 @@
  */
 bool initDeDupList(DeDupList * deDupList, unsigned long long maxEntries) {
 	void * p;
+	void * index;
+	unsigned long long slots;
 
 	if (deDupList == NULL) {
 		return false;
@@ -83,6 +203,15 @@ bool initDeDupList(DeDupList * deDupList, unsigned long long maxEntries) {
 	if (maxEntries < 1) {
 		return false;
 	}
+	if (maxEntries > (SIZE_MAX / 4 / sizeof(unsigned long long))) {
+		return false;
+	}
+
+	/* keep the index at most half full */
+	slots = 1;
+	while (slots < (2 * maxEntries)) {
+		slots <<= 1;
+	}
 
 	p = olsr_malloc(maxEntries * sizeof(DeDupEntry),
 			"DeDupEntry entries for DeDupList (PUD)");
@@ -90,12 +219,23 @@ bool initDeDupList(DeDupList * deDupList, unsigned long long maxEntries) {
 		return false;
 	}
 
+	/* olsr_malloc clears the memory: all slots are free */
+	index = olsr_malloc(slots * sizeof(unsigned long long),
+			"DeDupEntry index for DeDupList (PUD)");
+	if (index == NULL) {
+		free(p);
+		return false;
+	}
+
 	deDupList->entriesMaxCount = maxEntries;
 	deDupList->entries = p;
 
 	deDupList->entriesCount = 0;
 	deDupList->newestEntryIndex = 0;
 
+	deDupList->index = index;
+	deDupList->indexMask = slots - 1;
+
 	return true;
 }
 
@@ -112,8 +252,13 @@ void destroyDeDupList(DeDupList * deDupList) {
 		free(deDupList->entries);
 		deDupList->entries = NULL;
 	}
+	if (deDupList->index != NULL) {
+		free(deDupList->index);
+		deDupList->index = NULL;
+	}
 
 	deDupList->entriesMaxCount = 0;
+	deDupList->indexMask = 0;
 
 	deDupList->entriesCount = 0;
 	deDupList->newestEntryIndex = 0;
@@ -136,15 +281,14 @@ void addToDeDup(DeDupList * deDupList, union olsr_message *olsrMessage) {
 	incomingIndex = INCOMINGINDEX(deDupList);
 	newEntry = &deDupList->entries[incomingIndex];
 
-	memset(newEntry, 0, sizeof(DeDupEntry));
-	if (olsr_cnf->ip_version == AF_INET) {
-		newEntry->seqno = olsrMessage->v4.seqno;
-		newEntry->originator.v4.s_addr = olsrMessage->v4.originator;
-	} else {
-		newEntry->seqno = olsrMessage->v6.seqno;
-		newEntry->originator.v6 = olsrMessage->v6.originator;
+	/* a full list overwrites its oldest entry */
+	if (deDupList->entriesCount == deDupList->entriesMaxCount) {
+		removeFromIndex(deDupList, incomingIndex);
 	}
 
+	messageToEntry(newEntry, olsrMessage);
+	addToIndex(deDupList, incomingIndex);
+
 	deDupList->newestEntryIndex = incomingIndex;
 	if (deDupList->entriesCount < deDupList->entriesMaxCount) {
 		deDupList ->entriesCount++;
@@ -165,37 +309,16 @@ void addToDeDup(DeDupList * deDupList, union olsr_message *olsrMessage) {
  - false otherwise
  */
 bool isInDeDupList(DeDupList * deDupList, union olsr_message *olsrMessage) {
-	bool retval = false;
-	unsigned long long iteratedIndex;
-	unsigned long long count;
-
-	iteratedIndex = NEWESTINDEX(deDupList);
-	count = deDupList->entriesCount;
-
-	/* we iterate from newest until oldest: we have a higher probability to
-	 * match on the newest entries */
-
-	while (count > 0) {
-		DeDupEntry * iteratedEntry = &deDupList->entries[iteratedIndex];
-		if (olsr_cnf->ip_version == AF_INET) {
-			if ((iteratedEntry->seqno == olsrMessage->v4.seqno) && (memcmp(
-					&iteratedEntry->originator.v4, &olsrMessage->v4.originator,
-					sizeof(iteratedEntry->originator.v4))) == 0) {
-				retval = true;
-				break;
-			}
-		} else {
-			if ((iteratedEntry->seqno == olsrMessage->v6.seqno) && (memcmp(
-					&iteratedEntry->originator.v6, &olsrMessage->v6.originator,
-					sizeof(iteratedEntry->originator.v6)) == 0)) {
-				retval = true;
-				break;
-			}
-		}
+	DeDupEntry entry;
+	unsigned long long slot;
 
-		iteratedIndex = WRAPINDEX(deDupList, iteratedIndex + 1); /* go the the next older entry */
-		count--;
+	messageToEntry(&entry, olsrMessage);
+
+	for (slot = entrySlot(deDupList, &entry); deDupList->index[slot] != 0; slot = NEXTSLOT(deDupList, slot)) {
+		if (entriesEqual(&deDupList->entries[deDupList->index[slot] - 1], &entry)) {
+			return true;
+		}
 	}
 
-	return retval;
+	return false;
 }
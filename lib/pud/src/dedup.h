@@ -66,7 +66,9 @@ typedef struct _DeDupEntry {
  A list of de-duplication entries that are used to determine whether a received
  OLSR message was already seen.
 
- The list is a circular list.
+ The list is a circular list. A hash index with linear probing refers to the
+ entries in the list, an entry is removed from the index when the list
+ overwrites it.
  */
 typedef struct _DeDupList {
 	unsigned long long entriesMaxCount; /**< the maximum number of entries in the list */
@@ -74,6 +76,9 @@ typedef struct _DeDupList {
 
 	unsigned long long entriesCount; /**< the number of entries in the list */
 	unsigned long long newestEntryIndex; /**< index of the newest entry in the list (zero-based) */
+
+	unsigned long long * index; /**< the hash index: list index + 1 of an entry, 0 for a free slot */
+	unsigned long long indexMask; /**< the number of slots in the index minus 1 */
 } DeDupList;
 
 bool initDeDupList(DeDupList * deDupList, unsigned long long maxEntries);
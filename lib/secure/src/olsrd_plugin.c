@@ -77,7 +77,8 @@ my_init(void)
   /* Print plugin info to stdout */
   olsr_printf(0, "%s (%s)\n", PLUGIN_NAME, git_descriptor);
 
-  olsr_printf(0, "[ENC]Accepted parameter pairs: (\"Keyfile\" <FILENAME>)\n");
+  olsr_printf(0, "[ENC]Accepted parameter pairs: (\"Keyfile\" <FILENAME>) (\"Scheme\" <legacy|hmac-sha256>)"
+              " (\"Epochfile\" <FILENAME>)\n");
 }
 
 /**
@@ -104,8 +105,23 @@ store_string(const char *value, void *data, set_plugin_parameter_addon addon __a
   return 0;
 }
 
+static int
+set_scheme(const char *value, void *data __attribute__ ((unused)), set_plugin_parameter_addon addon __attribute__ ((unused)))
+{
+  if (strcasecmp(value, "legacy") == 0) {
+    secure_scheme = SECURE_SCHEME_LEGACY;
+  } else if (strcasecmp(value, "hmac-sha256") == 0) {
+    secure_scheme = SECURE_SCHEME_HMAC_SHA256;
+  } else {
+    return 1;
+  }
+  return 0;
+}
+
 static const struct olsrd_plugin_parameters plugin_parameters[] = {
   {.name = "keyfile",.set_plugin_parameter = &store_string,.data = keyfile},
+  {.name = "epochfile",.set_plugin_parameter = &store_string,.data = epochfile},
+  {.name = "scheme",.set_plugin_parameter = &set_scheme,.data = NULL},
 };
 
 void
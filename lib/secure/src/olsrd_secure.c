@@ -70,6 +70,7 @@
 #include "scheduler.h"
 #include "net_olsr.h"
 #include "olsr_random.h"
+#include "sha256.h"
 
 #ifdef USE_OPENSSL
 
@@ -79,6 +80,11 @@
 #define CHECKSUM SHA1
 #define SCHEME   SHA1_INCLUDING_KEY
 
+#define CHECKSUM_CTX SHA_CTX
+#define CHECKSUM_INIT(ctx) SHA1_Init(ctx)
+#define CHECKSUM_UPDATE(ctx, data, len) SHA1_Update(ctx, data, len)
+#define CHECKSUM_FINAL(ctx, hash) SHA1_Final(hash, ctx)
+
 #else /* USE_OPENSSL */
 
 /* Homebrewn checksuming */
@@ -97,6 +103,11 @@ MD5_checksum(const uint8_t * data, const uint16_t data_len, uint8_t * hashbuf)
 #define CHECKSUM MD5_checksum
 #define SCHEME   MD5_INCLUDING_KEY
 
+#define CHECKSUM_CTX MD5_CTX
+#define CHECKSUM_INIT(ctx) MD5Init(ctx)
+#define CHECKSUM_UPDATE(ctx, data, len) MD5Update(ctx, (const unsigned char *)(data), len)
+#define CHECKSUM_FINAL(ctx, hash) MD5Final(hash, ctx)
+
 #endif /* USE_OPENSSL */
 
 #ifdef OS
@@ -143,9 +154,41 @@ struct stamp {
 
 static struct stamp timestamps[HASHSIZE];
 
+/*
+ * Replay window of a neighbor using the HMAC scheme:
+ * bit n of the bitmap is set if packet top - n was seen.
+ * A window never expires, else the old packets of a silent
+ * neighbor would be accepted again. Only key holders create
+ * one, so their number stays small.
+ */
+struct replay_window {
+  union olsr_ip_addr addr;
+  uint32_t epoch;
+  uint32_t top;                         /* highest sequence number accepted */
+  uint64_t bitmap;
+  struct replay_window *prev;
+  struct replay_window *next;
+};
+
+static struct replay_window windows[HASHSIZE];
+
 char keyfile[FILENAME_MAX + 1];
+char epochfile[FILENAME_MAX + 1];
 char aes_key[16];
 
+int secure_scheme = SECURE_SCHEME_LEGACY;
+
+/* HMAC key schedule, computed once from aes_key */
+static struct hmac_sha256_key hmac_key;
+
+/* Our own epoch and packet counter for the HMAC scheme */
+static uint32_t hmac_epoch;
+static uint32_t hmac_seqno;
+
+/* Size of the HMAC signature message including the OLSR message header */
+#define HMAC_MSG_HDRSIZE (8 + (int)olsr_cnf->ipsize)
+#define HMAC_MSG_SIZE (HMAC_MSG_HDRSIZE + (int)sizeof(struct hmac_sig_msg))
+
 /* Event function to register with the sceduler */
 static int send_challenge(struct interface_olsr *olsr_if, const union olsr_ip_addr *);
 static int send_cres(struct interface_olsr *olsr_if, union olsr_ip_addr *, union olsr_ip_addr *, uint32_t, struct stamp *);
@@ -154,13 +197,18 @@ static int parse_challenge(struct interface_olsr *olsr_if, char *);
 static int parse_cres(struct interface_olsr *olsr_if, char *);
 static int parse_rres(char *);
 static int check_auth(struct interface_olsr *olsr_if, char *, int *);
-static int add_signature(uint8_t *, int *);
+static void add_signatures(struct olsr_ptf_packet *, unsigned int);
 static int validate_packet(struct interface_olsr *olsr_if, const char *, int *);
+static int validate_packet_hmac(const char *, int *);
+static void sign_packet(struct olsr_ptf_packet *);
+static void sign_packet_hmac(struct olsr_ptf_packet *);
 static char *secure_preprocessor(char *packet, struct interface_olsr *olsr_if, union olsr_ip_addr *from_addr, int *length);
 static void timeout_timestamps(void *);
 static int check_timestamp(struct interface_olsr *olsr_if, const union olsr_ip_addr *, time_t);
 static struct stamp *lookup_timestamp_entry(const union olsr_ip_addr *);
+static int check_replay(const union olsr_ip_addr *, uint32_t, uint32_t);
 static int read_key_from_file(const char *);
+static uint32_t next_epoch(const char *);
 
 /**
  *Do initialization here
@@ -181,6 +229,11 @@ secure_plugin_init(void)
   }
   olsr_printf(1, "Timestamp database initialized\n");
 
+  for (i = 0; i < HASHSIZE; i++) {
+    windows[i].next = &windows[i];
+    windows[i].prev = &windows[i];
+  }
+
   if (!strlen(keyfile))
     strscpy(keyfile, KEYFILE, sizeof(keyfile));
 
@@ -197,8 +250,22 @@ secure_plugin_init(void)
     olsr_exit(buf, EXIT_FAILURE);
   }
 
+  gettimeofday(&now, NULL);
+
+  if (secure_scheme == SECURE_SCHEME_HMAC_SHA256) {
+    hmac_sha256_setkey(&hmac_key, aes_key, KEYLENGTH);
+    hmac_epoch = next_epoch(epochfile);
+    hmac_seqno = 0;
+    olsr_printf(1, "[ENC]Using HMAC-SHA256, epoch %u\n", hmac_epoch);
+  }
+
+#ifdef SECURE_PROFILING
+  secure_benchmark();
+#endif /* SECURE_PROFILING */
+
   /* Register the packet transform function */
-  add_ptf(&add_signature);
+  add_ptf_batch(&add_signatures, "secure",
+                secure_scheme == SECURE_SCHEME_HMAC_SHA256 ? HMAC_MSG_SIZE : (int)sizeof(struct s_olsrmsg));
 
   olsr_preprocessor_add_function(&secure_preprocessor);
 
@@ -221,6 +288,7 @@ void
 secure_plugin_exit(void)
 {
   olsr_preprocessor_remove_function(&secure_preprocessor);
+  del_ptf_batch(&add_signatures);
 }
 
 static char *
@@ -229,18 +297,29 @@ secure_preprocessor(char *packet, struct interface_olsr *olsr_if, union olsr_ip_
   struct olsr *olsr = (struct olsr *)packet;
   struct ipaddr_str buf;
 
-  /*
-   * Check for challenge/response messages
-   */
-  check_auth(olsr_if, packet, length);
-
-  /*
-   * Check signature
-   */
-
-  if (!validate_packet(olsr_if, packet, length)) {
-    olsr_printf(1, "[ENC]Rejecting packet from %s\n", olsr_ip_to_string(&buf, from_addr));
-    return NULL;
+  if (secure_scheme == SECURE_SCHEME_HMAC_SHA256) {
+    /*
+     * No challenge/response messages in this scheme,
+     * the sequence numbers protect against replay
+     */
+    if (!validate_packet_hmac(packet, length)) {
+      olsr_printf(1, "[ENC]Rejecting packet from %s\n", olsr_ip_to_string(&buf, from_addr));
+      return NULL;
+    }
+  } else {
+    /*
+     * Check for challenge/response messages
+     */
+    check_auth(olsr_if, packet, length);
+
+    /*
+     * Check signature
+     */
+
+    if (!validate_packet(olsr_if, packet, length)) {
+      olsr_printf(1, "[ENC]Rejecting packet from %s\n", olsr_ip_to_string(&buf, from_addr));
+      return NULL;
+    }
   }
 
   olsr_printf(1, "[ENC]Packet from %s OK size %d\n", olsr_ip_to_string(&buf, from_addr), *length);
@@ -285,28 +364,52 @@ check_auth(struct interface_olsr *olsr_if, char *pck, int *size __attribute__ ((
 
 /**
  * Packet transform function
+ * Add the signature message of the configured scheme
+ * to all packets
+ */
+static void
+add_signatures(struct olsr_ptf_packet *pkts, unsigned int count)
+{
+  unsigned int p;
+
+  for (p = 0; p < count; p++) {
+    if (secure_scheme == SECURE_SCHEME_HMAC_SHA256) {
+      sign_packet_hmac(&pkts[p]);
+    } else {
+      sign_packet(&pkts[p]);
+    }
+  }
+}
+
+/**
  * Build a SHA-1/MD5 hash of the original message
  * + the signature message(-digest) + key
  *
  * Then add the signature message to the packet and
- * increase the size
+ * increase its size. The hash is built over the
+ * pieces of the packet, it is not copied first.
  */
-int
-add_signature(uint8_t * pck, int *size)
+static void
+sign_packet(struct olsr_ptf_packet *pkt)
 {
   struct s_olsrmsg *msg;
-#ifdef DEBUG
+  CHECKSUM_CTX context;
   unsigned int i;
+  int left;
+#ifdef DEBUG
   int j;
   const uint8_t *sigmsg;
 #endif /* DEBUG */
 
-  olsr_printf(2, "[ENC]Adding signature for packet size %d\n", *size);
-  fflush(stdout);
+  if (pkt->tail_room < (int)sizeof(struct s_olsrmsg)) {
+    olsr_printf(1, "[ENC]No room to sign packet of size %d\n", pkt->len);
+    return;
+  }
+
+  olsr_printf(2, "[ENC]Adding signature for packet size %d\n", pkt->len);
 
-  msg = (struct s_olsrmsg *)ARM_NOWARN_ALIGN(&pck[*size]);
-  /* Update size */
-  ((struct olsr *)pck)->olsr_packlen = htons(*size + sizeof(struct s_olsrmsg));
+  msg = (struct s_olsrmsg *)ARM_NOWARN_ALIGN(pkt->tail);
+  memset(msg, 0, sizeof(*msg));
 
   /* Fill packet header */
   msg->olsr_msgtype = MESSAGE_TYPE;
@@ -327,20 +430,21 @@ add_signature(uint8_t * pck, int *size)
 #ifndef _WIN32
   olsr_printf(3, "[ENC]timestamp: %lld\n", (long long)now.tv_sec);
 #endif /* _WIN32 */
-  /* Set the new size */
-  *size += sizeof(struct s_olsrmsg);
 
-  {
-    uint8_t checksum_cache[1512 + KEYLENGTH];
-    /* Create packet + key cache */
-    /* First the OLSR packet + signature message - digest */
-    memcpy(checksum_cache, pck, *size - SIGNATURE_SIZE);
-    /* Then the key */
-    memcpy(&checksum_cache[*size - SIGNATURE_SIZE], aes_key, KEYLENGTH);
+  /* Append it, this also sets the new size */
+  net_ptf_append(pkt, sizeof(struct s_olsrmsg));
 
-    /* Create the hash */
-    CHECKSUM(checksum_cache, (*size - SIGNATURE_SIZE) + KEYLENGTH, &pck[*size - SIGNATURE_SIZE]);
+  /* Hash the OLSR packet + signature message - digest, then the key */
+  CHECKSUM_INIT(&context);
+  left = pkt->len - SIGNATURE_SIZE;
+  for (i = 0; i < pkt->iovcnt && left > 0; i++) {
+    int len = MIN((int)pkt->iov[i].iov_len, left);
+
+    CHECKSUM_UPDATE(&context, pkt->iov[i].iov_base, len);
+    left -= len;
   }
+  CHECKSUM_UPDATE(&context, aes_key, KEYLENGTH);
+  CHECKSUM_FINAL(&context, (uint8_t *)msg + sizeof(struct s_olsrmsg) - SIGNATURE_SIZE);
 
 #ifdef DEBUG
   olsr_printf(1, "Signature message:\n");
@@ -359,8 +463,72 @@ add_signature(uint8_t * pck, int *size)
 #endif /* DEBUG */
 
   olsr_printf(3, "[ENC] Message signed\n");
+}
 
-  return 1;
+/**
+ * Append the HMAC-SHA256 signature message to a packet.
+ * The MAC covers the packet and the signature message
+ * up to the MAC itself, and starts from the cached
+ * key schedule instead of hashing the key again.
+ */
+static void
+sign_packet_hmac(struct olsr_ptf_packet *pkt)
+{
+  uint8_t *msg;
+  struct hmac_sig_msg sig;
+  struct sha256_ctx context;
+  uint8_t mac[SHA256_DIGEST_SIZE];
+  uint16_t val16;
+  unsigned int i;
+  int left;
+
+  if (pkt->tail_room < HMAC_MSG_SIZE) {
+    olsr_printf(1, "[ENC]No room to sign packet of size %d\n", pkt->len);
+    return;
+  }
+
+  olsr_printf(2, "[ENC]Adding HMAC for packet size %d\n", pkt->len);
+
+  /* Fill message header */
+  msg = pkt->tail;
+  msg[0] = MESSAGE_TYPE;
+  msg[1] = 0;
+  val16 = htons(HMAC_MSG_SIZE);
+  memcpy(&msg[2], &val16, sizeof(val16));
+  memcpy(&msg[4], &olsr_cnf->main_addr, olsr_cnf->ipsize);
+  msg[HMAC_MSG_HDRSIZE - 4] = 1;
+  msg[HMAC_MSG_HDRSIZE - 3] = 0;
+  val16 = htons(get_msg_seqno());
+  memcpy(&msg[HMAC_MSG_HDRSIZE - 2], &val16, sizeof(val16));
+
+  /* Fill subheader, a wrapping counter starts a new epoch */
+  if (++hmac_seqno == 0) {
+    hmac_epoch++;
+  }
+  memset(&sig, 0, sizeof(sig));
+  sig.type = ONE_CHECKSUM;
+  sig.algorithm = HMAC_SHA256;
+  sig.epoch = htonl(hmac_epoch);
+  sig.seqno = htonl(hmac_seqno);
+  memcpy(&msg[HMAC_MSG_HDRSIZE], &sig, sizeof(sig));
+
+  /* Append it, this also sets the new size */
+  net_ptf_append(pkt, HMAC_MSG_SIZE);
+
+  hmac_sha256_init(&hmac_key, &context);
+  left = pkt->len - HMAC_SIGSIZE;
+  for (i = 0; i < pkt->iovcnt && left > 0; i++) {
+    int len = MIN((int)pkt->iov[i].iov_len, left);
+
+    sha256_update(&context, pkt->iov[i].iov_base, len);
+    left -= len;
+  }
+  hmac_sha256_final(&hmac_key, &context, mac);
+
+  /* Truncated to HMAC_SIGSIZE bytes like RFC 4868 does */
+  memcpy(&msg[HMAC_MSG_SIZE - HMAC_SIGSIZE], mac, HMAC_SIGSIZE);
+
+  olsr_printf(3, "[ENC] Message signed, epoch %u seqno %u\n", hmac_epoch, hmac_seqno);
 }
 
 static int
@@ -431,15 +599,15 @@ validate_packet(struct interface_olsr *olsr_if, const char *pck, int *size)
 one_checksum_SHA:
 
   {
-    uint8_t checksum_cache[1512 + KEYLENGTH];
-    /* Create packet + key cache */
-    /* First the OLSR packet + signature message - digest */
-    memcpy(checksum_cache, pck, *size - SIGNATURE_SIZE);
-    /* Then the key */
-    memcpy(&checksum_cache[*size - SIGNATURE_SIZE], aes_key, KEYLENGTH);
+    CHECKSUM_CTX context;
+
+    /* The OLSR packet + signature message - digest, then the key */
+    CHECKSUM_INIT(&context);
+    CHECKSUM_UPDATE(&context, pck, *size - SIGNATURE_SIZE);
+    CHECKSUM_UPDATE(&context, aes_key, KEYLENGTH);
 
     /* generate SHA-1 */
-    CHECKSUM(checksum_cache, *size - SIGNATURE_SIZE + KEYLENGTH, sha1_hash);
+    CHECKSUM_FINAL(&context, sha1_hash);
   }
 
 #ifdef DEBUG
@@ -484,6 +652,129 @@ one_checksum_SHA:
   return 1;
 }
 
+/**
+ * Check the HMAC-SHA256 signature message at the end of
+ * a packet and its sequence number, then remove it
+ */
+static int
+validate_packet_hmac(const char *pck, int *size)
+{
+  const uint8_t *msg;
+  struct hmac_sig_msg sig;
+  struct sha256_ctx context;
+  uint8_t mac[SHA256_DIGEST_SIZE];
+  union olsr_ip_addr originator;
+  uint8_t diff;
+  int packetsize, i;
+
+  /* Find size - signature message */
+  packetsize = *size - HMAC_MSG_SIZE;
+
+  if (packetsize < 4)
+    return 0;
+
+  msg = (const uint8_t *)pck + packetsize;
+
+  /* Sanity check first */
+  if ((msg[0] != MESSAGE_TYPE) || (msg[1] != 0) || (((msg[2] << 8) | msg[3]) != HMAC_MSG_SIZE)
+      || (msg[HMAC_MSG_HDRSIZE - 4] != 1) || (msg[HMAC_MSG_HDRSIZE - 3] != 0)) {
+    olsr_printf(1, "[ENC]Packet not sane!\n");
+    return 0;
+  }
+
+  memcpy(&sig, &msg[HMAC_MSG_HDRSIZE], sizeof(sig));
+  if ((sig.type != ONE_CHECKSUM) || (sig.algorithm != HMAC_SHA256)) {
+    olsr_printf(1, "[ENC]Unsupported sceme: %d enc: %d!\n", sig.type, sig.algorithm);
+    return 0;
+  }
+
+  hmac_sha256_init(&hmac_key, &context);
+  sha256_update(&context, pck, *size - HMAC_SIGSIZE);
+  hmac_sha256_final(&hmac_key, &context, mac);
+
+  /* Compare all bytes, the time taken must not tell how many matched */
+  diff = 0;
+  for (i = 0; i < HMAC_SIGSIZE; i++) {
+    diff |= mac[i] ^ sig.signature[i];
+  }
+  if (diff != 0) {
+    olsr_printf(1, "[ENC]Signature missmatch\n");
+    return 0;
+  }
+
+  memset(&originator, 0, sizeof(originator));
+  memcpy(&originator, &msg[4], olsr_cnf->ipsize);
+
+  if (!check_replay(&originator, ntohl(sig.epoch), ntohl(sig.seqno))) {
+    struct ipaddr_str buf;
+    olsr_printf(1, "[ENC]Replayed packet %u/%u from %s!\n", ntohl(sig.epoch), ntohl(sig.seqno),
+                olsr_ip_to_string(&buf, &originator));
+    return 0;
+  }
+
+  /* Remove signature message */
+  *size = packetsize;
+  return 1;
+}
+
+/**
+ * Sliding window check of the sequence number of a packet
+ * with a valid MAC, every (epoch, seqno) pair is accepted once.
+ * A higher epoch means the sender restarted and resets
+ * the window, a lower one is a replay.
+ *
+ *@return 1 if the packet is new
+ */
+static int
+check_replay(const union olsr_ip_addr *originator, uint32_t epoch, uint32_t seqno)
+{
+  struct replay_window *entry;
+  uint32_t hash;
+
+  hash = olsr_ip_hashing(originator);
+
+  for (entry = windows[hash].next; entry != &windows[hash]; entry = entry->next) {
+    if (memcmp(&entry->addr, originator, olsr_cnf->ipsize) == 0) {
+      break;
+    }
+  }
+
+  if (entry == &windows[hash]) {
+    /* First packet of this neighbor */
+    entry = olsr_malloc(sizeof(struct replay_window), "SECURE replay window");
+    memcpy(&entry->addr, originator, olsr_cnf->ipsize);
+    entry->epoch = epoch;
+    entry->top = seqno;
+    entry->bitmap = 1;
+
+    /* Queue */
+    windows[hash].next->prev = entry;
+    entry->next = windows[hash].next;
+    windows[hash].next = entry;
+    entry->prev = &windows[hash];
+  } else if (epoch < entry->epoch) {
+    return 0;
+  } else if (epoch > entry->epoch) {
+    entry->epoch = epoch;
+    entry->top = seqno;
+    entry->bitmap = 1;
+  } else if (seqno > entry->top) {
+    uint32_t shift = seqno - entry->top;
+
+    entry->bitmap = shift < REPLAY_WINDOW ? (entry->bitmap << shift) | 1 : 1;
+    entry->top = seqno;
+  } else {
+    uint32_t behind = entry->top - seqno;
+
+    if (behind >= REPLAY_WINDOW || (entry->bitmap & ((uint64_t)1 << behind)) != 0) {
+      return 0;
+    }
+    entry->bitmap |= (uint64_t)1 << behind;
+  }
+
+  return 1;
+}
+
 int
 check_timestamp(struct interface_olsr *olsr_if, const union olsr_ip_addr *originator, time_t tstamp)
 {
@@ -1132,6 +1423,136 @@ read_key_from_file(const char *file)
   return 1;
 }
 
+/**
+ * Pick the epoch of the HMAC scheme. It must grow with
+ * every restart, else neighbors drop our packets as
+ * replays until they forget us. The clock is good enough
+ * if it is set, nodes without a real time clock keep the
+ * last epoch in a file and count up from it.
+ *
+ *@param file file to keep the epoch in, may be empty
+ *@return the new epoch
+ */
+static uint32_t
+next_epoch(const char *file)
+{
+  uint32_t epoch = (uint32_t)now.tv_sec;
+  unsigned long last;
+  FILE *ef;
+
+  if (file[0] == 0) {
+    if (epoch < EPOCH_MIN_CLOCK) {
+      olsr_printf(1, "[ENC]The clock is not set and there is no epoch file, neighbors may drop our packets!\n");
+    }
+    return epoch;
+  }
+
+  ef = fopen(file, "r");
+  if (ef != NULL) {
+    if (fscanf(ef, "%lu", &last) == 1 && last >= epoch) {
+      epoch = last + 1;
+    }
+    fclose(ef);
+  }
+
+  ef = fopen(file, "w");
+  if (ef == NULL) {
+    olsr_printf(1, "[ENC]Could not write epoch file %s!\nError: %s\n", file, strerror(errno));
+    return epoch;
+  }
+  fprintf(ef, "%u\n", epoch);
+  fclose(ef);
+
+  return epoch;
+}
+
+#ifdef SECURE_PROFILING
+static uint64_t
+bench_nsec(const struct timespec *start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (uint64_t)(end.tv_sec - start->tv_sec) * 1000000000ULL + end.tv_nsec - start->tv_nsec;
+}
+
+/**
+ * Print how many packets per second both schemes sign and
+ * verify for a few packet sizes. Verifying the legacy scheme
+ * is measured without the timestamp check, the HMAC scheme
+ * includes the replay window.
+ */
+void
+secure_benchmark(void)
+{
+  static const int sizes[] = { 64, 512, 1400 };
+  static uint8_t buf[1500 + 64];
+  const int rounds = 20000;
+  struct hmac_sha256_key saved_key = hmac_key;
+  unsigned int s;
+
+  hmac_sha256_setkey(&hmac_key, aes_key, KEYLENGTH);
+
+  olsr_printf(0, "[ENC]Benchmark %d packets per size: packets/s\n", rounds);
+  olsr_printf(0, "[ENC]%6s %12s %12s %12s %12s\n", "size", "legacy sign", "legacy check", "hmac sign", "hmac check");
+
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    uint64_t nsec[4] = { 0, 0, 0, 0 };
+    int scheme, r;
+
+    for (scheme = 0; scheme < 2; scheme++) {
+      for (r = 0; r < rounds; r++) {
+        struct olsr_ptf_packet pkt;
+        struct iovec iov[2];
+        struct timespec start;
+        int size;
+
+        memset(buf, r, sizes[s]);
+        iov[0].iov_base = buf;
+        iov[0].iov_len = sizes[s];
+        pkt.ifp = NULL;
+        pkt.iov = iov;
+        pkt.iovcnt = 1;
+        pkt.len = sizes[s];
+        pkt.tail = buf + sizes[s];
+        pkt.tail_room = sizeof(buf) - sizes[s];
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (scheme == 0) {
+          sign_packet(&pkt);
+        } else {
+          sign_packet_hmac(&pkt);
+        }
+        nsec[2 * scheme] += bench_nsec(&start);
+
+        size = pkt.len;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (scheme == 0) {
+          CHECKSUM_CTX context;
+          uint8_t hash[SIGNATURE_SIZE];
+
+          CHECKSUM_INIT(&context);
+          CHECKSUM_UPDATE(&context, buf, size - SIGNATURE_SIZE);
+          CHECKSUM_UPDATE(&context, aes_key, KEYLENGTH);
+          CHECKSUM_FINAL(&context, hash);
+          if (memcmp(hash, buf + size - SIGNATURE_SIZE, SIGNATURE_SIZE) != 0) {
+            olsr_printf(0, "[ENC]Benchmark: legacy signature broken\n");
+          }
+        } else if (!validate_packet_hmac((const char *)buf, &size)) {
+          olsr_printf(0, "[ENC]Benchmark: HMAC signature broken\n");
+        }
+        nsec[2 * scheme + 1] += bench_nsec(&start);
+      }
+    }
+
+    olsr_printf(0, "[ENC]%6d %12.0f %12.0f %12.0f %12.0f\n", sizes[s],
+                rounds * 1e9 / nsec[0], rounds * 1e9 / nsec[1], rounds * 1e9 / nsec[2], rounds * 1e9 / nsec[3]);
+  }
+
+  hmac_key = saved_key;
+}
+#endif /* SECURE_PROFILING */
+
 /*
  * Local Variables:
  * c-basic-offset: 2
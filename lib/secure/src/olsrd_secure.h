@@ -62,6 +62,11 @@
 /* Algorithm definitions */
 #define SHA1_INCLUDING_KEY   1
 #define MD5_INCLUDING_KEY   2
+#define HMAC_SHA256         3
+
+/* Values of the "Scheme" plugin parameter */
+#define SECURE_SCHEME_LEGACY      0   /* keyed SHA-1/MD5 + timestamp exchange */
+#define SECURE_SCHEME_HMAC_SHA256 1   /* HMAC-SHA256 + sequence number window */
 
 #ifdef USE_OPENSSL
 #define SIGNATURE_SIZE 20
@@ -76,6 +81,14 @@
 
 extern char aes_key[16];
 
+extern int secure_scheme;
+
+/* Packets a replayed or reordered sequence number may lag behind */
+#define REPLAY_WINDOW 64
+
+/* Epochs below this (2010-01-01) come from a clock that was never set */
+#define EPOCH_MIN_CLOCK 1262304000U
+
 /* Seconds of slack allowed */
 #define SLACK 3
 
@@ -83,6 +96,10 @@ int secure_plugin_init(void);
 
 void secure_plugin_exit(void);
 
+#ifdef SECURE_PROFILING
+void secure_benchmark(void);
+#endif /* SECURE_PROFILING */
+
 int plugin_ipc_init(void);
 
 #endif /* _OLSRD_SECURE_H */
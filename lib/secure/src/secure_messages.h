@@ -73,6 +73,7 @@
 #define TYPE_RRESPONSE 13
 
 extern char keyfile[FILENAME_MAX + 1];
+extern char epochfile[FILENAME_MAX + 1];
 
 #ifdef USE_OPENSSL
 #define SIGSIZE   20
@@ -93,6 +94,26 @@ struct sig_msg {
   uint8_t signature[SIGSIZE];
 };
 
+/*
+ * Signature of the HMAC-SHA256 scheme. It follows an OLSR message
+ * header whose originator is olsr_cnf->ipsize bytes long, so unlike
+ * sig_msg it works the same for IPv4 and IPv6 and has no time_t.
+ * The (epoch, seqno) pair replaces the timestamp exchange: the epoch
+ * changes whenever the sender restarts, the sequence number counts
+ * its packets within that epoch.
+ */
+#define HMAC_SIGSIZE 16
+
+struct hmac_sig_msg {
+  uint8_t type;
+  uint8_t algorithm;
+  uint16_t reserved;
+
+  uint32_t epoch;
+  uint32_t seqno;
+  uint8_t signature[HMAC_SIGSIZE];
+};
+
 /*
  * OLSR message (several can exist in one OLSR packet)
  */
@@ -0,0 +1,262 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+#include "sha256.h"
+
+#include <string.h>
+
+static const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define EP0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define EP1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static void
+sha256_transform(uint32_t state[8], const uint8_t block[SHA256_BLOCK_SIZE])
+{
+  uint32_t w[64];
+  uint32_t a, b, c, d, e, f, g, h;
+  int i;
+
+  for (i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16)
+      | ((uint32_t)block[4 * i + 2] << 8) | (uint32_t)block[4 * i + 3];
+  }
+  for (; i < 64; i++) {
+    w[i] = SIG1(w[i - 2]) + w[i - 7] + SIG0(w[i - 15]) + w[i - 16];
+  }
+
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+  f = state[5];
+  g = state[6];
+  h = state[7];
+
+  for (i = 0; i < 64; i++) {
+    uint32_t t1 = h + EP1(e) + CH(e, f, g) + K[i] + w[i];
+    uint32_t t2 = EP0(a) + MAJ(a, b, c);
+
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+void
+sha256_init(struct sha256_ctx *ctx)
+{
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->count = 0;
+}
+
+void
+sha256_update(struct sha256_ctx *ctx, const void *data, size_t len)
+{
+  const uint8_t *ptr = data;
+  size_t fill = ctx->count % SHA256_BLOCK_SIZE;
+
+  ctx->count += len;
+
+  /* complete a partial block first */
+  if (fill > 0) {
+    size_t n = SHA256_BLOCK_SIZE - fill;
+
+    if (len < n) {
+      memcpy(&ctx->buffer[fill], ptr, len);
+      return;
+    }
+    memcpy(&ctx->buffer[fill], ptr, n);
+    sha256_transform(ctx->state, ctx->buffer);
+    ptr += n;
+    len -= n;
+  }
+
+  /* then hash full blocks directly from the input */
+  while (len >= SHA256_BLOCK_SIZE) {
+    sha256_transform(ctx->state, ptr);
+    ptr += SHA256_BLOCK_SIZE;
+    len -= SHA256_BLOCK_SIZE;
+  }
+
+  if (len > 0) {
+    memcpy(ctx->buffer, ptr, len);
+  }
+}
+
+void
+sha256_final(struct sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  uint64_t bits = ctx->count * 8;
+  size_t fill = ctx->count % SHA256_BLOCK_SIZE;
+  int i;
+
+  /* padding: 0x80, zeros, then the 64 bit length in bits */
+  ctx->buffer[fill++] = 0x80;
+  if (fill > SHA256_BLOCK_SIZE - 8) {
+    memset(&ctx->buffer[fill], 0, SHA256_BLOCK_SIZE - fill);
+    sha256_transform(ctx->state, ctx->buffer);
+    fill = 0;
+  }
+  memset(&ctx->buffer[fill], 0, SHA256_BLOCK_SIZE - 8 - fill);
+  for (i = 0; i < 8; i++) {
+    ctx->buffer[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+  }
+  sha256_transform(ctx->state, ctx->buffer);
+
+  for (i = 0; i < 8; i++) {
+    digest[4 * i] = (uint8_t)(ctx->state[i] >> 24);
+    digest[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+    digest[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+    digest[4 * i + 3] = (uint8_t)ctx->state[i];
+  }
+}
+
+/**
+ * Precompute the HMAC-SHA256 key schedule
+ *
+ * @param hkey key schedule to fill
+ * @param key the secret
+ * @param keylen length of the secret, keys longer than
+ *   a block are hashed first as RFC 2104 requires
+ */
+void
+hmac_sha256_setkey(struct hmac_sha256_key *hkey, const void *key, size_t keylen)
+{
+  uint8_t block[SHA256_BLOCK_SIZE];
+  size_t i;
+
+  memset(block, 0, sizeof(block));
+  if (keylen > SHA256_BLOCK_SIZE) {
+    struct sha256_ctx ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, key, keylen);
+    sha256_final(&ctx, block);
+  } else {
+    memcpy(block, key, keylen);
+  }
+
+  for (i = 0; i < SHA256_BLOCK_SIZE; i++) {
+    block[i] ^= 0x36;
+  }
+  sha256_init(&hkey->inner);
+  sha256_update(&hkey->inner, block, SHA256_BLOCK_SIZE);
+
+  /* 0x36 ^ 0x5c turns the ipad block into the opad block */
+  for (i = 0; i < SHA256_BLOCK_SIZE; i++) {
+    block[i] ^= 0x36 ^ 0x5c;
+  }
+  sha256_init(&hkey->outer);
+  sha256_update(&hkey->outer, block, SHA256_BLOCK_SIZE);
+
+  memset(block, 0, sizeof(block));
+}
+
+/**
+ * Start a MAC, the context then takes the message
+ * through sha256_update()
+ */
+void
+hmac_sha256_init(const struct hmac_sha256_key *hkey, struct sha256_ctx *ctx)
+{
+  *ctx = hkey->inner;
+}
+
+/**
+ * Finish a MAC started with hmac_sha256_init()
+ */
+void
+hmac_sha256_final(const struct hmac_sha256_key *hkey, struct sha256_ctx *ctx, uint8_t mac[SHA256_DIGEST_SIZE])
+{
+  uint8_t inner[SHA256_DIGEST_SIZE];
+
+  sha256_final(ctx, inner);
+  *ctx = hkey->outer;
+  sha256_update(ctx, inner, sizeof(inner));
+  sha256_final(ctx, mac);
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,89 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+/*
+ * SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104) for the secure plugin
+ */
+
+#ifndef _SHA256_H_
+#define _SHA256_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA256_BLOCK_SIZE  64
+#define SHA256_DIGEST_SIZE 32
+
+struct sha256_ctx {
+  uint32_t state[8];
+  uint64_t count;                      /* number of bytes hashed so far */
+  uint8_t buffer[SHA256_BLOCK_SIZE];
+};
+
+/*
+ * Key schedule of HMAC-SHA256: the hash states after the
+ * key XOR ipad and key XOR opad blocks. Computed once when
+ * the key is loaded, every MAC then starts from a copy.
+ */
+struct hmac_sha256_key {
+  struct sha256_ctx inner;
+  struct sha256_ctx outer;
+};
+
+void sha256_init(struct sha256_ctx *);
+void sha256_update(struct sha256_ctx *, const void *, size_t);
+void sha256_final(struct sha256_ctx *, uint8_t[SHA256_DIGEST_SIZE]);
+
+void hmac_sha256_setkey(struct hmac_sha256_key *, const void *, size_t);
+void hmac_sha256_init(const struct hmac_sha256_key *, struct sha256_ctx *);
+void hmac_sha256_final(const struct hmac_sha256_key *, struct sha256_ctx *, uint8_t[SHA256_DIGEST_SIZE]);
+
+#endif /* _SHA256_H_ */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
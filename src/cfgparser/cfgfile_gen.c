@@ -442,6 +442,31 @@ void olsrd_write_cnf_autobuf_uncached(struct autobuf *out, struct olsrd_config *
   abuf_appendf(out, "%sFIBMetricDefault %u\n",
       cnf->fib_metric_default == DEF_FIB_METRIC_DEFAULT? "# " : "",
       cnf->fib_metric_default);
+  abuf_appendf(out,
+    "\n"
+    "# SpfMode controls how the routing table is recalculated.\n"
+    "# - \"full\" runs a complete Dijkstra over the topology on every change.\n"
+    "# - \"incremental\" only repairs the part of the shortest path tree that\n"
+    "#   is affected by changed topology edges. A full run is still done when\n"
+    "#   the main address or the set of 1-hop neighbors changes.\n"
+    "# - \"check\" runs both and reports differences (for debugging only)\n"
+    "# (default is \"%s\")\n"
+    "\n", SPF_MODE_TXT[DEF_SPF_MODE]);
+  abuf_appendf(out, "%sSpfMode \"%s\"\n",
+      cnf->spf_mode == DEF_SPF_MODE ? "# " : "",
+      SPF_MODE_TXT[cnf->spf_mode]);
+  abuf_appendf(out,
+    "\n"
+    "# MprMode controls how the MPR set is recalculated.\n"
+    "# - \"full\" runs the MPR selection over all neighbors on every change.\n"
+    "# - \"incremental\" keeps the coverage of every 2-hop neighbor and only\n"
+    "#   repairs the coverage of 2-hop neighbors affected by a change.\n"
+    "# - \"check\" runs both and reports differences (for debugging only)\n"
+    "# (default is \"%s\")\n"
+    "\n", MPR_MODE_TXT[DEF_MPR_MODE]);
+  abuf_appendf(out, "%sMprMode \"%s\"\n",
+      cnf->mpr_mode == DEF_MPR_MODE ? "# " : "",
+      MPR_MODE_TXT[cnf->mpr_mode]);
   abuf_appendf(out,
     "\n"
     "#######################################\n"
@@ -1102,6 +1127,37 @@ void olsrd_write_cnf_autobuf_uncached(struct autobuf *out, struct olsrd_config *
   abuf_appendf(out, "%sLinkQualityFishEye  %d\n",
       cnf->lq_fish == DEF_LQ_FISH ? "# " : "",
       cnf->lq_fish);
+  {
+    static const uint8_t default_lq_fish_ttl[] = DEF_LQ_FISH_TTL;
+    bool is_default = cnf->lq_fish_ttl_cnt == sizeof(default_lq_fish_ttl)
+        && memcmp(cnf->lq_fish_ttl, default_lq_fish_ttl, sizeof(default_lq_fish_ttl)) == 0;
+    int i;
+
+    abuf_appendf(out,
+      "\n"
+      "# TTL sequence of the fisheye mechanism, the TCs cycle through it.\n"
+      "# Near nodes get every TC, far away nodes only the ones with a large\n"
+      "# TTL. The validity time of a TC is raised to at least three times\n"
+      "# the interval until the next TC reaching as far. The sequence must\n"
+      "# contain 255.\n"
+      "# (default is \"2 8 2 16 2 8 2 255\")\n"
+      "\n");
+    abuf_appendf(out, "%sLinkQualityFishEyeTtl \"", is_default ? "# " : "");
+    for (i = 0; i < cnf->lq_fish_ttl_cnt; i++) {
+      abuf_appendf(out, "%s%u", i ? " " : "", cnf->lq_fish_ttl[i]);
+    }
+    abuf_appendf(out, "\"\n");
+  }
+  abuf_appendf(out,
+    "\n"
+    "# Delta TCs, only the changed edges are sent between full TCs.\n"
+    "# Every n-th TC of an interface is a full one, 0 disables deltas.\n"
+    "# Nodes running older versions can only use the full TCs.\n"
+    "# (default is %u)\n"
+    "\n", DEF_TC_DELTA_REFRESH);
+  abuf_appendf(out, "%sTcDeltaRefresh  %d\n",
+      cnf->tc_delta_refresh == DEF_TC_DELTA_REFRESH ? "# " : "",
+      cnf->tc_delta_refresh);
   abuf_appendf(out,
     "\n"
     "#\n"
@@ -89,6 +89,20 @@ const char *FIB_METRIC_TXT[] = {
   "approx",
 };
 
+const char *SPF_MODE_TXT[] = {
+  "full",
+  "incremental",
+  "check",
+};
+
+const char *MPR_MODE_TXT[] = {
+  "full",
+  "incremental",
+  "check",
+};
+
+static const uint8_t default_lq_fish_ttl[] = DEF_LQ_FISH_TTL;
+
 const char *GW_UPLINK_TXT[] = {
   "none",
   "ipv4",
@@ -627,6 +641,22 @@ olsrd_sanity_check_cnf(struct olsrd_config *cnf)
     return -1;
   }
 
+  /* Fisheye, some TCs must reach the whole mesh */
+  if (cnf->lq_fish) {
+    bool mesh_wide = false;
+    int i;
+
+    for (i = 0; i < cnf->lq_fish_ttl_cnt; i++) {
+      if (cnf->lq_fish_ttl[i] == MAX_TTL) {
+        mesh_wide = true;
+      }
+    }
+    if (!mesh_wide) {
+      fprintf(stderr, "LQ fish eye TTL sequence must contain %d\n", MAX_TTL);
+      return -1;
+    }
+  }
+
   /* Link quality window size */
   if (cnf->lq_level && (cnf->lq_aging < (float)MIN_LQ_AGING || cnf->lq_aging > (float)MAX_LQ_AGING)) {
     fprintf(stderr, "LQ aging factor %f is not allowed\n", (double)cnf->lq_aging);
@@ -1100,6 +1130,8 @@ set_default_cnf(struct olsrd_config *cnf, char * configuration_file)
   cnf->use_hysteresis = DEF_USE_HYST;
   cnf->fib_metric = DEF_FIB_METRIC;
   cnf->fib_metric_default = DEF_FIB_METRIC_DEFAULT;
+  cnf->spf_mode = DEF_SPF_MODE;
+  cnf->mpr_mode = DEF_MPR_MODE;
   cnf->hysteresis_param.scaling = HYST_SCALING;cnf->hysteresis_param.thr_high = HYST_THRESHOLD_HIGH;cnf->hysteresis_param.thr_low = HYST_THRESHOLD_LOW;
   cnf->plugins = NULL;
   cnf->hna_entries = NULL;
@@ -1113,6 +1145,9 @@ set_default_cnf(struct olsrd_config *cnf, char * configuration_file)
   cnf->mpr_coverage = MPR_COVERAGE;
   cnf->lq_level = DEF_LQ_LEVEL;
   cnf->lq_fish = DEF_LQ_FISH;
+  memcpy(cnf->lq_fish_ttl, default_lq_fish_ttl, sizeof(default_lq_fish_ttl));
+  cnf->lq_fish_ttl_cnt = sizeof(default_lq_fish_ttl);
+  cnf->tc_delta_refresh = DEF_TC_DELTA_REFRESH;
   cnf->lq_aging = DEF_LQ_AGING;
   cnf->lq_algorithm = NULL;
 
@@ -1230,6 +1265,7 @@ olsrd_print_cnf(struct olsrd_config *cnf)
   struct olsr_if *in = cnf->interfaces;
   struct plugin_entry *pe = cnf->plugins;
   struct ip_prefix_list *ie = cnf->ipc_nets;
+  int i;
 
   printf(" *** olsrd configuration ***\n");
 
@@ -1275,12 +1311,24 @@ olsrd_print_cnf(struct olsrd_config *cnf)
 
   printf("LQ fish eye      : %d\n", cnf->lq_fish);
 
+  printf("LQ fish eye TTLs :");
+  for (i = 0; i < cnf->lq_fish_ttl_cnt; i++) {
+    printf(" %u", cnf->lq_fish_ttl[i]);
+  }
+  printf("\n");
+
+  printf("TC delta refresh : %d\n", cnf->tc_delta_refresh);
+
   printf("LQ aging factor  : %f\n", (double)cnf->lq_aging);
 
   printf("LQ algorithm name: %s\n", cnf->lq_algorithm ? cnf->lq_algorithm : "default");
 
   printf("NAT threshold    : %f\n", (double)cnf->lq_nat_thresh);
 
+  printf("SPF mode         : %s\n", SPF_MODE_TXT[cnf->spf_mode]);
+
+  printf("MPR mode         : %s\n", MPR_MODE_TXT[cnf->mpr_mode]);
+
   printf("Clear screen     : %s\n", cnf->clear_screen ? "yes" : "no");
 
   printf("Use niit         : %s\n", cnf->use_niit ? "yes" : "no");
@@ -203,6 +203,8 @@ static int add_ipv6_addr(YYSTYPE ipaddr_arg, YYSTYPE prefixlen_arg)
 %token TOK_IPCCON
 %token TOK_FIBMETRIC
 %token TOK_FIBMETRICDEFAULT
+%token TOK_SPFMODE
+%token TOK_MPRMODE
 %token TOK_USEHYST
 %token TOK_HYSTSCALE
 %token TOK_HYSTUPPER
@@ -213,6 +215,8 @@ static int add_ipv6_addr(YYSTYPE ipaddr_arg, YYSTYPE prefixlen_arg)
 %token TOK_MPRCOVERAGE
 %token TOK_LQ_LEVEL
 %token TOK_LQ_FISH
+%token TOK_LQ_FISH_TTL
+%token TOK_TC_DELTA_REFRESH
 %token TOK_LQ_AGING
 %token TOK_LQ_PLUGIN
 %token TOK_LQ_NAT_THRESH
@@ -292,6 +296,8 @@ stmt:       idebug
           | iipversion
           | fibmetric
           | afibmetricdefault
+          | sspfmode
+          | smprmode
           | bnoint
           | atos
           | aolsrport
@@ -315,6 +321,8 @@ stmt:       idebug
           | alq_level
           | alq_plugin
           | alq_fish
+          | alq_fish_ttl
+          | atc_delta_refresh
           | anat_thresh
           | alq_aging
           | bclear_screen
@@ -887,6 +895,46 @@ afibmetricdefault: TOK_FIBMETRICDEFAULT TOK_INTEGER
 }
 ;
 
+sspfmode:     TOK_SPFMODE TOK_STRING
+{
+  int i;
+  PARSER_DEBUG_PRINTF("SpfMode: %s\n", $2->string);
+  for (i=0; i<SPFM_CNT; i++) {
+    if (strcmp($2->string, SPF_MODE_TXT[i]) == 0) {
+      olsr_cnf->spf_mode = i;
+      break;
+    }
+  }
+  if (i == SPFM_CNT) {
+    fprintf(stderr, "Bad SpfMode value: %s\n", $2->string);
+    YYABORT;
+  }
+  free($1);
+  free($2->string);
+  free($2);
+}
+;
+
+smprmode:     TOK_MPRMODE TOK_STRING
+{
+  int i;
+  PARSER_DEBUG_PRINTF("MprMode: %s\n", $2->string);
+  for (i=0; i<MPRM_CNT; i++) {
+    if (strcmp($2->string, MPR_MODE_TXT[i]) == 0) {
+      olsr_cnf->mpr_mode = i;
+      break;
+    }
+  }
+  if (i == MPRM_CNT) {
+    fprintf(stderr, "Bad MprMode value: %s\n", $2->string);
+    YYABORT;
+  }
+  free($1);
+  free($2->string);
+  free($2);
+}
+;
+
 ihna4entry:     TOK_IPV4_ADDR TOK_IPV4_ADDR
 {
   union olsr_ip_addr ipaddr, netmask;
@@ -1281,6 +1329,43 @@ alq_fish: TOK_LQ_FISH TOK_INTEGER
 }
 ;
 
+alq_fish_ttl: TOK_LQ_FISH_TTL TOK_STRING
+{
+  char *ptr = $2->string, *end;
+  unsigned long ttl;
+
+  PARSER_DEBUG_PRINTF("Link quality fish eye TTLs %s\n", $2->string);
+  olsr_cnf->lq_fish_ttl_cnt = 0;
+  while (*ptr) {
+    if (*ptr == ' ' || *ptr == ',') {
+      ptr++;
+      continue;
+    }
+    ttl = strtoul(ptr, &end, 10);
+    if (end == ptr || ttl == 0 || ttl > MAX_TTL || olsr_cnf->lq_fish_ttl_cnt == MAX_LQ_FISH_TTL) {
+      fprintf(stderr, "Bad LinkQualityFishEyeTtl value: %s\n", $2->string);
+      YYABORT;
+    }
+    olsr_cnf->lq_fish_ttl[olsr_cnf->lq_fish_ttl_cnt++] = ttl;
+    ptr = end;
+  }
+  if (olsr_cnf->lq_fish_ttl_cnt == 0) {
+    fprintf(stderr, "Empty LinkQualityFishEyeTtl value\n");
+    YYABORT;
+  }
+  free($2->string);
+  free($2);
+}
+;
+
+atc_delta_refresh: TOK_TC_DELTA_REFRESH TOK_INTEGER
+{
+  PARSER_DEBUG_PRINTF("TC delta refresh %d\n", $2->integer);
+  olsr_cnf->tc_delta_refresh = $2->integer;
+  free($2);
+}
+;
+
 alq_aging: TOK_LQ_AGING TOK_FLOAT
 {
   PARSER_DEBUG_PRINTF("Link quality aging factor %f\n", (double)$2->floating);
@@ -0,0 +1,405 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include "common/hashtable.h"
+#include "hashing.h"
+#include "ipcalc.h"
+#include "olsr.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HASHTABLE_KEY(table, item) ((const uint8_t *)(item) + (table)->key_offset)
+
+/* distance of the item in a slot from its home slot */
+#define HASHTABLE_DIST(table, slot_idx) (((slot_idx) - (table)->slots[slot_idx].hash) & ((table)->size - 1))
+
+/**
+ * Hash a key. Mixes the key in 32 bit words and finishes
+ * with the MurmurHash3 avalanche, which is a lot cheaper
+ * than the Jenkins lookup2 hash for 4 and 16 byte addresses.
+ *
+ * @param key pointer to the key
+ * @param len length of the key
+ * @return the hash value
+ */
+uint32_t
+hashtable_hash(const void *key, size_t len)
+{
+  const uint8_t *k = key;
+  uint32_t h = 0x9e3779b9 ^ (uint32_t)len;
+  uint32_t w;
+
+  while (len >= sizeof(w)) {
+    memcpy(&w, k, sizeof(w));
+    h = (h ^ w) * 0x85ebca6b;
+    h ^= h >> 15;
+    k += sizeof(w);
+    len -= sizeof(w);
+  }
+  while (len > 0) {
+    h = (h ^ *k++) * 0x85ebca6b;
+    len--;
+  }
+
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+/**
+ * Initialize an empty hash table, no memory is allocated
+ * before the first insert.
+ *
+ * @param table the table
+ * @param key_offset offset of the key inside the items
+ * @param key_len length of the key
+ */
+void
+hashtable_init(struct hashtable *table, size_t key_offset, size_t key_len)
+{
+  memset(table, 0, sizeof(*table));
+  table->key_offset = key_offset;
+  table->key_len = key_len;
+}
+
+/**
+ * Remove all items and release the slots.
+ *
+ * @param table the table
+ */
+void
+hashtable_flush(struct hashtable *table)
+{
+  free(table->slots);
+  table->slots = NULL;
+  table->size = 0;
+  table->count = 0;
+}
+
+/*
+ * Place an item which is known not to be in the table,
+ * moving richer items out of the way.
+ */
+static void
+hashtable_place(struct hashtable *table, uint32_t hash, void *item)
+{
+  uint32_t mask = table->size - 1;
+  uint32_t idx = hash & mask;
+  uint32_t dist = 0;
+
+  for (;;) {
+    struct hashtable_slot *slot = &table->slots[idx];
+    uint32_t slot_dist;
+
+    if (slot->item == NULL) {
+      slot->hash = hash;
+      slot->item = item;
+      return;
+    }
+
+    slot_dist = HASHTABLE_DIST(table, idx);
+    if (slot_dist < dist) {
+      /* robin hood: take the slot from the item closer to its home */
+      uint32_t tmp_hash = slot->hash;
+      void *tmp_item = slot->item;
+
+      slot->hash = hash;
+      slot->item = item;
+      hash = tmp_hash;
+      item = tmp_item;
+      dist = slot_dist;
+    }
+
+    idx = (idx + 1) & mask;
+    dist++;
+  }
+}
+
+static void
+hashtable_resize(struct hashtable *table, uint32_t size)
+{
+  struct hashtable_slot *old_slots = table->slots;
+  uint32_t old_size = table->size;
+  uint32_t i;
+
+  table->slots = olsr_malloc(sizeof(*table->slots) * size, "hashtable slots");
+  table->size = size;
+
+  for (i = 0; i < old_size; i++) {
+    if (old_slots[i].item) {
+      hashtable_place(table, old_slots[i].hash, old_slots[i].item);
+    }
+  }
+  free(old_slots);
+}
+
+/*
+ * Find the slot of the item with the given key,
+ * return the table size if it is not indexed.
+ */
+static uint32_t
+hashtable_lookup(const struct hashtable *table, uint32_t hash, const void *key)
+{
+  uint32_t mask = table->size - 1;
+  uint32_t idx = hash & mask;
+  uint32_t dist = 0;
+
+  if (table->count == 0) {
+    return table->size;
+  }
+
+  for (;;) {
+    const struct hashtable_slot *slot = &table->slots[idx];
+
+    if (slot->item == NULL || HASHTABLE_DIST(table, idx) < dist) {
+      return table->size;
+    }
+    if (slot->hash == hash && memcmp(HASHTABLE_KEY(table, slot->item), key, table->key_len) == 0) {
+      return idx;
+    }
+
+    idx = (idx + 1) & mask;
+    dist++;
+  }
+}
+
+/**
+ * Look up an item by its key.
+ *
+ * @param table the table
+ * @param key pointer to the key
+ * @return the item or NULL if not found
+ */
+void *
+hashtable_find(const struct hashtable *table, const void *key)
+{
+  uint32_t idx = hashtable_lookup(table, hashtable_hash(key, table->key_len), key);
+
+  return idx < table->size ? table->slots[idx].item : NULL;
+}
+
+/**
+ * Index an item. If an item with the same key is indexed
+ * already it is replaced.
+ *
+ * @param table the table
+ * @param item the item to add
+ * @return the replaced item or NULL
+ */
+void *
+hashtable_insert(struct hashtable *table, void *item)
+{
+  const void *key = HASHTABLE_KEY(table, item);
+  uint32_t hash = hashtable_hash(key, table->key_len);
+  uint32_t idx = hashtable_lookup(table, hash, key);
+
+  if (idx < table->size) {
+    void *old = table->slots[idx].item;
+
+    table->slots[idx].item = item;
+    return old;
+  }
+
+  /* keep the load factor below 3/4 */
+  if ((table->count + 1) * 4 > table->size * 3) {
+    hashtable_resize(table, table->size ? table->size * 2 : HASHTABLE_MIN_SIZE);
+  }
+
+  hashtable_place(table, hash, item);
+  table->count++;
+  return NULL;
+}
+
+/**
+ * Remove an item from the index.
+ *
+ * @param table the table
+ * @param item the item to remove
+ * @return true if the item was indexed
+ */
+bool
+hashtable_remove(struct hashtable *table, void *item)
+{
+  const void *key = HASHTABLE_KEY(table, item);
+  uint32_t idx = hashtable_lookup(table, hashtable_hash(key, table->key_len), key);
+  uint32_t mask = table->size - 1;
+  uint32_t next;
+
+  if (idx == table->size || table->slots[idx].item != item) {
+    return false;
+  }
+
+  /* backward shift the following items of the cluster */
+  for (next = (idx + 1) & mask; table->slots[next].item && HASHTABLE_DIST(table, next) > 0; next = (next + 1) & mask) {
+    table->slots[idx] = table->slots[next];
+    idx = next;
+  }
+  table->slots[idx].item = NULL;
+  table->count--;
+
+  /* shrink below 1/8 usage */
+  if (table->size > HASHTABLE_MIN_SIZE && table->count * 8 < table->size) {
+    hashtable_resize(table, table->size / 2);
+  }
+  return true;
+}
+
+#ifdef HASH_PROFILING
+#include <time.h>
+
+struct hashtable_bench_item {
+  union olsr_ip_addr addr;
+  struct hashtable_bench_item *next;
+};
+
+static uint32_t
+hashtable_bench_random(uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 1;
+}
+
+static long
+hashtable_bench_usec(const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+/*
+ * Compare lookups in HASHSIZE chained buckets, the layout of the
+ * neighbor, two hop, MID and HNA sets before, with the open addressing
+ * table. Half of the lookups are misses.
+ */
+static void
+hashtable_bench_run(unsigned int count)
+{
+  const unsigned int lookups = 2000000;
+  struct hashtable_bench_item *items, *chains[HASHSIZE];
+  struct hashtable table;
+  struct timespec t1, t2, t3;
+  uint32_t seed = count;
+  unsigned int i, chain_hits = 0, table_hits = 0;
+  long chain_time, table_time;
+
+  items = olsr_malloc(sizeof(*items) * count, "hash benchmark");
+  memset(chains, 0, sizeof(chains));
+  hashtable_init(&table, offsetof(struct hashtable_bench_item, addr), olsr_cnf->ipsize);
+
+  for (i = 0; i < count; i++) {
+    uint32_t h;
+
+    /* even host parts are present, odd ones are misses */
+    items[i].addr.v4.s_addr = htonl(0x0a000000 + i * 2);
+    h = olsr_ip_hashing(&items[i].addr);
+    items[i].next = chains[h];
+    chains[h] = &items[i];
+    hashtable_insert(&table, &items[i]);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  for (i = 0; i < lookups; i++) {
+    union olsr_ip_addr addr;
+    struct hashtable_bench_item *item;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.v4.s_addr = htonl(0x0a000000 + hashtable_bench_random(&seed) % (count * 2));
+    for (item = chains[olsr_ip_hashing(&addr)]; item; item = item->next) {
+      if (ipequal(&item->addr, &addr)) {
+        chain_hits++;
+        break;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  seed = count;
+  for (i = 0; i < lookups; i++) {
+    union olsr_ip_addr addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.v4.s_addr = htonl(0x0a000000 + hashtable_bench_random(&seed) % (count * 2));
+    if (hashtable_find(&table, &addr)) {
+      table_hits++;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+
+  chain_time = hashtable_bench_usec(&t1, &t2);
+  table_time = hashtable_bench_usec(&t2, &t3);
+  OLSR_PRINTF(1, "--- HASH-benchmark for %u entries (chains/table): %ld, %ld (lookups/msec)%s\n", //
+      count, //
+      chain_time ? (long)lookups * 1000 / chain_time : 0, //
+      table_time ? (long)lookups * 1000 / table_time : 0, //
+      chain_hits != table_hits ? ", RESULT MISMATCH" : "");
+
+  hashtable_flush(&table);
+  free(items);
+}
+
+/**
+ * Benchmark lookups for sets of 1k, 10k and 100k addresses.
+ */
+void
+hashtable_benchmark(void)
+{
+  if (olsr_cnf->ip_version != AF_INET) {
+    return;
+  }
+  hashtable_bench_run(1000);
+  hashtable_bench_run(10000);
+  hashtable_bench_run(100000);
+}
+#endif /* HASH_PROFILING */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,95 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef _HASHTABLE_H
+#define _HASHTABLE_H
+
+#include <stddef.h>
+#include "defs.h"
+
+/*
+ * Resizable open addressing hash table with robin hood probing.
+ *
+ * The table stores pointers to items, the key is a fixed length
+ * byte string at a fixed offset inside of each item. Every key is
+ * indexed at most once, inserting an item with an existing key
+ * replaces the indexed item.
+ */
+
+#define HASHTABLE_MIN_SIZE 16
+
+struct hashtable_slot {
+  uint32_t hash;
+  void *item;                          /* NULL if the slot is empty */
+};
+
+struct hashtable {
+  struct hashtable_slot *slots;
+  uint32_t size;                       /* number of slots, power of two */
+  uint32_t count;                      /* number of items */
+  size_t key_offset;                   /* offset of the key in an item */
+  size_t key_len;
+};
+
+uint32_t hashtable_hash(const void *key, size_t len);
+
+void hashtable_init(struct hashtable *, size_t key_offset, size_t key_len);
+void hashtable_flush(struct hashtable *);
+void *hashtable_find(const struct hashtable *, const void *key);
+void *hashtable_insert(struct hashtable *, void *item);
+bool hashtable_remove(struct hashtable *, void *item);
+
+#ifdef HASH_PROFILING
+void hashtable_benchmark(void);
+#endif /* HASH_PROFILING */
+
+#endif /* _HASHTABLE_H */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
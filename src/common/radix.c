@@ -0,0 +1,475 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include "common/radix.h"
+#include "common/avl.h"
+#include "olsr.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* a branch node, it owns a copy of the key */
+struct radix_glue {
+  struct radix_node node;
+  uint8_t key[RADIX_MAX_KEY_LEN];
+};
+
+/* value of a single bit of the key, bit 0 is the MSB of the first byte */
+static INLINE unsigned int
+radix_bit(const uint8_t *key, unsigned int bit)
+{
+  return (key[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+/*
+ * Check if the first bits of two keys are equal. The bits before
+ * 'from' are known to match already.
+ */
+static INLINE bool
+radix_match(const uint8_t *a, const uint8_t *b, unsigned int from, unsigned int bits)
+{
+  unsigned int i;
+
+  for (i = from >> 3; i < (bits >> 3); i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  if (bits & 7) {
+    return ((a[i] ^ b[i]) & (0xff << (8 - (bits & 7)))) == 0;
+  }
+  return true;
+}
+
+/* number of leading bits two keys have in common, at most max */
+static unsigned int
+radix_common_bits(const uint8_t *a, const uint8_t *b, unsigned int max)
+{
+  unsigned int bits = 0, i;
+
+  for (i = 0; bits < max; i++) {
+    uint8_t diff = a[i] ^ b[i];
+
+    if (diff) {
+      while (!(diff & 0x80)) {
+        diff <<= 1;
+        bits++;
+      }
+      break;
+    }
+    bits += 8;
+  }
+  return MIN(bits, max);
+}
+
+static struct radix_node *
+radix_alloc_glue(const struct radix_tree *tree, const void *key, unsigned int prefix_len)
+{
+  struct radix_glue *glue = olsr_malloc(sizeof(*glue), "radix glue node");
+
+  memcpy(glue->key, key, tree->key_len);
+  glue->node.key = glue->key;
+  glue->node.prefix_len = prefix_len;
+  glue->node.glue = true;
+  return &glue->node;
+}
+
+/* hook a node (or NULL) into the place of another one */
+static void
+radix_relink(struct radix_tree *tree, struct radix_node *old, struct radix_node *node)
+{
+  struct radix_node *parent = old->parent;
+
+  if (node) {
+    node->parent = parent;
+  }
+  if (parent == NULL) {
+    tree->root = node;
+  } else {
+    parent->child[parent->child[0] == old ? 0 : 1] = node;
+  }
+}
+
+/* move the children of a node to another one */
+static void
+radix_adopt(struct radix_node *node, struct radix_node *old)
+{
+  unsigned int i;
+
+  for (i = 0; i < 2; i++) {
+    node->child[i] = old->child[i];
+    if (node->child[i]) {
+      node->child[i]->parent = node;
+    }
+  }
+}
+
+/**
+ * Initialize an empty radix tree.
+ *
+ * @param tree the tree
+ * @param key_len length of the keys in bytes, at most RADIX_MAX_KEY_LEN
+ */
+void
+radix_init(struct radix_tree *tree, unsigned int key_len)
+{
+  tree->root = NULL;
+  tree->count = 0;
+  tree->key_len = key_len;
+}
+
+/**
+ * Insert a node, key and prefix_len must be set by the caller.
+ *
+ * @param tree the tree
+ * @param node the node
+ * @return 0 on success, -1 if the prefix is already in the tree
+ */
+int
+radix_insert(struct radix_tree *tree, struct radix_node *node)
+{
+  const uint8_t *key = node->key;
+  struct radix_node *parent = NULL, *cur = tree->root, *glue;
+  unsigned int common;
+
+  node->parent = NULL;
+  node->child[0] = NULL;
+  node->child[1] = NULL;
+  node->glue = false;
+
+  while (cur && cur->prefix_len <= node->prefix_len
+         && radix_match(cur->key, key, parent ? parent->prefix_len : 0, cur->prefix_len)) {
+    if (cur->prefix_len == node->prefix_len) {
+      if (!cur->glue) {
+        return -1;
+      }
+
+      /* take the place of the branch node */
+      radix_adopt(node, cur);
+      radix_relink(tree, cur, node);
+      free(cur);
+      tree->count++;
+      return 0;
+    }
+    parent = cur;
+    cur = cur->child[radix_bit(key, cur->prefix_len)];
+  }
+
+  if (cur == NULL) {
+    /* new leaf */
+    node->parent = parent;
+    if (parent == NULL) {
+      tree->root = node;
+    } else {
+      parent->child[radix_bit(key, parent->prefix_len)] = node;
+    }
+  } else {
+    common = radix_common_bits(cur->key, key, MIN(cur->prefix_len, node->prefix_len));
+    if (common == node->prefix_len) {
+      /* the new node is a shorter prefix of the subtree */
+      radix_relink(tree, cur, node);
+      node->child[radix_bit(cur->key, common)] = cur;
+      cur->parent = node;
+    } else {
+      /* the prefixes diverge, branch at the first different bit */
+      glue = radix_alloc_glue(tree, key, common);
+      radix_relink(tree, cur, glue);
+      glue->child[radix_bit(key, common)] = node;
+      glue->child[radix_bit(cur->key, common)] = cur;
+      node->parent = glue;
+      cur->parent = glue;
+    }
+  }
+  tree->count++;
+  return 0;
+}
+
+/**
+ * Remove a node from the tree.
+ *
+ * @param tree the tree
+ * @param node the node, it must be in the tree
+ */
+void
+radix_delete(struct radix_tree *tree, struct radix_node *node)
+{
+  struct radix_node *parent = node->parent, *glue;
+
+  tree->count--;
+
+  if (node->child[0] && node->child[1]) {
+    /* the node still branches the tree */
+    glue = radix_alloc_glue(tree, node->key, node->prefix_len);
+    radix_adopt(glue, node);
+    radix_relink(tree, node, glue);
+    return;
+  }
+
+  radix_relink(tree, node, node->child[0] ? node->child[0] : node->child[1]);
+
+  /* a branch node with a single child is redundant */
+  if (parent && parent->glue && (parent->child[0] == NULL || parent->child[1] == NULL)) {
+    radix_relink(tree, parent, parent->child[0] ? parent->child[0] : parent->child[1]);
+    free(parent);
+  }
+}
+
+/**
+ * Exact match lookup.
+ *
+ * @param tree the tree
+ * @param key the prefix bytes
+ * @param prefix_len the prefix length
+ * @return the node or NULL
+ */
+struct radix_node *
+radix_find(const struct radix_tree *tree, const void *key, uint8_t prefix_len)
+{
+  struct radix_node *cur = tree->root;
+  unsigned int from = 0;
+
+  while (cur && cur->prefix_len <= prefix_len && radix_match(cur->key, key, from, cur->prefix_len)) {
+    if (cur->prefix_len == prefix_len) {
+      return cur->glue ? NULL : cur;
+    }
+    from = cur->prefix_len;
+    cur = cur->child[radix_bit(key, cur->prefix_len)];
+  }
+  return NULL;
+}
+
+/**
+ * Longest prefix match lookup of an address.
+ *
+ * @param tree the tree
+ * @param key the address, key_len bytes
+ * @return the node with the longest prefix containing the address or NULL
+ */
+struct radix_node *
+radix_lookup(const struct radix_tree *tree, const void *key)
+{
+  struct radix_node *cur = tree->root, *best = NULL;
+  unsigned int from = 0, max = tree->key_len * 8;
+
+  while (cur && radix_match(cur->key, key, from, cur->prefix_len)) {
+    if (!cur->glue) {
+      best = cur;
+    }
+    if (cur->prefix_len == max) {
+      break;
+    }
+    from = cur->prefix_len;
+    cur = cur->child[radix_bit(key, cur->prefix_len)];
+  }
+  return best;
+}
+
+#ifdef RADIX_PROFILING
+#include <time.h>
+
+struct radix_bench_item {
+  struct olsr_ip_prefix prefix;
+  struct avl_node tree_node;
+  struct radix_node radix_node;
+};
+
+static uint32_t
+radix_bench_random(uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 1;
+}
+
+static long
+radix_bench_usec(const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+}
+
+/* clear the host part of an address */
+static void
+radix_bench_mask(union olsr_ip_addr *addr, unsigned int prefix_len)
+{
+  uint8_t *bytes = (uint8_t *)addr;
+  unsigned int i;
+
+  for (i = prefix_len; i < olsr_cnf->maxplen; i++) {
+    bytes[i >> 3] &= ~(0x80 >> (i & 7));
+  }
+}
+
+/* random address, below a random prefix of the set for three of four */
+static void
+radix_bench_addr(union olsr_ip_addr *addr, const struct radix_bench_item *items, unsigned int count, uint32_t *seed)
+{
+  uint8_t *bytes = (uint8_t *)addr;
+  unsigned int i;
+
+  for (i = 0; i < olsr_cnf->ipsize; i++) {
+    bytes[i] = radix_bench_random(seed) >> 8;
+  }
+  if (radix_bench_random(seed) % 4) {
+    const struct olsr_ip_prefix *p = &items[radix_bench_random(seed) % count].prefix;
+    const uint8_t *pbytes = (const uint8_t *)&p->prefix;
+
+    for (i = 0; i < p->prefix_len; i++) {
+      bytes[i >> 3] = (bytes[i >> 3] & ~(0x80 >> (i & 7))) | (pbytes[i >> 3] & (0x80 >> (i & 7)));
+    }
+  }
+}
+
+/*
+ * Compare longest prefix matching by probing the prefix tree with
+ * every prefix length, which is what a plugin has to do with the
+ * routingtree, with the radix tree.
+ */
+static void
+radix_bench_run(unsigned int count)
+{
+  const unsigned int lookups = 200000;
+  struct radix_bench_item *items;
+  struct avl_tree tree;
+  struct radix_tree rtree;
+  struct timespec t1, t2, t3;
+  uint32_t seed = count;
+  unsigned int i, inserted = 0, mismatch = 0;
+  long avl_time, radix_time;
+  struct radix_bench_item **avl_result;
+
+  items = olsr_malloc(sizeof(*items) * count, "radix benchmark");
+  avl_result = olsr_malloc(sizeof(*avl_result) * lookups, "radix benchmark");
+  avl_init(&tree, avl_comp_prefix_default);
+  radix_init(&rtree, olsr_cnf->ipsize);
+
+  /* HNA like prefixes between /16 and /28 (/48 and /64 for IPv6), some of them nested */
+  while (inserted < count) {
+    struct radix_bench_item *item = &items[inserted];
+    unsigned int len = olsr_cnf->ip_version == AF_INET ? 16 + radix_bench_random(&seed) % 13 : 48 + radix_bench_random(&seed) % 17;
+
+    memset(item, 0, sizeof(*item));
+    if (inserted > 0 && radix_bench_random(&seed) % 8 == 0) {
+      radix_bench_addr(&item->prefix.prefix, items, inserted, &seed);
+    } else {
+      for (i = 0; i < olsr_cnf->ipsize; i++) {
+        ((uint8_t *)&item->prefix.prefix)[i] = radix_bench_random(&seed) >> 8;
+      }
+    }
+    radix_bench_mask(&item->prefix.prefix, len);
+    item->prefix.prefix_len = len;
+    item->tree_node.key = &item->prefix;
+    if (avl_insert(&tree, &item->tree_node, AVL_DUP_NO) != 0) {
+      continue;
+    }
+    item->radix_node.key = &item->prefix.prefix;
+    item->radix_node.prefix_len = len;
+    radix_insert(&rtree, &item->radix_node);
+    inserted++;
+  }
+
+  seed = count;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  for (i = 0; i < lookups; i++) {
+    struct olsr_ip_prefix prefix;
+    struct avl_node *node = NULL;
+    int len;
+
+    memset(&prefix, 0, sizeof(prefix));
+    radix_bench_addr(&prefix.prefix, items, inserted, &seed);
+    for (len = olsr_cnf->maxplen; len >= 0 && node == NULL; len--) {
+      radix_bench_mask(&prefix.prefix, len);
+      prefix.prefix_len = len;
+      node = avl_find(&tree, &prefix);
+    }
+    avl_result[i] = node ? (struct radix_bench_item *)((char *)node - offsetof(struct radix_bench_item, tree_node)) : NULL;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  seed = count;
+  for (i = 0; i < lookups; i++) {
+    union olsr_ip_addr addr;
+    struct radix_node *node;
+
+    memset(&addr, 0, sizeof(addr));
+    radix_bench_addr(&addr, items, inserted, &seed);
+    node = radix_lookup(&rtree, &addr);
+    if ((node ? (struct radix_bench_item *)((char *)node - offsetof(struct radix_bench_item, radix_node)) : NULL) != avl_result[i]) {
+      mismatch++;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+
+  avl_time = radix_bench_usec(&t1, &t2);
+  radix_time = radix_bench_usec(&t2, &t3);
+  OLSR_PRINTF(1, "--- RADIX-benchmark for %u prefixes (avl/radix): %ld, %ld (lookups/msec)%s\n", //
+      inserted, //
+      avl_time ? (long)lookups * 1000 / avl_time : 0, //
+      radix_time ? (long)lookups * 1000 / radix_time : 0, //
+      mismatch ? ", RESULT MISMATCH" : "");
+
+  for (i = 0; i < inserted; i++) {
+    radix_delete(&rtree, &items[i].radix_node);
+  }
+  free(avl_result);
+  free(items);
+}
+
+/**
+ * Benchmark longest prefix matching for 1k, 10k and 100k prefixes.
+ */
+void
+radix_benchmark(void)
+{
+  radix_bench_run(1000);
+  radix_bench_run(10000);
+  radix_bench_run(100000);
+}
+#endif /* RADIX_PROFILING */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,105 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef _RADIX_H
+#define _RADIX_H
+
+#include <stddef.h>
+#include "compiler.h"
+#include "defs.h"
+
+/*
+ * Path compressed binary radix tree (patricia trie) for longest
+ * prefix matching.
+ *
+ * Like the avl tree the nodes are embedded into the indexed items,
+ * the key points to the prefix bytes (network byte order) of the item.
+ * Nodes which only branch the tree are allocated internally and are
+ * never returned by the lookup functions.
+ */
+
+#define RADIX_MAX_KEY_LEN 16
+
+struct radix_node {
+  struct radix_node *parent;
+  struct radix_node *child[2];
+  const void *key;
+  uint8_t prefix_len;
+  bool glue;                           /* internal branch node */
+};
+
+struct radix_tree {
+  struct radix_node *root;
+  unsigned int count;                  /* number of non-glue nodes */
+  unsigned int key_len;                /* length of the keys in bytes */
+};
+
+void radix_init(struct radix_tree *, unsigned int key_len);
+int radix_insert(struct radix_tree *, struct radix_node *);
+void radix_delete(struct radix_tree *, struct radix_node *);
+struct radix_node *radix_find(const struct radix_tree *, const void *key, uint8_t prefix_len);
+struct radix_node *radix_lookup(const struct radix_tree *, const void *key);
+
+#define RADIXNODE2STRUCT(funcname, structname, radixnodename) \
+static INLINE structname * funcname (struct radix_node *ptr)\
+{\
+  return( \
+    ptr ? \
+      (structname *) (((size_t) ptr) - offsetof(structname, radixnodename)) : \
+      NULL); \
+}
+
+#ifdef RADIX_PROFILING
+void radix_benchmark(void);
+#endif /* RADIX_PROFILING */
+
+#endif /* _RADIX_H */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -45,7 +45,7 @@
 
 #include "duplicate_set.h"
 #include "ipcalc.h"
-#include "common/avl.h"
+#include "common/hashtable.h"
 #include "olsr.h"
 #include "mid_set.h"
 #include "scheduler.h"
@@ -53,13 +53,27 @@
 
 static void olsr_cleanup_duplicate_entry(void *unused);
 
-struct avl_tree duplicate_set;
+/* lookup index of the duplicate entries by originator */
+static struct hashtable duplicate_set;
+
+/* entries ordered by the cleanup interval of their last refresh */
+struct list_node duplicate_buckets[DUP_BUCKET_COUNT];
+static unsigned int duplicate_current_bucket;
+
+struct dup_stats duplicate_stats;
+
 struct timer_entry *duplicate_cleanup_timer;
 
 void
 olsr_init_duplicate_set(void)
 {
-  avl_init(&duplicate_set, olsr_cnf->ip_version == AF_INET ? &avl_comp_ipv4 : &avl_comp_ipv6);
+  unsigned int i;
+
+  hashtable_init(&duplicate_set, offsetof(struct dup_entry, ip), olsr_cnf->ipsize);
+  for (i = 0; i < DUP_BUCKET_COUNT; i++) {
+    list_head_init(&duplicate_buckets[i]);
+  }
+  duplicate_current_bucket = 0;
 
   olsr_set_timer(&duplicate_cleanup_timer, DUPLICATE_CLEANUP_INTERVAL, DUPLICATE_CLEANUP_JITTER, OLSR_TIMER_PERIODIC,
                  &olsr_cleanup_duplicate_entry, NULL, 0);
@@ -68,7 +82,7 @@ olsr_init_duplicate_set(void)
 void olsr_cleanup_duplicates(union olsr_ip_addr *orig) {
   struct dup_entry *entry;
 
-  entry = (struct dup_entry *)avl_find(&duplicate_set, orig);
+  entry = hashtable_find(&duplicate_set, orig);
   if (entry != NULL) {
     entry->too_low_counter = DUP_MAX_TOO_LOW - 2;
   }
@@ -83,24 +97,51 @@ olsr_create_duplicate_entry(void *ip, uint16_t seqnr)
     memcpy(&entry->ip, ip, olsr_cnf->ip_version == AF_INET ? sizeof(entry->ip.v4) : sizeof(entry->ip.v6));
     entry->seqnr = seqnr;
     entry->too_low_counter = 0;
-    entry->avl.key = &entry->ip;
-    entry->array = 0;
+    entry->bucket = 0;
+    list_node_init(&entry->bucket_node);
+    memset(entry->array, 0, sizeof(entry->array));
   }
   return entry;
 }
 
+/**
+ * Move an entry into the time bucket of the current cleanup interval.
+ */
+static void
+olsr_refresh_duplicate_entry(struct dup_entry *entry, uint32_t valid_until)
+{
+  if (valid_until > entry->valid_until) {
+    entry->valid_until = valid_until;
+  }
+  if (entry->bucket != duplicate_current_bucket || !list_node_on_list(&entry->bucket_node)) {
+    if (list_node_on_list(&entry->bucket_node)) {
+      list_remove(&entry->bucket_node);
+    }
+    list_add_before(&duplicate_buckets[duplicate_current_bucket], &entry->bucket_node);
+    entry->bucket = duplicate_current_bucket;
+  }
+}
+
+/**
+ * Advance to the next time bucket. It contains the entries which were
+ * not refreshed for at least DUPLICATE_VTIME, drop all of them.
+ */
 static void
 olsr_cleanup_duplicate_entry(void __attribute__ ((unused)) * unused)
 {
-  struct dup_entry *entry;
+  struct list_node *bucket;
 
-  OLSR_FOR_ALL_DUP_ENTRIES(entry) {
-    if (TIMED_OUT(entry->valid_until)) {
-      avl_delete(&duplicate_set, &entry->avl);
-      free(entry);
-    }
+  duplicate_current_bucket = (duplicate_current_bucket + 1) % DUP_BUCKET_COUNT;
+  bucket = &duplicate_buckets[duplicate_current_bucket];
+
+  while (!list_is_empty(bucket)) {
+    struct dup_entry *entry = list2dupentry(bucket->next);
+
+    list_remove(&entry->bucket_node);
+    hashtable_remove(&duplicate_set, entry);
+    free(entry);
+    duplicate_stats.expired++;
   }
-  OLSR_FOR_ALL_DUP_ENTRIES_END(entry);
 }
 
 int olsr_seqno_diff(uint16_t seqno1, uint16_t seqno2) {
@@ -116,6 +157,41 @@ int olsr_seqno_diff(uint16_t seqno1, uint16_t seqno2) {
   return diff;
 }
 
+/*
+ * The window is a ring of bits indexed by the sequence number
+ * modulo DUP_WINDOW_SIZE.
+ */
+static INLINE uint32_t *
+dup_window_word(struct dup_entry *entry, uint16_t seqnr)
+{
+  return &entry->array[(seqnr % DUP_WINDOW_SIZE) / 32];
+}
+
+static INLINE uint32_t
+dup_window_bit(uint16_t seqnr)
+{
+  return 1u << (seqnr % 32);
+}
+
+/**
+ * Move the upper edge of the window forward by diff sequence
+ * numbers, forgetting about the ones which drop out of it.
+ */
+static void
+dup_window_advance(struct dup_entry *entry, uint16_t seqnr, int diff)
+{
+  if (diff >= DUP_WINDOW_SIZE) {
+    memset(entry->array, 0, sizeof(entry->array));
+  } else {
+    uint16_t seq;
+
+    for (seq = (uint16_t)(entry->seqnr + 1); seq != (uint16_t)(seqnr + 1); seq++) {
+      *dup_window_word(entry, seq) &= ~dup_window_bit(seq);
+    }
+  }
+  entry->seqnr = seqnr;
+}
+
 int
 olsr_message_is_duplicate(union olsr_message *m)
 {
@@ -126,6 +202,7 @@ olsr_message_is_duplicate(union olsr_message *m)
   struct ipaddr_str buf;
   uint16_t seqnr;
   void *ip;
+  uint32_t *word, bit;
 
   if (olsr_cnf->ip_version == AF_INET) {
     seqnr = ntohs(m->v4.seqno);
@@ -141,57 +218,56 @@ olsr_message_is_duplicate(union olsr_message *m)
     mainIp = ip;
   }
 
+  duplicate_stats.messages++;
   valid_until = GET_TIMESTAMP(DUPLICATE_VTIME);
 
-  entry = (struct dup_entry *)avl_find(&duplicate_set, ip);
+  entry = hashtable_find(&duplicate_set, ip);
   if (entry == NULL) {
     entry = olsr_create_duplicate_entry(ip, seqnr);
     if (entry != NULL) {
-      avl_insert(&duplicate_set, &entry->avl, 0);
+      hashtable_insert(&duplicate_set, entry);
       entry->valid_until = valid_until;
+      olsr_refresh_duplicate_entry(entry, valid_until);
+      *dup_window_word(entry, seqnr) |= dup_window_bit(seqnr);
     }
     return false;               // okay, we process this package
   }
 
-
   // update timestamp
-  if (valid_until > entry->valid_until) {
-    entry->valid_until = valid_until;
-  }
+  olsr_refresh_duplicate_entry(entry, valid_until);
 
   diff = olsr_seqno_diff(seqnr, entry->seqnr);
-  if (diff < -31) {
+  if (diff <= -DUP_WINDOW_SIZE) {
     entry->too_low_counter++;
+    duplicate_stats.too_low++;
 
     // client did restart with a lower number ?
     if (entry->too_low_counter > DUP_MAX_TOO_LOW) {
       entry->too_low_counter = 0;
       entry->seqnr = seqnr;
-      entry->array = 1;
+      memset(entry->array, 0, sizeof(entry->array));
+      *dup_window_word(entry, seqnr) |= dup_window_bit(seqnr);
+      duplicate_stats.restarts++;
       return false;             /* start with a new sequence number, so NO duplicate */
     }
     OLSR_PRINTF(9, "blocked 0x%x from %s\n", seqnr, olsr_ip_to_string(&buf, mainIp));
+    duplicate_stats.duplicates++;
     return true;                /* duplicate ! */
   }
 
   entry->too_low_counter = 0;
-  if (diff <= 0) {
-    uint32_t bitmask = 1u << ((uint32_t) (-diff));
+  if (diff > 0) {
+    dup_window_advance(entry, seqnr, diff);
+  }
 
-    if ((entry->array & bitmask) != 0) {
-      OLSR_PRINTF(9, "blocked 0x%x (diff=%d,mask=%08x) from %s\n", seqnr, diff, entry->array, olsr_ip_to_string(&buf, mainIp));
-      return true;              /* duplicate ! */
-    }
-    entry->array |= bitmask;
-    OLSR_PRINTF(9, "processed 0x%x from %s\n", seqnr, olsr_ip_to_string(&buf, mainIp));
-    return false;               /* no duplicate */
-  } else if (diff < 32) {
-    entry->array <<= (uint32_t) diff;
-  } else {
-    entry->array = 0;
+  word = dup_window_word(entry, seqnr);
+  bit = dup_window_bit(seqnr);
+  if ((*word & bit) != 0) {
+    OLSR_PRINTF(9, "blocked 0x%x (diff=%d) from %s\n", seqnr, diff, olsr_ip_to_string(&buf, mainIp));
+    duplicate_stats.duplicates++;
+    return true;                /* duplicate ! */
   }
-  entry->array |= 1;
-  entry->seqnr = seqnr;
+  *word |= bit;
   OLSR_PRINTF(9, "processed 0x%x from %s\n", seqnr, olsr_ip_to_string(&buf, mainIp));
   return false;                 /* no duplicate */
 }
@@ -205,13 +281,28 @@ olsr_print_duplicate_table(void)
   const int ipwidth = olsr_cnf->ip_version == AF_INET ? (INET_ADDRSTRLEN - 1) : (INET6_ADDRSTRLEN - 1);
   struct ipaddr_str addrbuf;
 
-  OLSR_PRINTF(1, "\n--- %s ------------------------------------------------- DUPLICATE SET\n\n" "%-*s %8s %s\n",
-              olsr_wallclock_string(), ipwidth, "Node IP", "DupArray", "VTime");
+  OLSR_PRINTF(1, "\n--- %s ------------------------------------------------- DUPLICATE SET\n\n" "%-*s %6s %8s %s\n",
+              olsr_wallclock_string(), ipwidth, "Node IP", "Seqno", "DupArray", "VTime");
 
   OLSR_FOR_ALL_DUP_ENTRIES(entry) {
-    OLSR_PRINTF(1, "%-*s %08x %s\n", ipwidth, olsr_ip_to_string(&addrbuf, (union olsr_ip_addr *)(entry->avl.key)),
-                entry->array, olsr_clock_string(entry->valid_until));
+    /* show the newest 32 sequence numbers of the window */
+    uint32_t recent = 0;
+    uint16_t i;
+
+    for (i = 0; i < 32; i++) {
+      uint16_t seq = (uint16_t)(entry->seqnr - i);
+      if (*dup_window_word(entry, seq) & dup_window_bit(seq)) {
+        recent |= 1u << i;
+      }
+    }
+    OLSR_PRINTF(1, "%-*s %6u %08x %s\n", ipwidth, olsr_ip_to_string(&addrbuf, &entry->ip),
+                entry->seqnr, recent, olsr_clock_string(entry->valid_until));
   } OLSR_FOR_ALL_DUP_ENTRIES_END(entry);
+
+  OLSR_PRINTF(1, "\n%u entries, window %u, %u messages, %u duplicates (%u%%), %u below window, %u restarts, %u expired\n",
+              duplicate_set.count, DUP_WINDOW_SIZE, duplicate_stats.messages, duplicate_stats.duplicates,
+              duplicate_stats.messages ? (unsigned int)((uint64_t)duplicate_stats.duplicates * 100 / duplicate_stats.messages) : 0,
+              duplicate_stats.too_low, duplicate_stats.restarts, duplicate_stats.expired);
 }
 #endif /* NODEBUG */
 
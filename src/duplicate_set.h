@@ -49,23 +49,55 @@
 #include "defs.h"
 #include "olsr.h"
 #include "mantissa.h"
-#include "common/avl.h"
+#include "common/list.h"
 
 #define DUPLICATE_CLEANUP_INTERVAL 15000
 #define DUPLICATE_CLEANUP_JITTER 25
 #define DUPLICATE_VTIME 120000
 #define DUP_MAX_TOO_LOW 16
 
+/*
+ * Number of sequence numbers remembered per originator,
+ * must be a power of two between 32 and 16384.
+ */
+#ifndef DUP_WINDOW_SIZE
+#define DUP_WINDOW_SIZE 128
+#endif /* DUP_WINDOW_SIZE */
+
+#if (DUP_WINDOW_SIZE & (DUP_WINDOW_SIZE - 1)) != 0 || DUP_WINDOW_SIZE < 32 || DUP_WINDOW_SIZE > 16384
+#error "DUP_WINDOW_SIZE must be a power of two between 32 and 16384"
+#endif
+
+#define DUP_WINDOW_WORDS (DUP_WINDOW_SIZE / 32)
+
+/*
+ * Entries are kept in one time bucket per cleanup interval,
+ * the bucket after the current one has expired as a whole.
+ */
+#define DUP_BUCKET_COUNT (DUPLICATE_VTIME / DUPLICATE_CLEANUP_INTERVAL + 1)
+
 struct dup_entry {
-  struct avl_node avl;
+  struct list_node bucket_node;
   union olsr_ip_addr ip;
   uint16_t seqnr;
   uint16_t too_low_counter;
-  uint32_t array;
+  uint16_t bucket;
+  uint32_t array[DUP_WINDOW_WORDS];    /* bit (seqnr % DUP_WINDOW_SIZE) */
   uint32_t valid_until;
 };
 
-AVLNODE2STRUCT(duptree2dupentry, struct dup_entry, avl);
+LISTNODE2STRUCT(list2dupentry, struct dup_entry, bucket_node);
+
+struct dup_stats {
+  uint32_t messages;                   /* messages checked */
+  uint32_t duplicates;                 /* messages found in the window */
+  uint32_t too_low;                    /* messages older than the window */
+  uint32_t restarts;                   /* originators which restarted their seqno */
+  uint32_t expired;                    /* entries removed by the cleanup */
+};
+
+extern struct list_node duplicate_buckets[DUP_BUCKET_COUNT];
+extern struct dup_stats duplicate_stats;
 
 void olsr_init_duplicate_set(void);
 void olsr_cleanup_duplicates(union olsr_ip_addr *orig);
@@ -80,11 +112,13 @@ void olsr_print_duplicate_table(void);
 
 #define OLSR_FOR_ALL_DUP_ENTRIES(dup) \
 { \
-  struct avl_node *dup_tree_node, *next_dup_tree_node; \
-  for (dup_tree_node = avl_walk_first(&duplicate_set); \
-    dup_tree_node; dup_tree_node = next_dup_tree_node) { \
-    next_dup_tree_node = avl_walk_next(dup_tree_node); \
-    dup = duptree2dupentry(dup_tree_node);
+  struct list_node *dup_list_node, *next_dup_list_node; \
+  unsigned int dup_bucket; \
+  for (dup_bucket = 0; dup_bucket < DUP_BUCKET_COUNT; dup_bucket++) \
+  for (dup_list_node = duplicate_buckets[dup_bucket].next; \
+    dup_list_node != &duplicate_buckets[dup_bucket]; dup_list_node = next_dup_list_node) { \
+    next_dup_list_node = dup_list_node->next; \
+    dup = list2dupentry(dup_list_node);
 #define OLSR_FOR_ALL_DUP_ENTRIES_END(dup) }}
 
 #endif /* DUPLICATE_SET_2_H_ */
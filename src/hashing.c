@@ -46,98 +46,7 @@
 #include "olsr_protocol.h"
 #include "hashing.h"
 #include "defs.h"
-
-/*
- * Taken from lookup2.c by Bob Jenkins.  (http://burtleburtle.net/bob/c/lookup2.c).
- * --------------------------------------------------------------------
- * lookup2.c, by Bob Jenkins, December 1996, Public Domain.
- * You can use this free for any purpose.  It has no warranty.
- * --------------------------------------------------------------------
- */
-
-#define __jhash_mix(a, b, c) \
-{ \
-  a -= b; a -= c; a ^= (c>>13); \
-  b -= c; b -= a; b ^= (a<<8); \
-  c -= a; c -= b; c ^= (b>>13); \
-  a -= b; a -= c; a ^= (c>>12);  \
-  b -= c; b -= a; b ^= (a<<16); \
-  c -= a; c -= b; c ^= (b>>5); \
-  a -= b; a -= c; a ^= (c>>3);  \
-  b -= c; b -= a; b ^= (a<<10); \
-  c -= a; c -= b; c ^= (b>>15); \
-}
-
-static uint32_t
-jenkins_hash(const uint8_t * k, uint32_t length)
-{
-  /* k: the key
-   * length: length of the key
-   * initval: the previous hash, or an arbitrary value
-   */
-  uint32_t a, b, c, len;
-
-  /* Set up the internal state */
-  len = length;
-  a = b = 0x9e3779b9;           /* the golden ratio; an arbitrary value */
-  c = 0;                        /* the previous hash value */
-
-  /* handle most of the key */
-  while (len >= 12) {
-    a += (k[0] + ((uint32_t) k[1] << 8) + ((uint32_t) k[2] << 16) + ((uint32_t) k[3] << 24));
-    b += (k[4] + ((uint32_t) k[5] << 8) + ((uint32_t) k[6] << 16) + ((uint32_t) k[7] << 24));
-    c += (k[8] + ((uint32_t) k[9] << 8) + ((uint32_t) k[10] << 16) + ((uint32_t) k[11] << 24));
-
-    __jhash_mix(a, b, c);
-
-    k += 12;
-    len -= 12;
-  }
-
-  c += length;
-  switch (len) {
-  case 11:
-    c += ((uint32_t) k[10] << 24);
-    /* no break */
-  case 10:
-    c += ((uint32_t) k[9] << 16);
-    /* no break */
-  case 9:
-    c += ((uint32_t) k[8] << 8);
-    /* the first byte of c is reserved for the length */
-    /* no break */
-  case 8:
-    b += ((uint32_t) k[7] << 24);
-    /* no break */
-  case 7:
-    b += ((uint32_t) k[6] << 16);
-    /* no break */
-  case 6:
-    b += ((uint32_t) k[5] << 8);
-    /* no break */
-  case 5:
-    b += k[4];
-    /* no break */
-  case 4:
-    a += ((uint32_t) k[3] << 24);
-    /* no break */
-  case 3:
-    a += ((uint32_t) k[2] << 16);
-    /* no break */
-  case 2:
-    a += ((uint32_t) k[1] << 8);
-    /* no break */
-  case 1:
-    a += k[0];
-    break;
-
-  default:
-	  break;
-  }
-  __jhash_mix(a, b, c);
-
-  return c;
-}
+#include "common/hashtable.h"
 
 /**
  * Hashing function. Creates a key based on an IP address.
@@ -151,10 +60,10 @@ olsr_ip_hashing(const union olsr_ip_addr * address)
 
   switch (olsr_cnf->ip_version) {
   case AF_INET:
-    hash = jenkins_hash((const uint8_t *)&address->v4, sizeof(uint32_t));
+    hash = hashtable_hash(&address->v4, sizeof(uint32_t));
     break;
   case AF_INET6:
-    hash = jenkins_hash((const uint8_t *)&address->v6, sizeof(struct in6_addr));
+    hash = hashtable_hash(&address->v6, sizeof(struct in6_addr));
     break;
   default:
     hash = 0;
@@ -52,8 +52,12 @@
 #include "parser.h"
 #include "gateway.h"
 #include "duplicate_handler.h"
+#include "common/hashtable.h"
 
 struct hna_entry hna_set[HASHSIZE];
+
+/* lookup index of hna_set by gateway address */
+static struct hashtable hna_index;
 struct olsr_cookie_info *hna_net_timer_cookie = NULL;
 struct olsr_cookie_info *hna_entry_mem_cookie = NULL;
 struct olsr_cookie_info *hna_net_mem_cookie = NULL;
@@ -73,6 +77,8 @@ olsr_init_hna_set(void)
     hna_set[idx].prev = &hna_set[idx];
   }
 
+  hashtable_init(&hna_index, offsetof(struct hna_entry, A_gateway_addr), olsr_cnf->ipsize);
+
   hna_net_timer_cookie = olsr_alloc_cookie("HNA Network", OLSR_COOKIE_TYPE_TIMER);
 
   hna_net_mem_cookie = olsr_alloc_cookie("hna_net", OLSR_COOKIE_TYPE_MEMORY);
@@ -129,19 +135,8 @@ olsr_lookup_hna_net(const struct hna_net *nets, const union olsr_ip_addr *net, u
 struct hna_entry *
 olsr_lookup_hna_gw(const union olsr_ip_addr *gw)
 {
-  struct hna_entry *tmp_hna;
-  uint32_t hash = olsr_ip_hashing(gw);
-
   /* Check for registered entry */
-
-  for (tmp_hna = hna_set[hash].next; tmp_hna != &hna_set[hash]; tmp_hna = tmp_hna->next) {
-    if (ipequal(&tmp_hna->A_gateway_addr, gw)) {
-      return tmp_hna;
-    }
-  }
-
-  /* Not found */
-  return NULL;
+  return hashtable_find(&hna_index, gw);
 }
 
 /**
@@ -174,6 +169,8 @@ olsr_add_hna_entry(const union olsr_ip_addr *addr)
   hna_set[hash].next = new_entry;
   new_entry->prev = &hna_set[hash];
 
+  hashtable_insert(&hna_index, new_entry);
+
   return new_entry;
 }
 
@@ -245,6 +242,7 @@ olsr_delete_hna_net_entry(struct hna_net *net_to_delete) {
   /* Delete hna_gw if empty */
   if (hna_gw->networks.next == &hna_gw->networks) {
     DEQUEUE_ELEM(hna_gw);
+    hashtable_remove(&hna_index, hna_gw);
     olsr_cookie_free(hna_entry_mem_cookie, hna_gw);
     removed_entry = true;
   }
@@ -55,6 +55,7 @@
 #include "ipcalc.h"
 #include "log.h"
 #include "parser.h"
+#include "link_set.h"
 
 #ifdef _WIN32
 #include <winbase.h>
@@ -404,6 +405,7 @@ olsr_remove_interface(struct olsr_if * iface)
     }
     tmp_ifp->int_next = ifp->int_next;
   }
+  olsr_invalidate_best_links();
 
   /* Remove output buffer */
   net_remove_buffer(ifp);
@@ -109,12 +109,27 @@ struct vtimes {
 
 /* Output buffer structure. This should actually be in net_olsr.h but we have circular references then.
  */
+struct olsr_netbuf_queue;
+struct olsr_msgbuf;
+
+/* maximum number of shared messages referenced by one packet */
+#define OLSR_NETBUF_REFS 8
+
+/* a shared message filling the gap at 'offset' of the buffer */
+struct olsr_netbuf_ref {
+  struct olsr_msgbuf *msg;
+  int offset;
+};
+
 struct olsr_netbuf {
   uint8_t *buff;                       /* Pointer to the allocated buffer */
   int bufsize;                         /* Size of the buffer */
   int maxsize;                         /* Max bytes of payload that can be added to the buffer */
   int pending;                         /* How much data is currently pending in the buffer */
   int reserved;                        /* Plugins can reserve space in buffers */
+  struct olsr_netbuf_queue *queue;     /* Finished packets waiting to be sent */
+  struct olsr_netbuf_ref refs[OLSR_NETBUF_REFS]; /* Messages pushed by reference */
+  unsigned int ref_count;
 };
 
 /**
@@ -181,6 +196,11 @@ struct interface_olsr {
   /* index in TTL array for fish-eye */
   int ttl_index;
 
+  /* delta TCs, ANSN and TTL of the last TC sent and number of deltas until the next full TC */
+  uint16_t tc_delta_ansn;
+  uint8_t tc_delta_ttl;
+  uint8_t tc_delta_countdown;
+
   /* Hello's are sent immediately normally, this flag prefers to send TC's */
   bool immediate_send_tc;
 
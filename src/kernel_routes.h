@@ -49,6 +49,9 @@
 #include "defs.h"
 #include "routing_table.h"
 
+/* callback with the result of a batched route change, 0 on success */
+typedef void (*olsr_route_done_function) (struct rt_entry *, int);
+
 int olsr_ioctl_add_route(const struct rt_entry *rt);
 
 int olsr_ioctl_add_route6(const struct rt_entry *rt);
@@ -64,6 +67,9 @@ int olsr_ioctl_del_route6(const struct rt_entry *rt);
     const struct olsr_ip_prefix *dst, bool set, bool del_similar, bool blackhole);
 
   int rtnetlink_register_socket(int);
+
+  void olsr_os_route_batch_add(struct rt_entry *rt, bool set, olsr_route_done_function done);
+  void olsr_os_route_batch_flush(void);
 #endif /* __linux__ */
 
 void olsr_os_niit_4to6_route(const struct olsr_ip_prefix *dst_v4, bool set);
@@ -67,6 +67,12 @@ struct list_node link_entry_head;
 
 bool link_changes = false; /* is set if changes occur in MPRS set */
 
+/*
+ * Generation of the link set for the best link cache of the
+ * neighbors, bumped on changes which may affect all neighbors.
+ */
+static uint32_t link_set_generation = 1;
+
 void
 signal_link_changes(bool val)
 {                               /* XXX ugly */
@@ -80,6 +86,27 @@ static struct link_entry *add_link_entry(const union olsr_ip_addr *, const union
 static int get_neighbor_status(const union olsr_ip_addr *);
 static void olsr_expire_link_sym_timer(void *context);
 
+/**
+ * Invalidate the cached best link of all neighbors, e.g.
+ * after link costs or interface metrics changed.
+ */
+void
+olsr_invalidate_best_links(void)
+{
+  if (++link_set_generation == 0) {
+    link_set_generation = 1;
+  }
+}
+
+/**
+ * Invalidate the cached best link of the neighbor of a link.
+ */
+static void
+olsr_invalidate_best_link(struct link_entry *link)
+{
+  link->neighbor->best_link_generation = 0;
+}
+
 void
 olsr_init_link_set(void)
 {
@@ -106,6 +133,8 @@ void olsr_reset_all_links(void) {
     link->neighbor->status = NOT_SYM;
   } OLSR_FOR_ALL_LINK_ENTRIES_END(link)
 
+  olsr_invalidate_best_links();
+
 
   OLSR_FOR_ALL_LINK_ENTRIES(link) {
     olsr_expire_link_sym_timer(link);
@@ -212,36 +241,44 @@ get_neighbor_status(const union olsr_ip_addr *address)
 }
 
 /**
- * Find best link to a neighbor
+ * Select the best link out of the links to a neighbor.
+ *
+ * @param neighbor the neighbor entry
+ * @param remote the requested address, used as a tie-breaker
+ * @param until set to the time when the status of one of the
+ * links changes without an event, if expires is set
+ * @param expires set if until is valid
+ * @return the best link or NULL if there is none
  */
-struct link_entry *
-get_best_link_to_neighbor(const union olsr_ip_addr *remote)
+static struct link_entry *
+olsr_select_best_link(struct neighbor_entry *neighbor, const union olsr_ip_addr *remote, uint32_t *until, bool *expires)
 {
-  const union olsr_ip_addr *main_addr;
+  struct list_node *node;
   struct link_entry *walker, *good_link, *backup_link;
   struct interface_olsr *tmp_if;
   int curr_metric = MAX_IF_METRIC;
   olsr_linkcost curr_lcost = LINK_COST_BROKEN;
   olsr_linkcost tmp_lc;
 
-  /* main address lookup */
-  main_addr = mid_lookup_main_addr(remote);
-
-  /* "remote" *already is* the main address */
-  if (!main_addr) {
-    main_addr = remote;
-  }
-
   /* we haven't selected any links, yet */
   good_link = NULL;
   backup_link = NULL;
+  *expires = false;
 
-  /* loop through all links that we have */
-  OLSR_FOR_ALL_LINK_ENTRIES(walker) {
+  /* loop through all links to the neighbor */
+  for (node = neighbor->link_list.next; node != &neighbor->link_list; node = node->next) {
+    walker = nbrlist2link(node);
 
-    /* if this is not a link to the neighour in question, skip */
-    if (!ipequal(&walker->neighbor->neighbor_main_addr, main_addr))
-      continue;
+    /* remember the next time a link may change its status by itself */
+    if (!TIMED_OUT(walker->ASYM_time) && (!*expires || TIME_DUE(walker->ASYM_time) < TIME_DUE(*until))) {
+      *until = walker->ASYM_time;
+      *expires = true;
+    }
+    if (olsr_cnf->use_hysteresis && !TIMED_OUT(walker->L_LOST_LINK_time)
+        && (!*expires || TIME_DUE(walker->L_LOST_LINK_time) < TIME_DUE(*until))) {
+      *until = walker->L_LOST_LINK_time;
+      *expires = true;
+    }
 
     if (olsr_cnf->lq_level == 0) {
 
@@ -302,7 +339,6 @@ get_best_link_to_neighbor(const union olsr_ip_addr *remote)
       }
     }
   }
-  OLSR_FOR_ALL_LINK_ENTRIES_END(walker);
 
   /*
    * if we haven't found any symmetric links, try to return an asymmetric link.
@@ -310,6 +346,48 @@ get_best_link_to_neighbor(const union olsr_ip_addr *remote)
   return good_link ? good_link : backup_link;
 }
 
+/**
+ * Find best link to a neighbor
+ *
+ * The result for the main address of a neighbor is cached in the
+ * neighbor entry until a link of the neighbor changes.
+ */
+struct link_entry *
+get_best_link_to_neighbor(const union olsr_ip_addr *remote)
+{
+  const union olsr_ip_addr *main_addr;
+  struct neighbor_entry *neighbor;
+  uint32_t until = 0;
+  bool expires;
+
+  /* main address lookup */
+  main_addr = mid_lookup_main_addr(remote);
+
+  /* "remote" *already is* the main address */
+  if (!main_addr) {
+    main_addr = remote;
+  }
+
+  neighbor = olsr_lookup_neighbor_table_alias(main_addr);
+  if (neighbor == NULL) {
+    return NULL;
+  }
+
+  if (main_addr != remote) {
+    /* the tie-breaker differs from the cached result */
+    return olsr_select_best_link(neighbor, remote, &until, &expires);
+  }
+
+  if (neighbor->best_link_generation != link_set_generation
+      || (neighbor->best_link_expires && TIMED_OUT(neighbor->best_link_until))) {
+    neighbor->best_link = olsr_select_best_link(neighbor, remote, &until, &expires);
+    neighbor->best_link_until = until;
+    neighbor->best_link_expires = expires;
+    neighbor->best_link_generation = link_set_generation;
+  }
+  return neighbor->best_link;
+}
+
 static void
 set_loss_link_multiplier(struct link_entry *entry)
 {
@@ -376,6 +454,16 @@ olsr_delete_link_entry(struct link_entry *link)
     olsr_delete_tc_edge_entry(tc_edge);
   }
 
+  /* the link may still be referenced as SPF next-hop */
+  olsr_spf_force_full();
+
+  olsr_invalidate_best_link(link);
+  if (list_node_on_list(&link->neighbor_link_list)) {
+    list_remove(&link->neighbor_link_list);
+  }
+
+  /* the best link to the neighbor may be a worse one now */
+  olsr_mpr_touch_neighbor(link->neighbor);
 
   /* Delete neighbor entry */
   if (link->neighbor->linkcount == 1) {
@@ -456,6 +544,7 @@ olsr_expire_link_sym_timer(void *context)
   }
 
   link->prev_status = lookup_link_status(link);
+  olsr_invalidate_best_link(link);
   update_neighbor_status(link->neighbor, get_neighbor_status(&link->neighbor_iface_addr));
   changes_neighborhood = true;
 }
@@ -480,6 +569,7 @@ olsr_expire_link_hello_timer(void *context)
 
   /* Update hysteresis values */
   olsr_process_hysteresis(link);
+  olsr_invalidate_best_link(link);
 
   /* update neighbor status */
   update_neighbor_status(link->neighbor, get_neighbor_status(&link->neighbor_iface_addr));
@@ -623,6 +713,8 @@ add_link_entry(const union olsr_ip_addr *local, const union olsr_ip_addr *remote
 
   neighbor->linkcount++;
   new_link->neighbor = neighbor;
+  list_add_before(&neighbor->link_list, &new_link->neighbor_link_list);
+  olsr_invalidate_best_link(new_link);
 
   return new_link;
 }
@@ -735,6 +827,8 @@ update_link_entry(const union olsr_ip_addr *local, const union olsr_ip_addr *rem
   if (olsr_cnf->use_hysteresis)
     olsr_process_hysteresis(entry);
 
+  olsr_invalidate_best_link(entry);
+
   /* Update neighbor */
   update_neighbor_status(entry->neighbor, get_neighbor_status(remote));
 
@@ -763,7 +857,12 @@ replace_neighbor_link_set(const struct neighbor_entry *old, struct neighbor_entr
   OLSR_FOR_ALL_LINK_ENTRIES(link) {
 
     if (link->neighbor == old) {
+      if (list_node_on_list(&link->neighbor_link_list)) {
+        list_remove(&link->neighbor_link_list);
+      }
       link->neighbor = new;
+      list_add_before(&new->link_list, &link->neighbor_link_list);
+      olsr_invalidate_best_link(link);
       retval++;
     }
   }
@@ -94,12 +94,14 @@ struct link_entry {
   /* cost of this link */
   olsr_linkcost linkcost;
 
+  struct list_node neighbor_link_list; /* double linked list of the links of a neighbor */
   struct list_node link_list;          /* double linked list of all link entries */
   uint32_t linkquality[0];
 };
 
 /* INLINE to recast from link_list back to link_entry */
 LISTNODE2STRUCT(list2link, struct link_entry, link_list);
+LISTNODE2STRUCT(nbrlist2link, struct link_entry, neighbor_link_list);
 
 #define OLSR_LINK_JITTER       5        /* percent */
 #define OLSR_LINK_HELLO_JITTER 0        /* percent jitter */
@@ -129,6 +131,7 @@ void olsr_reset_all_links(void);
 void olsr_delete_link_entry_by_ip(const union olsr_ip_addr *);
 void olsr_expire_link_hello_timer(void *);
 void signal_link_changes(bool);        /* XXX ugly */
+void olsr_invalidate_best_links(void);
 
 struct link_entry *get_best_link_to_neighbor(const union olsr_ip_addr *);
 
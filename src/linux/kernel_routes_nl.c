@@ -73,7 +73,7 @@
  * from /usr/include/linux/netlink.h and adapted for ARM
  */
 #define MY_NLMSG_NEXT(nlh,len)   ((len) -= NLMSG_ALIGN((nlh)->nlmsg_len), \
-          (struct nlmsghdr*)ARM_NOWARN_ALIGN((((char*)(nlh)) + NLMSG_ALIGN((nlh)->nlmsg_len)))
+          (struct nlmsghdr*)ARM_NOWARN_ALIGN((((char*)(nlh)) + NLMSG_ALIGN((nlh)->nlmsg_len))))
 
 
 static void rtnetlink_read(int sock, void *, unsigned int);
@@ -90,6 +90,42 @@ struct olsr_ipadd_req {
   char buf[256];
 };
 
+/*
+ * Route changes are collected into one buffer of netlink messages
+ * and sent with a single sendmsg(). The kernel handles the whole
+ * buffer inside sendmsg() and queues one ACK per message, which
+ * are matched to the requests by their sequence number.
+ */
+#define NETLINK_BATCH_MAX 128
+#define NETLINK_BATCH_BUFSIZE (NETLINK_BATCH_MAX * 128)
+
+struct olsr_netlink_batch_entry {
+  struct rt_entry *rt;
+  olsr_route_done_function done;
+  bool set;
+  bool acked;
+  int error;
+  uint32_t offset;                     /* of the request in the batch buffer */
+};
+
+static uint32_t netlink_batch_buf[NETLINK_BATCH_BUFSIZE / sizeof(uint32_t)];
+static uint32_t netlink_batch_len;
+static struct olsr_netlink_batch_entry netlink_batch[NETLINK_BATCH_MAX];
+static unsigned int netlink_batch_count;
+static uint32_t netlink_batch_seq;
+
+/* sequence number of the last netlink request */
+static uint32_t netlink_seq;
+
+/* parameters of the kernel route for a rt_entry */
+struct olsr_rt_params {
+  uint32_t table;
+  int metric;
+  const struct rt_nexthop *nexthop;
+  union olsr_ip_addr *src;
+  bool hostRoute;
+};
+
 int rtnetlink_register_socket(int rtnl_mgrp)
 {
   int sock = socket(AF_NETLINK,SOCK_RAW,NETLINK_ROUTE);
@@ -230,6 +266,8 @@ olsr_netlink_send(struct nlmsghdr *nl_hdr)
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
 
+  nl_hdr->nlmsg_seq = ++netlink_seq;
+
   iov.iov_base = nl_hdr;
   iov.iov_len = nl_hdr->nlmsg_len;
   ret = sendmsg(olsr_cnf->rtnl_s, &msg, 0);
@@ -238,19 +276,23 @@ olsr_netlink_send(struct nlmsghdr *nl_hdr)
     return -1;
   }
 
-  iov.iov_base = rcvbuf;
-  iov.iov_len = sizeof(rcvbuf);
-  ret = recvmsg(olsr_cnf->rtnl_s, &msg, 0);
-  if (ret <= 0) {
-    olsr_syslog(OLSR_LOG_ERR, "Error while reading answer to netlink message (%d: %s)", errno, strerror(errno));
-    return -1;
-  }
+  do {
+    iov.iov_base = rcvbuf;
+    iov.iov_len = sizeof(rcvbuf);
+    ret = recvmsg(olsr_cnf->rtnl_s, &msg, 0);
+    if (ret <= 0) {
+      olsr_syslog(OLSR_LOG_ERR, "Error while reading answer to netlink message (%d: %s)", errno, strerror(errno));
+      return -1;
+    }
 
-  h = (struct nlmsghdr *)ARM_NOWARN_ALIGN(rcvbuf);
-  if (!NLMSG_OK(h, (unsigned int)ret)) {
-    olsr_syslog(OLSR_LOG_ERR, "Received netlink message was malformed (ret=%d, %u)", ret, h->nlmsg_len);
-    return -1;
-  }
+    h = (struct nlmsghdr *)ARM_NOWARN_ALIGN(rcvbuf);
+    if (!NLMSG_OK(h, (unsigned int)ret)) {
+      olsr_syslog(OLSR_LOG_ERR, "Received netlink message was malformed (ret=%d, %u)", ret, h->nlmsg_len);
+      return -1;
+    }
+
+    /* skip answers to earlier requests, e.g. of an aborted batch */
+  } while (h->nlmsg_seq != nl_hdr->nlmsg_seq);
 
   if (h->nlmsg_type != NLMSG_ERROR) {
     olsr_syslog(OLSR_LOG_INFO,
@@ -344,13 +386,11 @@ int olsr_os_ifip(int ifindex, union olsr_ip_addr *ip, bool create) {
   return olsr_add_ip(ifindex, ip, NULL, create);
 }
 
-int olsr_new_netlink_route(unsigned char family, uint32_t rttable, unsigned int flags, unsigned char scope, int if_index, int metric, int protocol,
-    const union olsr_ip_addr *src, const union olsr_ip_addr *gw, const struct olsr_ip_prefix *dst,
-    bool set, bool del_similar, bool blackhole) {
-
-  struct olsr_rtreq req;
+static void
+olsr_netlink_route_req(struct olsr_rtreq *req, unsigned char family, uint32_t rttable, unsigned int flags, unsigned char scope,
+    int if_index, int metric, int protocol, const union olsr_ip_addr *src, const union olsr_ip_addr *gw,
+    const struct olsr_ip_prefix *dst, bool set, bool del_similar, bool blackhole) {
   int family_size;
-  int err;
 
   if (0) {
     struct ipaddr_str buf1, buf2;
@@ -362,104 +402,120 @@ int olsr_new_netlink_route(unsigned char family, uint32_t rttable, unsigned int
   }
   family_size = family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr);
 
-  memset(&req, 0, sizeof(req));
+  memset(req, 0, sizeof(*req));
 
-  req.r.rtm_flags = flags;
-  req.r.rtm_family = family;
+  req->r.rtm_flags = flags;
+  req->r.rtm_family = family;
 #ifndef __ANDROID__
   if (rttable < 256)
-    req.r.rtm_table = rttable;
+    req->r.rtm_table = rttable;
   else {
-    req.r.rtm_table = RT_TABLE_UNSPEC;
-    olsr_netlink_addreq(&req.n, sizeof(req), RTA_TABLE, &rttable, sizeof(rttable));
+    req->r.rtm_table = RT_TABLE_UNSPEC;
+    olsr_netlink_addreq(&req->n, sizeof(*req), RTA_TABLE, &rttable, sizeof(rttable));
   }
 #else
-  req.r.rtm_table = rttable;
+  req->r.rtm_table = rttable;
 #endif
 
-  req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
-  req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+  req->n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+  req->n.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
 
   if (set) {
-    req.n.nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
-    req.n.nlmsg_type = RTM_NEWROUTE;
+    req->n.nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+    req->n.nlmsg_type = RTM_NEWROUTE;
   } else {
-    req.n.nlmsg_type = RTM_DELROUTE;
+    req->n.nlmsg_type = RTM_DELROUTE;
   }
 
   /* RTN_UNSPEC would be the wildcard, but blackhole broadcast or nat roules should usually not conflict */
   /* -> olsr only adds deletes unicast routes */
   if (blackhole) {
-    req.r.rtm_type = RTN_BLACKHOLE;
+    req->r.rtm_type = RTN_BLACKHOLE;
   } else {
-    req.r.rtm_type = RTN_UNICAST;
+    req->r.rtm_type = RTN_UNICAST;
   }
 
-  req.r.rtm_dst_len = dst->prefix_len;
+  req->r.rtm_dst_len = dst->prefix_len;
 
   if (set) {
     /* add protocol for setting a route */
-    req.r.rtm_protocol = protocol;
+    req->r.rtm_protocol = protocol;
   }
 
   /* calculate scope of operation */
   if (!set && del_similar) {
     /* as wildcard for fuzzy deletion */
-    req.r.rtm_scope = RT_SCOPE_NOWHERE;
+    req->r.rtm_scope = RT_SCOPE_NOWHERE;
   }
   else {
     /* for all our routes */
-    req.r.rtm_scope = scope;
+    req->r.rtm_scope = scope;
   }
 
   if ((set || !del_similar) && !blackhole) {
     /* add interface*/
-    olsr_netlink_addreq(&req.n, sizeof(req), RTA_OIF, &if_index, sizeof(if_index));
+    olsr_netlink_addreq(&req->n, sizeof(*req), RTA_OIF, &if_index, sizeof(if_index));
   }
 
   if (set && src != NULL) {
     /* add src-ip */
-    olsr_netlink_addreq(&req.n, sizeof(req), RTA_PREFSRC, src, family_size);
+    olsr_netlink_addreq(&req->n, sizeof(*req), RTA_PREFSRC, src, family_size);
   }
 
   if (metric >= 0) {
     /* add metric */
-    olsr_netlink_addreq(&req.n, sizeof(req), RTA_PRIORITY, &metric, sizeof(metric));
+    olsr_netlink_addreq(&req->n, sizeof(*req), RTA_PRIORITY, &metric, sizeof(metric));
   }
 
   if (gw) {
     /* add gateway */
-    olsr_netlink_addreq(&req.n, sizeof(req), RTA_GATEWAY, gw, family_size);
+    olsr_netlink_addreq(&req->n, sizeof(*req), RTA_GATEWAY, gw, family_size);
   }
   else {
     if ( dst->prefix_len == 32 ) {
       /* use destination as gateway, to 'force' linux kernel to do proper source address selection */
-      olsr_netlink_addreq(&req.n, sizeof(req), RTA_GATEWAY, &dst->prefix, family_size);
+      olsr_netlink_addreq(&req->n, sizeof(*req), RTA_GATEWAY, &dst->prefix, family_size);
     }
     else {
       /*do not use onlink on such routes(no gateway, but no hostroute aswell) -  e.g. smartgateway default route over an ptp tunnel interface*/
-      req.r.rtm_flags &= (~RTNH_F_ONLINK);
+      req->r.rtm_flags &= (~RTNH_F_ONLINK);
     }
   }
 
    /* add destination */
-  olsr_netlink_addreq(&req.n, sizeof(req), RTA_DST, &dst->prefix, family_size);
+  olsr_netlink_addreq(&req->n, sizeof(*req), RTA_DST, &dst->prefix, family_size);
+}
+
+static void
+olsr_netlink_route_error(bool set, int if_index, const union olsr_ip_addr *gw, const struct olsr_ip_prefix *dst) {
+  struct ipaddr_str buf;
+
+  if (gw) {
+    olsr_syslog(OLSR_LOG_ERR, ". error: %s route to %s via %s dev %s onlink (%s %d)",
+        set ? "add" : "del",
+        olsr_ip_prefix_to_string(dst), olsr_ip_to_string(&buf, gw),
+        if_ifwithindex_name(if_index), strerror(errno), errno);
+  }
+  else {
+    olsr_syslog(OLSR_LOG_ERR, ". error: %s route to %s via %s dev %s onlink (%s %d)",
+        set ? "add" : "del",
+        olsr_ip_prefix_to_string(dst), olsr_ip_to_string(&buf, &dst->prefix), if_ifwithindex_name(if_index),
+        strerror(errno), errno);
+  }
+}
+
+int olsr_new_netlink_route(unsigned char family, uint32_t rttable, unsigned int flags, unsigned char scope, int if_index, int metric, int protocol,
+    const union olsr_ip_addr *src, const union olsr_ip_addr *gw, const struct olsr_ip_prefix *dst,
+    bool set, bool del_similar, bool blackhole) {
+
+  struct olsr_rtreq req;
+  int err;
+
+  olsr_netlink_route_req(&req, family, rttable, flags, scope, if_index, metric, protocol, src, gw, dst, set, del_similar, blackhole);
 
   err = olsr_netlink_send(&req.n);
   if (err) {
-      struct ipaddr_str buf;
-    if (gw) {
-      olsr_syslog(OLSR_LOG_ERR, ". error: %s route to %s via %s dev %s onlink (%s %d)",
-          set ? "add" : "del",
-          olsr_ip_prefix_to_string(dst), olsr_ip_to_string(&buf, gw),
-          if_ifwithindex_name(if_index), strerror(errno), errno);
-    }
-    else {
-      olsr_syslog(OLSR_LOG_ERR, ". error: %s route to %s via %s dev %s onlink (%s %d)",
-          set ? "add" : "del",
-          olsr_ip_prefix_to_string(dst), olsr_ip_to_string(&buf, &dst->prefix), if_ifwithindex_name(if_index),
-          strerror(errno), errno);
-    }
+    olsr_netlink_route_error(set, if_index, gw, dst);
   }
 
   return err;
@@ -499,54 +555,53 @@ void olsr_os_inetgw_tunnel_route(uint32_t if_idx, bool ipv4, bool set, uint8_t t
   }
 }
 
-static int olsr_os_process_rt_entry(unsigned char af_family, const struct rt_entry *rt, bool set) {
-  int metric;
-  uint32_t table;
-  const struct rt_nexthop *nexthop;
-  union olsr_ip_addr *src;
-  bool hostRoute;
-  int err;
-
+static void olsr_os_rt_params(const struct rt_entry *rt, bool set, struct olsr_rt_params *p) {
   /* calculate metric */
   if (FIBM_FLAT == olsr_cnf->fib_metric) {
-    metric = olsr_cnf->fib_metric_default;
+    p->metric = olsr_cnf->fib_metric_default;
   }
   else {
-    metric = set ? rt->rt_best->rtp_metric.hops : rt->rt_metric.hops;
+    p->metric = set ? rt->rt_best->rtp_metric.hops : rt->rt_metric.hops;
   }
 
   if (olsr_cnf->smart_gw_active && is_prefix_inetgw(&rt->rt_dst)) {
     /* make space for the tunnel gateway route */
-    metric += 2;
+    p->metric += 2;
   }
 
   /* get table */
-  table = is_prefix_inetgw(&rt->rt_dst)
+  p->table = is_prefix_inetgw(&rt->rt_dst)
       ? olsr_cnf->rt_table_default : olsr_cnf->rt_table;
 
   /* get next hop */
   if (rt->rt_best && set) {
-    nexthop = &rt->rt_best->rtp_nexthop;
+    p->nexthop = &rt->rt_best->rtp_nexthop;
   }
   else {
-    nexthop = &rt->rt_nexthop;
+    p->nexthop = &rt->rt_nexthop;
   }
 
   /* detect 1-hop hostroute */
-  hostRoute = rt->rt_dst.prefix_len == olsr_cnf->ipsize * 8
-      && ipequal(&nexthop->gateway, &rt->rt_dst.prefix);
+  p->hostRoute = rt->rt_dst.prefix_len == olsr_cnf->ipsize * 8
+      && ipequal(&p->nexthop->gateway, &rt->rt_dst.prefix);
 
   /* get src ip */
   if (olsr_cnf->use_src_ip_routes) {
-    src = &olsr_cnf->unicast_src_ip;
+    p->src = &olsr_cnf->unicast_src_ip;
   }
   else {
-    src = NULL;
+    p->src = NULL;
   }
+}
 
-  /* create route */
-  err = olsr_new_netlink_route(af_family, table, RTNH_F_ONLINK, RT_SCOPE_UNIVERSE, nexthop->iif_index, metric, olsr_cnf->rt_proto,
-      src, hostRoute ? NULL : &nexthop->gateway, &rt->rt_dst, set, false, false);
+/* try to repair the kernel route of a rt_entry after a failed netlink request */
+static int olsr_os_repair_rt_entry(unsigned char af_family, const struct rt_entry *rt, bool set,
+    const struct olsr_rt_params *p, int err) {
+  int metric = p->metric;
+  uint32_t table = p->table;
+  const struct rt_nexthop *nexthop = p->nexthop;
+  union olsr_ip_addr *src = p->src;
+  bool hostRoute = p->hostRoute;
 
   /* resolve "File exist" (17) propblems (on orig and autogen routes)*/
   if (set && err == 17) {
@@ -608,6 +663,199 @@ static int olsr_os_process_rt_entry(unsigned char af_family, const struct rt_ent
   return err;
 }
 
+static int olsr_os_process_rt_entry(unsigned char af_family, const struct rt_entry *rt, bool set) {
+  struct olsr_rt_params p;
+  int err;
+
+  olsr_os_rt_params(rt, set, &p);
+
+  /* create route */
+  err = olsr_new_netlink_route(af_family, p.table, RTNH_F_ONLINK, RT_SCOPE_UNIVERSE, p.nexthop->iif_index, p.metric, olsr_cnf->rt_proto,
+      p.src, p.hostRoute ? NULL : &p.nexthop->gateway, &rt->rt_dst, set, false, false);
+
+  return olsr_os_repair_rt_entry(af_family, rt, set, &p, err);
+}
+
+/**
+ * Read the ACKs of the current route batch and match
+ * them by sequence number.
+ *
+ * @return number of requests still waiting for an ACK
+ */
+static unsigned int
+olsr_os_route_batch_read_acks(void)
+{
+  uint32_t rcvbuf[4096 / sizeof(uint32_t)];
+  unsigned int missing = netlink_batch_count;
+  struct sockaddr_nl nladdr;
+  struct iovec iov;
+  struct msghdr msg;
+  int ret;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &nladdr;
+  msg.msg_namelen = sizeof(nladdr);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  while (missing > 0) {
+    struct nlmsghdr *h;
+    int len;
+
+    iov.iov_base = rcvbuf;
+    iov.iov_len = sizeof(rcvbuf);
+    ret = recvmsg(olsr_cnf->rtnl_s, &msg, MSG_DONTWAIT);
+    if (ret <= 0) {
+      if (ret < 0 && errno != EAGAIN) {
+        /* ENOBUFS means ACKs were dropped, the requests are retried */
+        olsr_syslog(OLSR_LOG_ERR, "Error while reading answers to netlink batch (%d: %s)", errno, strerror(errno));
+      }
+      break;
+    }
+
+    len = ret;
+    for (h = (struct nlmsghdr *)ARM_NOWARN_ALIGN(rcvbuf); NLMSG_OK(h, (unsigned int)len); h = MY_NLMSG_NEXT(h, len)) {
+      struct olsr_netlink_batch_entry *entry;
+      uint32_t idx = h->nlmsg_seq - netlink_batch_seq;
+
+      if (h->nlmsg_type != NLMSG_ERROR || idx >= netlink_batch_count
+          || NLMSG_LENGTH(sizeof(struct nlmsgerr)) > h->nlmsg_len) {
+        OLSR_PRINTF(3, "KERN: ignoring netlink answer type %u seqnr %u\n", h->nlmsg_type, h->nlmsg_seq);
+        continue;
+      }
+
+      entry = &netlink_batch[idx];
+      if (!entry->acked) {
+        entry->acked = true;
+        entry->error = -((struct nlmsgerr *)NLMSG_DATA(h))->error;
+        missing--;
+      }
+    }
+  }
+  return missing;
+}
+
+/**
+ * Send all queued route changes in one netlink message batch,
+ * then report the result of each request to its callback.
+ * Requests that failed or got no ACK are handled by the
+ * same repair and retry logic as single route changes.
+ */
+void
+olsr_os_route_batch_flush(void)
+{
+  struct sockaddr_nl nladdr;
+  struct iovec iov;
+  struct msghdr msg;
+  unsigned int i, missing;
+
+  if (netlink_batch_count == 0) {
+    return;
+  }
+
+  memset(&nladdr, 0, sizeof(nladdr));
+  memset(&msg, 0, sizeof(msg));
+
+  nladdr.nl_family = AF_NETLINK;
+
+  msg.msg_name = &nladdr;
+  msg.msg_namelen = sizeof(nladdr);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  iov.iov_base = netlink_batch_buf;
+  iov.iov_len = netlink_batch_len;
+
+  if (sendmsg(olsr_cnf->rtnl_s, &msg, 0) <= 0) {
+    olsr_syslog(OLSR_LOG_ERR, "Cannot send batch to netlink socket (%d: %s)", errno, strerror(errno));
+    missing = netlink_batch_count;
+  }
+  else {
+    missing = olsr_os_route_batch_read_acks();
+  }
+
+  OLSR_PRINTF(3, "KERN: sent %u route changes in one netlink batch, %u unanswered\n", netlink_batch_count, missing);
+
+  for (i = 0; i < netlink_batch_count; i++) {
+    struct olsr_netlink_batch_entry *entry = &netlink_batch[i];
+    unsigned char af_family = olsr_cnf->ip_version;
+    struct olsr_rt_params p;
+    int err = entry->error;
+
+    olsr_os_rt_params(entry->rt, entry->set, &p);
+
+    if (!entry->acked) {
+      /* retry the request on its own */
+      err = olsr_netlink_send((struct nlmsghdr *)ARM_NOWARN_ALIGN((char *)netlink_batch_buf + entry->offset));
+    }
+
+    if (err) {
+      if (err > 0) {
+        errno = err;
+      }
+      olsr_netlink_route_error(entry->set, p.nexthop->iif_index, p.hostRoute ? NULL : &p.nexthop->gateway, &entry->rt->rt_dst);
+      err = olsr_os_repair_rt_entry(af_family, entry->rt, entry->set, &p, err);
+      if (err > 0) {
+        errno = err;
+      }
+    }
+
+    entry->done(entry->rt, err);
+  }
+
+  netlink_batch_count = 0;
+  netlink_batch_len = 0;
+}
+
+/**
+ * Queue an add (set == true) or delete of the kernel route
+ * of a rt_entry. The result is reported to the done callback
+ * by olsr_os_route_batch_flush(), which is called when the
+ * batch is full.
+ *
+ * @param rt the route
+ * @param set true to add the route, false to delete it
+ * @param done callback for the result of the request
+ */
+void
+olsr_os_route_batch_add(struct rt_entry *rt, bool set, olsr_route_done_function done)
+{
+  struct olsr_netlink_batch_entry *entry;
+  struct olsr_rt_params p;
+  struct olsr_rtreq req;
+
+  if (set) {
+    OLSR_PRINTF(2, "KERN: Adding %s\n", olsr_rtp_to_string(rt->rt_best));
+  } else {
+    OLSR_PRINTF(2, "KERN: Deleting %s\n", olsr_rt_to_string(rt));
+  }
+
+  olsr_os_rt_params(rt, set, &p);
+  olsr_netlink_route_req(&req, olsr_cnf->ip_version, p.table, RTNH_F_ONLINK, RT_SCOPE_UNIVERSE, p.nexthop->iif_index, p.metric,
+      olsr_cnf->rt_proto, p.src, p.hostRoute ? NULL : &p.nexthop->gateway, &rt->rt_dst, set, false, false);
+
+  if (netlink_batch_count == NETLINK_BATCH_MAX
+      || netlink_batch_len + NLMSG_ALIGN(req.n.nlmsg_len) > sizeof(netlink_batch_buf)) {
+    olsr_os_route_batch_flush();
+  }
+
+  if (netlink_batch_count == 0) {
+    netlink_batch_seq = netlink_seq + 1;
+  }
+  req.n.nlmsg_seq = ++netlink_seq;
+
+  entry = &netlink_batch[netlink_batch_count++];
+  entry->rt = rt;
+  entry->done = done;
+  entry->set = set;
+  entry->acked = false;
+  entry->error = 0;
+  entry->offset = netlink_batch_len;
+
+  memcpy((char *)netlink_batch_buf + netlink_batch_len, &req, req.n.nlmsg_len);
+  netlink_batch_len += NLMSG_ALIGN(req.n.nlmsg_len);
+}
+
 /**
  * Insert a route in the kernel routing table
  *
@@ -50,39 +50,142 @@
 #include "lq_mpr.h"
 #include "scheduler.h"
 #include "lq_plugin.h"
+#include "mpr.h"
+#include "log.h"
 
-void
-olsr_calculate_lq_mpr(void)
+#include <stdlib.h>
+
+/**
+ * Select the MPRs for a single 2-hop neighbour,
+ * replacing its previous selection.
+ */
+static void
+olsr_select_lq_mprs(struct neighbor_2_entry *neigh2)
 {
-  struct neighbor_2_entry *neigh2;
-  struct neighbor_list_entry *walker;
-  int i, k;
+  struct neighbor_list_entry *walker, *best_walker;
+  int k;
   struct neighbor_entry *neigh;
   olsr_linkcost best, best_1hop;
-  bool mpr_changes = false;
 
-  OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
+  /* forget the previous selection */
 
-    /* Memorize previous MPR status. */
+  for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+    if (walker->mpr_selected) {
+      walker->mpr_selected = false;
+      walker->neighbor->mpr_selected_count--;
+    }
 
-    neigh->was_mpr = neigh->is_mpr;
+  best_1hop = LINK_COST_BROKEN;
 
-    /* Clear current MPR status. */
+  /* check whether this 2-hop neighbour is also a neighbour */
 
-    neigh->is_mpr = false;
+  neigh = olsr_lookup_neighbor_table(&neigh2->neighbor_2_addr);
 
-    /* In this pass we are only interested in WILL_ALWAYS neighbours */
+  /* if it's a neighbour and also symmetric, then examine
+     the link quality */
 
-    if (neigh->status == NOT_SYM || neigh->willingness != WILL_ALWAYS) {
-      continue;
-    }
+  if (neigh != NULL && neigh->status == SYM) {
+    /* if the direct link is better than the best route via
+     * an MPR, then prefer the direct link and do not select
+     * an MPR for this 2-hop neighbour */
 
-    neigh->is_mpr = true;
+    /* determine the link quality of the direct link */
 
-    if (neigh->is_mpr != neigh->was_mpr) {
-      mpr_changes = true;
+    struct link_entry *lnk = get_best_link_to_neighbor(&neigh->neighbor_main_addr);
+
+    if (!lnk)
+      return;
+
+    best_1hop = lnk->linkcost;
+
+    /* see wether we find a better route via an MPR */
+
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+      if (walker->path_linkcost < best_1hop)
+        break;
+
+    /* we've reached the end of the list, so we haven't found
+     * a better route via an MPR - so, skip MPR selection for
+     * this 1-hop neighbor */
+
+    if (walker == &neigh2->neighbor_2_nblist)
+      return;
+  }
+
+  /* find the connecting 1-hop neighbours with the
+   * best total link qualities */
+
+  /* mark all 1-hop neighbours as not selected */
+
+  for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+    walker->neighbor->skip = false;
+
+  for (k = 0; k < olsr_cnf->mpr_coverage; k++) {
+    /* look for the best 1-hop neighbour that we haven't
+     * yet selected */
+
+    best_walker = NULL;
+    best = LINK_COST_BROKEN;
+
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+      if (walker->neighbor->status == SYM && !walker->neighbor->skip && walker->path_linkcost < best) {
+        best_walker = walker;
+        best = walker->path_linkcost;
+      }
+
+    /* Found a 1-hop neighbor that we haven't previously selected.
+     * Use it as MPR only when the 2-hop path through it is better than
+     * any existing 1-hop path. */
+    if ((best_walker != NULL) && (best < best_1hop)) {
+      best_walker->mpr_selected = true;
+      best_walker->neighbor->mpr_selected_count++;
+      best_walker->neighbor->skip = true;
     }
 
+    /* no neighbour found => the requested MPR coverage cannot
+     * be satisfied => stop */
+
+    else
+      break;
+  }
+}
+
+/**
+ * Derive the MPR status of a neighbour from its willingness
+ * and the number of 2-hop neighbours which selected it.
+ *
+ * @return true if the MPR status has changed
+ */
+static bool
+olsr_update_lq_mpr_status(struct neighbor_entry *neigh)
+{
+  bool is_mpr;
+
+  is_mpr = neigh->mpr_selected_count > 0 || (neigh->status != NOT_SYM && neigh->willingness == WILL_ALWAYS);
+  if (is_mpr == neigh->is_mpr) {
+    return false;
+  }
+
+  neigh->is_mpr = is_mpr;
+  return true;
+}
+
+/**
+ * Select the MPRs of all 2-hop neighbours from scratch.
+ *
+ * @return true if the MPR set has changed
+ */
+static bool
+olsr_calculate_lq_mpr_full(void)
+{
+  struct neighbor_2_entry *neigh2;
+  struct neighbor_list_entry *walker;
+  struct neighbor_entry *neigh;
+  int i;
+  bool mpr_changes = false;
+
+  OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
+    neigh->mpr_selected_count = 0;
   }
   OLSR_FOR_ALL_NBR_ENTRIES_END(neigh);
 
@@ -90,84 +193,99 @@ olsr_calculate_lq_mpr(void)
     /* loop through all 2-hop neighbours */
 
     for (neigh2 = two_hop_neighbortable[i].next; neigh2 != &two_hop_neighbortable[i]; neigh2 = neigh2->next) {
-      best_1hop = LINK_COST_BROKEN;
-
-      /* check whether this 2-hop neighbour is also a neighbour */
-
-      neigh = olsr_lookup_neighbor_table(&neigh2->neighbor_2_addr);
-
-      /* if it's a neighbour and also symmetric, then examine
-         the link quality */
+      for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+        walker->mpr_selected = false;
 
-      if (neigh != NULL && neigh->status == SYM) {
-        /* if the direct link is better than the best route via
-         * an MPR, then prefer the direct link and do not select
-         * an MPR for this 2-hop neighbour */
+      olsr_select_lq_mprs(neigh2);
+    }
+  }
 
-        /* determine the link quality of the direct link */
+  OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
+    if (olsr_update_lq_mpr_status(neigh))
+      mpr_changes = true;
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(neigh);
 
-        struct link_entry *lnk = get_best_link_to_neighbor(&neigh->neighbor_main_addr);
+  return mpr_changes;
+}
 
-        if (!lnk)
-          continue;
+/**
+ * Redo the MPR selection only for the 2-hop neighbours
+ * affected by changes of the neighbourhood.
+ *
+ * @return true if the MPR set has changed
+ */
+static bool
+olsr_calculate_lq_mpr_incremental(void)
+{
+  struct list_node *node;
+  struct neighbor_2_entry *neigh2;
+  struct neighbor_list_entry *walker;
+  struct neighbor_entry *neigh;
+  bool mpr_changes = false;
 
-        best_1hop = lnk->linkcost;
+  olsr_mpr_expand_dirty_neighbors();
 
-        /* see wether we find a better route via an MPR */
+  if (mpr_link_costs_changed) {
+    /* the direct link to a 2-hop neighbour, which is a neighbour as well */
 
-        for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
-          if (walker->path_linkcost < best_1hop)
-            break;
+    OLSR_FOR_ALL_NBR_ENTRIES(neigh) {
+      if (neigh->status == SYM && (neigh2 = olsr_lookup_two_hop_neighbor_table(&neigh->neighbor_main_addr)) != NULL)
+        olsr_mpr_touch_two_hop(neigh2);
+    }
+    OLSR_FOR_ALL_NBR_ENTRIES_END(neigh);
+  }
 
-        /* we've reached the end of the list, so we haven't found
-         * a better route via an MPR - so, skip MPR selection for
-         * this 1-hop neighbor */
+  for (node = mpr_dirty_two_hops.next; node != &mpr_dirty_two_hops; node = node->next) {
+    neigh2 = mprdirty2nbr2(node);
 
-        if (walker == &neigh2->neighbor_2_nblist)
-          continue;
-      }
+    olsr_select_lq_mprs(neigh2);
 
-      /* find the connecting 1-hop neighbours with the
-       * best total link qualities */
+    for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
+      olsr_mpr_touch_neighbor(walker->neighbor);
+  }
 
-      /* mark all 1-hop neighbours as not selected */
+  for (node = mpr_dirty_neighbors.next; node != &mpr_dirty_neighbors; node = node->next) {
+    if (olsr_update_lq_mpr_status(mprdirty2nbr(node)))
+      mpr_changes = true;
+  }
 
-      for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
-        walker->neighbor->skip = false;
+  return mpr_changes;
+}
 
-      for (k = 0; k < olsr_cnf->mpr_coverage; k++) {
-        /* look for the best 1-hop neighbour that we haven't
-         * yet selected */
+void
+olsr_calculate_lq_mpr(void)
+{
+  bool *check_mpr;
+  unsigned int mismatch;
+  bool mpr_changes;
 
-        neigh = NULL;
-        best = LINK_COST_BROKEN;
+  if (mpr_full_pending || olsr_cnf->mpr_mode == MPRM_FULL) {
+    mpr_changes = olsr_calculate_lq_mpr_full();
+  } else {
+    mpr_changes = olsr_calculate_lq_mpr_incremental();
 
-        for (walker = neigh2->neighbor_2_nblist.next; walker != &neigh2->neighbor_2_nblist; walker = walker->next)
-          if (walker->neighbor->status == SYM && !walker->neighbor->skip && walker->path_linkcost < best) {
-            neigh = walker->neighbor;
-            best = walker->path_linkcost;
-          }
+    if (olsr_cnf->mpr_mode == MPRM_CHECK) {
 
-        /* Found a 1-hop neighbor that we haven't previously selected.
-         * Use it as MPR only when the 2-hop path through it is better than
-         * any existing 1-hop path. */
-        if ((neigh != NULL) && (best < best_1hop)) {
-          neigh->is_mpr = true;
-          neigh->skip = true;
+      /*
+       * Keep the incremental result for comparison and
+       * continue with the full run.
+       */
+      check_mpr = olsr_mpr_snapshot();
 
-          if (neigh->is_mpr != neigh->was_mpr)
-            mpr_changes = true;
-        }
+      if (olsr_calculate_lq_mpr_full())
+        mpr_changes = true;
 
-        /* no neighbour found => the requested MPR coverage cannot
-         * be satisfied => stop */
+      mismatch = olsr_mpr_compare(check_mpr);
+      free(check_mpr);
 
-        else
-          break;
-      }
+      if (mismatch)
+        olsr_syslog(OLSR_LOG_ERR, "MPR: incremental result differs from full run for %u neighbors", mismatch);
     }
   }
 
+  olsr_mpr_clear_changes();
+
   if (mpr_changes && olsr_cnf->tc_redundancy > 0)
     signal_link_changes(true);
 }
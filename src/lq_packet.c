@@ -62,12 +62,25 @@
 #include "build_msg.h"
 #include "net_olsr.h"
 #include "lq_plugin.h"
+#include "tc_set.h"
 
 bool lq_tc_pending = false;
 
 static uint32_t msg_buffer_aligned[(MAXMESSAGESIZE - OLSR_HEADERSIZE) / sizeof(uint32_t) + 1];
 static unsigned char *const msg_buffer = (unsigned char *)msg_buffer_aligned;
 
+/*
+ * Delta TCs: the neighbor set of the last LQ_TC and the changes
+ * from the set before, each tagged with its ANSN.
+ */
+static struct tc_mpr_addr *tc_delta_set;        /* sorted like in create_lq_tc() */
+static uint16_t tc_delta_set_ansn;
+static bool tc_delta_set_valid = false;
+static struct tc_mpr_addr *tc_delta_changed;    /* added or changed edges */
+static struct tc_mpr_addr *tc_delta_removed;
+static uint16_t tc_delta_base_ansn;             /* ANSN the changes apply to */
+static bool tc_delta_changes_valid = false;
+
 static void
 create_lq_hello(struct lq_hello_message *lq_hello, struct interface_olsr *outif)
 {
@@ -151,14 +164,32 @@ destroy_lq_hello(struct lq_hello_message *lq_hello)
   lq_hello->neigh = NULL;
 }
 
+/* number of fisheye gaps a scoped TC stays valid */
+#define LQ_TC_FISHEYE_VTIME_MARGIN 3
+
+/*
+ * Number of TCs from a position in the fisheye TTL sequence to the
+ * next one with at least the same TTL.
+ */
+static unsigned int
+lq_tc_fisheye_gap(int idx)
+{
+  unsigned int gap;
+
+  for (gap = 1; gap < olsr_cnf->lq_fish_ttl_cnt; gap++) {
+    if (olsr_cnf->lq_fish_ttl[(idx + gap) % olsr_cnf->lq_fish_ttl_cnt] >= olsr_cnf->lq_fish_ttl[idx]) {
+      break;
+    }
+  }
+  return gap;
+}
+
 static void
 create_lq_tc(struct lq_tc_message *lq_tc, struct interface_olsr *outif)
 {
   struct link_entry *lnk;
   struct neighbor_entry *walker;
   struct tc_mpr_addr *neigh;
-  static int ttl_list[] = { 2, 8, 2, 16, 2, 8, 2, MAX_TTL };
-
   // remember that we have generated an LQ TC message; this is
   // checked in net_output()
 
@@ -173,10 +204,20 @@ create_lq_tc(struct lq_tc_message *lq_tc, struct interface_olsr *outif)
   lq_tc->comm.orig = olsr_cnf->main_addr;
 
   if (olsr_cnf->lq_fish > 0) {
-    if (outif->ttl_index >= (int)(sizeof(ttl_list) / sizeof(ttl_list[0])))
+    if (outif->ttl_index >= olsr_cnf->lq_fish_ttl_cnt)
       outif->ttl_index = 0;
 
-    lq_tc->comm.ttl = (0 <= outif->ttl_index ? ttl_list[outif->ttl_index] : MAX_TTL);
+    if (0 <= outif->ttl_index) {
+      lq_tc->comm.ttl = olsr_cnf->lq_fish_ttl[outif->ttl_index];
+
+      // nodes at the edge of the scope only get every n-th TC, so
+      // the validity time has to cover a few of these gaps
+      lq_tc->comm.vtime = MAX(lq_tc->comm.vtime,
+                              (olsr_reltime) (lq_tc_fisheye_gap(outif->ttl_index) * LQ_TC_FISHEYE_VTIME_MARGIN
+                                              * outif->olsr_if->cnf->tc_params.emission_interval * MSEC_PER_SEC));
+    } else {
+      lq_tc->comm.ttl = MAX_TTL;
+    }
     outif->ttl_index++;
 
     OLSR_PRINTF(3, "Creating LQ TC with TTL %d.\n", lq_tc->comm.ttl);
@@ -283,6 +324,94 @@ destroy_lq_tc(struct lq_tc_message *lq_tc)
   }
 }
 
+static void
+free_tc_mpr_addr_list(struct tc_mpr_addr *list)
+{
+  struct tc_mpr_addr *aux;
+
+  for (; list != NULL; list = aux) {
+    aux = list->next;
+    free(list);
+  }
+}
+
+/* check if the advertised link quality of an edge differs */
+static bool
+tc_delta_lq_changed(struct tc_mpr_addr *old, struct tc_mpr_addr *new)
+{
+  unsigned char old_lq[32], new_lq[32];
+  int len;
+
+  assert(olsr_sizeof_tc_lqdata() <= sizeof(old_lq));
+
+  len = olsr_serialize_tc_lq_pair(old_lq, old);
+  return len != olsr_serialize_tc_lq_pair(new_lq, new) || memcmp(old_lq, new_lq, len) != 0;
+}
+
+/* append a copy of a neighbor entry to a list */
+static void
+tc_delta_append(struct tc_mpr_addr ***tail, struct tc_mpr_addr *neigh)
+{
+  struct tc_mpr_addr *copy = olsr_copy_tc_mpr_addr(neigh, "Build LQ_TC delta");
+
+  **tail = copy;
+  *tail = &copy->next;
+}
+
+/*
+ * Compare a freshly created neighbor set with the last one and
+ * remember the changes. Every set with different content gets
+ * a new ANSN. The neighbor list of the LQ_TC is kept as the new
+ * set, the caller must not free it.
+ */
+static void
+update_lq_tc_delta(struct lq_tc_message *lq_tc)
+{
+  struct tc_mpr_addr *old = tc_delta_set, *new = lq_tc->neigh;
+  struct tc_mpr_addr *changed = NULL, *removed = NULL;
+  struct tc_mpr_addr **changed_tail = &changed, **removed_tail = &removed;
+
+  if (tc_delta_set_valid) {
+    /* merge the two sorted sets */
+    while (old != NULL || new != NULL) {
+      int diff = old == NULL ? 1 : new == NULL ? -1 : avl_comp_default(&old->address, &new->address);
+
+      if (diff < 0) {
+        tc_delta_append(&removed_tail, old);
+        old = old->next;
+      } else if (diff > 0) {
+        tc_delta_append(&changed_tail, new);
+        new = new->next;
+      } else {
+        if (tc_delta_lq_changed(old, new)) {
+          tc_delta_append(&changed_tail, new);
+        }
+        old = old->next;
+        new = new->next;
+      }
+    }
+
+    if (changed != NULL || removed != NULL || tc_delta_set_ansn != lq_tc->ansn) {
+      if (tc_delta_set_ansn == lq_tc->ansn) {
+        increase_local_ansn();
+        lq_tc->ansn = get_local_ansn();
+      }
+
+      free_tc_mpr_addr_list(tc_delta_changed);
+      free_tc_mpr_addr_list(tc_delta_removed);
+      tc_delta_changed = changed;
+      tc_delta_removed = removed;
+      tc_delta_base_ansn = tc_delta_set_ansn;
+      tc_delta_changes_valid = true;
+    }
+  }
+
+  free_tc_mpr_addr_list(tc_delta_set);
+  tc_delta_set = lq_tc->neigh;
+  tc_delta_set_ansn = lq_tc->ansn;
+  tc_delta_set_valid = true;
+}
+
 static int
 common_size(void)
 {
@@ -514,6 +643,16 @@ calculate_border_flag(void *lower_border, void *higher_border)
   return bitpos + 1;
 }
 
+static void
+lq_tc_count_sent(const struct lq_tc_message *lq_tc, int size)
+{
+  tc_flood_stats.sent++;
+  tc_flood_stats.sent_bytes += size;
+  if (lq_tc->comm.ttl < MAX_TTL) {
+    tc_flood_stats.sent_scoped++;
+  }
+}
+
 static void
 serialize_lq_tc(struct lq_tc_message *lq_tc, struct interface_olsr *outif)
 {
@@ -589,6 +728,7 @@ serialize_lq_tc(struct lq_tc_message *lq_tc, struct interface_olsr *outif)
       // output packet
 
       net_outbuffer_push(outif, msg_buffer, size + off);
+      lq_tc_count_sent(lq_tc, size + off);
 
       net_output(outif);
 
@@ -618,6 +758,103 @@ serialize_lq_tc(struct lq_tc_message *lq_tc, struct interface_olsr *outif)
   serialize_common((struct olsr_common *)lq_tc);
 
   net_outbuffer_push(outif, msg_buffer, size + off);
+  lq_tc_count_sent(lq_tc, size + off);
+}
+
+/*
+ * Send the changes since the last TC of the interface as a delta,
+ * if there is no full TC due.
+ *
+ * @return true if a delta was queued, false if the caller has to
+ * send a full TC
+ */
+static bool
+serialize_lq_tc_delta(struct lq_tc_message *lq_tc, struct interface_olsr *outif)
+{
+  int off, rem, size, expected_size;
+  struct lq_tc_delta_header *head;
+  struct tc_mpr_addr *neigh, *changed = NULL, *removed = NULL;
+  uint16_t base_ansn, count = 0;
+  unsigned char *buff;
+
+  /*
+   * Fisheye: nodes out of reach of the last TC missed it, so a TC
+   * reaching further than the last one has to be a full one.
+   */
+  if (outif->tc_delta_countdown == 0 || lq_tc->comm.ttl > outif->tc_delta_ttl) {
+    goto full;
+  }
+
+  if (outif->tc_delta_ansn == lq_tc->ansn) {
+    /* nothing changed, an empty delta refreshes the validity time */
+    base_ansn = lq_tc->ansn;
+  } else if (tc_delta_changes_valid && outif->tc_delta_ansn == tc_delta_base_ansn && tc_delta_set_ansn == lq_tc->ansn) {
+    base_ansn = tc_delta_base_ansn;
+    changed = tc_delta_changed;
+    removed = tc_delta_removed;
+  } else {
+    /* we missed more than one change on this interface */
+    goto full;
+  }
+
+  off = common_size() + sizeof(struct lq_tc_delta_header);
+  expected_size = 0;
+  for (neigh = changed; neigh != NULL; neigh = neigh->next) {
+    expected_size += olsr_cnf->ipsize + olsr_sizeof_tc_lqdata();
+  }
+  for (neigh = removed; neigh != NULL; neigh = neigh->next) {
+    expected_size += olsr_cnf->ipsize;
+  }
+
+  /* a delta is never fragmented, send a full TC instead */
+  rem = net_outbuffer_bytes_left(outif) - off;
+  if (rem < expected_size && 0 < net_output_pending(outif)) {
+    net_output(outif);
+    rem = net_outbuffer_bytes_left(outif) - off;
+  }
+  if (rem < expected_size) {
+    goto full;
+  }
+
+  head = (struct lq_tc_delta_header *)ARM_NOWARN_ALIGN(msg_buffer + common_size());
+  buff = msg_buffer + off;
+  size = 0;
+
+  for (neigh = changed; neigh != NULL; neigh = neigh->next) {
+    genipcopy(buff + size, &neigh->address);
+    size += olsr_cnf->ipsize;
+    size += olsr_serialize_tc_lq_pair(&buff[size], neigh);
+    count++;
+  }
+  for (neigh = removed; neigh != NULL; neigh = neigh->next) {
+    genipcopy(buff + size, &neigh->address);
+    size += olsr_cnf->ipsize;
+  }
+
+  head->ansn = htons(lq_tc->ansn);
+  head->base_ansn = htons(base_ansn);
+  head->changed = htons(count);
+  head->reserved = 0;
+
+  lq_tc->comm.type = LQ_TC_DELTA_MESSAGE;
+  lq_tc->comm.size = size + off;
+
+  serialize_common((struct olsr_common *)lq_tc);
+
+  net_outbuffer_push(outif, msg_buffer, size + off);
+  lq_tc_count_sent(lq_tc, size + off);
+  tc_flood_stats.sent_delta++;
+
+  outif->tc_delta_ansn = lq_tc->ansn;
+  outif->tc_delta_ttl = lq_tc->comm.ttl;
+  outif->tc_delta_countdown--;
+  return true;
+
+full:
+  outif->tc_delta_ansn = lq_tc->ansn;
+  outif->tc_delta_ttl = lq_tc->comm.ttl;
+  outif->tc_delta_countdown = olsr_cnf->tc_delta_refresh - 1;
+  return false;
 }
 
 void
@@ -662,13 +899,21 @@ olsr_output_lq_tc(void *para)
 
   create_lq_tc(&lq_tc, outif);
 
+  // remember the changes since the last TC, this keeps the neighbor list
+
+  if (olsr_cnf->tc_delta_refresh > 0) {
+    update_lq_tc_delta(&lq_tc);
+  }
+
   // a) the message is not empty
 
   if (lq_tc.neigh != NULL) {
     prev_empty = 0;
 
     // convert internal format into transmission format, send it
-    serialize_lq_tc(&lq_tc, outif);
+    if (olsr_cnf->tc_delta_refresh == 0 || !serialize_lq_tc_delta(&lq_tc, outif)) {
+      serialize_lq_tc(&lq_tc, outif);
+    }
 
     // b) this is the first empty message
   } else if (prev_empty == 0) {
@@ -686,9 +931,17 @@ olsr_output_lq_tc(void *para)
   } else if (!TIMED_OUT(get_empty_tc_timer())) {
     serialize_lq_tc(&lq_tc, outif);
   }
+
+  // receivers drop us after an empty TC, start over with a full one
+
+  if (lq_tc.neigh == NULL) {
+    outif->tc_delta_countdown = 0;
+  }
   // destroy internal format
 
-  destroy_lq_tc(&lq_tc);
+  if (olsr_cnf->tc_delta_refresh == 0) {
+    destroy_lq_tc(&lq_tc);
+  }
 
   if (net_output_pending(outif)) {
     if (!outif->immediate_send_tc) {
@@ -53,6 +53,7 @@
 
 #define LQ_HELLO_MESSAGE      201
 #define LQ_TC_MESSAGE         202
+#define LQ_TC_DELTA_MESSAGE   203
 
 /* deserialized OLSR header */
 
@@ -136,6 +137,19 @@ struct lq_tc_header {
   uint8_t upper_border;
 };
 
+/*
+ * serialized LQ_TC delta, followed by 'changed' added or changed
+ * edges (address and link quality) and the addresses of the removed
+ * edges up to the end of the message
+ */
+
+struct lq_tc_delta_header {
+  uint16_t ansn;
+  uint16_t base_ansn;                  /* ANSN of the neighbor set the delta applies to */
+  uint16_t changed;
+  uint16_t reserved;
+};
+
 static INLINE void
 pkt_get_u8(const uint8_t ** p, uint8_t * var)
 {
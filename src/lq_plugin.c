@@ -50,6 +50,7 @@
 #include "packet.h"
 #include "olsr.h"
 #include "two_hop_neighbor_table.h"
+#include "mpr.h"
 #include "common/avl.h"
 
 #include "lq_plugin_default_float.h"
@@ -457,6 +458,28 @@ olsr_malloc_tc_mpr_addr(const char *id)
   return t;
 }
 
+/**
+ * olsr_copy_tc_mpr_addr
+ *
+ * this function duplicates a tc_mpr_addr inclusive
+ * linkquality data, the copy is not linked to a list.
+ *
+ * @param neigh the tc_mpr_addr to copy
+ * @param id string for memory debugging
+ *
+ * @return pointer to the new tc_mpr_addr
+ */
+struct tc_mpr_addr *
+olsr_copy_tc_mpr_addr(const struct tc_mpr_addr *neigh, const char *id)
+{
+  struct tc_mpr_addr *t;
+
+  t = olsr_malloc(sizeof(struct tc_mpr_addr) + active_lq_handler->tc_lq_size, id);
+  memcpy(t, neigh, sizeof(struct tc_mpr_addr) + active_lq_handler->tc_lq_size);
+  t->next = NULL;
+  return t;
+}
+
 /**
  * olsr_malloc_lq_hello_neighbor
  *
@@ -517,6 +540,10 @@ void olsr_relevant_linkcost_change(void) {
   changes_neighborhood = true;
   changes_topology = true;
 
+  /* the best link to a neighbor might be a different one */
+  olsr_invalidate_best_links();
+  olsr_mpr_touch_link_costs();
+
   /* XXX - we should check whether we actually announce this neighbour */
   signal_link_changes(true);
 }
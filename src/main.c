@@ -78,6 +78,9 @@
 #include "pid_file.h"
 #include "lock_file.h"
 #include "cli.h"
+#include "olsr_spf.h"
+#include "common/hashtable.h"
+#include "common/radix.h"
 
 #ifdef __linux__
 #include <linux/types.h>
@@ -181,6 +184,7 @@ static void olsr_shutdown_messages(void) {
     }
     net_output(ifn);
   }
+  net_output_flush();
 }
 
 /**
@@ -628,6 +632,21 @@ int main(int argc, char *argv[]) {
   /* Initialisation of different tables to be used. */
   olsr_init_tables();
 
+#ifdef SPF_PROFILING
+  /* compare the SPF candidate heap against the AVL tree */
+  olsr_spf_benchmark();
+#endif /* SPF_PROFILING */
+
+#ifdef HASH_PROFILING
+  /* compare the hash chains against the open addressing index */
+  hashtable_benchmark();
+#endif /* HASH_PROFILING */
+
+#ifdef RADIX_PROFILING
+  /* compare prefix probing in the routingtree against the radix tree */
+  radix_benchmark();
+#endif /* RADIX_PROFILING */
+
 #ifdef __linux__
   /* startup gateway system */
   if (olsr_cnf->smart_gw_active && olsr_startup_gateways()) {
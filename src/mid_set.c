@@ -48,6 +48,7 @@
 #include "defs.h"
 #include "two_hop_neighbor_table.h"
 #include "mid_set.h"
+#include "mpr.h"
 #include "olsr.h"
 #include "rebuild_packet.h"
 #include "scheduler.h"
@@ -57,12 +58,83 @@
 #include "packet.h"             /* struct mid_alias */
 #include "net_olsr.h"
 #include "duplicate_handler.h"
+#include "common/hashtable.h"
 
 struct mid_entry mid_set[HASHSIZE];
 struct mid_address reverse_mid_set[HASHSIZE];
 
+/* lookup indices of mid_set by main address and reverse_mid_set by alias */
+static struct hashtable mid_index;
+static struct hashtable reverse_mid_index;
+
 struct mid_entry *mid_lookup_entry_bymain(const union olsr_ip_addr *adr);
 
+/**
+ * Queue a MID entry in the mid_set and index it.
+ */
+static void
+olsr_queue_mid_entry(struct mid_entry *mid)
+{
+  QUEUE_ELEM(mid_set[olsr_ip_hashing(&mid->main_addr)], mid);
+  hashtable_insert(&mid_index, mid);
+}
+
+/**
+ * Dequeue a MID entry from the mid_set and the index.
+ */
+static void
+olsr_dequeue_mid_entry(struct mid_entry *mid)
+{
+  uint32_t hash = olsr_ip_hashing(&mid->main_addr);
+  struct mid_entry *dup;
+
+  DEQUEUE_ELEM(mid);
+
+  if (!hashtable_remove(&mid_index, mid)) {
+    return;
+  }
+  for (dup = mid_set[hash].next; dup != &mid_set[hash]; dup = dup->next) {
+    if (ipequal(&dup->main_addr, &mid->main_addr)) {
+      hashtable_insert(&mid_index, dup);
+      break;
+    }
+  }
+}
+
+/**
+ * Queue an alias in the reverse_mid_set and index it.
+ */
+static void
+olsr_queue_mid_alias(struct mid_address *alias)
+{
+  QUEUE_ELEM(reverse_mid_set[olsr_ip_hashing(&alias->alias)], alias);
+  hashtable_insert(&reverse_mid_index, alias);
+}
+
+/**
+ * Dequeue an alias from the reverse_mid_set. The same alias might
+ * be registered for another main address, so the newest remaining
+ * registration is indexed instead.
+ */
+static void
+olsr_dequeue_mid_alias(struct mid_address *alias)
+{
+  uint32_t hash = olsr_ip_hashing(&alias->alias);
+  struct mid_address *dup;
+
+  DEQUEUE_ELEM(alias);
+
+  if (!hashtable_remove(&reverse_mid_index, alias)) {
+    return;
+  }
+  for (dup = reverse_mid_set[hash].next; dup != &reverse_mid_set[hash]; dup = dup->next) {
+    if (ipequal(&dup->alias, &alias->alias)) {
+      hashtable_insert(&reverse_mid_index, dup);
+      break;
+    }
+  }
+}
+
 /**
  * Initialize the MID set
  *
@@ -82,6 +154,9 @@ olsr_init_mid_set(void)
     reverse_mid_set[idx].prev = &reverse_mid_set[idx];
   }
 
+  hashtable_init(&mid_index, offsetof(struct mid_entry, main_addr), olsr_cnf->ipsize);
+  hashtable_init(&reverse_mid_index, offsetof(struct mid_address, alias), olsr_cnf->ipsize);
+
   return 1;
 }
 
@@ -157,17 +232,10 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
 {
   struct mid_entry *tmp;
   struct mid_address *tmp_adr;
-  uint32_t hash, alias_hash;
   union olsr_ip_addr *registered_m_addr;
 
-  hash = olsr_ip_hashing(m_addr);
-  alias_hash = olsr_ip_hashing(&alias->alias);
-
   /* Check for registered entry */
-  for (tmp = mid_set[hash].next; tmp != &mid_set[hash]; tmp = tmp->next) {
-    if (ipequal(&tmp->main_addr, m_addr))
-      break;
-  }
+  tmp = mid_lookup_entry_bymain(m_addr);
 
   /* Check if alias is already registered with m_addr */
   registered_m_addr = mid_lookup_main_addr(&alias->alias);
@@ -182,11 +250,11 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
   olsr_insert_routing_table(&alias->alias, olsr_cnf->maxplen, m_addr, OLSR_RT_ORIGIN_MID);
 
   /*If the address was registered */
-  if (tmp != &mid_set[hash]) {
+  if (tmp != NULL) {
     tmp_adr = tmp->aliases;
     tmp->aliases = alias;
     alias->main_entry = tmp;
-    QUEUE_ELEM(reverse_mid_set[alias_hash], alias);
+    olsr_queue_mid_alias(alias);
     alias->next_alias = tmp_adr;
     olsr_set_mid_timer(tmp, vtime);
   } else {
@@ -196,12 +264,12 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
 
     tmp->aliases = alias;
     alias->main_entry = tmp;
-    QUEUE_ELEM(reverse_mid_set[alias_hash], alias);
+    olsr_queue_mid_alias(alias);
     tmp->main_addr = *m_addr;
     olsr_set_mid_timer(tmp, vtime);
 
     /* Queue */
-    QUEUE_ELEM(mid_set[hash], tmp);
+    olsr_queue_mid_entry(tmp);
   }
 
   /*
@@ -226,6 +294,7 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
 
       olsr_delete_two_hop_neighbor_table(tmp_2_neighbor);
 
+      olsr_mpr_force_full();
       changes_neighborhood = true;
     }
 
@@ -238,11 +307,13 @@ insert_mid_tuple(union olsr_ip_addr *m_addr, struct mid_address *alias, olsr_rel
 
       replace_neighbor_link_set(tmp_neigh, real_neigh);
 
+      olsr_mpr_forget_neighbor(tmp_neigh);
       /* Dequeue */
-      DEQUEUE_ELEM(tmp_neigh);
+      olsr_dequeue_neighbor_table(tmp_neigh);
       /* Delete */
       free(tmp_neigh);
 
+      olsr_mpr_force_full();
       changes_neighborhood = true;
     }
     tmp_adr = tmp_adr->next_alias;
@@ -291,6 +362,7 @@ insert_mid_alias(union olsr_ip_addr *main_add, const union olsr_ip_addr *alias,
     ne_new = olsr_insert_neighbor_table(main_add);
     /* adjust pointers to neighbortable-entry in link_set */
     ne_ref_rp_count = replace_neighbor_link_set(ne_old, ne_new);
+    olsr_mpr_force_full();
     if (ne_ref_rp_count > 0)
       OLSR_PRINTF(2, "Performed %d neighbortable-pointer replacements (%p -> %p) in link_set.\n", ne_ref_rp_count, ne_old, ne_new);
 
@@ -310,6 +382,9 @@ insert_mid_alias(union olsr_ip_addr *main_add, const union olsr_ip_addr *alias,
 
   if (!insert_mid_tuple(main_add, adr, vtime)) {
     free(adr);
+  } else {
+    /* addresses of the neighborhood may resolve differently now */
+    olsr_mpr_force_full();
   }
 
   /*
@@ -329,18 +404,10 @@ insert_mid_alias(union olsr_ip_addr *main_add, const union olsr_ip_addr *alias,
 union olsr_ip_addr *
 mid_lookup_main_addr(const union olsr_ip_addr *adr)
 {
-  uint32_t hash;
   struct mid_address *tmp_list;
 
-  hash = olsr_ip_hashing(adr);
-
-  /*Traverse MID list */
-  for (tmp_list = reverse_mid_set[hash].next; tmp_list != &reverse_mid_set[hash]; tmp_list = tmp_list->next) {
-    if (ipequal(&tmp_list->alias, adr))
-      return &tmp_list->main_entry->main_addr;
-  }
-  return NULL;
-
+  tmp_list = hashtable_find(&reverse_mid_index, adr);
+  return tmp_list ? &tmp_list->main_entry->main_addr : NULL;
 }
 
 /*
@@ -352,17 +419,7 @@ mid_lookup_main_addr(const union olsr_ip_addr *adr)
 struct mid_entry *
 mid_lookup_entry_bymain(const union olsr_ip_addr *adr)
 {
-  struct mid_entry *tmp_list;
-  uint32_t hash;
-
-  hash = olsr_ip_hashing(adr);
-
-  /* Check all registered nodes... */
-  for (tmp_list = mid_set[hash].next; tmp_list != &mid_set[hash]; tmp_list = tmp_list->next) {
-    if (ipequal(&tmp_list->main_addr, adr))
-      return tmp_list;
-  }
-  return NULL;
+  return hashtable_find(&mid_index, adr);
 }
 
 /*
@@ -388,21 +445,16 @@ mid_lookup_aliases(const union olsr_ip_addr *adr)
 int
 olsr_update_mid_table(const union olsr_ip_addr *adr, olsr_reltime vtime)
 {
-  uint32_t hash;
   struct ipaddr_str buf;
-  struct mid_entry *tmp_list = mid_set;
+  struct mid_entry *tmp_list;
 
   OLSR_PRINTF(3, "MID: update %s\n", olsr_ip_to_string(&buf, adr));
-  hash = olsr_ip_hashing(adr);
 
-  /* Check all registered nodes... */
-  for (tmp_list = mid_set[hash].next; tmp_list != &mid_set[hash]; tmp_list = tmp_list->next) {
-    /*find match */
-    if (ipequal(&tmp_list->main_addr, adr)) {
-      olsr_set_mid_timer(tmp_list, vtime);
+  tmp_list = mid_lookup_entry_bymain(adr);
+  if (tmp_list != NULL) {
+    olsr_set_mid_timer(tmp_list, vtime);
 
-      return 1;
-    }
+    return 1;
   }
   return 0;
 }
@@ -418,19 +470,13 @@ olsr_prune_aliases(struct mid_message *message)
   const union olsr_ip_addr *m_addr = &message->mid_origaddr;
   struct mid_alias * declared_aliases = message->mid_addr;
   struct mid_entry *entry;
-  uint32_t hash;
   struct mid_address *registered_aliases;
   struct mid_address *previous_alias;
   struct mid_alias *save_declared_aliases = declared_aliases;
 
-  hash = olsr_ip_hashing(m_addr);
-
   /* Check for registered entry */
-  for (entry = mid_set[hash].next; entry != &mid_set[hash]; entry = entry->next) {
-    if (ipequal(&entry->main_addr, m_addr))
-      break;
-  }
-  if (entry == &mid_set[hash]) {
+  entry = mid_lookup_entry_bymain(m_addr);
+  if (entry == NULL) {
     /* MID entry not found, nothing to prune here */
     return;
   }
@@ -469,7 +515,7 @@ olsr_prune_aliases(struct mid_message *message)
       }
 
       /* Remove from hash table */
-      DEQUEUE_ELEM(current_alias);
+      olsr_dequeue_mid_alias(current_alias);
 
       /*
        * Delete the rt_path for the alias.
@@ -481,6 +527,7 @@ olsr_prune_aliases(struct mid_message *message)
       /*
        *Recalculate topology
        */
+      olsr_mpr_force_full();
       changes_neighborhood = true;
       changes_topology = true;
     } else {
@@ -504,7 +551,7 @@ olsr_delete_mid_entry(struct mid_entry *mid)
   while (aliases) {
     struct mid_address *tmp_aliases = aliases;
     aliases = aliases->next_alias;
-    DEQUEUE_ELEM(tmp_aliases);
+    olsr_dequeue_mid_alias(tmp_aliases);
 
     /*
      * Delete the rt_path for the alias.
@@ -523,7 +570,7 @@ olsr_delete_mid_entry(struct mid_entry *mid)
   }
 
   /* Dequeue */
-  DEQUEUE_ELEM(mid);
+  olsr_dequeue_mid_entry(mid);
   free(mid);
 }
 
@@ -51,6 +51,9 @@
 #include "neighbor_table.h"
 #include "scheduler.h"
 #include "net_olsr.h"
+#include "log.h"
+
+#include <stdlib.h>
 
 /* Begin:
  * Prototypes for internal functions
@@ -72,69 +75,67 @@ static int olsr_check_mpr_changes(void);
 
 static int olsr_chosen_mpr(struct neighbor_entry *, uint16_t *);
 
-static struct neighbor_2_list_entry *olsr_find_2_hop_neighbors_with_1_link(int);
+static void olsr_add_2_hop_neighbors_with_1_link(int, uint16_t *);
+
+static bool olsr_calculate_mpr_full(void);
+
+static bool olsr_calculate_mpr_incremental(void);
+
+static void olsr_mpr_update_coverage(void);
+
+static unsigned int olsr_mpr_count_uncovered(void);
 
 /* End:
  * Prototypes for internal functions
  */
 
+/* neighbors and 2 hop neighbors changed since the last MPR calculation */
+struct list_node mpr_dirty_neighbors = { &mpr_dirty_neighbors, &mpr_dirty_neighbors };
+struct list_node mpr_dirty_two_hops = { &mpr_dirty_two_hops, &mpr_dirty_two_hops };
+
+/* the cost of some link to a neighbor has changed */
+bool mpr_link_costs_changed = false;
+
+/* the MPR set must be recalculated from scratch */
+bool mpr_full_pending = true;
+
 /**
- *Find all 2 hop neighbors with 1 link
- *connecting them to us trough neighbors
- *with a given willingness.
+ *Choose all neighbors with a given willingness which
+ *are the only link to a 2 hop neighbor.
  *
  *@param willingness the willigness of the neighbors
- *
- *@return a linked list of allocated neighbor_2_list_entry structures
+ *@param two_hop_covered_count the number of covered 2 hop neighbors
  */
-static struct neighbor_2_list_entry *
-olsr_find_2_hop_neighbors_with_1_link(int willingness)
+static void
+olsr_add_2_hop_neighbors_with_1_link(int willingness, uint16_t * two_hop_covered_count)
 {
-
-  uint8_t idx;
-  struct neighbor_2_list_entry *two_hop_list_tmp = NULL;
-  struct neighbor_2_list_entry *two_hop_list = NULL;
-  struct neighbor_entry *dup_neighbor;
-  struct neighbor_2_entry *two_hop_neighbor = NULL;
+  int idx;
+  struct neighbor_entry *one_hop_neighbor, *dup_neighbor;
+  struct neighbor_2_entry *two_hop_neighbor;
 
   for (idx = 0; idx < HASHSIZE; idx++) {
 
     for (two_hop_neighbor = two_hop_neighbortable[idx].next; two_hop_neighbor != &two_hop_neighbortable[idx];
          two_hop_neighbor = two_hop_neighbor->next) {
 
-      //two_hop_neighbor->neighbor_2_state=0;
-      //two_hop_neighbor->mpr_covered_count = 0;
-
-      dup_neighbor = olsr_lookup_neighbor_table(&two_hop_neighbor->neighbor_2_addr);
-
-      if ((dup_neighbor != NULL) && (dup_neighbor->status != NOT_SYM)) {
-
-        //OLSR_PRINTF(1, "(1)Skipping 2h neighbor %s - already 1hop\n", olsr_ip_to_string(&buf, &two_hop_neighbor->neighbor_2_addr));
-
+      if (two_hop_neighbor->neighbor_2_pointer != 1) {
         continue;
       }
 
-      if (two_hop_neighbor->neighbor_2_pointer == 1) {
-        if ((two_hop_neighbor->neighbor_2_nblist.next->neighbor->willingness == willingness)
-            && (two_hop_neighbor->neighbor_2_nblist.next->neighbor->status == SYM)) {
-          two_hop_list_tmp = olsr_malloc(sizeof(struct neighbor_2_list_entry), "MPR two hop list");
-
-          //OLSR_PRINTF(1, "ONE LINK ADDING %s\n", olsr_ip_to_string(&buf, &two_hop_neighbor->neighbor_2_addr));
-
-          /* Only queue one way here */
-          two_hop_list_tmp->neighbor_2 = two_hop_neighbor;
+      one_hop_neighbor = two_hop_neighbor->neighbor_2_nblist.next->neighbor;
+      if ((one_hop_neighbor->willingness != willingness) || (one_hop_neighbor->status != SYM) || one_hop_neighbor->is_mpr) {
+        continue;
+      }
 
-          two_hop_list_tmp->next = two_hop_list;
+      dup_neighbor = olsr_lookup_neighbor_table(&two_hop_neighbor->neighbor_2_addr);
 
-          two_hop_list = two_hop_list_tmp;
-        }
+      if ((dup_neighbor != NULL) && (dup_neighbor->status != NOT_SYM)) {
+        continue;
       }
 
+      olsr_chosen_mpr(one_hop_neighbor, two_hop_covered_count);
     }
-
   }
-
-  return (two_hop_list_tmp);
 }
 
 /**
@@ -176,13 +177,14 @@ olsr_chosen_mpr(struct neighbor_entry *one_hop_neighbor, uint16_t * two_hop_cove
 
     //OLSR_PRINTF(1, "[%s](%x) has coverage %d\n", olsr_ip_to_string(&buf, &second_hop_entries->neighbor_2->neighbor_2_addr), second_hop_entries->neighbor_2, second_hop_entries->neighbor_2->mpr_covered_count);
 
-    if (second_hop_entries->neighbor_2->mpr_covered_count >= olsr_cnf->mpr_coverage)
+    /* count each 2 hop neighbor once, when it gets enough coverage */
+    if (second_hop_entries->neighbor_2->mpr_covered_count == olsr_cnf->mpr_coverage)
       count++;
 
     while (the_one_hop_list != &second_hop_entries->neighbor_2->neighbor_2_nblist) {
 
       if (the_one_hop_list->neighbor->status == SYM) {
-        if (second_hop_entries->neighbor_2->mpr_covered_count >= olsr_cnf->mpr_coverage) {
+        if (second_hop_entries->neighbor_2->mpr_covered_count == olsr_cnf->mpr_coverage) {
           the_one_hop_list->neighbor->neighbor_2_nocov--;
         }
       }
@@ -317,8 +319,7 @@ olsr_calculate_two_hop_neighbors(void)
   struct neighbor_entry *a_neighbor, *dup_neighbor;
   struct neighbor_2_list_entry *twohop_neighbors;
   uint16_t count = 0;
-  uint16_t n_count = 0;
-  uint16_t sum = 0;
+  uint16_t n_count;
 
   /* Clear 2 hop neighs */
   olsr_clear_two_hop_processed();
@@ -326,10 +327,12 @@ olsr_calculate_two_hop_neighbors(void)
   OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
 
     if (a_neighbor->status == NOT_SYM) {
-      a_neighbor->neighbor_2_nocov = count;
+      a_neighbor->neighbor_2_nocov = 0;
       continue;
     }
 
+    n_count = 0;
+
     for (twohop_neighbors = a_neighbor->neighbor_2_list.next; twohop_neighbors != &a_neighbor->neighbor_2_list;
          twohop_neighbors = twohop_neighbors->next) {
 
@@ -345,14 +348,11 @@ olsr_calculate_two_hop_neighbors(void)
     }
     a_neighbor->neighbor_2_nocov = n_count;
 
-    /* Add the two hop count */
-    sum += count;
-
   }
   OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
 
-  OLSR_PRINTF(3, "Two hop neighbors: %d\n", sum);
-  return sum;
+  OLSR_PRINTF(3, "Two hop neighbors: %d\n", count);
+  return count;
 }
 
 /**
@@ -387,18 +387,17 @@ add_will_always_nodes(void)
 }
 
 /**
- *This function calculates the mpr neighbors
- *@return nada
+ *Calculate the MPR set from scratch
+ *
+ *@return true if the MPR set has changed
  */
-void
-olsr_calculate_mpr(void)
+static bool
+olsr_calculate_mpr_full(void)
 {
   uint16_t two_hop_covered_count;
   uint16_t two_hop_count;
   int i;
 
-  OLSR_PRINTF(3, "\n**RECALCULATING MPR**\n\n");
-
   olsr_clear_mprs();
   two_hop_count = olsr_calculate_two_hop_neighbors();
   two_hop_covered_count = add_will_always_nodes();
@@ -409,17 +408,8 @@ olsr_calculate_mpr(void)
 
   for (i = WILL_ALWAYS - 1; i > WILL_NEVER; i--) {
     struct neighbor_entry *mprs;
-    struct neighbor_2_list_entry *two_hop_list = olsr_find_2_hop_neighbors_with_1_link(i);
 
-    while (two_hop_list != NULL) {
-      struct neighbor_2_list_entry *tmp;
-      //printf("CHOSEN FROM 1 LINK\n");
-      if (!two_hop_list->neighbor_2->neighbor_2_nblist.next->neighbor->is_mpr)
-        olsr_chosen_mpr(two_hop_list->neighbor_2->neighbor_2_nblist.next->neighbor, &two_hop_covered_count);
-      tmp = two_hop_list;
-      two_hop_list = two_hop_list->next;;
-      free(tmp);
-    }
+    olsr_add_2_hop_neighbors_with_1_link(i, &two_hop_covered_count);
 
     if (two_hop_covered_count >= two_hop_count) {
       i = WILL_NEVER;
@@ -447,7 +437,60 @@ olsr_calculate_mpr(void)
   /* Optimize selection */
   olsr_optimize_mpr_set();
 
-  if (olsr_check_mpr_changes()) {
+  /* Exact coverage counts for the next incremental run */
+  if (olsr_cnf->mpr_mode != MPRM_FULL) {
+    olsr_mpr_update_coverage();
+  }
+
+  return olsr_check_mpr_changes() != 0;
+}
+
+/**
+ *This function calculates the mpr neighbors
+ *@return nada
+ */
+void
+olsr_calculate_mpr(void)
+{
+  bool *check_mpr;
+  unsigned int uncovered, mismatch;
+  bool changes;
+
+  OLSR_PRINTF(3, "\n**RECALCULATING MPR**\n\n");
+
+  if (mpr_full_pending || olsr_cnf->mpr_mode == MPRM_FULL) {
+    changes = olsr_calculate_mpr_full();
+  } else {
+    changes = olsr_calculate_mpr_incremental();
+
+    if (olsr_cnf->mpr_mode == MPRM_CHECK) {
+
+      /*
+       * Keep the incremental result for comparison and
+       * continue with the full run.
+       */
+      uncovered = olsr_mpr_count_uncovered();
+      check_mpr = olsr_mpr_snapshot();
+
+      if (olsr_calculate_mpr_full()) {
+        changes = true;
+      }
+
+      mismatch = olsr_mpr_compare(check_mpr);
+      free(check_mpr);
+
+      if (uncovered) {
+        olsr_syslog(OLSR_LOG_ERR, "MPR: incremental set leaves %u 2-hop neighbors uncovered", uncovered);
+      }
+      if (mismatch) {
+        OLSR_PRINTF(1, "MPR: incremental set differs from full run for %u neighbors\n", mismatch);
+      }
+    }
+  }
+
+  olsr_mpr_clear_changes();
+
+  if (changes) {
     OLSR_PRINTF(3, "CHANGES IN MPR SET\n");
     if (olsr_cnf->tc_redundancy > 0)
       signal_link_changes(true);
@@ -505,12 +548,458 @@ olsr_optimize_mpr_set(void)
           struct ipaddr_str buf;
           OLSR_PRINTF(3, "MPR OPTIMIZE: removiong mpr %s\n\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr));
           a_neighbor->is_mpr = false;
+
+          /* The remaining MPRs have to do without this one */
+          for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+               two_hop_list = two_hop_list->next) {
+            dup_neighbor = olsr_lookup_neighbor_table(&two_hop_list->neighbor_2->neighbor_2_addr);
+
+            if ((dup_neighbor == NULL) || (dup_neighbor->status == NOT_SYM)) {
+              two_hop_list->neighbor_2->mpr_covered_count--;
+            }
+          }
         }
       }
     } OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
   }
 }
 
+/**
+ * Mark a neighbor whose status or willingness has changed.
+ */
+void
+olsr_mpr_touch_neighbor(struct neighbor_entry *neighbor)
+{
+  if (olsr_cnf->mpr_mode == MPRM_FULL || list_node_on_list(&neighbor->mpr_dirty_node)) {
+    return;
+  }
+  list_add_before(&mpr_dirty_neighbors, &neighbor->mpr_dirty_node);
+}
+
+/**
+ * Mark a 2 hop neighbor whose list of 1 hop neighbors has changed.
+ */
+void
+olsr_mpr_touch_two_hop(struct neighbor_2_entry *two_hop_neighbor)
+{
+  if (olsr_cnf->mpr_mode == MPRM_FULL || list_node_on_list(&two_hop_neighbor->mpr_dirty_node)) {
+    return;
+  }
+  list_add_before(&mpr_dirty_two_hops, &two_hop_neighbor->mpr_dirty_node);
+}
+
+/**
+ * A neighbor is about to be freed.
+ * A 2 hop neighbor with the same address must now be covered.
+ */
+void
+olsr_mpr_forget_neighbor(struct neighbor_entry *neighbor)
+{
+  struct neighbor_2_entry *two_hop_neighbor;
+
+  if (list_node_on_list(&neighbor->mpr_dirty_node)) {
+    list_remove(&neighbor->mpr_dirty_node);
+  }
+
+  two_hop_neighbor = olsr_lookup_two_hop_neighbor_table(&neighbor->neighbor_main_addr);
+  if (two_hop_neighbor != NULL) {
+    olsr_mpr_touch_two_hop(two_hop_neighbor);
+  }
+}
+
+/**
+ * A 2 hop neighbor is about to be freed.
+ * The neighbors covering it may no longer be needed as MPR.
+ */
+void
+olsr_mpr_forget_two_hop(struct neighbor_2_entry *two_hop_neighbor)
+{
+  struct neighbor_list_entry *walker;
+
+  for (walker = two_hop_neighbor->neighbor_2_nblist.next; walker != &two_hop_neighbor->neighbor_2_nblist; walker = walker->next) {
+    if (walker->mpr_selected) {
+      walker->mpr_selected = false;
+      walker->neighbor->mpr_selected_count--;
+    }
+    olsr_mpr_touch_neighbor(walker->neighbor);
+  }
+
+  if (list_node_on_list(&two_hop_neighbor->mpr_dirty_node)) {
+    list_remove(&two_hop_neighbor->mpr_dirty_node);
+  }
+}
+
+/**
+ * Link costs have changed. Only LQ MPR selection looks at them.
+ */
+void
+olsr_mpr_touch_link_costs(void)
+{
+  if (olsr_cnf->mpr_mode != MPRM_FULL) {
+    mpr_link_costs_changed = true;
+  }
+}
+
+/**
+ * Recalculate the MPR set from scratch next time,
+ * e.g. because the address resolution by MID has changed.
+ */
+void
+olsr_mpr_force_full(void)
+{
+  mpr_full_pending = true;
+}
+
+/**
+ * Mark the 2 hop neighbors reachable through a changed neighbor
+ * and the 2 hop neighbor with the same address.
+ */
+void
+olsr_mpr_expand_dirty_neighbors(void)
+{
+  struct list_node *node;
+  struct neighbor_entry *a_neighbor;
+  struct neighbor_2_list_entry *two_hop_list;
+  struct neighbor_2_entry *two_hop_neighbor;
+
+  for (node = mpr_dirty_neighbors.next; node != &mpr_dirty_neighbors; node = node->next) {
+    a_neighbor = mprdirty2nbr(node);
+
+    for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+         two_hop_list = two_hop_list->next) {
+      olsr_mpr_touch_two_hop(two_hop_list->neighbor_2);
+    }
+
+    two_hop_neighbor = olsr_lookup_two_hop_neighbor_table(&a_neighbor->neighbor_main_addr);
+    if (two_hop_neighbor != NULL) {
+      olsr_mpr_touch_two_hop(two_hop_neighbor);
+    }
+  }
+}
+
+/**
+ * Forget all pending changes after an MPR calculation.
+ */
+void
+olsr_mpr_clear_changes(void)
+{
+  while (!list_is_empty(&mpr_dirty_neighbors)) {
+    list_remove(mpr_dirty_neighbors.next);
+  }
+  while (!list_is_empty(&mpr_dirty_two_hops)) {
+    list_remove(mpr_dirty_two_hops.next);
+  }
+  mpr_link_costs_changed = false;
+  mpr_full_pending = false;
+}
+
+/**
+ * Save the MPR status of all neighbors, in table order.
+ */
+bool *
+olsr_mpr_snapshot(void)
+{
+  struct neighbor_entry *a_neighbor;
+  bool *check_mpr;
+  int count = 0;
+
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    count++;
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+
+  check_mpr = olsr_malloc(sizeof(*check_mpr) * (count + 1), "MPR check");
+
+  count = 0;
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    check_mpr[count++] = a_neighbor->is_mpr;
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+
+  return check_mpr;
+}
+
+/**
+ * Compare the MPR status of all neighbors with a snapshot.
+ *
+ *@return the number of neighbors with a different status
+ */
+unsigned int
+olsr_mpr_compare(const bool *check_mpr)
+{
+  struct neighbor_entry *a_neighbor;
+  unsigned int mismatch = 0;
+  int count = 0;
+
+  OLSR_FOR_ALL_NBR_ENTRIES(a_neighbor) {
+    if (check_mpr[count++] != a_neighbor->is_mpr) {
+      struct ipaddr_str buf;
+      OLSR_PRINTF(3, "MPR check: %s is %sMPR in the full run\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr),
+                  a_neighbor->is_mpr ? "" : "no ");
+      mismatch++;
+    }
+  }
+  OLSR_FOR_ALL_NBR_ENTRIES_END(a_neighbor);
+
+  return mismatch;
+}
+
+/**
+ *Check whether a 2 hop neighbor is not a symmetric
+ *neighbor as well and thus has to be covered by MPRs.
+ */
+static bool
+olsr_mpr_is_strict_two_hop(struct neighbor_2_entry *two_hop_neighbor)
+{
+  struct neighbor_entry *dup_neighbor = olsr_lookup_neighbor_table(&two_hop_neighbor->neighbor_2_addr);
+
+  return (dup_neighbor == NULL) || (dup_neighbor->status != SYM);
+}
+
+/**
+ *Count the MPRs covering a 2 hop neighbor
+ *
+ *@param two_hop_neighbor the 2 hop neighbor
+ *@param candidates set to the number of neighbors which could cover it
+ *
+ *@return the number of MPRs covering the 2 hop neighbor
+ */
+static int
+olsr_mpr_count_coverage(struct neighbor_2_entry *two_hop_neighbor, int *candidates)
+{
+  struct neighbor_list_entry *walker;
+  int count = 0;
+
+  *candidates = 0;
+  for (walker = two_hop_neighbor->neighbor_2_nblist.next; walker != &two_hop_neighbor->neighbor_2_nblist; walker = walker->next) {
+    if (walker->neighbor->status != SYM) {
+      continue;
+    }
+    if (walker->neighbor->willingness != WILL_NEVER) {
+      (*candidates)++;
+    }
+    if (walker->neighbor->is_mpr) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ *Set the coverage count of all 2 hop neighbors
+ *to the number of symmetric MPRs linked to them
+ */
+static void
+olsr_mpr_update_coverage(void)
+{
+  struct neighbor_2_entry *two_hop_neighbor;
+  int idx, candidates;
+
+  for (idx = 0; idx < HASHSIZE; idx++) {
+    for (two_hop_neighbor = two_hop_neighbortable[idx].next; two_hop_neighbor != &two_hop_neighbortable[idx];
+         two_hop_neighbor = two_hop_neighbor->next) {
+      two_hop_neighbor->mpr_covered_count = olsr_mpr_count_coverage(two_hop_neighbor, &candidates);
+    }
+  }
+}
+
+/**
+ *Count the 2 hop neighbors which are covered by less MPRs
+ *than requested, although enough neighbors could cover them
+ */
+static unsigned int
+olsr_mpr_count_uncovered(void)
+{
+  struct neighbor_2_entry *two_hop_neighbor;
+  unsigned int uncovered = 0;
+  int idx, count, candidates;
+
+  for (idx = 0; idx < HASHSIZE; idx++) {
+    for (two_hop_neighbor = two_hop_neighbortable[idx].next; two_hop_neighbor != &two_hop_neighbortable[idx];
+         two_hop_neighbor = two_hop_neighbor->next) {
+      count = olsr_mpr_count_coverage(two_hop_neighbor, &candidates);
+      if (count < MIN(olsr_cnf->mpr_coverage, candidates) && olsr_mpr_is_strict_two_hop(two_hop_neighbor)) {
+        uncovered++;
+      }
+    }
+  }
+  return uncovered;
+}
+
+/**
+ *Find the best neighbor to cover a 2 hop neighbor: the one with
+ *the highest willingness, which covers most insufficiently
+ *covered 2 hop neighbors
+ */
+static struct neighbor_entry *
+olsr_mpr_find_candidate(struct neighbor_2_entry *two_hop_neighbor)
+{
+  struct neighbor_list_entry *walker;
+  struct neighbor_2_list_entry *two_hop_list;
+  struct neighbor_entry *a_neighbor, *mpr_candidate = NULL;
+  int uncovered, maximum = 0;
+
+  for (walker = two_hop_neighbor->neighbor_2_nblist.next; walker != &two_hop_neighbor->neighbor_2_nblist; walker = walker->next) {
+    a_neighbor = walker->neighbor;
+
+    if ((a_neighbor->status != SYM) || a_neighbor->is_mpr || (a_neighbor->willingness == WILL_NEVER)) {
+      continue;
+    }
+
+    uncovered = 0;
+    for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+         two_hop_list = two_hop_list->next) {
+      if (two_hop_list->neighbor_2->mpr_covered_count < olsr_cnf->mpr_coverage) {
+        uncovered++;
+      }
+    }
+
+    if ((mpr_candidate == NULL) || (a_neighbor->willingness > mpr_candidate->willingness)
+        || ((a_neighbor->willingness == mpr_candidate->willingness) && (uncovered > maximum))) {
+      mpr_candidate = a_neighbor;
+      maximum = uncovered;
+    }
+  }
+
+  return mpr_candidate;
+}
+
+/**
+ *Add a neighbor to the MPR set and update the
+ *coverage of its 2 hop neighbors
+ */
+static void
+olsr_mpr_select(struct neighbor_entry *one_hop_neighbor)
+{
+  struct neighbor_2_list_entry *two_hop_list;
+  struct ipaddr_str buf;
+
+  OLSR_PRINTF(1, "Setting %s as MPR\n", olsr_ip_to_string(&buf, &one_hop_neighbor->neighbor_main_addr));
+
+  one_hop_neighbor->is_mpr = true;
+
+  for (two_hop_list = one_hop_neighbor->neighbor_2_list.next; two_hop_list != &one_hop_neighbor->neighbor_2_list;
+       two_hop_list = two_hop_list->next) {
+    two_hop_list->neighbor_2->mpr_covered_count++;
+
+    /* other MPRs covering it may have become redundant */
+    olsr_mpr_touch_two_hop(two_hop_list->neighbor_2);
+  }
+}
+
+/**
+ *Check whether all 2 hop neighbors of an MPR are
+ *covered by enough other MPRs
+ */
+static bool
+olsr_mpr_is_redundant(struct neighbor_entry *one_hop_neighbor)
+{
+  struct neighbor_2_list_entry *two_hop_list;
+
+  for (two_hop_list = one_hop_neighbor->neighbor_2_list.next; two_hop_list != &one_hop_neighbor->neighbor_2_list;
+       two_hop_list = two_hop_list->next) {
+    if (two_hop_list->neighbor_2->mpr_covered_count <= olsr_cnf->mpr_coverage
+        && olsr_mpr_is_strict_two_hop(two_hop_list->neighbor_2)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ *Repair the MPR set after changes of the neighborhood.
+ *Only the 2 hop neighbors linked to a changed neighbor
+ *or with a changed list of neighbors are looked at.
+ *
+ *@return true if the MPR set has changed
+ */
+static bool
+olsr_calculate_mpr_incremental(void)
+{
+  struct list_node *node;
+  struct neighbor_entry *a_neighbor;
+  struct neighbor_2_entry *two_hop_neighbor;
+  struct neighbor_list_entry *walker;
+  int i, candidates;
+  bool changes = false;
+
+  /* the changed neighbors themselves */
+  for (node = mpr_dirty_neighbors.next; node != &mpr_dirty_neighbors; node = node->next) {
+    a_neighbor = mprdirty2nbr(node);
+
+    if ((a_neighbor->status == SYM) && (a_neighbor->willingness == WILL_ALWAYS)) {
+      if (!a_neighbor->is_mpr) {
+        a_neighbor->is_mpr = true;
+        changes = true;
+      }
+    } else if (a_neighbor->is_mpr && ((a_neighbor->status != SYM) || (a_neighbor->willingness == WILL_NEVER))) {
+      a_neighbor->is_mpr = false;
+      changes = true;
+    }
+  }
+
+  olsr_mpr_expand_dirty_neighbors();
+
+  /*
+   * Recount the coverage of the changed 2 hop neighbors and add MPRs
+   * until each of them is covered again. Selecting an MPR appends its
+   * 2 hop neighbors to the list, their counts are updated on the fly.
+   */
+  for (node = mpr_dirty_two_hops.next; node != &mpr_dirty_two_hops; node = node->next) {
+    two_hop_neighbor = mprdirty2nbr2(node);
+    two_hop_neighbor->mpr_covered_count = olsr_mpr_count_coverage(two_hop_neighbor, &candidates);
+
+    if (two_hop_neighbor->mpr_covered_count >= MIN(olsr_cnf->mpr_coverage, candidates)
+        || !olsr_mpr_is_strict_two_hop(two_hop_neighbor)) {
+      continue;
+    }
+
+    while (two_hop_neighbor->mpr_covered_count < MIN(olsr_cnf->mpr_coverage, candidates)) {
+      a_neighbor = olsr_mpr_find_candidate(two_hop_neighbor);
+      if (a_neighbor == NULL) {
+        break;
+      }
+      olsr_mpr_select(a_neighbor);
+      changes = true;
+    }
+  }
+
+  /* MPRs around the changed 2 hop neighbors may have become redundant */
+  for (node = mpr_dirty_two_hops.next; node != &mpr_dirty_two_hops; node = node->next) {
+    two_hop_neighbor = mprdirty2nbr2(node);
+
+    for (walker = two_hop_neighbor->neighbor_2_nblist.next; walker != &two_hop_neighbor->neighbor_2_nblist;
+         walker = walker->next) {
+      if (walker->neighbor->is_mpr) {
+        olsr_mpr_touch_neighbor(walker->neighbor);
+      }
+    }
+  }
+
+  for (i = WILL_NEVER + 1; i < WILL_ALWAYS; i++) {
+    for (node = mpr_dirty_neighbors.next; node != &mpr_dirty_neighbors; node = node->next) {
+      struct neighbor_2_list_entry *two_hop_list;
+      struct ipaddr_str buf;
+
+      a_neighbor = mprdirty2nbr(node);
+      if (!a_neighbor->is_mpr || (a_neighbor->willingness != i) || !olsr_mpr_is_redundant(a_neighbor)) {
+        continue;
+      }
+
+      OLSR_PRINTF(3, "MPR OPTIMIZE: removing mpr %s\n\n", olsr_ip_to_string(&buf, &a_neighbor->neighbor_main_addr));
+      a_neighbor->is_mpr = false;
+      changes = true;
+
+      for (two_hop_list = a_neighbor->neighbor_2_list.next; two_hop_list != &a_neighbor->neighbor_2_list;
+           two_hop_list = two_hop_list->next) {
+        two_hop_list->neighbor_2->mpr_covered_count--;
+      }
+    }
+  }
+
+  return changes;
+}
+
 #ifndef NODEBUG
 void
 olsr_print_mpr_set(void)
@@ -46,8 +46,33 @@
 #ifndef _OLSR_MPR
 #define _OLSR_MPR
 
+#include "defs.h"
+#include "common/list.h"
+
+struct neighbor_entry;
+struct neighbor_2_entry;
+
 void olsr_calculate_mpr(void);
 
+/* change notifications for the incremental MPR calculation */
+void olsr_mpr_touch_neighbor(struct neighbor_entry *);
+void olsr_mpr_touch_two_hop(struct neighbor_2_entry *);
+void olsr_mpr_forget_neighbor(struct neighbor_entry *);
+void olsr_mpr_forget_two_hop(struct neighbor_2_entry *);
+void olsr_mpr_touch_link_costs(void);
+void olsr_mpr_force_full(void);
+
+/* pending changes, shared with the LQ MPR calculation */
+extern struct list_node mpr_dirty_neighbors;
+extern struct list_node mpr_dirty_two_hops;
+extern bool mpr_link_costs_changed;
+extern bool mpr_full_pending;
+
+void olsr_mpr_expand_dirty_neighbors(void);
+void olsr_mpr_clear_changes(void);
+bool *olsr_mpr_snapshot(void);
+unsigned int olsr_mpr_compare(const bool *);
+
 #ifndef NODEBUG
 void olsr_print_mpr_set(void);
 #else
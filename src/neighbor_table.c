@@ -54,9 +54,13 @@
 #include "link_set.h"
 #include "mpr_selector_set.h"
 #include "net_olsr.h"
+#include "common/hashtable.h"
 
 struct neighbor_entry neighbortable[HASHSIZE];
 
+/* lookup index of neighbortable by main address */
+static struct hashtable neighbor_index;
+
 void
 olsr_init_neighbor_table(void)
 {
@@ -66,6 +70,42 @@ olsr_init_neighbor_table(void)
     neighbortable[i].next = &neighbortable[i];
     neighbortable[i].prev = &neighbortable[i];
   }
+
+  hashtable_init(&neighbor_index, offsetof(struct neighbor_entry, neighbor_main_addr), olsr_cnf->ipsize);
+}
+
+/**
+ * Queue a neighbor entry in the neighbortable and index it.
+ */
+static void
+olsr_queue_neighbor_table(struct neighbor_entry *entry)
+{
+  QUEUE_ELEM(neighbortable[olsr_ip_hashing(&entry->neighbor_main_addr)], entry);
+  hashtable_insert(&neighbor_index, entry);
+}
+
+/**
+ * Dequeue a neighbor entry from the neighbortable. If there is
+ * another entry with the same main address the newest one is
+ * indexed instead, like a walk of the hash chain would find it.
+ */
+void
+olsr_dequeue_neighbor_table(struct neighbor_entry *entry)
+{
+  uint32_t hash = olsr_ip_hashing(&entry->neighbor_main_addr);
+  struct neighbor_entry *dup;
+
+  DEQUEUE_ELEM(entry);
+
+  if (!hashtable_remove(&neighbor_index, entry)) {
+    return;
+  }
+  for (dup = neighbortable[hash].next; dup != &neighbortable[hash]; dup = dup->next) {
+    if (ipequal(&dup->neighbor_main_addr, &entry->neighbor_main_addr)) {
+      hashtable_insert(&neighbor_index, dup);
+      break;
+    }
+  }
 }
 
 /**
@@ -79,8 +119,7 @@ olsr_del_nbr2_list(struct neighbor_2_list_entry *nbr2_list)
   nbr2 = nbr2_list->neighbor_2;
 
   if (nbr2->neighbor_2_pointer < 1) {
-    DEQUEUE_ELEM(nbr2);
-    free(nbr2);
+    olsr_delete_two_hop_neighbor_table(nbr2);
   }
 
   /*
@@ -157,13 +196,13 @@ void
 olsr_update_neighbor_main_addr(struct neighbor_entry *entry, const union olsr_ip_addr *new_main_addr)
 {
   /*remove from old pos*/
-  DEQUEUE_ELEM(entry);
+  olsr_dequeue_neighbor_table(entry);
 
   /*update main addr*/
   entry->neighbor_main_addr = *new_main_addr;
 
   /*insert it again*/
-  QUEUE_ELEM(neighbortable[olsr_ip_hashing(new_main_addr)], entry);
+  olsr_queue_neighbor_table(entry);
 
 }
 
@@ -181,26 +220,13 @@ int
 olsr_delete_neighbor_table(const union olsr_ip_addr *neighbor_addr)
 {
   struct neighbor_2_list_entry *two_hop_list, *two_hop_to_delete;
-  uint32_t hash;
   struct neighbor_entry *entry;
 
-  //printf("inserting neighbor\n");
-
-  hash = olsr_ip_hashing(neighbor_addr);
-
-  entry = neighbortable[hash].next;
-
   /*
    * Find neighbor entry
    */
-  while (entry != &neighbortable[hash]) {
-    if (ipequal(&entry->neighbor_main_addr, neighbor_addr))
-      break;
-
-    entry = entry->next;
-  }
-
-  if (entry == &neighbortable[hash])
+  entry = hashtable_find(&neighbor_index, neighbor_addr);
+  if (entry == NULL)
     return 0;
 
   two_hop_list = entry->neighbor_2_list.next;
@@ -215,8 +241,15 @@ olsr_delete_neighbor_table(const union olsr_ip_addr *neighbor_addr)
     olsr_del_nbr2_list(two_hop_to_delete);
   }
 
+  /* links still pointing to this entry are moved by the caller */
+  while (!list_is_empty(&entry->link_list)) {
+    list_remove(entry->link_list.next);
+  }
+
+  olsr_mpr_forget_neighbor(entry);
+
   /* Dequeue */
-  DEQUEUE_ELEM(entry);
+  olsr_dequeue_neighbor_table(entry);
 
   free(entry);
 
@@ -236,17 +269,12 @@ olsr_delete_neighbor_table(const union olsr_ip_addr *neighbor_addr)
 struct neighbor_entry *
 olsr_insert_neighbor_table(const union olsr_ip_addr *main_addr)
 {
-  uint32_t hash;
   struct neighbor_entry *new_neigh;
 
-  hash = olsr_ip_hashing(main_addr);
-
   /* Check if entry exists */
-
-  for (new_neigh = neighbortable[hash].next; new_neigh != &neighbortable[hash]; new_neigh = new_neigh->next) {
-    if (ipequal(&new_neigh->neighbor_main_addr, main_addr))
-      return new_neigh;
-  }
+  new_neigh = hashtable_find(&neighbor_index, main_addr);
+  if (new_neigh != NULL)
+    return new_neigh;
 
   //printf("inserting neighbor\n");
 
@@ -263,9 +291,15 @@ olsr_insert_neighbor_table(const union olsr_ip_addr *main_addr)
   new_neigh->linkcount = 0;
   new_neigh->is_mpr = false;
   new_neigh->was_mpr = false;
+  new_neigh->mpr_selected_count = 0;
+  list_node_init(&new_neigh->mpr_dirty_node);
+
+  list_head_init(&new_neigh->link_list);
+  new_neigh->best_link = NULL;
+  new_neigh->best_link_generation = 0;
 
   /* Queue */
-  QUEUE_ELEM(neighbortable[hash], new_neigh);
+  olsr_queue_neighbor_table(new_neigh);
 
   return new_neigh;
 }
@@ -301,20 +335,7 @@ olsr_lookup_neighbor_table(const union olsr_ip_addr *dst)
 struct neighbor_entry *
 olsr_lookup_neighbor_table_alias(const union olsr_ip_addr *dst)
 {
-  struct neighbor_entry *entry;
-  uint32_t hash = olsr_ip_hashing(dst);
-
-  //printf("\nLookup %s\n", olsr_ip_to_string(&buf, dst));
-  for (entry = neighbortable[hash].next; entry != &neighbortable[hash]; entry = entry->next) {
-    //printf("Checking %s\n", olsr_ip_to_string(&buf, &entry->neighbor_main_addr));
-    if (ipequal(&entry->neighbor_main_addr, dst))
-      return entry;
-
-  }
-  //printf("NOPE\n\n");
-
-  return NULL;
-
+  return hashtable_find(&neighbor_index, dst);
 }
 
 int
@@ -334,6 +355,7 @@ update_neighbor_status(struct neighbor_entry *entry, int lnk)
         olsr_delete_two_hop_neighbor_table(two_hop_neighbor);
       }
 
+      olsr_mpr_touch_neighbor(entry);
       changes_neighborhood = true;
       changes_topology = true;
       if (olsr_cnf->tc_redundancy > 1)
@@ -342,6 +364,7 @@ update_neighbor_status(struct neighbor_entry *entry, int lnk)
     entry->status = SYM;
   } else {
     if (entry->status == SYM) {
+      olsr_mpr_touch_neighbor(entry);
       changes_neighborhood = true;
       changes_topology = true;
       if (olsr_cnf->tc_redundancy > 1)
@@ -49,6 +49,7 @@
 #include "olsr_types.h"
 #include "hashing.h"
 #include "two_hop_neighbor_table.h"
+#include "common/list.h"
 
 struct neighbor_2_list_entry {
   struct neighbor_entry *nbr2_nbr;     /* backpointer to owning nbr entry */
@@ -69,11 +70,20 @@ struct neighbor_entry {
   bool skip;
   int neighbor_2_nocov;
   int linkcount;
+  struct list_node link_list;          /* links to this neighbor */
+  struct link_entry *best_link;        /* cached get_best_link_to_neighbor() */
+  uint32_t best_link_generation;       /* link set generation of best_link, 0 if invalid */
+  uint32_t best_link_until;            /* time when a link status changes by itself */
+  bool best_link_expires;
+  int mpr_selected_count;              /* LQ MPR: 2-hop neighbors which selected us */
+  struct list_node mpr_dirty_node;     /* changed since the last MPR calculation */
   struct neighbor_2_list_entry neighbor_2_list;
   struct neighbor_entry *next;
   struct neighbor_entry *prev;
 };
 
+LISTNODE2STRUCT(mprdirty2nbr, struct neighbor_entry, mpr_dirty_node);
+
 #define OLSR_FOR_ALL_NBR_ENTRIES(nbr) \
 { \
   int _idx; \
@@ -115,6 +125,8 @@ void olsr_print_neighbor_table(void);
 
 void olsr_update_neighbor_main_addr(struct neighbor_entry *, const union olsr_ip_addr *);
 
+void olsr_dequeue_neighbor_table(struct neighbor_entry *);
+
 int update_neighbor_status(struct neighbor_entry *, int);
 
 #endif /* _OLSR_NEIGH_TBL */
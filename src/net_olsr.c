@@ -43,6 +43,11 @@
  *
  */
 
+#ifdef __linux__
+/* needed for recvmmsg() and sendmmsg() */
+#define _GNU_SOURCE 1
+#endif /* __linux__ */
+
 #include "net_olsr.h"
 #include "ipcalc.h"
 #include "log.h"
@@ -54,6 +59,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <limits.h>
+#include <errno.h>
+#include <time.h>
 
 #ifdef _WIN32
 #define perror(x) WinSockPError(x)
@@ -74,8 +81,73 @@ struct ptf {
 
 static struct ptf *ptf_list;
 
+/* receives all outgoing packets when set, the simulator uses it */
+net_output_sink_function net_output_sink;
+
+/* Batch packet transform functions */
+
+struct ptf_batch {
+  packet_transform_batch_function function;
+  int reserve;
+  struct net_ptf_stats stats;
+};
+
+static struct ptf_batch ptf_batch_list[NET_PTF_BATCH_MAX];
+static unsigned int ptf_batch_count;
+
+/* bytes the batch transform functions may append to a packet */
+static int ptf_batch_reserve;
+
 static struct deny_address_entry *deny_entries;
 
+/* histograms of the number of packets moved per system call */
+struct net_batch_stats net_rx_batch_stats, net_tx_batch_stats;
+
+/*
+ * A forwarded message, copied once and shared by the
+ * output buffers of all interfaces it is sent on.
+ */
+struct olsr_msgbuf {
+  struct olsr_msgbuf *next;            /* free list */
+  unsigned int refcount;
+  uint16_t size;
+  uint16_t capacity;
+  uint8_t data[];
+};
+
+/* unused message buffers of NET_MSGBUF_SIZE bytes */
+static struct olsr_msgbuf *msgbuf_pool;
+static unsigned int msgbuf_pool_count;
+
+struct net_msgbuf_stats net_msgbuf_stats;
+
+#ifdef __linux__
+/*
+ * Finished packets of an interface waiting for sendmmsg(). The data
+ * of the interface itself is copied into the queue, shared messages
+ * are referenced by their own iovec until the packet is sent.
+ */
+struct olsr_netbuf_queue {
+  unsigned int count;
+  struct mmsghdr msgs[NET_BATCH_SIZE];
+  struct iovec iov[NET_BATCH_SIZE][2 * OLSR_NETBUF_REFS + 2]; /* one more for a transform */
+  struct olsr_msgbuf *refs[NET_BATCH_SIZE][OLSR_NETBUF_REFS];
+  unsigned int ref_count[NET_BATCH_SIZE];
+  unsigned int len[NET_BATCH_SIZE];
+  unsigned int used[NET_BATCH_SIZE];   /* bytes of the buffer slot in use */
+  union {
+    struct sockaddr_in v4;
+    struct sockaddr_in6 v6;
+  } dst[NET_BATCH_SIZE];
+  uint8_t *buff;
+};
+
+/* number of packets queued on all interfaces */
+static unsigned int net_queued_packets;
+
+static bool sendmmsg_unsupported;
+#endif /* __linux__ */
+
 static const char *const deny_ipv4_defaults[] = {
   "0.0.0.0",
   "127.0.0.1",
@@ -109,6 +181,385 @@ init_net(void)
   }
 }
 
+/**
+ * Account one system call moving the given number of packets.
+ *
+ * @param stats the histogram to update
+ * @param packets the number of packets
+ */
+void
+net_batch_account(struct net_batch_stats *stats, unsigned int packets)
+{
+  stats->calls++;
+  stats->packets += packets;
+  stats->size[packets > NET_BATCH_SIZE ? NET_BATCH_SIZE : packets]++;
+}
+
+static void
+net_print_batch_stats(const char *name, const struct net_batch_stats *stats)
+{
+  unsigned int i;
+
+  OLSR_PRINTF(0, "%-4s %10u %10u %6u.%02u", name, stats->calls, stats->packets,
+              stats->calls ? stats->packets / stats->calls : 0,
+              stats->calls ? (stats->packets % stats->calls) * 100 / stats->calls : 0);
+  for (i = 1; i <= NET_BATCH_SIZE; i++) {
+    OLSR_PRINTF(0, " %u", stats->size[i]);
+  }
+  OLSR_PRINTF(0, "\n");
+}
+
+/**
+ * Print the histograms of packets per receive and send call.
+ */
+void
+olsr_print_net_batch_stats(void)
+{
+#ifndef NODEBUG
+  OLSR_PRINTF(0, "\n--- %s ------------------------------------------------- BATCHED I/O\n\n",
+              olsr_wallclock_string());
+  OLSR_PRINTF(0, "Dir       Calls    Packets  Avg/call  Histogram 1..%u\n", NET_BATCH_SIZE);
+  net_print_batch_stats("rx", &net_rx_batch_stats);
+  net_print_batch_stats("tx", &net_tx_batch_stats);
+  OLSR_PRINTF(0, "\nForwarded messages %u, queued by reference %u, copied %u\n", net_msgbuf_stats.messages,
+              net_msgbuf_stats.refs, net_msgbuf_stats.copies);
+  if (ptf_batch_count > 0) {
+    unsigned int i;
+
+    OLSR_PRINTF(0, "\nTransform      Calls    Packets  usec/packet  max usec/call\n");
+    for (i = 0; i < ptf_batch_count; i++) {
+      const struct net_ptf_stats *stats = &ptf_batch_list[i].stats;
+
+      OLSR_PRINTF(0, "%-10s %9u %10u %12.2f %14.2f\n", stats->name, stats->calls, stats->packets,
+                  stats->packets ? (double)stats->nsec / stats->packets / 1000.0 : 0.0, stats->max_nsec / 1000.0);
+    }
+  }
+#endif /* NODEBUG */
+}
+
+/**
+ * Run the batch transform functions over packets ready to be sent.
+ *
+ * @param pkts the packets
+ * @param count the number of packets
+ */
+static void
+net_ptf_batch_run(struct olsr_ptf_packet *pkts, unsigned int count)
+{
+  unsigned int i;
+
+  for (i = 0; i < ptf_batch_count; i++) {
+    struct net_ptf_stats *stats = &ptf_batch_list[i].stats;
+#ifndef _WIN32
+    struct timespec t1, t2;
+    uint32_t nsec;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+#endif /* _WIN32 */
+
+    ptf_batch_list[i].function(pkts, count);
+
+#ifndef _WIN32
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    nsec = (t2.tv_sec - t1.tv_sec) * 1000000000 + (t2.tv_nsec - t1.tv_nsec);
+    stats->nsec += nsec;
+    if (nsec > stats->max_nsec) {
+      stats->max_nsec = nsec;
+    }
+#endif /* _WIN32 */
+    stats->calls++;
+    stats->packets += count;
+  }
+}
+
+#ifdef __linux__
+/**
+ * Log a failed send of a queued packet the same way
+ * net_output() does for a single sendto().
+ */
+static void
+net_queue_send_error(struct interface_olsr *ifp, struct olsr_netbuf_queue *queue, unsigned int idx)
+{
+  if (olsr_cnf->ip_version == AF_INET) {
+    perror("sendto(v4)");
+    olsr_syslog(OLSR_LOG_ERR, "OLSR: sendto IPv4 %m");
+  } else {
+    struct ipaddr_str buf;
+    perror("sendto(v6)");
+    olsr_syslog(OLSR_LOG_ERR, "OLSR: sendto IPv6 %m");
+    fprintf(stderr, "Socket: %d interface: %d\n", ifp->olsr_socket, ifp->if_index);
+    fprintf(stderr, "To: %s (size: %u)\n", ip6_to_string(&buf, &queue->dst[idx].v6.sin6_addr),
+            (unsigned int)sizeof(queue->dst[idx].v6));
+    fprintf(stderr, "Outputsize: %u\n", queue->len[idx]);
+  }
+}
+
+/**
+ * Send all packets queued on an interface, using as few
+ * sendmmsg() calls as possible.
+ *
+ * @param ifp the interface to flush
+ */
+static void
+net_queue_flush(struct interface_olsr *ifp)
+{
+  struct olsr_netbuf_queue *queue = ifp->netbuf.queue;
+  unsigned int sent = 0;
+
+  if (queue == NULL || queue->count == 0) {
+    return;
+  }
+
+  /* let the batch transforms work on all packets at once */
+  if (ptf_batch_count > 0) {
+    struct olsr_ptf_packet pkts[NET_BATCH_SIZE];
+    unsigned int i;
+
+    for (i = 0; i < queue->count; i++) {
+      pkts[i].ifp = ifp;
+      pkts[i].iov = queue->iov[i];
+      pkts[i].iovcnt = queue->msgs[i].msg_hdr.msg_iovlen;
+      pkts[i].len = queue->len[i];
+      pkts[i].tail = &queue->buff[i * ifp->netbuf.bufsize + queue->used[i]];
+      pkts[i].tail_room = ifp->netbuf.bufsize - queue->len[i];
+    }
+
+    net_ptf_batch_run(pkts, queue->count);
+
+    for (i = 0; i < queue->count; i++) {
+      queue->msgs[i].msg_hdr.msg_iovlen = pkts[i].iovcnt;
+      queue->len[i] = pkts[i].len;
+    }
+  }
+
+  while (sent < queue->count) {
+    int n;
+
+    if (!sendmmsg_unsupported) {
+      n = sendmmsg(ifp->send_socket, &queue->msgs[sent], queue->count - sent, MSG_DONTROUTE);
+      if (n > 0) {
+        net_batch_account(&net_tx_batch_stats, n);
+        sent += n;
+        continue;
+      }
+      if (n < 0 && errno == ENOSYS) {
+        OLSR_PRINTF(1, "sendmmsg not supported, sending packets one by one\n");
+        sendmmsg_unsupported = true;
+        continue;
+      }
+    } else {
+      n = sendmsg(ifp->send_socket, &queue->msgs[sent].msg_hdr, MSG_DONTROUTE);
+      if (n >= 0) {
+        net_batch_account(&net_tx_batch_stats, 1);
+        sent++;
+        continue;
+      }
+    }
+
+    /* the first remaining packet failed, drop it and go on with the rest */
+    net_queue_send_error(ifp, queue, sent);
+    sent++;
+  }
+
+  /* the kernel has copied the shared messages */
+  for (sent = 0; sent < queue->count; sent++) {
+    unsigned int i;
+
+    for (i = 0; i < queue->ref_count[sent]; i++) {
+      net_msgbuf_put(queue->refs[sent][i]);
+    }
+  }
+
+  net_queued_packets -= queue->count;
+  queue->count = 0;
+}
+
+/**
+ * Send the queued packets and release the queue of an interface.
+ *
+ * @param ifp the interface
+ */
+static void
+net_queue_free(struct interface_olsr *ifp)
+{
+  struct olsr_netbuf_queue *queue = ifp->netbuf.queue;
+
+  if (queue == NULL) {
+    return;
+  }
+
+  net_queue_flush(ifp);
+  free(queue->buff);
+  free(queue);
+  ifp->netbuf.queue = NULL;
+}
+
+/**
+ * Append the finished packet in the output buffer of
+ * an interface to its send queue.
+ *
+ * @param ifp the interface
+ * @param dst the destination of the packet
+ * @param dstlen the size of the destination address
+ */
+static void
+net_queue_packet(struct interface_olsr *ifp, const struct sockaddr *dst, socklen_t dstlen)
+{
+  struct olsr_netbuf_queue *queue = ifp->netbuf.queue;
+  unsigned int idx, i, iovcnt = 0;
+  int start = 0, copied = 0;
+  uint8_t *slot;
+
+  if (queue == NULL) {
+    queue = olsr_malloc(sizeof(*queue), "netbuf queue");
+    queue->buff = olsr_malloc((size_t)ifp->netbuf.bufsize * NET_BATCH_SIZE, "netbuf queue buffer");
+    ifp->netbuf.queue = queue;
+  }
+
+  if (queue->count == NET_BATCH_SIZE) {
+    net_queue_flush(ifp);
+  }
+
+  idx = queue->count++;
+  net_queued_packets++;
+
+  /*
+   * Copy the data between the shared messages into the queue and
+   * take over the references, the gaps in the output buffer are
+   * never filled.
+   */
+  slot = &queue->buff[idx * ifp->netbuf.bufsize];
+  for (i = 0; i <= ifp->netbuf.ref_count; i++) {
+    struct olsr_netbuf_ref *ref = i < ifp->netbuf.ref_count ? &ifp->netbuf.refs[i] : NULL;
+    int end = ref ? ref->offset : ifp->netbuf.pending;
+
+    if (end > start) {
+      memcpy(slot + copied, &ifp->netbuf.buff[start], end - start);
+      queue->iov[idx][iovcnt].iov_base = slot + copied;
+      queue->iov[idx][iovcnt].iov_len = end - start;
+      iovcnt++;
+      copied += end - start;
+    }
+    if (ref) {
+      queue->iov[idx][iovcnt].iov_base = ref->msg->data;
+      queue->iov[idx][iovcnt].iov_len = ref->msg->size;
+      iovcnt++;
+      queue->refs[idx][i] = ref->msg;
+      start = ref->offset + ref->msg->size;
+    }
+  }
+  queue->ref_count[idx] = ifp->netbuf.ref_count;
+  queue->len[idx] = ifp->netbuf.pending;
+  queue->used[idx] = copied;
+  ifp->netbuf.ref_count = 0;
+
+  memcpy(&queue->dst[idx], dst, dstlen);
+
+  memset(&queue->msgs[idx], 0, sizeof(queue->msgs[idx]));
+  queue->msgs[idx].msg_hdr.msg_name = &queue->dst[idx];
+  queue->msgs[idx].msg_hdr.msg_namelen = dstlen;
+  queue->msgs[idx].msg_hdr.msg_iov = queue->iov[idx];
+  queue->msgs[idx].msg_hdr.msg_iovlen = iovcnt;
+}
+#endif /* __linux__ */
+
+/**
+ * Copy the shared messages into the gaps of an output buffer,
+ * so it holds the whole packet.
+ *
+ * @param ifp the interface
+ */
+static void
+net_netbuf_linearize(struct interface_olsr *ifp)
+{
+  unsigned int i;
+
+  for (i = 0; i < ifp->netbuf.ref_count; i++) {
+    struct olsr_netbuf_ref *ref = &ifp->netbuf.refs[i];
+
+    memcpy(&ifp->netbuf.buff[ref->offset], ref->msg->data, ref->msg->size);
+    net_msgbuf_put(ref->msg);
+  }
+  ifp->netbuf.ref_count = 0;
+}
+
+/**
+ * Get a shared buffer with a copy of a message, which can be
+ * pushed into the output buffers of several interfaces.
+ *
+ * @param data the message
+ * @param size the size of the message
+ *
+ * @return the buffer, the caller holds one reference
+ */
+struct olsr_msgbuf *
+net_msgbuf_get(const void *data, const uint16_t size)
+{
+  struct olsr_msgbuf *msgbuf;
+
+  if (size <= NET_MSGBUF_SIZE && msgbuf_pool != NULL) {
+    msgbuf = msgbuf_pool;
+    msgbuf_pool = msgbuf->next;
+    msgbuf_pool_count--;
+  } else {
+    uint16_t capacity = size <= NET_MSGBUF_SIZE ? NET_MSGBUF_SIZE : size;
+
+    msgbuf = olsr_malloc(sizeof(*msgbuf) + capacity, "forwarded message");
+    msgbuf->capacity = capacity;
+  }
+
+  memcpy(msgbuf->data, data, size);
+  msgbuf->size = size;
+  msgbuf->refcount = 1;
+  msgbuf->next = NULL;
+
+  net_msgbuf_stats.messages++;
+  return msgbuf;
+}
+
+/**
+ * Drop a reference to a shared message buffer.
+ *
+ * @param msgbuf the buffer
+ */
+void
+net_msgbuf_put(struct olsr_msgbuf *msgbuf)
+{
+  assert(msgbuf->refcount > 0);
+
+  if (--msgbuf->refcount > 0) {
+    return;
+  }
+
+  if (msgbuf->capacity == NET_MSGBUF_SIZE && msgbuf_pool_count < NET_MSGBUF_POOL) {
+    msgbuf->next = msgbuf_pool;
+    msgbuf_pool = msgbuf;
+    msgbuf_pool_count++;
+  } else {
+    free(msgbuf);
+  }
+}
+
+/**
+ * Send all packets that net_output() queued on any interface.
+ * This is cheap if nothing is queued.
+ */
+void
+net_output_flush(void)
+{
+#ifdef __linux__
+  struct interface_olsr *ifp;
+
+  if (net_queued_packets == 0) {
+    return;
+  }
+
+  for (ifp = ifnet; ifp != NULL; ifp = ifp->int_next) {
+    net_queue_flush(ifp);
+  }
+#endif /* __linux__ */
+}
+
 /**
  * Create an outputbuffer for the given interface. This
  * function will allocate the needed storage according
@@ -126,8 +577,17 @@ net_add_buffer(struct interface_olsr *ifp)
    * the "bufsize" field in "struct olsr_netbuf".
    */
   if (ifp->netbuf.bufsize != ifp->int_mtu && ifp->netbuf.buff != NULL) {
+    unsigned int i;
+
+    for (i = 0; i < ifp->netbuf.ref_count; i++) {
+      net_msgbuf_put(ifp->netbuf.refs[i].msg);
+    }
+    ifp->netbuf.ref_count = 0;
     free(ifp->netbuf.buff);
     ifp->netbuf.buff = NULL;
+#ifdef __linux__
+    net_queue_free(ifp);
+#endif /* __linux__ */
   }
 
   if (ifp->netbuf.buff == NULL) {
@@ -159,6 +619,10 @@ net_remove_buffer(struct interface_olsr *ifp)
   if (ifp->netbuf.pending)
     net_output(ifp);
 
+#ifdef __linux__
+  net_queue_free(ifp);
+#endif /* __linux__ */
+
   free(ifp->netbuf.buff);
   ifp->netbuf.buff = NULL;
 
@@ -219,7 +683,7 @@ net_output_pending(const struct interface_olsr * ifp)
 int
 net_outbuffer_push(struct interface_olsr *ifp, const void *data, const uint16_t size)
 {
-  if ((ifp->netbuf.pending + size) > ifp->netbuf.maxsize)
+  if ((ifp->netbuf.pending + size) > ifp->netbuf.maxsize - ptf_batch_reserve)
     return 0;
 
   memcpy(&ifp->netbuf.buff[ifp->netbuf.pending + OLSR_HEADERSIZE], data, size);
@@ -242,7 +706,7 @@ net_outbuffer_push(struct interface_olsr *ifp, const void *data, const uint16_t
 int
 net_outbuffer_push_reserved(struct interface_olsr *ifp, const void *data, const uint16_t size)
 {
-  if ((ifp->netbuf.pending + size) > (ifp->netbuf.maxsize + ifp->netbuf.reserved))
+  if ((ifp->netbuf.pending + size) > (ifp->netbuf.maxsize + ifp->netbuf.reserved - ptf_batch_reserve))
     return 0;
 
   memcpy(&ifp->netbuf.buff[ifp->netbuf.pending + OLSR_HEADERSIZE], data, size);
@@ -251,6 +715,46 @@ net_outbuffer_push_reserved(struct interface_olsr *ifp, const void *data, const
   return size;
 }
 
+/**
+ * Add a shared message to a buffer. On Linux only a reference is
+ * kept, net_output() sends it from the shared buffer. Packet transform
+ * functions need the whole packet, so it is copied if there are any.
+ *
+ * @param ifp the interface corresponding to the buffer
+ * @param msgbuf the message
+ *
+ * @return 0 if there was not enough room in buffer or the
+ *  number of bytes added on success
+ */
+int
+net_outbuffer_push_msgbuf(struct interface_olsr *ifp, struct olsr_msgbuf *msgbuf)
+{
+  int size;
+
+  if ((ifp->netbuf.pending + msgbuf->size) > ifp->netbuf.maxsize - ptf_batch_reserve)
+    return 0;
+
+#ifdef __linux__
+  if (ptf_list == NULL && ifp->netbuf.ref_count < OLSR_NETBUF_REFS) {
+    struct olsr_netbuf_ref *ref = &ifp->netbuf.refs[ifp->netbuf.ref_count++];
+
+    ref->msg = msgbuf;
+    ref->offset = ifp->netbuf.pending + OLSR_HEADERSIZE;
+    msgbuf->refcount++;
+    ifp->netbuf.pending += msgbuf->size;
+
+    net_msgbuf_stats.refs++;
+    return msgbuf->size;
+  }
+#endif /* __linux__ */
+
+  size = net_outbuffer_push(ifp, msgbuf->data, msgbuf->size);
+  if (size > 0) {
+    net_msgbuf_stats.copies++;
+  }
+  return size;
+}
+
 /**
  * Report the number of bytes currently available in the buffer
  * (not including possible reserved bytes)
@@ -264,7 +768,7 @@ net_outbuffer_bytes_left(const struct interface_olsr *ifp)
 {
   /* IPv6 minimum MTU - IPv6 header - UDP header - VLAN-Tag */
   static int MAX_REMAINING = 1280 - 40 - 8 - 4;
-  int remaining = ifp->netbuf.maxsize - ifp->netbuf.pending;
+  int remaining = ifp->netbuf.maxsize - ptf_batch_reserve - ifp->netbuf.pending;
 
   if (remaining > MAX_REMAINING) {
     return MAX_REMAINING;
@@ -327,7 +831,91 @@ del_ptf(packet_transform_function f)
 }
 
 /**
- *Sends a packet on a given interface.
+ * Add a batch packet transform function. It is called with all
+ * packets of an interface just before they are sent, on Linux
+ * these are all packets queued since the last flush.
+ *
+ * @param f the function pointer
+ * @param name the name shown in the statistics
+ * @param reserve the number of bytes the function appends to a
+ *  packet at most, this space is kept free in all buffers
+ *
+ * @returns 1 on success, 0 if there are too many functions
+ */
+int
+add_ptf_batch(packet_transform_batch_function f, const char *name, int reserve)
+{
+  if (ptf_batch_count == NET_PTF_BATCH_MAX) {
+    return 0;
+  }
+
+  memset(&ptf_batch_list[ptf_batch_count], 0, sizeof(ptf_batch_list[ptf_batch_count]));
+  ptf_batch_list[ptf_batch_count].function = f;
+  ptf_batch_list[ptf_batch_count].reserve = reserve;
+  ptf_batch_list[ptf_batch_count].stats.name = name;
+  ptf_batch_count++;
+  ptf_batch_reserve += reserve;
+
+  return 1;
+}
+
+/**
+ * Remove a batch packet transform function
+ *
+ * @param f the function pointer
+ *
+ * @returns 1 if a functionpointer was removed
+ *  0 if not
+ */
+int
+del_ptf_batch(packet_transform_batch_function f)
+{
+  unsigned int i;
+
+  for (i = 0; i < ptf_batch_count; i++) {
+    if (ptf_batch_list[i].function == f) {
+      ptf_batch_reserve -= ptf_batch_list[i].reserve;
+      ptf_batch_count--;
+      memmove(&ptf_batch_list[i], &ptf_batch_list[i + 1], (ptf_batch_count - i) * sizeof(ptf_batch_list[i]));
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Append data a batch transform function wrote to the tail
+ * of a packet, and update the packet length in the header.
+ *
+ * @param pkt the packet
+ * @param size the number of bytes written to pkt->tail
+ */
+void
+net_ptf_append(struct olsr_ptf_packet *pkt, int size)
+{
+  struct iovec *last = &pkt->iov[pkt->iovcnt - 1];
+
+  assert(size <= pkt->tail_room);
+
+  if ((uint8_t *)last->iov_base + last->iov_len == pkt->tail) {
+    last->iov_len += size;
+  } else {
+    pkt->iov[pkt->iovcnt].iov_base = pkt->tail;
+    pkt->iov[pkt->iovcnt].iov_len = size;
+    pkt->iovcnt++;
+  }
+
+  pkt->tail += size;
+  pkt->tail_room -= size;
+  pkt->len += size;
+
+  ((union olsr_packet *)pkt->iov[0].iov_base)->v4.olsr_packlen = htons(pkt->len);
+}
+
+/**
+ *Sends a packet on a given interface. On Linux the packet
+ *is only queued, net_output_flush() hands it to the kernel.
  *
  *@param ifp the interface to send on.
  *
@@ -376,12 +964,54 @@ net_output(struct interface_olsr *ifp)
   }
 
   /*
-   *Call possible packet transform functions registered by plugins
+   *Call possible packet transform functions registered by plugins,
+   *they need the shared messages in the buffer
    */
+  if (ptf_list != NULL) {
+    net_netbuf_linearize(ifp);
+  }
   for (tmp_ptf_list = ptf_list; tmp_ptf_list != NULL; tmp_ptf_list = tmp_ptf_list->next) {
     tmp_ptf_list->function(ifp->netbuf.buff, &ifp->netbuf.pending);
   }
 
+#ifndef __linux__
+  /* there is no queue, transform the packet on its own */
+  if (ptf_batch_count > 0) {
+    struct olsr_ptf_packet pkt;
+    struct iovec iov[2];
+
+    iov[0].iov_base = ifp->netbuf.buff;
+    iov[0].iov_len = ifp->netbuf.pending;
+
+    pkt.ifp = ifp;
+    pkt.iov = iov;
+    pkt.iovcnt = 1;
+    pkt.len = ifp->netbuf.pending;
+    pkt.tail = ifp->netbuf.buff + ifp->netbuf.pending;
+    pkt.tail_room = ifp->netbuf.bufsize - ifp->netbuf.pending;
+
+    net_ptf_batch_run(&pkt, 1);
+    ifp->netbuf.pending = pkt.len;
+  }
+#endif /* __linux__ */
+
+  if (net_output_sink != NULL) {
+    /* no socket involved, the sink gets the packet in one piece */
+    net_netbuf_linearize(ifp);
+    net_output_sink(ifp, ifp->netbuf.buff, ifp->netbuf.pending);
+    ifp->netbuf.pending = 0;
+    lq_tc_pending = false;
+    return retval;
+  }
+
+#ifdef __linux__
+  /* queue the packet, net_output_flush() sends it with sendmmsg() */
+  if (olsr_cnf->ip_version == AF_INET) {
+    net_queue_packet(ifp, (struct sockaddr *)sin, sizeof(*sin));
+  } else {
+    net_queue_packet(ifp, (struct sockaddr *)sin6, sizeof(*sin6));
+  }
+#else /* __linux__ */
   if (olsr_cnf->ip_version == AF_INET) {
     /* IP version 4 */
     if (olsr_sendto(ifp->send_socket, ifp->netbuf.buff, ifp->netbuf.pending, MSG_DONTROUTE, (struct sockaddr *)sin, sizeof(*sin)) <
@@ -407,6 +1037,7 @@ net_output(struct interface_olsr *ifp)
       retval = -1;
     }
   }
+#endif /* __linux__ */
 
   ifp->netbuf.pending = 0;
 
@@ -53,8 +53,73 @@
 #include <arpa/inet.h>
 #include <net/if.h>
 
+#ifdef _WIN32
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+#else /* _WIN32 */
+#include <sys/uio.h>
+#endif /* _WIN32 */
+
 typedef int (*packet_transform_function) (uint8_t *, int *);
 
+/* an outgoing packet handed to a batch transform function */
+struct olsr_ptf_packet {
+  struct interface_olsr *ifp;
+  struct iovec *iov;                   /* the data, iov[0] starts with the packet header */
+  unsigned int iovcnt;
+  int len;                             /* length of the packet */
+  uint8_t *tail;                       /* free space behind the packet */
+  int tail_room;
+};
+
+/* transforms all packets ready to be sent at once */
+typedef void (*packet_transform_batch_function) (struct olsr_ptf_packet *, unsigned int);
+
+/* number of batch transform functions with statistics */
+#define NET_PTF_BATCH_MAX 4
+
+/* time spent in a batch transform function */
+struct net_ptf_stats {
+  const char *name;
+  uint32_t calls;
+  uint32_t packets;
+  uint64_t nsec;
+  uint32_t max_nsec;                   /* slowest call */
+};
+
+/* maximum number of packets moved by one recvmmsg()/sendmmsg() call */
+#define NET_BATCH_SIZE 16
+
+/* histogram of the number of packets moved per system call */
+struct net_batch_stats {
+  uint32_t calls;
+  uint32_t packets;
+  uint32_t size[NET_BATCH_SIZE + 1];
+};
+
+extern struct net_batch_stats net_rx_batch_stats, net_tx_batch_stats;
+
+/* size of the pooled buffers for forwarded messages, larger ones are allocated */
+#define NET_MSGBUF_SIZE 1500
+
+/* number of unused message buffers kept for reuse */
+#define NET_MSGBUF_POOL 64
+
+/* how forwarded messages got into the output buffers */
+struct net_msgbuf_stats {
+  uint32_t messages;                   /* messages copied into a shared buffer */
+  uint32_t refs;                       /* ... queued by reference */
+  uint32_t copies;                     /* ... copied into an output buffer */
+};
+
+extern struct net_msgbuf_stats net_msgbuf_stats;
+
+void net_batch_account(struct net_batch_stats *, unsigned int);
+
+void olsr_print_net_batch_stats(void);
+
 void init_net(void);
 
 int net_add_buffer(struct interface_olsr *);
@@ -71,14 +136,33 @@ int net_outbuffer_push(struct interface_olsr *, const void *, const uint16_t);
 
 int net_outbuffer_push_reserved(struct interface_olsr *, const void *, const uint16_t);
 
+struct olsr_msgbuf *net_msgbuf_get(const void *, const uint16_t);
+
+void net_msgbuf_put(struct olsr_msgbuf *);
+
+int net_outbuffer_push_msgbuf(struct interface_olsr *, struct olsr_msgbuf *);
+
 int net_output(struct interface_olsr *);
 
+void net_output_flush(void);
+
 int net_sendroute(struct rt_entry *, struct sockaddr *);
 
+/* takes complete packets instead of the kernel, see net_output() */
+typedef void (*net_output_sink_function) (struct interface_olsr *, const uint8_t *, int);
+
+extern net_output_sink_function net_output_sink;
+
 int add_ptf(packet_transform_function);
 
 int del_ptf(packet_transform_function);
 
+int add_ptf_batch(packet_transform_batch_function, const char *, int);
+
+int del_ptf_batch(packet_transform_batch_function);
+
+void net_ptf_append(struct olsr_ptf_packet *, int);
+
 bool olsr_validate_address(const union olsr_ip_addr *);
 
 void olsr_add_invalid_address(const union olsr_ip_addr *);
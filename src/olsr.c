@@ -71,6 +71,7 @@
 #include "gateway.h"
 #include "duplicate_handler.h"
 #include "olsr_random.h"
+#include "olsr_cookie.h"
 
 #include <stdarg.h>
 #include <signal.h>
@@ -81,6 +82,10 @@ bool changes_neighborhood;
 bool changes_hna;
 bool changes_force;
 
+struct olsr_calc_stats olsr_calc_stats;
+
+bool olsr_random_repeatable;
+
 /*COLLECT startup sleeps caused by warnings*/
 
 #ifdef OLSR_COLLECT_STARTUP_SLEEP
@@ -181,10 +186,24 @@ register_pcf(int (*f) (int, int, int))
  *update the routing table.
  *@return 0
  */
+#ifndef _WIN32
+static uint64_t
+olsr_calc_nsec(const struct timespec *t1)
+{
+  struct timespec t2;
+
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+  return (uint64_t)(t2.tv_sec - t1->tv_sec) * 1000000000 + (t2.tv_nsec - t1->tv_nsec);
+}
+#endif /* _WIN32 */
+
 void
 olsr_process_changes(void)
 {
   struct pcf *tmp_pc_list;
+#ifndef _WIN32
+  struct timespec t1;
+#endif /* _WIN32 */
 
 #ifdef DEBUG
   if (changes_neighborhood)
@@ -204,16 +223,30 @@ olsr_process_changes(void)
   }
 
   if (changes_neighborhood) {
+#ifndef _WIN32
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+#endif /* _WIN32 */
     if (olsr_cnf->lq_level < 1) {
       olsr_calculate_mpr();
     } else {
       olsr_calculate_lq_mpr();
     }
+    olsr_calc_stats.mpr_runs++;
+#ifndef _WIN32
+    olsr_calc_stats.mpr_nsec += olsr_calc_nsec(&t1);
+#endif /* _WIN32 */
   }
 
   /* calculate the routing table */
   if (changes_neighborhood || changes_topology || changes_hna) {
+#ifndef _WIN32
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+#endif /* _WIN32 */
     olsr_calculate_routing_table(false);
+    olsr_calc_stats.spf_runs++;
+#ifndef _WIN32
+    olsr_calc_stats.spf_nsec += olsr_calc_nsec(&t1);
+#endif /* _WIN32 */
   }
 
   if (olsr_cnf->debug_level > 0) {
@@ -226,6 +259,10 @@ olsr_process_changes(void)
       if (olsr_cnf->debug_level > 3) {
         if (olsr_cnf->debug_level > 8) {
           olsr_print_duplicate_table();
+          olsr_print_cookie_timer_stats();
+          olsr_print_cookie_memory_stats();
+          olsr_print_net_batch_stats();
+          olsr_print_tc_flood_stats();
         }
         olsr_print_hna_set();
       }
@@ -322,6 +359,7 @@ olsr_forward_message(union olsr_message *m, struct interface_olsr *in_if, union
   struct neighbor_entry *neighbor;
   int msgsize;
   struct interface_olsr *ifn;
+  struct olsr_msgbuf *msgbuf;
   bool is_ttl_1 = false;
 
   /*
@@ -362,6 +400,14 @@ olsr_forward_message(union olsr_message *m, struct interface_olsr *in_if, union
     return 0;
   }
 
+  if (m->v4.olsr_msgtype == TC_MESSAGE || m->v4.olsr_msgtype == LQ_TC_MESSAGE || m->v4.olsr_msgtype == LQ_TC_DELTA_MESSAGE) {
+    if (is_ttl_1) {
+      tc_flood_stats.scope_end++;
+    } else {
+      tc_flood_stats.forwarded++;
+    }
+  }
+
   /* Treat TTL hopcnt except for ethernet link */
   if (!is_ttl_1) {
     if (olsr_cnf->ip_version == AF_INET) {
@@ -378,6 +424,9 @@ olsr_forward_message(union olsr_message *m, struct interface_olsr *in_if, union
   /* Update packet data */
   msgsize = ntohs(m->v4.olsr_msgsize);
 
+  /* copy the message once, the interfaces share it */
+  msgbuf = net_msgbuf_get(m, msgsize);
+
   /* looping trough interfaces */
   for (ifn = ifnet; ifn; ifn = ifn->int_next) {
     /* do not retransmit out through the same interface if it has mode == ether */
@@ -390,13 +439,13 @@ olsr_forward_message(union olsr_message *m, struct interface_olsr *in_if, union
       /*
        * Check if message is to big to be piggybacked
        */
-      if (net_outbuffer_push(ifn, m, msgsize) != msgsize) {
+      if (net_outbuffer_push_msgbuf(ifn, msgbuf) != msgsize) {
         /* Send */
         net_output(ifn);
         /* Buffer message */
         set_buffer_timer(ifn);
 
-        if (net_outbuffer_push(ifn, m, msgsize) != msgsize) {
+        if (net_outbuffer_push_msgbuf(ifn, msgbuf) != msgsize) {
           OLSR_PRINTF(1, "Received message to big to be forwarded in %s(%d bytes)!", ifn->int_name, msgsize);
           olsr_syslog(OLSR_LOG_ERR, "Received message to big to be forwarded on %s(%d bytes)!", ifn->int_name, msgsize);
         }
@@ -405,12 +454,14 @@ olsr_forward_message(union olsr_message *m, struct interface_olsr *in_if, union
       /* No forwarding pending */
       set_buffer_timer(ifn);
 
-      if (net_outbuffer_push(ifn, m, msgsize) != msgsize) {
+      if (net_outbuffer_push_msgbuf(ifn, msgbuf) != msgsize) {
         OLSR_PRINTF(1, "Received message to big to be forwarded in %s(%d bytes)!", ifn->int_name, msgsize);
         olsr_syslog(OLSR_LOG_ERR, "Received message to big to be forwarded on %s(%d bytes)!", ifn->int_name, msgsize);
       }
     }
   }
+
+  net_msgbuf_put(msgbuf);
   return 1;
 }
 
@@ -499,6 +550,8 @@ olsr_msgtype_to_string(uint8_t msgtype)
     return ("LQ-HELLO");
   case (LQ_TC_MESSAGE):
     return ("LQ-TC");
+  case (LQ_TC_DELTA_MESSAGE):
+    return ("LQ-TC-DELTA");
   default:
     break;
   }
@@ -56,6 +56,16 @@ extern bool changes_force;
 
 extern union olsr_ip_addr all_zero;
 
+/* time spent recalculating MPRs and routes, read by benchmarks */
+struct olsr_calc_stats {
+  uint32_t mpr_runs;
+  uint64_t mpr_nsec;
+  uint32_t spf_runs;
+  uint64_t spf_nsec;
+};
+
+extern struct olsr_calc_stats olsr_calc_stats;
+
 void olsr_startup_sleep(int);
 void olsr_do_startup_sleep(void);
 
@@ -73,9 +73,13 @@
 #define DEF_USE_HYST         false
 #define DEF_FIB_METRIC       FIBM_FLAT
 #define DEF_FIB_METRIC_DEFAULT            2
+#define DEF_SPF_MODE         SPFM_FULL
+#define DEF_MPR_MODE         MPRM_FULL
 #define DEF_LQ_LEVEL         2
 #define DEF_LQ_ALGORITHM     "etx_ff"
 #define DEF_LQ_FISH          1
+#define DEF_LQ_FISH_TTL      { 2, 8, 2, 16, 2, 8, 2, 255 }
+#define DEF_TC_DELTA_REFRESH 0
 #define DEF_LQ_NAT_THRESH    1.0
 #define DEF_LQ_AGING         0.05
 #define DEF_CLEAR_SCREEN     true
@@ -154,6 +158,7 @@
 #define MIN_LQ_LEVEL         0
 #define MAX_LQ_AGING         1.0
 #define MIN_LQ_AGING         0.01
+#define MAX_LQ_FISH_TTL      16 /* length of the fisheye TTL sequence */
 
 #define MIN_SMARTGW_USE_COUNT_MIN  1
 #define MAX_SMARTGW_USE_COUNT_MAX  64
@@ -196,6 +201,20 @@ typedef enum {
   FIBM_CNT
 } olsr_fib_metric_options;
 
+typedef enum {
+  SPFM_FULL,
+  SPFM_INCREMENTAL,
+  SPFM_CHECK,
+  SPFM_CNT
+} olsr_spf_mode_options;
+
+typedef enum {
+  MPRM_FULL,
+  MPRM_INCREMENTAL,
+  MPRM_CHECK,
+  MPRM_CNT
+} olsr_mpr_mode_options;
+
 enum olsr_if_mode {
   IF_MODE_MESH,
   IF_MODE_ETHER,
@@ -299,6 +318,8 @@ struct olsrd_config {
   bool use_hysteresis;
   olsr_fib_metric_options fib_metric;
   int fib_metric_default;
+  olsr_spf_mode_options spf_mode;
+  olsr_mpr_mode_options mpr_mode;
   struct hyst_param hysteresis_param;
   struct plugin_entry *plugins;
   struct ip_prefix_list *hna_entries;
@@ -312,6 +333,9 @@ struct olsrd_config {
   uint8_t mpr_coverage;
   uint8_t lq_level;
   uint8_t lq_fish;
+  uint8_t lq_fish_ttl[MAX_LQ_FISH_TTL];   /* fisheye TTL sequence of the TCs */
+  uint8_t lq_fish_ttl_cnt;
+  uint8_t tc_delta_refresh;             /* send a full TC every n TCs, deltas in between, 0 = off */
   float lq_aging;
   char *lq_algorithm;
 
@@ -392,6 +416,8 @@ extern "C" {
 
   extern const char *GW_UPLINK_TXT[];
   extern const char *FIB_METRIC_TXT[];
+  extern const char *SPF_MODE_TXT[];
+  extern const char *MPR_MODE_TXT[];
   extern const char *OLSR_IF_MODE[];
 
 /*
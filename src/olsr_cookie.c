@@ -47,12 +47,27 @@
 #include "defs.h"
 #include "olsr_cookie.h"
 #include "log.h"
+#include "scheduler.h"
 
 #include <assert.h>
 
 /* Root directory of the cookies we have in the system */
 static struct olsr_cookie_info *cookies[COOKIE_ID_MAX] = { 0 };
 
+/* blocks and slab pages are aligned to pointer size */
+#define COOKIE_ALIGN(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/* offset of the brand behind a block */
+#define COOKIE_BRAND_OFFSET(ci) COOKIE_ALIGN((ci)->ci_size)
+
+/* distance of two blocks in a slab page */
+#define COOKIE_SLAB_STRIDE(ci) COOKIE_ALIGN(COOKIE_BRAND_OFFSET(ci) + sizeof(struct olsr_cookie_mem_brand))
+
+/* offset of the first block in a slab page */
+#define COOKIE_SLAB_HEADER COOKIE_ALIGN(sizeof(struct olsr_cookie_slab_page))
+
+LISTNODE2STRUCT(list2slab_page, struct olsr_cookie_slab_page, sp_node);
+
 /*
  * Allocate a cookie for the next available cookie id.
  */
@@ -92,6 +107,8 @@ olsr_alloc_cookie(const char *cookie_name, olsr_cookie_type cookie_type)
   /* Init the free list */
   if (cookie_type == OLSR_COOKIE_TYPE_MEMORY) {
     list_head_init(&ci->ci_free_list);
+    list_head_init(&ci->ci_slab_partial);
+    list_head_init(&ci->ci_slab_full);
   }
 
   return ci;
@@ -113,13 +130,23 @@ olsr_free_cookie(struct olsr_cookie_info *ci)
     free(ci->ci_name);
   }
 
-  /* Flush all the memory on the free list */
+  /* Flush all the memory on the free list and all slab pages */
   if (ci->ci_type == OLSR_COOKIE_TYPE_MEMORY) {
     while (!list_is_empty(&ci->ci_free_list)) {
       memory_list = ci->ci_free_list.next;
       list_remove(memory_list);
       free(memory_list);
     }
+    while (!list_is_empty(&ci->ci_slab_partial)) {
+      memory_list = ci->ci_slab_partial.next;
+      list_remove(memory_list);
+      free(list2slab_page(memory_list));
+    }
+    while (!list_is_empty(&ci->ci_slab_full)) {
+      memory_list = ci->ci_slab_full.next;
+      list_remove(memory_list);
+      free(list2slab_page(memory_list));
+    }
   }
 
   free(ci);
@@ -156,9 +183,30 @@ olsr_cookie_set_memory_size(struct olsr_cookie_info *ci, size_t size)
   }
 
   assert(ci->ci_type == OLSR_COOKIE_TYPE_MEMORY);
+  assert(ci->ci_slab_pages == 0);
   ci->ci_size = size;
 }
 
+/*
+ * Switch a memory cookie to slab mode. Blocks are carved out of
+ * contiguous pages instead of being allocated one by one.
+ * At most max_pages pages are used (0 for no limit), further blocks
+ * come from the heap. If release is set, pages which become empty
+ * are handed back to the heap once a spare page is kept.
+ */
+void
+olsr_cookie_set_slab(struct olsr_cookie_info *ci, unsigned int max_pages, bool release)
+{
+  if (!ci) {
+    return;
+  }
+
+  assert(ci->ci_type == OLSR_COOKIE_TYPE_MEMORY);
+  ci->ci_slab = true;
+  ci->ci_slab_limit = max_pages;
+  ci->ci_slab_release = release;
+}
+
 /*
  * Basic sanity checking for a passed-in cookie-id.
  */
@@ -180,6 +228,9 @@ olsr_cookie_usage_incr(olsr_cookie_t cookie_id)
   if (olsr_cookie_valid(cookie_id)) {
     cookies[cookie_id]->ci_usage++;
     cookies[cookie_id]->ci_changes++;
+    if (cookies[cookie_id]->ci_usage > cookies[cookie_id]->ci_usage_peak) {
+      cookies[cookie_id]->ci_usage_peak = cookies[cookie_id]->ci_usage;
+    }
   }
 }
 
@@ -195,6 +246,85 @@ olsr_cookie_usage_decr(olsr_cookie_t cookie_id)
   }
 }
 
+/*
+ * Account a timer expiry and its lateness in milliseconds.
+ */
+void
+olsr_cookie_timer_fired(struct olsr_cookie_info *ci, uint32_t late)
+{
+  unsigned int bucket = 0;
+
+  while (late && bucket < COOKIE_TIMER_LATE_BUCKETS - 1) {
+    late >>= 1;
+    bucket++;
+  }
+
+  ci->ci_timer_fired++;
+  ci->ci_timer_late[bucket]++;
+}
+
+/*
+ * Print the expiry counters and lateness histograms of all timer cookies.
+ */
+void
+olsr_print_cookie_timer_stats(void)
+{
+#ifndef NODEBUG
+  int ci_index, bucket;
+
+  OLSR_PRINTF(0, "\n--- %s ---------------------------------------------- TIMERS\n\n", olsr_wallclock_string());
+  OLSR_PRINTF(0, "%-28s %10s  lateness 0,<2,<4,<8,...,>=%ums\n", "Cookie", "Fired", 1u << (COOKIE_TIMER_LATE_BUCKETS - 2));
+
+  for (ci_index = 1; ci_index < COOKIE_ID_MAX; ci_index++) {
+    struct olsr_cookie_info *ci = cookies[ci_index];
+
+    if (!ci || ci->ci_type != OLSR_COOKIE_TYPE_TIMER || !ci->ci_timer_fired) {
+      continue;
+    }
+
+    OLSR_PRINTF(0, "%-28s %10u ", ci->ci_name ? ci->ci_name : "unknown", ci->ci_timer_fired);
+    for (bucket = 0; bucket < COOKIE_TIMER_LATE_BUCKETS; bucket++) {
+      OLSR_PRINTF(0, " %u", ci->ci_timer_late[bucket]);
+    }
+    OLSR_PRINTF(0, "\n");
+  }
+#endif /* NODEBUG */
+}
+
+/*
+ * Print usage, slab page counts and fragmentation of all memory cookies.
+ * Fragmentation is the percentage of unused blocks in the slab pages.
+ */
+void
+olsr_print_cookie_memory_stats(void)
+{
+#ifndef NODEBUG
+  int ci_index;
+
+  OLSR_PRINTF(0, "\n--- %s ---------------------------------------------- MEMORY\n\n", olsr_wallclock_string());
+  OLSR_PRINTF(0, "%-28s %6s %8s %8s %8s %6s %6s %8s %5s\n", "Cookie", "Size", "Usage", "Peak", "Freelist", "Pages",
+              "Empty", "Overflow", "Frag");
+
+  for (ci_index = 1; ci_index < COOKIE_ID_MAX; ci_index++) {
+    struct olsr_cookie_info *ci = cookies[ci_index];
+    unsigned int slots, frag = 0;
+
+    if (!ci || ci->ci_type != OLSR_COOKIE_TYPE_MEMORY) {
+      continue;
+    }
+
+    slots = ci->ci_slab_pages * ci->ci_slab_objs;
+    if (slots) {
+      frag = (slots - (ci->ci_usage - ci->ci_slab_overflow)) * 100 / slots;
+    }
+
+    OLSR_PRINTF(0, "%-28s %6u %8u %8u %8u %6u %6u %8u %4u%%\n", ci->ci_name ? ci->ci_name : "unknown",
+                (unsigned int)ci->ci_size, ci->ci_usage, ci->ci_usage_peak, ci->ci_free_list_usage, ci->ci_slab_pages,
+                ci->ci_slab_empty, ci->ci_slab_overflow, frag);
+  }
+#endif /* NODEBUG */
+}
+
 /*
  * Return a cookie name.
  * Mostly used for logging purposes.
@@ -211,29 +341,144 @@ olsr_cookie_name(olsr_cookie_t cookie_id)
   return unknown;
 }
 
+/*
+ * Take a block from the slab pages of a cookie.
+ * Partially used pages are preferred over empty ones to keep
+ * the number of pages low.
+ *
+ * Returns NULL if the page limit is reached.
+ */
+static void *
+olsr_cookie_slab_alloc(struct olsr_cookie_info *ci, struct olsr_cookie_slab_page **page_ptr)
+{
+  struct olsr_cookie_slab_page *page;
+  void *ptr;
+
+  if (list_is_empty(&ci->ci_slab_partial)) {
+    unsigned char *block;
+    size_t stride = COOKIE_SLAB_STRIDE(ci);
+    unsigned int i;
+
+    if (ci->ci_slab_limit && ci->ci_slab_pages >= ci->ci_slab_limit) {
+      return NULL;
+    }
+
+    if (!ci->ci_slab_objs) {
+      ci->ci_slab_objs = (COOKIE_SLAB_PAGE_SIZE - COOKIE_SLAB_HEADER) / stride;
+      if (ci->ci_slab_objs < COOKIE_SLAB_MIN_OBJS) {
+        ci->ci_slab_objs = COOKIE_SLAB_MIN_OBJS;
+      }
+    }
+
+    page = malloc(COOKIE_SLAB_HEADER + ci->ci_slab_objs * stride);
+    if (!page) {
+      char buf[1024];
+      snprintf(buf, sizeof(buf), "%s: out of memory: %s", ci->ci_name, strerror(errno));
+      olsr_exit(buf, EXIT_FAILURE);
+    }
+
+    /* thread the free blocks, lowest address first */
+    page->sp_free = NULL;
+    page->sp_used = 0;
+    block = (unsigned char *)page + COOKIE_SLAB_HEADER + ci->ci_slab_objs * stride;
+    for (i = 0; i < ci->ci_slab_objs; i++) {
+      block -= stride;
+      *(void **)ARM_NOWARN_ALIGN(block) = page->sp_free;
+      page->sp_free = block;
+    }
+
+    list_node_init(&page->sp_node);
+    list_add_after(&ci->ci_slab_partial, &page->sp_node);
+    ci->ci_slab_pages++;
+    ci->ci_slab_empty++;
+  }
+
+  page = list2slab_page(ci->ci_slab_partial.next);
+  if (page->sp_used++ == 0) {
+    ci->ci_slab_empty--;
+  }
+
+  ptr = page->sp_free;
+  page->sp_free = *(void **)page->sp_free;
+  if (!page->sp_free) {
+    list_remove(&page->sp_node);
+    list_add_after(&ci->ci_slab_full, &page->sp_node);
+  }
+
+  *page_ptr = page;
+  return ptr;
+}
+
+/*
+ * Return a block to its slab page.
+ */
+static void
+olsr_cookie_slab_free(struct olsr_cookie_info *ci, struct olsr_cookie_slab_page *page, void *ptr)
+{
+  if (!page->sp_free) {
+    /* the page is no longer full */
+    list_remove(&page->sp_node);
+    list_add_after(&ci->ci_slab_partial, &page->sp_node);
+  }
+
+  *(void **)ptr = page->sp_free;
+  page->sp_free = ptr;
+
+  if (--page->sp_used > 0) {
+    return;
+  }
+
+  if (ci->ci_slab_release && ci->ci_slab_empty >= COOKIE_SLAB_SPARE_PAGES) {
+    list_remove(&page->sp_node);
+    free(page);
+    ci->ci_slab_pages--;
+    return;
+  }
+
+  /* keep the empty page, but use it last */
+  list_remove(&page->sp_node);
+  list_add_before(&ci->ci_slab_partial, &page->sp_node);
+  ci->ci_slab_empty++;
+}
+
 /*
  * Allocate a fixed amount of memory based on a passed in cookie type.
  */
 void *
 olsr_cookie_malloc(struct olsr_cookie_info *ci)
 {
-  void *ptr;
+  void *ptr = NULL;
   struct olsr_cookie_mem_brand *branding;
   struct list_node *free_list_node;
+  struct olsr_cookie_slab_page *page = NULL;
 
 #ifdef OLSR_COOKIE_DEBUG
   bool reuse = false;
 #endif /* OLSR_COOKIE_DEBUG */
 
+  /*
+   * Slab cookies use their pages, unless the page limit is reached.
+   */
+  if (ci->ci_slab) {
+    ptr = olsr_cookie_slab_alloc(ci, &page);
+    if (ptr) {
+      memset(ptr, 0, ci->ci_size);
+    } else {
+      ci->ci_slab_overflow++;
+    }
+  }
+
   /*
    * Check first if we have reusable memory.
    */
-  if (!ci->ci_free_list_usage) {
+  if (ptr) {
+    /* block taken from a slab page */
+  } else if (!ci->ci_free_list_usage) {
 
     /*
      * No reusable memory block on the free_list.
      */
-    ptr = calloc(1, ci->ci_size + sizeof(struct olsr_cookie_mem_brand));
+    ptr = calloc(1, COOKIE_BRAND_OFFSET(ci) + sizeof(struct olsr_cookie_mem_brand));
 
     if (!ptr) {
       char buf[1024];
@@ -262,9 +507,10 @@ olsr_cookie_malloc(struct olsr_cookie_info *ci)
    * indicating presence of a cookie. This will be checked against
    * When the block is freed to detect corruption.
    */
-  branding = (struct olsr_cookie_mem_brand *)ARM_NOWARN_ALIGN(((unsigned char *)ptr + ci->ci_size));
+  branding = (struct olsr_cookie_mem_brand *)ARM_NOWARN_ALIGN(((unsigned char *)ptr + COOKIE_BRAND_OFFSET(ci)));
   memcpy(&branding->cmb_sig[0], "cookie", 6);
   branding->cmb_id = ci->ci_id;
+  branding->cmb_page = page;
 
   /* Stats keeping */
   olsr_cookie_usage_incr(ci->ci_id);
@@ -284,13 +530,14 @@ void
 olsr_cookie_free(struct olsr_cookie_info *ci, void *ptr)
 {
   struct olsr_cookie_mem_brand *branding;
+  struct olsr_cookie_slab_page *page;
   struct list_node *free_list_node;
 
 #ifdef OLSR_COOKIE_DEBUG
   bool reuse = false;
 #endif /* OLSR_COOKIE_DEBUG */
 
-  branding = (struct olsr_cookie_mem_brand *)ARM_NOWARN_ALIGN(((unsigned char *)ptr + ci->ci_size));
+  branding = (struct olsr_cookie_mem_brand *)ARM_NOWARN_ALIGN(((unsigned char *)ptr + COOKIE_BRAND_OFFSET(ci)));
 
   /*
    * Verify if there has been a memory overrun, or
@@ -300,14 +547,28 @@ olsr_cookie_free(struct olsr_cookie_info *ci, void *ptr)
   assert(branding->cmb_id == ci->ci_id);
 
   /* Kill the brand */
+  page = branding->cmb_page;
   memset(branding, 0, sizeof(*branding));
 
   /*
    * Rather than freeing the memory right away, try to reuse at a later
    * point. Keep at least ten percent of the active used blocks or at least
    * ten blocks on the free list.
+   * Slab blocks go back to their page.
    */
-  if ((ci->ci_free_list_usage < COOKIE_FREE_LIST_THRESHOLD) || (ci->ci_free_list_usage < ci->ci_usage / COOKIE_FREE_LIST_THRESHOLD)) {
+  if (page) {
+    olsr_cookie_slab_free(ci, page, ptr);
+#ifdef OLSR_COOKIE_DEBUG
+    reuse = true;
+#endif /* OLSR_COOKIE_DEBUG */
+  } else if (ci->ci_slab && ci->ci_slab_overflow) {
+
+    /*
+     * Heap blocks of a slab cookie are not recycled.
+     */
+    ci->ci_slab_overflow--;
+    free(ptr);
+  } else if ((ci->ci_free_list_usage < COOKIE_FREE_LIST_THRESHOLD) || (ci->ci_free_list_usage < ci->ci_usage / COOKIE_FREE_LIST_THRESHOLD)) {
 
     free_list_node = (struct list_node *)ptr;
     list_node_init(free_list_node);
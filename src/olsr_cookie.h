@@ -51,6 +51,21 @@
 
 #define COOKIE_ID_MAX  50       /* maximum number of cookies in the system */
 
+/*
+ * Lateness histogram of timer cookies, bucket 0 counts timers fired
+ * in time, bucket n counts a lateness of [2^(n-1), 2^n) milliseconds.
+ */
+#define COOKIE_TIMER_LATE_BUCKETS 12
+
+/*
+ * Memory cookies in slab mode carve their blocks out of pages of
+ * at least COOKIE_SLAB_PAGE_SIZE bytes holding at least
+ * COOKIE_SLAB_MIN_OBJS blocks each.
+ */
+#define COOKIE_SLAB_PAGE_SIZE 4096
+#define COOKIE_SLAB_MIN_OBJS 8
+#define COOKIE_SLAB_SPARE_PAGES 1      /* empty pages kept before releasing */
+
 typedef enum olsr_cookie_type_ {
   OLSR_COOKIE_TYPE_MIN,
   OLSR_COOKIE_TYPE_MEMORY,
@@ -72,6 +87,27 @@ struct olsr_cookie_info {
   unsigned int ci_changes;             /* Stats, resource churn */
   struct list_node ci_free_list;       /* List head for recyclable blocks */
   unsigned int ci_free_list_usage;     /* Length of free list */
+  unsigned int ci_timer_fired;         /* Stats, timer expiries */
+  unsigned int ci_timer_late[COOKIE_TIMER_LATE_BUCKETS];       /* Stats, timer lateness */
+  unsigned int ci_usage_peak;          /* Stats, high water mark of ci_usage */
+  bool ci_slab;                        /* Allocate blocks from slab pages */
+  bool ci_slab_release;                /* Return empty slab pages to the heap */
+  unsigned int ci_slab_objs;           /* Blocks per slab page */
+  unsigned int ci_slab_limit;          /* Max slab pages, 0 for no limit */
+  unsigned int ci_slab_pages;          /* Stats, slab pages allocated */
+  unsigned int ci_slab_empty;          /* Stats, slab pages without used blocks */
+  unsigned int ci_slab_overflow;       /* Stats, blocks on the heap beyond the limit */
+  struct list_node ci_slab_partial;    /* Pages with free blocks, emptiest last */
+  struct list_node ci_slab_full;       /* Pages without free blocks */
+};
+
+/*
+ * Header of a slab page, followed by ci_slab_objs blocks.
+ */
+struct olsr_cookie_slab_page {
+  struct list_node sp_node;            /* On ci_slab_partial or ci_slab_full */
+  void *sp_free;                       /* First free block */
+  unsigned int sp_used;                /* Number of blocks handed out */
 };
 
 #define COOKIE_FREE_LIST_THRESHOLD 10   /* Blocks / Percent  */
@@ -83,6 +119,7 @@ struct olsr_cookie_info {
 struct olsr_cookie_mem_brand {
   char cmb_sig[6];
   olsr_cookie_t cmb_id;
+  struct olsr_cookie_slab_page *cmb_page;      /* Slab page of the block, NULL if on the heap */
 };
 
 /* Externals. */
@@ -91,8 +128,12 @@ extern void olsr_free_cookie(struct olsr_cookie_info *);
 extern void olsr_delete_all_cookies(void);
 extern char *olsr_cookie_name(olsr_cookie_t);
 extern void olsr_cookie_set_memory_size(struct olsr_cookie_info *, size_t);
+extern void olsr_cookie_set_slab(struct olsr_cookie_info *, unsigned int, bool);
 extern void olsr_cookie_usage_incr(olsr_cookie_t);
 extern void olsr_cookie_usage_decr(olsr_cookie_t);
+extern void olsr_cookie_timer_fired(struct olsr_cookie_info *, uint32_t);
+extern void olsr_print_cookie_timer_stats(void);
+extern void olsr_print_cookie_memory_stats(void);
 
 extern void *olsr_cookie_malloc(struct olsr_cookie_info *);
 extern void olsr_cookie_free(struct olsr_cookie_info *, void *);
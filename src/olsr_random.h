@@ -49,11 +49,15 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <time.h>
 
 #define OLSR_RANDOM_MAX INT32_MAX
 
+/* only use random(), so that srandom() with the same seed repeats a run */
+extern bool olsr_random_repeatable;
+
 static INLINE long int olsr_random(void) {
   int32_t value;
   int randomFile;
@@ -62,6 +66,10 @@ static INLINE long int olsr_random(void) {
   return random();
 #endif /* _WIN32 */
 
+  if (olsr_random_repeatable) {
+    return random();
+  }
+
   randomFile = open("/dev/urandom", O_RDONLY);
   if (randomFile == -1) {
     randomFile = open("/dev/random", O_RDONLY);
@@ -0,0 +1,512 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * olsr_sim - runs a mesh of olsrd instances in one process on a
+ * virtual clock and reports how fast and how well the routes converge.
+ * The same seed always gives the same run. With -p it replays a
+ * capture of a real mesh through a single instance instead.
+ */
+
+#include "olsr_sim.h"
+#include "ipcalc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+/* events of one node at the same time that are handled in one step */
+#define SIM_BATCH_SIZE 256
+
+struct sim sim;
+
+static struct sim_event sim_batch[SIM_BATCH_SIZE];
+
+static void
+usage(void)
+{
+  printf("Usage: olsr_sim [options]\n"
+         "       olsr_sim -p <pcap> -a <address> [-q <level>] [-S <mode>] [-M <mode>] [-D <n>]\n"
+         "                [-f <ttls>] [-s <seed>]\n"
+         "  -n <nodes>     number of nodes (default 100)\n"
+         "  -t <topology>  grid, line, ring or geo (default grid)\n"
+         "  -r <range>     radio range of the geo topology in the unit square\n"
+         "                 (default: about 8 neighbours per node)\n"
+         "  -l <percent>   packet loss per link (default 0)\n"
+         "  -d <ms>        link delay (default 5)\n"
+         "  -j <ms>        link jitter (default 2)\n"
+         "  -T <seconds>   simulated time (default 60)\n"
+         "  -s <seed>      random seed (default 1)\n"
+         "  -q <level>     link quality level, 0 for RFC3626 hop count (default 2,\n"
+         "                 a replay uses the level of the hellos in the capture)\n"
+         "  -S <mode>      SpfMode of the nodes: full, incremental or check (default full)\n"
+         "  -M <mode>      MprMode of the nodes: full, incremental or check (default full)\n"
+         "  -D <n>         TcDeltaRefresh, send a full TC every n TCs (default 0, off)\n"
+         "  -f <ttls>      fish eye TTL sequence, e.g. 2,8,255, or 0 to turn the fish eye\n"
+         "                 off (default 2,8,2,16,2,8,2,255)\n"
+         "  -m             measure the heap usage of the nodes (slow)\n"
+         "  -v             print the statistics of every node\n"
+         "  -w <pcap>      write the traffic of the first node to a pcap file\n"
+         "  -p <pcap>      replay the OLSR traffic of a pcap file, as captured\n"
+         "                 with tcpdump -w <pcap> udp port 698\n"
+         "  -a <address>   address of the host that captured the replayed traffic\n");
+}
+
+/* returns the index of a SpfMode or MprMode name, -1 if it is unknown */
+static int
+sim_parse_mode(const char *arg, const char **names, int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    if (strcmp(arg, names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* parses the fish eye option like LinkQualityFishEyeTtl, 0 turns the fish eye off */
+static int
+sim_parse_fish(const char *arg)
+{
+  const char *ptr = arg;
+  char *end;
+  unsigned long ttl;
+  bool mesh_wide = false;
+
+  sim.fish_set = true;
+  sim.lq_fish_ttl_cnt = 0;
+  if (strcmp(arg, "0") == 0) {
+    sim.lq_fish = 0;
+    return 0;
+  }
+  sim.lq_fish = 1;
+
+  while (*ptr) {
+    if (*ptr == ' ' || *ptr == ',') {
+      ptr++;
+      continue;
+    }
+    ttl = strtoul(ptr, &end, 10);
+    if (end == ptr || ttl == 0 || ttl > MAX_TTL || sim.lq_fish_ttl_cnt == MAX_LQ_FISH_TTL) {
+      return -1;
+    }
+    if (ttl == MAX_TTL) {
+      mesh_wide = true;
+    }
+    sim.lq_fish_ttl[sim.lq_fish_ttl_cnt++] = ttl;
+    ptr = end;
+  }
+
+  /* same rule as olsrd_sanity_check_cnf(), some TCs must reach the whole mesh */
+  return mesh_wide ? 0 : -1;
+}
+
+/* prints the olsrd settings that differ between benchmark runs */
+void
+sim_print_settings(void)
+{
+  int i;
+
+  printf("olsrd: spf %s, mpr %s, tc delta refresh %d, fish eye ", SPF_MODE_TXT[sim.spf_mode], MPR_MODE_TXT[sim.mpr_mode],
+         sim.tc_delta_refresh);
+  if (!sim.fish_set) {
+    printf("default\n");
+  } else if (sim.lq_fish == 0) {
+    printf("off\n");
+  } else {
+    for (i = 0; i < sim.lq_fish_ttl_cnt; i++) {
+      printf("%s%u", i == 0 ? "" : ",", sim.lq_fish_ttl[i]);
+    }
+    printf("\n");
+  }
+}
+
+static double
+sim_wall_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* updates the convergence after a node changed its routing table */
+static void
+sim_check_converged(struct sim_node *node)
+{
+  bool converged = node->routes + 1 >= (unsigned int)node->reachable;
+
+  if (converged == node->converged) {
+    return;
+  }
+  node->converged = converged;
+
+  if (converged) {
+    sim.converged_nodes++;
+    if (sim.converged_nodes == (unsigned int)sim.node_count) {
+      if (sim.first_converged == 0) {
+        sim.first_converged = sim.now;
+      }
+      sim.last_converged = sim.now;
+    }
+  } else {
+    sim.converged_nodes--;
+  }
+}
+
+/**
+ * Runs the events of the next node in the queue.
+ */
+void
+sim_run_events(void)
+{
+  struct sim_event ev;
+  struct sim_node *node;
+  unsigned int i, count = 0;
+  bool run = false;
+
+  sim_event_pop(&ev);
+  sim.now = ev.time;
+  node = &sim.nodes[ev.node];
+
+  sim_batch[count++] = ev;
+  while (count < SIM_BATCH_SIZE && sim_event_peek(&ev) && ev.time == sim.now && ev.node == sim_batch[0].node) {
+    sim_event_pop(&ev);
+    sim_batch[count++] = ev;
+  }
+  sim.events_run += count;
+
+  for (i = 0; i < count; i++) {
+    /* a timer event is stale once the node got a different deadline */
+    if (sim_batch[i].pkt == NULL ? sim_batch[i].time == node->timer_due : node->data != NULL) {
+      run = true;
+      break;
+    }
+  }
+
+  if (run && node->data == NULL) {
+    /* the first timer event boots the node, packets sent to it before are lost */
+    sim_node_init(sim_batch[0].node, sim.now);
+  } else if (run) {
+    sim_node_step(sim_batch[0].node, sim_batch, count);
+  }
+
+  for (i = 0; i < count; i++) {
+    struct sim_packet *pkt = sim_batch[i].pkt;
+
+    if (pkt != NULL && --pkt->refs == 0) {
+      free(pkt);
+    }
+  }
+
+  sim_check_converged(node);
+}
+
+static void
+sim_report(const char *topology, int links, int partitions, double wall, bool verbose)
+{
+  uint64_t tx_bytes = 0, rx_bytes = 0, mpr_nsec = 0, spf_nsec = 0, step_nsec = 0, max_spf_nsec = 0;
+  uint32_t tx_packets = 0, rx_packets = 0, lost = 0, mpr_runs = 0, spf_runs = 0;
+  int64_t heap = 0, max_heap = 0;
+  int *dist;
+  int i, missing = 0, longer = 0;
+  double n = sim.node_count;
+
+  dist = malloc(sim.node_count * sizeof(int));
+  if (dist == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (verbose) {
+    printf("%-15s %5s %6s %8s %10s %8s %10s %6s %9s %6s %9s %8s\n", "Node", "Nbrs", "Routes", "TxPkts", "TxBytes", "RxPkts",
+           "RxBytes", "MPRs", "MPR(us)", "SPFs", "SPF(us)", "Heap(KB)");
+  }
+
+  for (i = 0; i < sim.node_count; i++) {
+    struct sim_node *node = &sim.nodes[i];
+    int node_longer;
+
+    sim_topology_distances(i, dist);
+    if (node->data != NULL) {
+      missing += sim_node_route_errors(i, dist, &node_longer);
+      longer += node_longer;
+    } else {
+      missing += node->reachable - 1;
+    }
+
+    tx_bytes += node->tx_bytes;
+    tx_packets += node->tx_packets;
+    rx_bytes += node->rx_bytes;
+    rx_packets += node->rx_packets;
+    lost += node->lost_packets;
+    mpr_runs += node->calc.mpr_runs;
+    mpr_nsec += node->calc.mpr_nsec;
+    spf_runs += node->calc.spf_runs;
+    spf_nsec += node->calc.spf_nsec;
+    step_nsec += node->step_nsec;
+    heap += node->heap_bytes;
+    if (node->calc.spf_nsec > max_spf_nsec) {
+      max_spf_nsec = node->calc.spf_nsec;
+    }
+    if (node->heap_bytes > max_heap) {
+      max_heap = node->heap_bytes;
+    }
+
+    if (verbose) {
+      struct ipaddr_str buf;
+
+      printf("%-15s %5d %6u %8u %10llu %8u %10llu %6u %9llu %6u %9llu %8lld\n", olsr_ip_to_string(&buf, &node->addr),
+             node->nbr_count, node->routes, node->tx_packets, (unsigned long long)node->tx_bytes, node->rx_packets,
+             (unsigned long long)node->rx_bytes, node->calc.mpr_runs, (unsigned long long)(node->calc.mpr_nsec / 1000),
+             node->calc.spf_runs, (unsigned long long)(node->calc.spf_nsec / 1000), (long long)(node->heap_bytes / 1024));
+    }
+  }
+  free(dist);
+
+  printf("olsr_sim %s: %d nodes, %s topology, %d links, %d partition%s\n", OLSR_SIM_VERSION, sim.node_count, topology, links,
+         partitions, partitions == 1 ? "" : "s");
+  printf("links: %u%% loss, %u ms delay, %u ms jitter, lq level %d\n", sim.model.loss, sim.model.delay, sim.model.jitter,
+         sim.lq_level);
+  sim_print_settings();
+  printf("simulated %.1f s in %.2f s, %llu events (%.0f events/s)\n", sim.now / 1000.0, wall,
+         (unsigned long long)sim.events_run, wall > 0 ? sim.events_run / wall : 0.0);
+
+  if (sim.first_converged == 0) {
+    printf("convergence: not converged, %u of %d nodes have all routes\n", sim.converged_nodes, sim.node_count);
+  } else if (sim.converged_nodes == (unsigned int)sim.node_count) {
+    printf("convergence: all routes after %.3f s, stable since %.3f s\n", sim.first_converged / 1000.0, sim.last_converged / 1000.0);
+  } else {
+    printf("convergence: all routes after %.3f s, lost again (%u of %d nodes have all routes)\n", sim.first_converged / 1000.0,
+           sim.converged_nodes, sim.node_count);
+  }
+  printf("routes: %d missing, %d longer than the shortest path\n", missing, longer);
+  printf("traffic per node: tx %.1f packets %.0f bytes, rx %.1f packets %.0f bytes, %.1f lost\n", tx_packets / n, tx_bytes / n,
+         rx_packets / n, rx_bytes / n, lost / n);
+  printf("cpu per node: %.3f ms total, mpr %.1f runs %.3f ms, spf %.1f runs %.3f ms (max %.3f ms)\n", step_nsec / n / 1e6,
+         mpr_runs / n, mpr_nsec / n / 1e6, spf_runs / n, spf_nsec / n / 1e6, max_spf_nsec / 1e6);
+  if (sim.measure_heap) {
+    printf("memory per node: %zu KB state, %.1f KB heap (max %.1f KB)\n", sim_segment_size() / 1024, heap / n / 1024,
+           max_heap / 1024.0);
+  } else {
+    printf("memory per node: %zu KB state, heap not measured\n", sim_segment_size() / 1024);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  const char *topology = "grid", *replay = NULL, *record = NULL, *addr = NULL;
+  union olsr_ip_addr replay_addr;
+  struct sim_pcap pcap;
+  double range = 0, wall;
+  unsigned int duration = 60;
+  uint32_t seed = 1;
+  bool verbose = false;
+  int count = 100, links, partitions, i, opt;
+
+  sim.model.delay = 5;
+  sim.model.jitter = 2;
+  sim.ip_version = AF_INET;
+  sim.lq_level = -1;
+  sim.spf_mode = DEF_SPF_MODE;
+  sim.mpr_mode = DEF_MPR_MODE;
+  sim.tc_delta_refresh = DEF_TC_DELTA_REFRESH;
+
+  while ((opt = getopt(argc, argv, "n:t:r:l:d:j:T:s:q:S:M:D:f:mvw:p:a:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      count = atoi(optarg);
+      break;
+    case 't':
+      topology = optarg;
+      break;
+    case 'r':
+      range = atof(optarg);
+      break;
+    case 'l':
+      sim.model.loss = (unsigned int)atoi(optarg);
+      break;
+    case 'd':
+      sim.model.delay = (unsigned int)atoi(optarg);
+      break;
+    case 'j':
+      sim.model.jitter = (unsigned int)atoi(optarg);
+      break;
+    case 'T':
+      duration = (unsigned int)atoi(optarg);
+      break;
+    case 's':
+      seed = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'q':
+      sim.lq_level = atoi(optarg);
+      break;
+    case 'S':
+      sim.spf_mode = sim_parse_mode(optarg, SPF_MODE_TXT, SPFM_CNT);
+      break;
+    case 'M':
+      sim.mpr_mode = sim_parse_mode(optarg, MPR_MODE_TXT, MPRM_CNT);
+      break;
+    case 'D':
+      sim.tc_delta_refresh = atoi(optarg);
+      break;
+    case 'f':
+      if (sim_parse_fish(optarg) < 0) {
+        fprintf(stderr, "Bad fish eye TTL sequence %s, it must contain %d\n", optarg, MAX_TTL);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'm':
+      sim.measure_heap = true;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    case 'w':
+      record = optarg;
+      break;
+    case 'p':
+      replay = optarg;
+      break;
+    case 'a':
+      addr = optarg;
+      break;
+    case 'h':
+      usage();
+      return EXIT_SUCCESS;
+    default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (count < 2 || count > 0xffff || sim.model.loss > 100 || duration == 0 || duration > 86400 || sim.lq_level < -1
+      || sim.lq_level > 2 || sim.spf_mode < 0 || sim.mpr_mode < 0 || sim.tc_delta_refresh < 0 || sim.tc_delta_refresh > 255
+      || (replay != NULL && (addr == NULL || record != NULL))) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  if (replay != NULL) {
+    memset(&replay_addr, 0, sizeof(replay_addr));
+    if (inet_pton(AF_INET, addr, &replay_addr.v4) == 1) {
+      sim.ip_version = AF_INET;
+    } else if (inet_pton(AF_INET6, addr, &replay_addr.v6) == 1) {
+      sim.ip_version = AF_INET6;
+    } else {
+      fprintf(stderr, "Invalid address %s\n", addr);
+      return EXIT_FAILURE;
+    }
+    srandom(seed);
+    return sim_replay(replay, &replay_addr);
+  }
+
+  if (sim.lq_level < 0) {
+    sim.lq_level = 2;
+  }
+  if (record != NULL) {
+    if (sim_pcap_create(&pcap, record) < 0) {
+      return EXIT_FAILURE;
+    }
+    sim.record = &pcap;
+  }
+
+  sim_segment_check();
+
+  if (strcmp(topology, "grid") == 0) {
+    links = sim_topology_grid(count, 0);
+  } else if (strcmp(topology, "line") == 0) {
+    links = sim_topology_line(count, false);
+  } else if (strcmp(topology, "ring") == 0) {
+    links = sim_topology_line(count, true);
+  } else if (strcmp(topology, "geo") == 0) {
+    if (range <= 0) {
+      range = sqrt(8.0 / (M_PI * count));
+    }
+    links = sim_topology_geometric(count, range, seed);
+  } else {
+    usage();
+    return EXIT_FAILURE;
+  }
+  partitions = sim_topology_partitions();
+
+  /* the daemons draw their jitter from random() */
+  srandom(seed);
+  sim_random_seed(seed);
+
+  /* the nodes boot within the first second */
+  for (i = 0; i < count; i++) {
+    sim.nodes[i].timer_due = sim_random() % 1000;
+    sim_event_push(sim.nodes[i].timer_due, i, NULL);
+  }
+
+  wall = sim_wall_time();
+  while (sim.event_count > 0 && sim.events[0].time <= duration * 1000) {
+    sim_run_events();
+  }
+  sim.now = duration * 1000;
+  wall = sim_wall_time() - wall;
+
+  if (sim.record != NULL) {
+    sim_pcap_close(sim.record);
+  }
+
+  sim_report(topology, links, partitions, wall, verbose);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,498 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Topology, link model and event queue of the simulated network
+ */
+
+#include "olsr_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct sim_edge {
+  int a, b;
+};
+
+static struct sim_edge *sim_edges;
+static int sim_edge_count;
+static int sim_edge_size;
+
+static uint32_t sim_rand_state = 1;
+
+/**
+ * Seeds the random generator of the network model. The daemons use
+ * random(), the network has its own generator so the packet losses do
+ * not depend on how often the daemons draw numbers.
+ */
+void
+sim_random_seed(uint32_t seed)
+{
+  sim_rand_state = seed ? seed : 1;
+}
+
+/* xorshift32 */
+uint32_t
+sim_random(void)
+{
+  uint32_t x = sim_rand_state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sim_rand_state = x;
+  return x;
+}
+
+void *
+sim_alloc(size_t size)
+{
+  void *ptr = calloc(1, size);
+
+  if (ptr == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  return ptr;
+}
+
+static void
+sim_add_edge(int a, int b)
+{
+  if (sim_edge_count == sim_edge_size) {
+    sim_edge_size = sim_edge_size ? sim_edge_size * 2 : 256;
+    sim_edges = realloc(sim_edges, sim_edge_size * sizeof(*sim_edges));
+    if (sim_edges == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  sim_edges[sim_edge_count].a = a;
+  sim_edges[sim_edge_count].b = b;
+  sim_edge_count++;
+}
+
+/* creates the nodes with addresses 10.0.0.1 upwards and their neighbour lists from the edges */
+static int
+sim_topology_build(int count)
+{
+  int i, links = 0;
+
+  sim.node_count = count;
+  sim.nodes = sim_alloc(count * sizeof(*sim.nodes));
+  for (i = 0; i < count; i++) {
+    sim.nodes[i].addr.v4.s_addr = htonl(0x0a000001 + (uint32_t)i);
+  }
+
+  for (i = 0; i < sim_edge_count; i++) {
+    sim.nodes[sim_edges[i].a].nbr_count++;
+    sim.nodes[sim_edges[i].b].nbr_count++;
+  }
+  for (i = 0; i < count; i++) {
+    sim.nodes[i].nbrs = sim_alloc((sim.nodes[i].nbr_count + 1) * sizeof(int));
+    sim.nodes[i].nbr_count = 0;
+  }
+  for (i = 0; i < sim_edge_count; i++) {
+    struct sim_node *a = &sim.nodes[sim_edges[i].a];
+    struct sim_node *b = &sim.nodes[sim_edges[i].b];
+
+    a->nbrs[a->nbr_count++] = sim_edges[i].b;
+    b->nbrs[b->nbr_count++] = sim_edges[i].a;
+    links++;
+  }
+
+  free(sim_edges);
+  sim_edges = NULL;
+  sim_edge_count = sim_edge_size = 0;
+  return links;
+}
+
+/**
+ * Nodes on a square grid, each connected to the nodes left, right,
+ * above and below of it.
+ *
+ * @param count number of nodes
+ * @param width nodes per row, 0 for a square
+ * @return number of links
+ */
+int
+sim_topology_grid(int count, int width)
+{
+  int i;
+
+  if (width <= 0) {
+    for (width = 1; width * width < count; width++);
+  }
+
+  for (i = 0; i < count; i++) {
+    if ((i + 1) % width != 0 && i + 1 < count) {
+      sim_add_edge(i, i + 1);
+    }
+    if (i + width < count) {
+      sim_add_edge(i, i + width);
+    }
+  }
+  return sim_topology_build(count);
+}
+
+/**
+ * Nodes in a chain, the longest paths a topology of this size can have.
+ *
+ * @param count number of nodes
+ * @param ring true to connect the last node with the first one
+ * @return number of links
+ */
+int
+sim_topology_line(int count, bool ring)
+{
+  int i;
+
+  for (i = 0; i + 1 < count; i++) {
+    sim_add_edge(i, i + 1);
+  }
+  if (ring && count > 2) {
+    sim_add_edge(count - 1, 0);
+  }
+  return sim_topology_build(count);
+}
+
+/**
+ * Nodes at random positions in the unit square, connected when their
+ * distance is at most the radio range.
+ *
+ * @param count number of nodes
+ * @param range radio range
+ * @param seed seed for the positions
+ * @return number of links
+ */
+int
+sim_topology_geometric(int count, double range, uint32_t seed)
+{
+  double *x, *y;
+  int i, j;
+
+  x = sim_alloc(count * sizeof(double));
+  y = sim_alloc(count * sizeof(double));
+
+  sim_random_seed(seed);
+  for (i = 0; i < count; i++) {
+    uint32_t r = sim_random();
+
+    x[i] = r / 4294967296.0;
+    r = sim_random();
+    y[i] = r / 4294967296.0;
+  }
+
+  for (i = 0; i < count; i++) {
+    for (j = i + 1; j < count; j++) {
+      double dx = x[i] - x[j], dy = y[i] - y[j];
+
+      if (dx * dx + dy * dy <= range * range) {
+        sim_add_edge(i, j);
+      }
+    }
+  }
+
+  free(x);
+  free(y);
+  return sim_topology_build(count);
+}
+
+/**
+ * Breadth first search from a node.
+ *
+ * @param src index of the node
+ * @param dist array of node_count hop counts, -1 for unreachable nodes
+ */
+void
+sim_topology_distances(int src, int *dist)
+{
+  int *queue = sim_alloc(sim.node_count * sizeof(int));
+  int head = 0, tail = 0, i;
+
+  for (i = 0; i < sim.node_count; i++) {
+    dist[i] = -1;
+  }
+
+  dist[src] = 0;
+  queue[tail++] = src;
+  while (head < tail) {
+    struct sim_node *node = &sim.nodes[queue[head]];
+
+    for (i = 0; i < node->nbr_count; i++) {
+      if (dist[node->nbrs[i]] < 0) {
+        dist[node->nbrs[i]] = dist[queue[head]] + 1;
+        queue[tail++] = node->nbrs[i];
+      }
+    }
+    head++;
+  }
+  free(queue);
+}
+
+/**
+ * Sets the number of reachable nodes for every node.
+ *
+ * @return number of partitions
+ */
+int
+sim_topology_partitions(void)
+{
+  int *dist = sim_alloc(sim.node_count * sizeof(int));
+  int *done = sim_alloc(sim.node_count * sizeof(int));
+  int i, j, partitions = 0;
+
+  for (i = 0; i < sim.node_count; i++) {
+    int size = 0;
+
+    if (done[i]) {
+      continue;
+    }
+    partitions++;
+
+    sim_topology_distances(i, dist);
+    for (j = 0; j < sim.node_count; j++) {
+      if (dist[j] >= 0) {
+        size++;
+      }
+    }
+    for (j = 0; j < sim.node_count; j++) {
+      if (dist[j] >= 0) {
+        sim.nodes[j].reachable = size;
+        done[j] = 1;
+      }
+    }
+  }
+
+  free(dist);
+  free(done);
+  return partitions;
+}
+
+/**
+ * Copies a packet for the event queue, the caller sets the references.
+ *
+ * @param src address of the sender
+ * @param data packet
+ * @param len length of the packet
+ * @return the packet
+ */
+struct sim_packet *
+sim_packet_alloc(const union olsr_ip_addr *src, const uint8_t *data, int len)
+{
+  struct sim_packet *pkt = sim_alloc(sizeof(*pkt) + len);
+
+  pkt->from = -1;
+  pkt->src = *src;
+  pkt->len = len;
+  memcpy(pkt->data, data, len);
+  return pkt;
+}
+
+/**
+ * Hands a packet to all neighbours of a node. Every link loses the
+ * packet with the configured probability, otherwise it arrives after
+ * the delay plus a random jitter.
+ *
+ * @param from index of the sending node
+ * @param data packet
+ * @param len length of the packet
+ */
+void
+sim_send(int from, const uint8_t *data, int len)
+{
+  struct sim_node *node = &sim.nodes[from];
+  struct sim_packet *pkt;
+  int i;
+
+  node->tx_packets++;
+  node->tx_bytes += (uint64_t)len;
+
+  if (from == 0 && sim.record != NULL) {
+    sim_pcap_write(sim.record, sim.now, &node->addr, data, len);
+  }
+
+  pkt = sim_packet_alloc(&node->addr, data, len);
+  pkt->from = from;
+
+  for (i = 0; i < node->nbr_count; i++) {
+    uint32_t delay;
+
+    if (sim.model.loss > 0 && sim_random() % 100 < sim.model.loss) {
+      node->lost_packets++;
+      continue;
+    }
+
+    delay = sim.model.delay;
+    if (sim.model.jitter > 0) {
+      delay += sim_random() % (sim.model.jitter + 1);
+    }
+    if (delay == 0) {
+      /* keep the receiver from answering within the same millisecond */
+      delay = 1;
+    }
+
+    pkt->refs++;
+    sim_event_push(sim.now + delay, node->nbrs[i], pkt);
+  }
+
+  if (pkt->refs == 0) {
+    free(pkt);
+  }
+}
+
+static bool
+sim_event_before(const struct sim_event *a, const struct sim_event *b)
+{
+  if (a->time != b->time) {
+    return (int32_t)(a->time - b->time) < 0;
+  }
+  return (int32_t)(a->seq - b->seq) < 0;
+}
+
+/**
+ * Queues an event.
+ *
+ * @param time when the event happens
+ * @param node index of the node
+ * @param pkt received packet, NULL for the timers of the node
+ */
+void
+sim_event_push(uint32_t time, int node, struct sim_packet *pkt)
+{
+  struct sim_event ev;
+  unsigned int i;
+
+  if (sim.event_count == sim.event_size) {
+    sim.event_size = sim.event_size ? sim.event_size * 2 : 1024;
+    sim.events = realloc(sim.events, sim.event_size * sizeof(*sim.events));
+    if (sim.events == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  ev.time = time;
+  ev.seq = sim.event_seq++;
+  ev.node = node;
+  ev.pkt = pkt;
+
+  /* sift up */
+  i = sim.event_count++;
+  while (i > 0) {
+    unsigned int parent = (i - 1) / 2;
+
+    if (!sim_event_before(&ev, &sim.events[parent])) {
+      break;
+    }
+    sim.events[i] = sim.events[parent];
+    i = parent;
+  }
+  sim.events[i] = ev;
+}
+
+/**
+ * Looks at the next event without removing it.
+ *
+ * @param ev pointer to store the event
+ * @return false if the queue is empty
+ */
+bool
+sim_event_peek(struct sim_event *ev)
+{
+  if (sim.event_count == 0) {
+    return false;
+  }
+  *ev = sim.events[0];
+  return true;
+}
+
+/**
+ * Removes the next event from the queue.
+ *
+ * @param ev pointer to store the event
+ * @return false if the queue is empty
+ */
+bool
+sim_event_pop(struct sim_event *ev)
+{
+  struct sim_event last;
+  unsigned int i = 0;
+
+  if (sim.event_count == 0) {
+    return false;
+  }
+  *ev = sim.events[0];
+
+  /* sift down */
+  last = sim.events[--sim.event_count];
+  for (;;) {
+    unsigned int child = 2 * i + 1;
+
+    if (child >= sim.event_count) {
+      break;
+    }
+    if (child + 1 < sim.event_count && sim_event_before(&sim.events[child + 1], &sim.events[child])) {
+      child++;
+    }
+    if (!sim_event_before(&sim.events[child], &last)) {
+      break;
+    }
+    sim.events[i] = sim.events[child];
+    i = child;
+  }
+  if (sim.event_count > 0) {
+    sim.events[i] = last;
+  }
+  return true;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,580 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+/*
+ * Running the daemon code as one of the virtual nodes
+ */
+
+#include "olsr_sim.h"
+
+#include "defs.h"
+#include "olsr.h"
+#include "olsr_cfg.h"
+#include "olsr_cookie.h"
+#include "scheduler.h"
+#include "interfaces.h"
+#include "net_olsr.h"
+#include "parser.h"
+#include "generate_msg.h"
+#include "lq_packet.h"
+#include "tc_set.h"
+#include "routing_table.h"
+#include "process_routes.h"
+#include "build_msg.h"
+#include "process_package.h"
+#include "mid_set.h"
+#include "hna_set.h"
+#include "olsr_random.h"
+#include "ipcalc.h"
+#include "cfgparser/olsrd_conf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif /* __GLIBC__ */
+
+/* node whose state is in the daemon segment, -1 for the pristine state */
+static int sim_current = -1;
+
+/* contents of the segment before any node was set up */
+static uint8_t *sim_pristine_data;
+static uint8_t *sim_pristine_bss;
+
+/* packets sent by the running node, handed to the network after the step */
+static struct {
+  int len;
+  uint8_t data[SIM_MAX_PACKET];
+} sim_outbox[SIM_OUTBOX_SIZE];
+static unsigned int sim_outbox_count;
+
+/* received packets are parsed in place, so they need a private copy */
+static uint32_t sim_inbuf[SIM_MAX_PACKET / sizeof(uint32_t)];
+
+static size_t
+sim_data_size(void)
+{
+  return (size_t)(sim_data_end - sim_data_begin);
+}
+
+static size_t
+sim_bss_size(void)
+{
+  return (size_t)(sim_bss_end - sim_bss_begin);
+}
+
+size_t
+sim_segment_size(void)
+{
+  return sim_data_size() + sim_bss_size();
+}
+
+static bool
+sim_in_segment(const void *ptr)
+{
+  const char *p = ptr;
+
+  return (p >= sim_data_begin && p < sim_data_end) || (p >= sim_bss_begin && p < sim_bss_end);
+}
+
+/**
+ * Makes sure the linker placed the daemon state between the markers
+ * and stores the pristine contents of the segment. A daemon variable
+ * outside of the markers would be shared by all nodes, a variable of
+ * the simulator inside of them would be swapped with the nodes.
+ */
+void
+sim_segment_check(void)
+{
+  const void *daemon_vars[] = { &now_times, &olsr_cnf, &ifnet, &routingtree, &tc_myself,
+    &net_output_sink, &olsr_calc_stats, &changes_topology, &def_timer_ci };
+  const void *sim_vars[] = { &sim, &sim_current, &sim_outbox, &sim_inbuf };
+  unsigned int i;
+
+  if (sim_data_end - sim_data_begin <= 0 || sim_bss_end - sim_bss_begin <= 0) {
+    fprintf(stderr, "Segment markers are out of order, check the link order\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < ARRAYSIZE(daemon_vars); i++) {
+    if (!sim_in_segment(daemon_vars[i])) {
+      fprintf(stderr, "Daemon variable %u is outside the node segment (build with -fno-common)\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < ARRAYSIZE(sim_vars); i++) {
+    if (sim_in_segment(sim_vars[i])) {
+      fprintf(stderr, "Simulator variable %u is inside the node segment\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  sim_pristine_data = malloc(sim_data_size());
+  sim_pristine_bss = malloc(sim_bss_size());
+  if (sim_pristine_data == NULL || sim_pristine_bss == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(sim_pristine_data, sim_data_begin, sim_data_size());
+  memcpy(sim_pristine_bss, sim_bss_begin, sim_bss_size());
+}
+
+/**
+ * Swaps the state of a node into the daemon segment.
+ *
+ * @param idx index of the node, -1 for the state of a fresh daemon
+ */
+void
+sim_node_enter(int idx)
+{
+  struct sim_node *node;
+
+  if (idx == sim_current) {
+    return;
+  }
+
+  if (sim_current >= 0) {
+    node = &sim.nodes[sim_current];
+    memcpy(node->data, sim_data_begin, sim_data_size());
+    memcpy(node->bss, sim_bss_begin, sim_bss_size());
+  }
+
+  if (idx >= 0) {
+    node = &sim.nodes[idx];
+    memcpy(sim_data_begin, node->data, sim_data_size());
+    memcpy(sim_bss_begin, node->bss, sim_bss_size());
+  } else {
+    memcpy(sim_data_begin, sim_pristine_data, sim_data_size());
+    memcpy(sim_bss_begin, sim_pristine_bss, sim_bss_size());
+  }
+  sim_current = idx;
+}
+
+/* mallinfo2() walks the free lists of the allocator, so it is only used on request */
+static int64_t
+sim_heap_used(void)
+{
+#if defined __GLIBC__ && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 mi;
+
+  if (!sim.measure_heap) {
+    return 0;
+  }
+  mi = mallinfo2();
+
+  return (int64_t)(mi.uordblks + mi.hblkhd);
+#else /* __GLIBC__ */
+  return 0;
+#endif /* __GLIBC__ */
+}
+
+static uint64_t
+sim_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* time of the route calculations so far */
+static uint64_t
+sim_calc_nsec(void)
+{
+  return olsr_calc_stats.mpr_nsec + olsr_calc_stats.spf_nsec;
+}
+
+/* the routes of a node only exist in its tables */
+static int
+sim_route_dummy(const struct rt_entry *rt __attribute__ ((unused)))
+{
+  return 0;
+}
+
+static void
+sim_sink(struct interface_olsr *ifp __attribute__ ((unused)), const uint8_t *data, int len)
+{
+  if (sim_outbox_count == SIM_OUTBOX_SIZE || len > SIM_MAX_PACKET) {
+    sim.nodes[sim_current].lost_packets++;
+    return;
+  }
+  sim_outbox[sim_outbox_count].len = len;
+  memcpy(sim_outbox[sim_outbox_count].data, data, len);
+  sim_outbox_count++;
+}
+
+/*
+ * Sets up the emulated interface the way add_hemu_if() does, without
+ * the connection to olsr_switch.
+ */
+static struct interface_olsr *
+sim_add_if(struct olsr_if *iface)
+{
+  struct interface_olsr *ifp;
+
+  ifp = olsr_malloc(sizeof(struct interface_olsr), "sim interface");
+  memset(ifp, 0, sizeof(struct interface_olsr));
+
+  ifp->olsr_if = iface;
+  iface->configured = true;
+  iface->interf = ifp;
+
+  ifp->is_hcif = true;
+  ifp->int_name = iface->name;
+  ifp->int_metric = 0;
+  ifp->olsr_socket = -1;
+  ifp->send_socket = -1;
+  ifp->ip_addr = iface->hemu_ip;
+  ifp->int_mtu = OLSR_DEFAULT_MTU - UDP_IPV4_HDRSIZE;
+
+  ifp->int_next = ifnet;
+  ifnet = ifp;
+
+  net_add_buffer(ifp);
+
+  ifp->hello_gen_timer =
+    olsr_start_timer(iface->cnf->hello_params.emission_interval * MSEC_PER_SEC, HELLO_JITTER, OLSR_TIMER_PERIODIC,
+                     olsr_cnf->lq_level == 0 ? &generate_hello : &olsr_output_lq_hello, ifp, hello_gen_timer_cookie);
+  ifp->tc_gen_timer =
+    olsr_start_timer(iface->cnf->tc_params.emission_interval * MSEC_PER_SEC, TC_JITTER, OLSR_TIMER_PERIODIC,
+                     olsr_cnf->lq_level == 0 ? &generate_tc : &olsr_output_lq_tc, ifp, tc_gen_timer_cookie);
+  ifp->mid_gen_timer =
+    olsr_start_timer(iface->cnf->mid_params.emission_interval * MSEC_PER_SEC, MID_JITTER, OLSR_TIMER_PERIODIC, &generate_mid, ifp,
+                     mid_gen_timer_cookie);
+  ifp->hna_gen_timer =
+    olsr_start_timer(iface->cnf->hna_params.emission_interval * MSEC_PER_SEC, HNA_JITTER, OLSR_TIMER_PERIODIC, &generate_hna, ifp,
+                     hna_gen_timer_cookie);
+
+  if (olsr_cnf->max_tc_vtime < iface->cnf->tc_params.emission_interval)
+    olsr_cnf->max_tc_vtime = iface->cnf->tc_params.emission_interval;
+
+  ifp->hello_etime = (olsr_reltime) (iface->cnf->hello_params.emission_interval * MSEC_PER_SEC);
+  ifp->valtimes.hello = reltime_to_me(iface->cnf->hello_params.validity_time * MSEC_PER_SEC);
+  ifp->valtimes.tc = reltime_to_me(iface->cnf->tc_params.validity_time * MSEC_PER_SEC);
+  ifp->valtimes.mid = reltime_to_me(iface->cnf->mid_params.validity_time * MSEC_PER_SEC);
+  ifp->valtimes.hna = reltime_to_me(iface->cnf->hna_params.validity_time * MSEC_PER_SEC);
+  ifp->valtimes.hna_reltime = me_to_reltime(ifp->valtimes.hna);
+
+  ifp->mode = iface->cnf->mode;
+
+  return ifp;
+}
+
+/* queues the next timer event of the running node and hands its packets to the network */
+static void
+sim_node_finish(int idx, bool timers, uint32_t deadline)
+{
+  struct sim_node *node = &sim.nodes[idx];
+  unsigned int i;
+
+  for (i = 0; i < sim_outbox_count; i++) {
+    sim_send(idx, sim_outbox[i].data, sim_outbox[i].len);
+  }
+  sim_outbox_count = 0;
+
+  node->routes = routingtree.count;
+  node->calc = olsr_calc_stats;
+
+  if (timers) {
+    if (TIME_DUE(deadline) <= 0) {
+      deadline = sim.now + 1;
+    }
+    if (deadline != node->timer_due) {
+      node->timer_due = deadline;
+      sim_event_push(deadline, idx, NULL);
+    }
+  }
+}
+
+/**
+ * Starts the daemon of a node.
+ *
+ * @param idx index of the node, its address must be set
+ * @param now start time in milliseconds
+ */
+void
+sim_node_init(int idx, uint32_t now)
+{
+  struct sim_node *node = &sim.nodes[idx];
+  struct olsr_if *iface;
+  uint32_t deadline;
+  int64_t heap;
+  bool timers;
+
+  node->data = malloc(sim_data_size());
+  node->bss = malloc(sim_bss_size());
+  if (node->data == NULL || node->bss == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+
+  sim_node_enter(-1);
+  heap = sim_heap_used();
+
+  olsr_random_repeatable = true;
+
+  olsr_cnf = olsrd_get_default_cnf(strdup("olsr_sim"));
+  olsr_cnf->ip_version = sim.ip_version;
+  if (sim.ip_version == AF_INET6) {
+    olsr_cnf->ipsize = sizeof(struct in6_addr);
+    olsr_cnf->maxplen = 128;
+  } else {
+    olsr_cnf->ipsize = sizeof(struct in_addr);
+    olsr_cnf->maxplen = 32;
+  }
+  olsr_cnf->host_emul = true;
+  olsr_cnf->debug_level = 0;
+  olsr_cnf->lq_level = sim.lq_level;
+  olsr_cnf->spf_mode = sim.spf_mode;
+  olsr_cnf->mpr_mode = sim.mpr_mode;
+  olsr_cnf->tc_delta_refresh = sim.tc_delta_refresh;
+  if (sim.fish_set) {
+    olsr_cnf->lq_fish = sim.lq_fish;
+    memcpy(olsr_cnf->lq_fish_ttl, sim.lq_fish_ttl, sizeof(sim.lq_fish_ttl));
+    olsr_cnf->lq_fish_ttl_cnt = sim.lq_fish_ttl_cnt;
+  }
+  olsr_cnf->main_addr = node->addr;
+  olsr_cnf->unicast_src_ip = node->addr;
+
+  /*
+   * olsrd_sanity_check_cnf() would print the interface configuration of
+   * every node, the defaults are applied here instead
+   */
+  olsr_cnf->interface_defaults = get_default_if_config();
+  iface = olsr_create_olsrif("sim0", 1);
+  if (olsr_cnf->interface_defaults == NULL || iface == NULL) {
+    fprintf(stderr, "Cannot configure the interface of node %d\n", idx);
+    exit(EXIT_FAILURE);
+  }
+  iface->hemu_ip = node->addr;
+  *iface->cnf = *olsr_cnf->interface_defaults;
+
+  /* same order as in main() */
+  olsr_init_timers();
+  now_times = now;
+  def_timer_ci = olsr_alloc_cookie("Default Timer Cookie", OLSR_COOKIE_TYPE_TIMER);
+  hello_gen_timer_cookie = olsr_alloc_cookie("Hello Generation", OLSR_COOKIE_TYPE_TIMER);
+  tc_gen_timer_cookie = olsr_alloc_cookie("TC Generation", OLSR_COOKIE_TYPE_TIMER);
+  mid_gen_timer_cookie = olsr_alloc_cookie("MID Generation", OLSR_COOKIE_TYPE_TIMER);
+  hna_gen_timer_cookie = olsr_alloc_cookie("HNA Generation", OLSR_COOKIE_TYPE_TIMER);
+
+  set_empty_tc_timer(GET_TIMESTAMP(0));
+  olsr_init_parser();
+  olsr_init_export_route();
+  init_msg_seqno();
+  olsr_init_willingness();
+  init_net();
+
+  node->ifp = sim_add_if(iface);
+
+  olsr_init_tables();
+
+  olsr_addroute_function = sim_route_dummy;
+  olsr_addroute6_function = sim_route_dummy;
+  olsr_delroute_function = sim_route_dummy;
+  olsr_delroute6_function = sim_route_dummy;
+  net_output_sink = sim_sink;
+
+  /* the swap below stores the node state, the first step runs as the node */
+  sim_current = idx;
+
+  timers = olsr_scheduler_step(&deadline);
+  node->heap_bytes += sim_heap_used() - heap;
+  sim_node_finish(idx, timers, deadline);
+}
+
+/**
+ * Lets a node process the packets it received and the timers that
+ * expired at the current time.
+ *
+ * @param idx index of the node
+ * @param ev array of events for the node
+ * @param count number of events
+ */
+void
+sim_node_step(int idx, struct sim_event *ev, unsigned int count)
+{
+  struct sim_node *node = &sim.nodes[idx];
+  unsigned int i;
+  uint32_t deadline;
+  uint64_t start, calc;
+  int64_t heap;
+  bool timers;
+
+  sim_node_enter(idx);
+  now_times = sim.now;
+
+  heap = sim_heap_used();
+  start = sim_nsec();
+  calc = sim_calc_nsec();
+
+  for (i = 0; i < count; i++) {
+    struct sim_packet *pkt = ev[i].pkt;
+    union olsr_ip_addr from;
+
+    if (pkt == NULL) {
+      continue;
+    }
+
+    node->rx_packets++;
+    node->rx_bytes += (uint64_t)pkt->len;
+
+    if (idx == 0 && sim.record != NULL) {
+      sim_pcap_write(sim.record, sim.now, &pkt->src, pkt->data, pkt->len);
+    }
+
+    /* no plugins are loaded, so there are no preprocessors to run */
+    memcpy(sim_inbuf, pkt->data, pkt->len);
+    from = pkt->src;
+    parse_packet((struct olsr *)sim_inbuf, pkt->len, node->ifp, &from);
+  }
+  node->parse_nsec += sim_nsec() - start - (sim_calc_nsec() - calc);
+
+  timers = olsr_scheduler_step(&deadline);
+
+  node->steps++;
+  node->step_nsec += sim_nsec() - start;
+  node->heap_bytes += sim_heap_used() - heap;
+
+  sim_node_finish(idx, timers, deadline);
+}
+
+/* the message handlers of the daemon, see olsr_init_package_process() */
+static const struct {
+  parse_function *function;
+  uint32_t type;
+} sim_handlers[] = {
+  { &olsr_input_hello, HELLO_MESSAGE },
+  { &olsr_input_tc, TC_MESSAGE },
+  { &olsr_input_mid, MID_MESSAGE },
+  { &olsr_input_hna, HNA_MESSAGE },
+  { &olsr_input_hello, LQ_HELLO_MESSAGE },
+  { &olsr_input_tc, LQ_TC_MESSAGE },
+  { &olsr_input_tc_delta, LQ_TC_DELTA_MESSAGE },
+};
+
+/* accounts a message handler, without the route calculation the hello handler triggers */
+static bool
+sim_timed_handler(union olsr_message *m, struct interface_olsr *in_if, union olsr_ip_addr *from)
+{
+  uint8_t type = m->v4.olsr_msgtype;
+  struct sim_msg_stats *stats = &sim.msg_stats[type];
+  uint64_t start;
+  unsigned int i;
+  bool forward = false;
+
+  start = sim_nsec() - sim_calc_nsec();
+  for (i = 0; i < ARRAYSIZE(sim_handlers); i++) {
+    if (sim_handlers[i].type == type) {
+      forward = sim_handlers[i].function(m, in_if, from);
+      break;
+    }
+  }
+  stats->nsec += sim_nsec() - sim_calc_nsec() - start;
+  stats->handled++;
+
+  return forward;
+}
+
+/**
+ * Replaces the message handlers of a node with wrappers that account
+ * their time in sim.msg_stats.
+ *
+ * @param idx index of the node
+ */
+void
+sim_node_time_handlers(int idx)
+{
+  unsigned int i;
+
+  sim_node_enter(idx);
+
+  for (i = 0; i < ARRAYSIZE(sim_handlers); i++) {
+    if (olsr_parser_remove_function(sim_handlers[i].function, sim_handlers[i].type)) {
+      olsr_parser_add_function(&sim_timed_handler, sim_handlers[i].type);
+    }
+  }
+}
+
+/**
+ * Compares the routing table of a node with the shortest paths of the
+ * topology.
+ *
+ * @param idx index of the node
+ * @param dist hop counts from the node, -1 for unreachable nodes
+ * @param longer pointer to store the number of routes with more hops than necessary
+ * @return number of reachable nodes without a route
+ */
+int
+sim_node_route_errors(int idx, const int *dist, int *longer)
+{
+  int i, missing = 0;
+
+  sim_node_enter(idx);
+
+  *longer = 0;
+  for (i = 0; i < sim.node_count; i++) {
+    struct rt_entry *rt;
+
+    if (i == idx || dist[i] < 0) {
+      continue;
+    }
+    rt = olsr_lookup_routing_table(&sim.nodes[i].addr);
+    if (rt == NULL || rt->rt_best == NULL) {
+      missing++;
+    } else if ((int)rt->rt_best->rtp_metric.hops > dist[i]) {
+      (*longer)++;
+    }
+  }
+  return missing;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,242 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#ifndef _OLSR_SIM
+#define _OLSR_SIM
+
+#include "olsr_types.h"
+#include "olsr.h"
+
+#include <stdio.h>
+
+#define OLSR_SIM_VERSION "0.1"
+
+/* largest packet a virtual node can send */
+#define SIM_MAX_PACKET 1500
+
+/* packets a node may send during a single step */
+#define SIM_OUTBOX_SIZE 64
+
+/* UDP port of OLSR, a pcap only contributes the packets to or from it */
+#define SIM_OLSR_PORT 698
+
+/*
+ * All virtual nodes run in one process on the same daemon code. The
+ * daemon keeps its state in global variables, so every node owns a
+ * copy of the .data and .bss contents of the daemon objects, which is
+ * swapped in before the node runs. The daemon objects are linked
+ * between segment_begin.o and segment_end.o, whose markers delimit
+ * the memory to swap.
+ */
+extern char sim_data_begin[], sim_data_end[];
+extern char sim_bss_begin[], sim_bss_end[];
+
+/* loss and latency of the links */
+struct sim_model {
+  unsigned int loss;                   /* percent of packets lost per link */
+  unsigned int delay;                  /* ms from sending to reception */
+  unsigned int jitter;                 /* up to this many ms added to the delay */
+};
+
+struct sim_node {
+  union olsr_ip_addr addr;
+  struct interface_olsr *ifp;
+
+  /* saved daemon state while the node is not running */
+  uint8_t *data;
+  uint8_t *bss;
+
+  /* neighbours in the simulated topology */
+  int *nbrs;
+  int nbr_count;
+
+  /* nodes in the same partition of the topology, including this one */
+  int reachable;
+
+  /* time of the next timer, a queued event for another time is stale */
+  uint32_t timer_due;
+
+  /* state after the last step */
+  unsigned int routes;
+  bool converged;
+  struct olsr_calc_stats calc;
+
+  /* statistics */
+  uint64_t tx_bytes;
+  uint32_t tx_packets;
+  uint64_t rx_bytes;
+  uint32_t rx_packets;
+  uint32_t lost_packets;
+  uint32_t steps;
+  uint64_t step_nsec;
+  uint64_t parse_nsec;                 /* step_nsec in parse_packet(), without route calculations */
+  int64_t heap_bytes;
+};
+
+/* a packet on its way to the neighbours of the sender */
+struct sim_packet {
+  int refs;
+  int from;                            /* -1 for a packet of a pcap */
+  union olsr_ip_addr src;
+  int len;
+  uint8_t data[];
+};
+
+struct sim_event {
+  uint32_t time;
+  uint32_t seq;                        /* keeps events of the same time in order */
+  int node;
+  struct sim_packet *pkt;              /* NULL for a timer event */
+};
+
+/* messages of one type */
+struct sim_msg_stats {
+  uint32_t count;                      /* in the received packets */
+  uint64_t bytes;
+  uint32_t handled;                    /* passed to the handler of the type */
+  uint64_t nsec;                       /* spent in the handler */
+};
+
+/* a pcap file, either read or written */
+struct sim_pcap {
+  FILE *file;
+  bool swapped;                        /* written with the other byte order */
+  bool nsec;                           /* timestamps in nanoseconds */
+  uint32_t linktype;
+  uint32_t snaplen;
+  uint8_t *buf;
+};
+
+/* an OLSR packet of a pcap */
+struct sim_pcap_packet {
+  uint64_t usec;                       /* timestamp */
+  int family;                          /* AF_INET or AF_INET6, 0 for any other packet */
+  union olsr_ip_addr src;
+  const uint8_t *data;                 /* the OLSR packet in the UDP payload */
+  int len;
+};
+
+struct sim {
+  struct sim_node *nodes;
+  int node_count;
+  struct sim_model model;
+  int ip_version;
+  int lq_level;
+  int spf_mode;                        /* SPFM_*, passed to every node */
+  int mpr_mode;                        /* MPRM_* */
+  int tc_delta_refresh;
+  bool fish_set;                       /* the fish eye settings below replace the defaults */
+  uint8_t lq_fish;
+  uint8_t lq_fish_ttl[MAX_LQ_FISH_TTL];
+  int lq_fish_ttl_cnt;
+  bool measure_heap;                   /* account the heap usage of every step */
+  uint32_t now;
+
+  /* message handlers are timed if set, indexed by the message type */
+  struct sim_msg_stats *msg_stats;
+
+  /* the traffic of node 0 is written to it if set */
+  struct sim_pcap *record;
+
+  /* event queue, a binary heap ordered by time and sequence */
+  struct sim_event *events;
+  unsigned int event_count;
+  unsigned int event_size;
+  uint32_t event_seq;
+  uint64_t events_run;
+
+  unsigned int converged_nodes;
+  uint32_t first_converged;            /* 0 until all nodes had all routes */
+  uint32_t last_converged;             /* last time the network became converged */
+};
+
+extern struct sim sim;
+
+/* main.c */
+void sim_run_events(void);
+void sim_print_settings(void);
+
+/* node.c */
+void sim_node_init(int, uint32_t);
+void sim_node_step(int, struct sim_event *, unsigned int);
+void sim_node_time_handlers(int);
+void sim_node_enter(int);
+int sim_node_route_errors(int, const int *, int *);
+size_t sim_segment_size(void);
+void sim_segment_check(void);
+
+/* network.c */
+int sim_topology_grid(int, int);
+int sim_topology_line(int, bool);
+int sim_topology_geometric(int, double, uint32_t);
+void sim_topology_distances(int, int *);
+int sim_topology_partitions(void);
+void sim_send(int, const uint8_t *, int);
+void sim_event_push(uint32_t, int, struct sim_packet *);
+bool sim_event_pop(struct sim_event *);
+bool sim_event_peek(struct sim_event *);
+uint32_t sim_random(void);
+void sim_random_seed(uint32_t);
+void *sim_alloc(size_t);
+struct sim_packet *sim_packet_alloc(const union olsr_ip_addr *, const uint8_t *, int);
+
+/* pcap.c */
+int sim_pcap_open(struct sim_pcap *, const char *);
+int sim_pcap_next(struct sim_pcap *, struct sim_pcap_packet *);
+int sim_pcap_create(struct sim_pcap *, const char *);
+void sim_pcap_write(struct sim_pcap *, uint32_t, const union olsr_ip_addr *, const uint8_t *, int);
+void sim_pcap_close(struct sim_pcap *);
+
+/* replay.c */
+int sim_replay(const char *, const union olsr_ip_addr *);
+
+#endif /* _OLSR_SIM */
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
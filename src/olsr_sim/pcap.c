@@ -0,0 +1,410 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+/*
+ * Reading and writing the OLSR traffic of pcap files, as written by
+ * tcpdump -w. Only the classic format is supported, pcapng files can
+ * be converted with editcap -F pcap.
+ */
+
+#include "olsr_sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAPNG_MAGIC    0x0a0d0d0a
+
+#define PCAP_HDR_SIZE    24
+#define PCAP_REC_SIZE    16
+
+/* larger records are considered a corrupt file */
+#define PCAP_MAX_SNAPLEN 262144
+
+/* link types, see https://www.tcpdump.org/linktypes.html */
+#define LINKTYPE_NULL       0
+#define LINKTYPE_ETHERNET   1
+#define LINKTYPE_RAW        101
+#define LINKTYPE_LOOP       108
+#define LINKTYPE_LINUX_SLL  113
+#define LINKTYPE_IPV4       228
+#define LINKTYPE_IPV6       229
+#define LINKTYPE_LINUX_SLL2 276
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_IPV6 0x86dd
+
+#define IP_PROTO_UDP 17
+
+static uint16_t
+pcap_get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t
+pcap_get32(const struct sim_pcap *pcap, const uint8_t *p)
+{
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  if (pcap->swapped) {
+    v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+  }
+  return v;
+}
+
+/**
+ * Opens a pcap file for reading.
+ *
+ * @param pcap the file
+ * @param name path of the file
+ * @return 0 on success, -1 after printing an error
+ */
+int
+sim_pcap_open(struct sim_pcap *pcap, const char *name)
+{
+  uint8_t hdr[PCAP_HDR_SIZE];
+  uint32_t magic;
+
+  memset(pcap, 0, sizeof(*pcap));
+  pcap->file = fopen(name, "rb");
+  if (pcap->file == NULL) {
+    perror(name);
+    return -1;
+  }
+  if (fread(hdr, sizeof(hdr), 1, pcap->file) != 1) {
+    fprintf(stderr, "%s: not a pcap file\n", name);
+    sim_pcap_close(pcap);
+    return -1;
+  }
+
+  memcpy(&magic, hdr, sizeof(magic));
+  if (magic == PCAP_MAGIC_USEC || magic == PCAP_MAGIC_NSEC) {
+    pcap->nsec = magic == PCAP_MAGIC_NSEC;
+  } else {
+    pcap->swapped = true;
+    magic = pcap_get32(pcap, hdr);
+    if (magic != PCAP_MAGIC_USEC && magic != PCAP_MAGIC_NSEC) {
+      fprintf(stderr, "%s: %s\n", name, magic == PCAPNG_MAGIC ? "pcapng is not supported, convert it with editcap -F pcap"
+              : "not a pcap file");
+      sim_pcap_close(pcap);
+      return -1;
+    }
+    pcap->nsec = magic == PCAP_MAGIC_NSEC;
+  }
+
+  pcap->snaplen = pcap_get32(pcap, hdr + 16);
+  pcap->linktype = pcap_get32(pcap, hdr + 20) & 0xffff;
+  if (pcap->snaplen == 0 || pcap->snaplen > PCAP_MAX_SNAPLEN) {
+    pcap->snaplen = PCAP_MAX_SNAPLEN;
+  }
+
+  switch (pcap->linktype) {
+  case LINKTYPE_NULL:
+  case LINKTYPE_ETHERNET:
+  case LINKTYPE_RAW:
+  case LINKTYPE_LOOP:
+  case LINKTYPE_LINUX_SLL:
+  case LINKTYPE_IPV4:
+  case LINKTYPE_IPV6:
+  case LINKTYPE_LINUX_SLL2:
+    break;
+  default:
+    fprintf(stderr, "%s: link type %u is not supported\n", name, pcap->linktype);
+    sim_pcap_close(pcap);
+    return -1;
+  }
+
+  pcap->buf = malloc(pcap->snaplen);
+  if (pcap->buf == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  return 0;
+}
+
+/* finds the IP header behind the link layer header, returns its offset or -1 */
+static int
+pcap_ip_offset(const struct sim_pcap *pcap, const uint8_t *p, uint32_t len)
+{
+  uint32_t off;
+  uint16_t type;
+
+  switch (pcap->linktype) {
+  case LINKTYPE_NULL:
+  case LINKTYPE_LOOP:
+    /* the address family, the version of the IP header tells the same */
+    return 4;
+  case LINKTYPE_RAW:
+  case LINKTYPE_IPV4:
+  case LINKTYPE_IPV6:
+    return 0;
+  case LINKTYPE_LINUX_SLL:
+    return len >= 16 && (pcap_get16(p + 14) == ETHERTYPE_IPV4 || pcap_get16(p + 14) == ETHERTYPE_IPV6) ? 16 : -1;
+  case LINKTYPE_LINUX_SLL2:
+    return len >= 20 && (pcap_get16(p) == ETHERTYPE_IPV4 || pcap_get16(p) == ETHERTYPE_IPV6) ? 20 : -1;
+  default:
+    break;
+  }
+
+  /* ethernet, possibly with VLAN tags */
+  off = 12;
+  for (;;) {
+    if (len < off + 2) {
+      return -1;
+    }
+    type = pcap_get16(p + off);
+    if (type != ETHERTYPE_VLAN) {
+      break;
+    }
+    off += 4;
+  }
+  return type == ETHERTYPE_IPV4 || type == ETHERTYPE_IPV6 ? (int)off + 2 : -1;
+}
+
+/* looks for an OLSR packet in the captured frame */
+static void
+pcap_parse(const struct sim_pcap *pcap, struct sim_pcap_packet *pkt, const uint8_t *p, uint32_t len)
+{
+  int off = pcap_ip_offset(pcap, p, len);
+  uint32_t ip_len, udp_len;
+
+  pkt->family = 0;
+  if (off < 0 || len <= (uint32_t)off) {
+    return;
+  }
+  p += off;
+  len -= off;
+
+  if ((p[0] >> 4) == 4) {
+    uint32_t hlen = (p[0] & 0x0f) * 4;
+
+    if (len < 20 || hlen < 20 || len < hlen + 8 || p[9] != IP_PROTO_UDP) {
+      return;
+    }
+    /* fragments are dropped, the daemon never sends a packet larger than the MTU */
+    if ((pcap_get16(p + 6) & 0x3fff) != 0) {
+      return;
+    }
+    ip_len = pcap_get16(p + 2);
+    if (ip_len < hlen + 8) {
+      return;
+    }
+    if (ip_len < len) {
+      /* ethernet padding */
+      len = ip_len;
+    }
+    memset(&pkt->src, 0, sizeof(pkt->src));
+    memcpy(&pkt->src.v4, p + 12, sizeof(pkt->src.v4));
+    pkt->family = AF_INET;
+    p += hlen;
+    len -= hlen;
+  } else if ((p[0] >> 4) == 6) {
+    if (len < 48 || p[6] != IP_PROTO_UDP) {
+      return;
+    }
+    ip_len = 40 + pcap_get16(p + 4);
+    if (ip_len < 48) {
+      return;
+    }
+    if (ip_len < len) {
+      len = ip_len;
+    }
+    memcpy(&pkt->src.v6, p + 8, sizeof(pkt->src.v6));
+    pkt->family = AF_INET6;
+    p += 40;
+    len -= 40;
+  } else {
+    return;
+  }
+
+  udp_len = pcap_get16(p + 4);
+  if ((pcap_get16(p) != SIM_OLSR_PORT && pcap_get16(p + 2) != SIM_OLSR_PORT) || udp_len < 8 || udp_len > len) {
+    /* not OLSR or truncated by the snaplen */
+    pkt->family = 0;
+    return;
+  }
+  pkt->data = p + 8;
+  pkt->len = (int)udp_len - 8;
+}
+
+/**
+ * Reads the next packet of a pcap file.
+ *
+ * @param pcap the file
+ * @param pkt pointer to store the packet, its family is 0 if the
+ *   packet does not carry OLSR, the data is valid until the next call
+ * @return 1 for a packet, 0 at the end of the file, -1 after printing an error
+ */
+int
+sim_pcap_next(struct sim_pcap *pcap, struct sim_pcap_packet *pkt)
+{
+  uint8_t rec[PCAP_REC_SIZE];
+  uint32_t len, frac;
+
+  if (fread(rec, sizeof(rec), 1, pcap->file) != 1) {
+    return 0;
+  }
+  len = pcap_get32(pcap, rec + 8);
+  if (len > pcap->snaplen) {
+    fprintf(stderr, "Corrupt pcap record of %u bytes\n", len);
+    return -1;
+  }
+  if (fread(pcap->buf, 1, len, pcap->file) != len) {
+    /* a capture that was cut off */
+    return 0;
+  }
+
+  frac = pcap_get32(pcap, rec + 4);
+  pkt->usec = (uint64_t)pcap_get32(pcap, rec) * 1000000 + (pcap->nsec ? frac / 1000 : frac);
+  pcap_parse(pcap, pkt, pcap->buf, len);
+  return 1;
+}
+
+/**
+ * Creates a pcap file of raw IPv4 packets.
+ *
+ * @param pcap the file
+ * @param name path of the file
+ * @return 0 on success, -1 after printing an error
+ */
+int
+sim_pcap_create(struct sim_pcap *pcap, const char *name)
+{
+  uint32_t hdr[PCAP_HDR_SIZE / sizeof(uint32_t)];
+
+  memset(pcap, 0, sizeof(*pcap));
+  pcap->file = fopen(name, "wb");
+  if (pcap->file == NULL) {
+    perror(name);
+    return -1;
+  }
+  pcap->linktype = LINKTYPE_RAW;
+  pcap->snaplen = 65535;
+
+  /* version 2.4 in host byte order */
+  hdr[0] = PCAP_MAGIC_USEC;
+  hdr[1] = 2 | 4 << 16;
+  hdr[2] = 0;
+  hdr[3] = 0;
+  hdr[4] = pcap->snaplen;
+  hdr[5] = pcap->linktype;
+  if (fwrite(hdr, sizeof(hdr), 1, pcap->file) != 1) {
+    perror(name);
+    sim_pcap_close(pcap);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Writes an OLSR packet as a broadcast from the sender.
+ *
+ * @param pcap the file
+ * @param now time of the packet in milliseconds
+ * @param src IPv4 address of the sender
+ * @param data the OLSR packet
+ * @param len length of the packet
+ */
+void
+sim_pcap_write(struct sim_pcap *pcap, uint32_t now, const union olsr_ip_addr *src, const uint8_t *data, int len)
+{
+  uint32_t rec[PCAP_REC_SIZE / sizeof(uint32_t)];
+  uint8_t hdr[28];
+  uint32_t sum = 0;
+  unsigned int i;
+
+  rec[0] = now / 1000;
+  rec[1] = now % 1000 * 1000;
+  rec[2] = rec[3] = sizeof(hdr) + len;
+
+  memset(hdr, 0, sizeof(hdr));
+  hdr[0] = 0x45;
+  hdr[2] = (uint8_t)((sizeof(hdr) + len) >> 8);
+  hdr[3] = (uint8_t)(sizeof(hdr) + len);
+  hdr[8] = 1;
+  hdr[9] = IP_PROTO_UDP;
+  memcpy(hdr + 12, &src->v4, 4);
+  memset(hdr + 16, 0xff, 4);
+  for (i = 0; i < 20; i += 2) {
+    sum += pcap_get16(hdr + i);
+  }
+  sum = (sum & 0xffff) + (sum >> 16);
+  sum = ~((sum & 0xffff) + (sum >> 16));
+  hdr[10] = (uint8_t)(sum >> 8);
+  hdr[11] = (uint8_t)sum;
+
+  /* UDP without a checksum */
+  hdr[20] = hdr[22] = SIM_OLSR_PORT >> 8;
+  hdr[21] = hdr[23] = SIM_OLSR_PORT & 0xff;
+  hdr[24] = (uint8_t)((8 + len) >> 8);
+  hdr[25] = (uint8_t)(8 + len);
+
+  if (fwrite(rec, sizeof(rec), 1, pcap->file) != 1 || fwrite(hdr, sizeof(hdr), 1, pcap->file) != 1
+      || fwrite(data, len, 1, pcap->file) != 1) {
+    perror("pcap");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void
+sim_pcap_close(struct sim_pcap *pcap)
+{
+  if (pcap->file != NULL) {
+    fclose(pcap->file);
+  }
+  free(pcap->buf);
+  memset(pcap, 0, sizeof(*pcap));
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,323 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+/*
+ * Replaying a capture of OLSR traffic through a single node. The node
+ * takes the address of the host that captured the traffic, so the
+ * neighbours of the capture become its neighbours. The packets are fed
+ * on the virtual clock as fast as possible, the timers of the node
+ * expire in the gaps between the packets as they did on the host.
+ */
+
+#include "olsr_sim.h"
+#include "ipcalc.h"
+#include "lq_packet.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct replay_counts {
+  uint32_t frames;                     /* all records of the file */
+  uint32_t packets;                    /* OLSR packets fed to the node */
+  uint32_t own;                        /* sent by the capturing host */
+  uint32_t other;                      /* other family or not OLSR */
+  uint32_t too_large;                  /* larger than the daemon receives */
+  uint32_t messages;
+  uint32_t hellos;
+  uint32_t lq_hellos;
+  uint32_t duration;                   /* ms from the first to the last packet */
+};
+
+static const char *
+replay_type_name(unsigned int type)
+{
+  static char buf[16];
+
+  switch (type) {
+  case HELLO_MESSAGE:
+    return "HELLO";
+  case TC_MESSAGE:
+    return "TC";
+  case MID_MESSAGE:
+    return "MID";
+  case HNA_MESSAGE:
+    return "HNA";
+  case LQ_HELLO_MESSAGE:
+    return "LQ_HELLO";
+  case LQ_TC_MESSAGE:
+    return "LQ_TC";
+  case LQ_TC_DELTA_MESSAGE:
+    return "LQ_TC_DELTA";
+  default:
+    snprintf(buf, sizeof(buf), "type %u", type);
+    return buf;
+  }
+}
+
+static double
+replay_wall_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* the packets the node gets, false for packets to skip */
+static bool
+replay_accept(const struct sim_pcap_packet *pkt, const union olsr_ip_addr *addr, struct replay_counts *counts)
+{
+  counts->frames++;
+  if (pkt->family != sim.ip_version) {
+    counts->other++;
+    return false;
+  }
+  if (memcmp(&pkt->src, addr, sim.ip_version == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr)) == 0) {
+    /* the daemon ignores its own packets */
+    counts->own++;
+    return false;
+  }
+  if (pkt->len > SIM_MAX_PACKET) {
+    counts->too_large++;
+    return false;
+  }
+  return true;
+}
+
+/* counts the messages of a packet, the daemon validates them while parsing */
+static void
+replay_count_messages(const uint8_t *data, int len, struct replay_counts *counts)
+{
+  int off = 4;
+
+  while (off + 4 <= len) {
+    unsigned int type = data[off];
+    int size = data[off + 2] << 8 | data[off + 3];
+
+    if (size < 4 || off + size > len) {
+      break;
+    }
+    counts->messages++;
+    if (type == HELLO_MESSAGE) {
+      counts->hellos++;
+    } else if (type == LQ_HELLO_MESSAGE) {
+      counts->lq_hellos++;
+    }
+    if (sim.msg_stats != NULL) {
+      sim.msg_stats[type].count++;
+      sim.msg_stats[type].bytes += (uint64_t)size;
+    }
+    off += size;
+  }
+}
+
+/* guesses the link quality level from the hellos of the capture */
+static int
+replay_lq_level(const char *name, const union olsr_ip_addr *addr)
+{
+  struct sim_pcap pcap;
+  struct sim_pcap_packet pkt;
+  struct replay_counts counts;
+  int ret;
+
+  if (sim_pcap_open(&pcap, name) < 0) {
+    return -1;
+  }
+  memset(&counts, 0, sizeof(counts));
+  while ((ret = sim_pcap_next(&pcap, &pkt)) > 0) {
+    if (replay_accept(&pkt, addr, &counts)) {
+      replay_count_messages(pkt.data, pkt.len, &counts);
+    }
+  }
+  sim_pcap_close(&pcap);
+
+  if (ret < 0) {
+    return -1;
+  }
+  return counts.lq_hellos > counts.hellos ? 2 : 0;
+}
+
+static void
+replay_report(const char *name, const struct replay_counts *counts, const struct olsr_calc_stats *boot, double wall)
+{
+  struct sim_node *node = &sim.nodes[0];
+  struct olsr_calc_stats calc = node->calc;
+  struct ipaddr_str buf;
+  uint64_t handled_nsec = 0;
+  int64_t other_nsec;
+  uint32_t handled = 0;
+  unsigned int type;
+
+  printf("olsr_sim %s: replay of %s as %s, lq level %d\n", OLSR_SIM_VERSION, name, olsr_ip_to_string(&buf, &node->addr),
+         sim.lq_level);
+  sim_print_settings();
+  printf("capture: %u frames, %u OLSR packets replayed, %u own, %u too large, %u others\n", counts->frames, counts->packets,
+         counts->own, counts->too_large, counts->other);
+
+  printf("%-12s %10s %12s %10s %10s %8s\n", "Message", "Count", "Bytes", "Handled", "Time(ms)", "ns/msg");
+  for (type = 0; type < 256; type++) {
+    const struct sim_msg_stats *stats = &sim.msg_stats[type];
+
+    if (stats->count == 0 && stats->handled == 0) {
+      continue;
+    }
+    printf("%-12s %10u %12llu %10u %10.3f %8.0f\n", replay_type_name(type), stats->count, (unsigned long long)stats->bytes,
+           stats->handled, stats->nsec / 1e6, stats->handled ? (double)stats->nsec / stats->handled : 0.0);
+    handled += stats->handled;
+    handled_nsec += stats->nsec;
+  }
+
+  printf("replayed %.1f s of traffic in %.3f s, %.3f s in the daemon: %u messages (%.0f messages/s)\n", counts->duration / 1000.0,
+         wall, node->step_nsec / 1e9, counts->messages, node->step_nsec ? counts->messages * 1e9 / node->step_nsec : 0.0);
+
+  /* the calculations while the node started are not part of the replay */
+  calc.mpr_runs -= boot->mpr_runs;
+  calc.mpr_nsec -= boot->mpr_nsec;
+  calc.spf_runs -= boot->spf_runs;
+  calc.spf_nsec -= boot->spf_nsec;
+
+  other_nsec = (int64_t)(node->step_nsec - node->parse_nsec - calc.mpr_nsec - calc.spf_nsec);
+  if (other_nsec < 0) {
+    other_nsec = 0;
+  }
+  printf("stages: parse %.3f ms, handlers %.3f ms (%u messages), mpr %u runs %.3f ms, spf %u runs %.3f ms, "
+         "timers and output %.3f ms\n", (node->parse_nsec - handled_nsec) / 1e6, handled_nsec / 1e6, handled, calc.mpr_runs,
+         calc.mpr_nsec / 1e6, calc.spf_runs, calc.spf_nsec / 1e6, other_nsec / 1e6);
+  printf("result: %u routes, tx %u packets %llu bytes\n", node->routes, node->tx_packets, (unsigned long long)node->tx_bytes);
+}
+
+/**
+ * Replays a capture through a node.
+ *
+ * @param name path of the pcap file
+ * @param addr address of the host that captured the traffic, its
+ *   family selects the packets to replay
+ * @return exit code
+ */
+int
+sim_replay(const char *name, const union olsr_ip_addr *addr)
+{
+  struct sim_pcap pcap;
+  struct sim_pcap_packet pkt;
+  struct replay_counts counts;
+  struct sim_event ev;
+  struct olsr_calc_stats boot;
+  uint64_t first = 0;
+  uint32_t now = 0;
+  double wall;
+  int ret;
+
+  if (sim.lq_level < 0) {
+    sim.lq_level = replay_lq_level(name, addr);
+    if (sim.lq_level < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  if (sim_pcap_open(&pcap, name) < 0) {
+    return EXIT_FAILURE;
+  }
+
+  sim_segment_check();
+
+  sim.nodes = sim_alloc(sizeof(*sim.nodes));
+  sim.node_count = 1;
+  sim.nodes[0].addr = *addr;
+  sim.nodes[0].reachable = 1;
+  sim.msg_stats = sim_alloc(256 * sizeof(*sim.msg_stats));
+
+  sim_node_init(0, 0);
+  sim_node_time_handlers(0);
+  boot = sim.nodes[0].calc;
+
+  memset(&counts, 0, sizeof(counts));
+  wall = replay_wall_time();
+  while ((ret = sim_pcap_next(&pcap, &pkt)) > 0) {
+    struct sim_packet *p;
+    uint32_t time;
+
+    if (!replay_accept(&pkt, addr, &counts)) {
+      continue;
+    }
+
+    /* the clock of the node starts with the first packet and never goes back */
+    if (counts.packets == 0) {
+      first = pkt.usec;
+    }
+    time = pkt.usec > first ? (uint32_t)((pkt.usec - first) / 1000) : 0;
+    if ((int32_t)(time - now) > 0) {
+      now = time;
+    }
+    counts.packets++;
+    replay_count_messages(pkt.data, pkt.len, &counts);
+
+    /* the timers before the packet, the ones at the same time run with it */
+    while (sim_event_peek(&ev) && (int32_t)(ev.time - now) < 0) {
+      sim_run_events();
+    }
+
+    p = sim_packet_alloc(&pkt.src, pkt.data, pkt.len);
+    p->refs = 1;
+    sim_event_push(now, 0, p);
+  }
+  while (sim_event_peek(&ev) && (int32_t)(ev.time - now) <= 0) {
+    sim_run_events();
+  }
+  wall = replay_wall_time() - wall;
+  counts.duration = now;
+  sim_pcap_close(&pcap);
+
+  if (ret < 0) {
+    return EXIT_FAILURE;
+  }
+  replay_report(name, &counts, &boot, wall);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
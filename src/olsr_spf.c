@@ -47,18 +47,29 @@
  * Implementation of Dijkstras algorithm. Initially all nodes
  * are initialized to infinite cost. First we put ourselves
  * on the heap of reachable nodes. Our heap implementation
- * is based on an AVL tree which gives interesting performance
- * characteristics for the frequent operations of minimum key
- * extraction and re-keying. Next all neighbors of a node are
+ * is an array based 4-ary min-heap. Every vertex stores its
+ * position in the heap, which makes re-keying a vertex with a
+ * better path cost a cheap in-place decrease-key operation.
+ * Next all neighbors of a node are
  * explored and put on the heap if the cost of reaching them is
  * better than reaching the current candidate node.
  * The SPF calculation is terminated if there are no more nodes
  * on the heap.
+ *
+ * With SpfMode "incremental" the shortest path tree of the previous
+ * run is kept. Vertices whose edges have changed get collected on a
+ * dirty list. During the next run only the subtrees hanging off a
+ * changed tree edge are cut off and re-attached to their cheapest
+ * unaffected neighbor, then the dirty vertices are relaxed again such
+ * that cheaper edges propagate through the tree (dynamic SPT in the
+ * style of Ramalingam/Reps). Everything that is not affected keeps its
+ * path cost, next-hop and hopcount.
  */
 
 #include "ipcalc.h"
 #include "defs.h"
 #include "olsr.h"
+#include "log.h"
 #include "tc_set.h"
 #include "neighbor_table.h"
 #include "two_hop_neighbor_table.h"
@@ -73,65 +84,203 @@
 #include "lq_plugin.h"
 #include "gateway.h"
 
+#include <stdlib.h>
+
 #ifdef SPF_PROFILING
 #include <time.h>
 #endif /* SPF_PROFILING */
 
 struct timer_entry *spf_backoff_timer = NULL;
 
+/* vertices whose edges or prefixes have changed since the last run */
+static struct list_node spf_dirty_list = { &spf_dirty_list, &spf_dirty_list };
+
+/* the shortest path tree must be rebuilt from scratch */
+static bool spf_full_pending = true;
+
 /*
- * avl_comp_etx
+ * an array based d-ary min-heap keyed by path cost. equal costs are
+ * ordered by hop count and then first-in-first-out, like the AVL_DUP
+ * candidate tree did. with hop count metrics all costs are equal and
+ * this order keeps the paths minimal.
+ */
+#define SPF_HEAP_ARITY 4
+
+struct spf_heap_slot {
+  olsr_linkcost key;
+  uint32_t hops;
+  uint32_t seq;                        /* insertion order */
+  struct tc_entry *tc;
+};
+
+struct spf_heap {
+  struct spf_heap_slot *slot;
+  unsigned int count;
+  unsigned int size;
+  uint32_t seq;
+};
+
+/*
+ * olsr_spf_heap_before
  *
- * compare two etx metrics.
- * return 0 if there is an exact match and
- * -1 / +1 depending on being smaller or bigger.
- * note that this results in the most optimal code
- * after compiler optimization.
+ * Check if a slot is extracted before another one.
  */
-static int
-avl_comp_etx(const void *etx1, const void *etx2)
+static INLINE bool
+olsr_spf_heap_before(const struct spf_heap_slot *a, const struct spf_heap_slot *b)
 {
-  if (*(const olsr_linkcost *)etx1 < *(const olsr_linkcost *)etx2) {
-    return -1;
+  if (a->key != b->key) {
+    return a->key < b->key;
+  }
+  if (a->hops != b->hops) {
+    return a->hops < b->hops;
   }
+  /* sequence numbers may wrap */
+  return (int32_t)(a->seq - b->seq) < 0;
+}
 
-  if (*(const olsr_linkcost *)etx1 > *(const olsr_linkcost *)etx2) {
-    return +1;
+/* the candidate heap, kept between runs to avoid reallocation */
+static struct spf_heap cand_heap;
+
+/*
+ * olsr_spf_heap_place
+ *
+ * Store a slot at a heap position and update
+ * the position index of its vertex.
+ */
+static INLINE void
+olsr_spf_heap_place(struct spf_heap *heap, unsigned int pos, struct spf_heap_slot slot)
+{
+  heap->slot[pos] = slot;
+  slot.tc->spf_heap_pos = pos + 1;
+}
+
+/*
+ * olsr_spf_heap_up
+ *
+ * Move a slot towards the root until the heap order is restored.
+ */
+static void
+olsr_spf_heap_up(struct spf_heap *heap, unsigned int pos)
+{
+  struct spf_heap_slot slot = heap->slot[pos];
+
+  while (pos > 0) {
+    unsigned int parent = (pos - 1) / SPF_HEAP_ARITY;
+
+    if (!olsr_spf_heap_before(&slot, &heap->slot[parent])) {
+      break;
+    }
+    olsr_spf_heap_place(heap, pos, heap->slot[parent]);
+    pos = parent;
   }
+  olsr_spf_heap_place(heap, pos, slot);
+}
 
-  return 0;
+/*
+ * olsr_spf_heap_down
+ *
+ * Move a slot towards the leaves until the heap order is restored.
+ */
+static void
+olsr_spf_heap_down(struct spf_heap *heap, unsigned int pos)
+{
+  struct spf_heap_slot slot = heap->slot[pos];
+
+  for (;;) {
+    unsigned int child = pos * SPF_HEAP_ARITY + 1;
+    unsigned int last = child + SPF_HEAP_ARITY;
+    unsigned int best;
+
+    if (child >= heap->count) {
+      break;
+    }
+    if (last > heap->count) {
+      last = heap->count;
+    }
+
+    /* find the cheapest child */
+    for (best = child++; child < last; child++) {
+      if (olsr_spf_heap_before(&heap->slot[child], &heap->slot[best])) {
+        best = child;
+      }
+    }
+
+    if (!olsr_spf_heap_before(&heap->slot[best], &slot)) {
+      break;
+    }
+    olsr_spf_heap_place(heap, pos, heap->slot[best]);
+    pos = best;
+  }
+  olsr_spf_heap_place(heap, pos, slot);
 }
 
 /*
- * olsr_spf_add_cand_tree
+ * olsr_spf_add_cand_heap
  *
- * Key an existing vertex to a candidate tree.
+ * Key an existing vertex to a candidate heap.
  */
 static void
-olsr_spf_add_cand_tree(struct avl_tree *tree, struct tc_entry *tc)
+olsr_spf_add_cand_heap(struct spf_heap *heap, struct tc_entry *tc)
 {
 #if !defined(NODEBUG) && defined(DEBUG)
   struct ipaddr_str buf;
   struct lqtextbuffer lqbuffer;
 #endif /* !defined(NODEBUG) && defined(DEBUG) */
-  tc->cand_tree_node.key = &tc->path_cost;
+  struct spf_heap_slot slot;
 
 #ifdef DEBUG
   OLSR_PRINTF(2, "SPF: insert candidate %s, cost %s\n", olsr_ip_to_string(&buf, &tc->addr),
               get_linkcost_text(tc->path_cost, true, &lqbuffer));
 #endif /* DEBUG */
 
-  avl_insert(tree, &tc->cand_tree_node, AVL_DUP);
+  if (heap->count == heap->size) {
+    heap->size = heap->size ? heap->size * 2 : 64;
+    heap->slot = olsr_realloc(heap->slot, heap->size * sizeof(*heap->slot), "SPF candidate heap");
+  }
+
+  slot.key = tc->path_cost;
+  slot.hops = tc->hops;
+  slot.seq = heap->seq++;
+  slot.tc = tc;
+  olsr_spf_heap_place(heap, heap->count++, slot);
+  olsr_spf_heap_up(heap, tc->spf_heap_pos - 1);
 }
 
 /*
- * olsr_spf_del_cand_tree
+ * olsr_spf_decrease_cand_heap
  *
- * Unkey an existing vertex from a candidate tree.
+ * Re-key a vertex on the candidate heap after
+ * its path cost has been lowered.
  */
 static void
-olsr_spf_del_cand_tree(struct avl_tree *tree, struct tc_entry *tc)
+olsr_spf_decrease_cand_heap(struct spf_heap *heap, struct tc_entry *tc)
 {
+#if !defined(NODEBUG) && defined(DEBUG)
+  struct ipaddr_str buf;
+  struct lqtextbuffer lqbuffer;
+#endif /* !defined(NODEBUG) && defined(DEBUG) */
+
+#ifdef DEBUG
+  OLSR_PRINTF(2, "SPF: decrease candidate %s, cost %s\n", olsr_ip_to_string(&buf, &tc->addr),
+              get_linkcost_text(tc->path_cost, true, &lqbuffer));
+#endif /* DEBUG */
+
+  /* a re-keyed vertex queues up behind the vertices of equal cost */
+  heap->slot[tc->spf_heap_pos - 1].key = tc->path_cost;
+  heap->slot[tc->spf_heap_pos - 1].hops = tc->hops;
+  heap->slot[tc->spf_heap_pos - 1].seq = heap->seq++;
+  olsr_spf_heap_up(heap, tc->spf_heap_pos - 1);
+}
+
+/*
+ * olsr_spf_del_cand_heap
+ *
+ * Unkey an existing vertex from a candidate heap.
+ */
+static void
+olsr_spf_del_cand_heap(struct spf_heap *heap, struct tc_entry *tc)
+{
+  unsigned int pos = tc->spf_heap_pos - 1;
 
 #ifdef DEBUG
 #ifndef NODEBUG
@@ -142,13 +291,24 @@ olsr_spf_del_cand_tree(struct avl_tree *tree, struct tc_entry *tc)
               get_linkcost_text(tc->path_cost, true, &lqbuffer));
 #endif /* DEBUG */
 
-  avl_delete(tree, &tc->cand_tree_node);
+  tc->spf_heap_pos = 0;
+
+  /* fill the hole with the last slot */
+  if (pos < --heap->count) {
+    olsr_spf_heap_place(heap, pos, heap->slot[heap->count]);
+    if (pos > 0 && olsr_spf_heap_before(&heap->slot[pos], &heap->slot[(pos - 1) / SPF_HEAP_ARITY])) {
+      olsr_spf_heap_up(heap, pos);
+    } else {
+      olsr_spf_heap_down(heap, pos);
+    }
+  }
 }
 
 /*
  * olsr_spf_add_path_list
  *
  * Insert an SPF result at the end of the path list.
+ * A vertex is only inserted once.
  */
 static void
 olsr_spf_add_path_list(struct list_node *head, int *path_count, struct tc_entry *tc)
@@ -158,6 +318,10 @@ olsr_spf_add_path_list(struct list_node *head, int *path_count, struct tc_entry
   struct lqtextbuffer lqbuffer;
 #endif /* !defined(NODEBUG) && defined(DEBUG) */
 
+  if (list_node_on_list(&tc->path_list_node)) {
+    return;
+  }
+
 #ifdef DEBUG
   OLSR_PRINTF(2, "SPF: append path %s, cost %s, via %s\n", olsr_ip_to_string(&pathbuf, &tc->addr),
               get_linkcost_text(tc->path_cost, true, &lqbuffer), tc->next_hop ? olsr_ip_to_string(&nbuf,
@@ -175,22 +339,87 @@ olsr_spf_add_path_list(struct list_node *head, int *path_count, struct tc_entry
  * return the node with the minimum pathcost.
  */
 static struct tc_entry *
-olsr_spf_extract_best(struct avl_tree *tree)
+olsr_spf_extract_best(struct spf_heap *heap)
 {
-  struct avl_node *node = avl_walk_first(tree);
+  return (heap->count ? heap->slot[0].tc : NULL);
+}
 
-  return (node ? cand_tree2tc(node) : NULL);
+/*
+ * olsr_spf_unlink_parent
+ *
+ * Remove a vertex from the children list of its SPF predecessor.
+ */
+static void
+olsr_spf_unlink_parent(struct tc_entry *tc)
+{
+  if (list_node_on_list(&tc->spf_sibling_node)) {
+    list_remove(&tc->spf_sibling_node);
+  }
+  tc->spf_parent = NULL;
+}
+
+/*
+ * olsr_spf_set_path
+ *
+ * Reach a vertex through a predecessor at a given path cost.
+ */
+static void
+olsr_spf_set_path(struct tc_entry *tc, struct tc_entry *pred, olsr_linkcost cost)
+{
+  tc->path_cost = cost;
+
+  /* pull-up the next-hop and bump the hop count */
+  if (pred == tc_myself) {
+    tc->next_hop = tc->spf_link;
+  } else if (pred->next_hop) {
+    tc->next_hop = pred->next_hop;
+  }
+  tc->hops = pred->hops + 1;
+
+  olsr_spf_unlink_parent(tc);
+  tc->spf_parent = pred;
+}
+
+/*
+ * olsr_spf_settle
+ *
+ * Move the best candidate off the candidate heap and
+ * hang it off the children list of its predecessor.
+ */
+static void
+olsr_spf_settle(struct spf_heap *heap, struct tc_entry *tc)
+{
+  olsr_spf_del_cand_heap(heap, tc);
+
+  if (tc->spf_parent) {
+    list_add_before(&tc->spf_parent->spf_children, &tc->spf_sibling_node);
+  }
+}
+
+/*
+ * olsr_spf_better_path
+ *
+ * Check if a path of the given cost and hop count beats the current
+ * path of a vertex. Equal costs are the rule with hop count routing
+ * (LQ level 0), then the path with fewer hops wins.
+ */
+static bool
+olsr_spf_better_path(const struct tc_entry *tc, olsr_linkcost cost, unsigned int hops)
+{
+  return cost < tc->path_cost || (cost == tc->path_cost && hops < tc->hops);
 }
 
 /*
  * olsr_spf_relax
  *
  * Explore all edges of a node and add the node
- * to the candidate tree if the if the aggregate
+ * to the candidate heap if the if the aggregate
  * path cost is better.
+ * If a change list is passed, all vertices with a
+ * better path get recorded on it.
  */
 static void
-olsr_spf_relax(struct avl_tree *cand_tree, struct tc_entry *tc)
+olsr_spf_relax(struct spf_heap *heap, struct tc_entry *tc, struct list_node *change_list, int *change_count)
 {
   struct avl_node *edge_node;
   olsr_linkcost new_cost;
@@ -248,22 +477,20 @@ olsr_spf_relax(struct avl_tree *cand_tree, struct tc_entry *tc)
      */
     new_tc = tc_edge->edge_inv->tc;
 
-    if (new_cost < new_tc->path_cost) {
+    if (olsr_spf_better_path(new_tc, new_cost, tc->hops + 1)) {
 
-      /* if this node has been on the candidate tree delete it */
-      if (new_tc->path_cost < ROUTE_COST_BROKEN) {
-        olsr_spf_del_cand_tree(cand_tree, new_tc);
-      }
+      olsr_spf_set_path(new_tc, tc, new_cost);
 
-      /* re-insert on candidate tree with the better metric */
-      new_tc->path_cost = new_cost;
-      olsr_spf_add_cand_tree(cand_tree, new_tc);
+      /* re-key the node on the candidate heap with the better metric */
+      if (new_tc->spf_heap_pos) {
+        olsr_spf_decrease_cand_heap(heap, new_tc);
+      } else {
+        olsr_spf_add_cand_heap(heap, new_tc);
+      }
 
-      /* pull-up the next-hop and bump the hop count */
-      if (tc->next_hop) {
-        new_tc->next_hop = tc->next_hop;
+      if (change_list) {
+        olsr_spf_add_path_list(change_list, change_count, new_tc);
       }
-      new_tc->hops = tc->hops + 1;
 
 #ifdef DEBUG
       OLSR_PRINTF(2, "SPF:   better path to %s, cost %s, via %s, hops %u\n", olsr_ip_to_string(&buf, &new_tc->addr),
@@ -281,33 +508,390 @@ olsr_spf_relax(struct avl_tree *cand_tree, struct tc_entry *tc)
  *
  * Run the Dijkstra algorithm.
  *
- * A node gets added to the candidate tree when one of its edges has
+ * A node gets added to the candidate heap when one of its edges has
  * an overall better root path cost than the node itself.
  * The node with the shortest metric gets moved from the candidate to
  * the path list every pass.
  * The SPF computation is completed when there are no more nodes
- * on the candidate tree.
+ * on the candidate heap.
  */
 static void
-olsr_spf_run_full(struct avl_tree *cand_tree, struct list_node *path_list, int *path_count)
+olsr_spf_run_full(struct spf_heap *heap, struct list_node *path_list, int *path_count)
 {
   struct tc_entry *tc;
 
   *path_count = 0;
 
-  while ((tc = olsr_spf_extract_best(cand_tree))) {
+  while ((tc = olsr_spf_extract_best(heap))) {
 
-    olsr_spf_relax(cand_tree, tc);
+    olsr_spf_relax(heap, tc, NULL, NULL);
 
     /*
-     * move the best path from the candidate tree
+     * move the best path from the candidate heap
      * to the path list.
      */
-    olsr_spf_del_cand_tree(cand_tree, tc);
+    olsr_spf_settle(heap, tc);
     olsr_spf_add_path_list(path_list, path_count, tc);
   }
 }
 
+/*
+ * olsr_spf_reset
+ *
+ * Initialize all vertices in the lsdb for a full SPF run.
+ */
+static void
+olsr_spf_reset(void)
+{
+  struct tc_entry *tc;
+
+  OLSR_FOR_ALL_TC_ENTRIES(tc) {
+    tc->next_hop = NULL;
+    tc->path_cost = ROUTE_COST_BROKEN;
+    tc->hops = 0;
+    tc->spf_parent = NULL;
+    tc->spf_affected = false;
+    list_head_init(&tc->spf_children);
+    list_node_init(&tc->spf_sibling_node);
+  }
+  OLSR_FOR_ALL_TC_ENTRIES_END(tc);
+
+  /* a full run picks up all pending changes */
+  while (!list_is_empty(&spf_dirty_list)) {
+    list_remove(spf_dirty_list.next);
+  }
+  spf_full_pending = false;
+}
+
+/*
+ * olsr_spf_cut_subtree
+ *
+ * Detach a vertex and all its SPF descendants from the shortest path
+ * tree and record them on the change list.
+ * The change list doubles as the work queue for walking the subtree.
+ */
+static void
+olsr_spf_cut_subtree(struct list_node *change_list, int *change_count, struct tc_entry *root)
+{
+  struct list_node *node;
+  struct tc_entry *tc, *child;
+
+  olsr_spf_unlink_parent(root);
+
+  root->spf_affected = true;
+  root->path_cost = ROUTE_COST_BROKEN;
+  root->next_hop = NULL;
+  root->hops = 0;
+  olsr_spf_add_path_list(change_list, change_count, root);
+
+  for (node = &root->path_list_node; node != change_list; node = node->next) {
+    tc = pathlist2tc(node);
+
+    while (!list_is_empty(&tc->spf_children)) {
+      child = siblinglist2tc(tc->spf_children.next);
+      olsr_spf_unlink_parent(child);
+
+      child->spf_affected = true;
+      child->path_cost = ROUTE_COST_BROKEN;
+      child->next_hop = NULL;
+      child->hops = 0;
+      olsr_spf_add_path_list(change_list, change_count, child);
+    }
+  }
+}
+
+/*
+ * olsr_spf_run_incremental
+ *
+ * Repair the shortest path tree of the previous run for the
+ * vertices on the dirty list.
+ *
+ * The change list gets all vertices whose path cost, next-hop or
+ * prefixes may have changed.
+ */
+static void
+olsr_spf_run_incremental(struct spf_heap *heap, struct list_node *change_list, int *change_count)
+{
+  struct list_node *node, *child_node, *next_child_node;
+  struct tc_entry *tc, *child;
+  struct tc_edge_entry *tc_edge;
+
+  *change_count = 0;
+
+  /*
+   * Cut off the subtrees hanging off a tree edge that changed or went away.
+   * A changed tree edge always has a dirty vertex as its source.
+   */
+  for (node = spf_dirty_list.next; node != &spf_dirty_list; node = node->next) {
+    tc = dirtylist2tc(node);
+
+    for (child_node = tc->spf_children.next; child_node != &tc->spf_children; child_node = next_child_node) {
+      next_child_node = child_node->next;
+      child = siblinglist2tc(child_node);
+
+      tc_edge = olsr_lookup_tc_edge(tc, &child->addr);
+      if (tc_edge && tc_edge->edge_inv && tc_edge->cost < LINK_COST_BROKEN
+          && tc->path_cost + tc_edge->cost == child->path_cost) {
+        continue;
+      }
+      olsr_spf_cut_subtree(change_list, change_count, child);
+    }
+  }
+
+  /*
+   * Re-attach the affected vertices to their cheapest unaffected neighbor.
+   * So far the change list only holds affected vertices.
+   */
+  for (node = change_list->next; node != change_list; node = node->next) {
+    tc = pathlist2tc(node);
+
+    OLSR_FOR_ALL_TC_EDGE_ENTRIES(tc, tc_edge) {
+      struct tc_edge_entry *tc_edge_inv = tc_edge->edge_inv;
+      struct tc_entry *pred;
+
+      if (!tc_edge_inv || tc_edge_inv->cost >= LINK_COST_BROKEN) {
+        continue;
+      }
+      pred = tc_edge_inv->tc;
+      if (pred->spf_affected || pred->path_cost >= ROUTE_COST_BROKEN) {
+        continue;
+      }
+      if (olsr_spf_better_path(tc, pred->path_cost + tc_edge_inv->cost, pred->hops + 1)) {
+        olsr_spf_set_path(tc, pred, pred->path_cost + tc_edge_inv->cost);
+      }
+    } OLSR_FOR_ALL_TC_EDGE_ENTRIES_END(tc, tc_edge);
+
+    if (tc->path_cost < ROUTE_COST_BROKEN) {
+      olsr_spf_add_cand_heap(heap, tc);
+    }
+  }
+
+  /*
+   * Propagate cheaper and new edges of the remaining dirty vertices.
+   */
+  for (node = spf_dirty_list.next; node != &spf_dirty_list; node = node->next) {
+    tc = dirtylist2tc(node);
+
+    if (!tc->spf_affected && tc->path_cost < ROUTE_COST_BROKEN) {
+      olsr_spf_relax(heap, tc, change_list, change_count);
+    }
+  }
+
+  while ((tc = olsr_spf_extract_best(heap))) {
+    olsr_spf_relax(heap, tc, change_list, change_count);
+    olsr_spf_settle(heap, tc);
+  }
+
+  /*
+   * The prefixes of dirty vertices need to be exported as well.
+   */
+  while (!list_is_empty(&spf_dirty_list)) {
+    tc = dirtylist2tc(spf_dirty_list.next);
+    list_remove(&tc->spf_dirty_node);
+    olsr_spf_add_path_list(change_list, change_count, tc);
+  }
+
+  for (node = change_list->next; node != change_list; node = node->next) {
+    pathlist2tc(node)->spf_affected = false;
+  }
+}
+
+/*
+ * Path of a vertex after an incremental run, kept
+ * for the comparison against the full run.
+ */
+struct spf_check {
+  olsr_linkcost cost;
+  struct link_entry *next_hop;
+  uint8_t hops;
+  bool next_hop_valid;                 /* the next-hop is the one of the SPF predecessor */
+};
+
+/*
+ * olsr_spf_snapshot
+ *
+ * Copy the paths of all vertices in lsdb order.
+ */
+static struct spf_check *
+olsr_spf_snapshot(void)
+{
+  struct spf_check *check;
+  struct tc_entry *tc;
+  unsigned int i = 0;
+
+  check = olsr_malloc(sizeof(*check) * (tc_tree.count + 1), "SPF check");
+
+  OLSR_FOR_ALL_TC_ENTRIES(tc) {
+    check[i].cost = tc->path_cost;
+    check[i].next_hop = tc->next_hop;
+    check[i].hops = tc->hops;
+    if (tc == tc_myself || tc->path_cost >= ROUTE_COST_BROKEN) {
+      check[i].next_hop_valid = true;
+    } else if (tc->spf_parent == tc_myself) {
+      check[i].next_hop_valid = tc->next_hop == tc->spf_link;
+    } else {
+      check[i].next_hop_valid = tc->spf_parent && tc->next_hop == tc->spf_parent->next_hop;
+    }
+    i++;
+  }
+  OLSR_FOR_ALL_TC_ENTRIES_END(tc);
+
+  return check;
+}
+
+/*
+ * olsr_spf_compare
+ *
+ * Compare the paths of a full run against a snapshot
+ * of the incremental run.
+ * Both runs may pick different next-hops for paths of equal cost
+ * and hop count, so a next-hop only has to match the one of its
+ * SPF predecessor in the incremental run.
+ */
+static void
+olsr_spf_compare(const struct spf_check *check)
+{
+  struct tc_entry *tc;
+  struct ipaddr_str buf, nbuf1, nbuf2;
+  struct lqtextbuffer lqbuffer1, lqbuffer2;
+  unsigned int i = 0, mismatch = 0;
+
+  OLSR_FOR_ALL_TC_ENTRIES(tc) {
+    if (check[i].cost != tc->path_cost || (tc->path_cost < ROUTE_COST_BROKEN && check[i].hops != tc->hops)
+        || !check[i].next_hop_valid) {
+      OLSR_PRINTF(1, "SPF: check mismatch for %s, incremental %s %u hops via %s, full %s %u hops via %s\n",
+                  olsr_ip_to_string(&buf, &tc->addr), get_linkcost_text(check[i].cost, true, &lqbuffer1), check[i].hops,
+                  check[i].next_hop ? olsr_ip_to_string(&nbuf1, &check[i].next_hop->neighbor_iface_addr) : "-",
+                  get_linkcost_text(tc->path_cost, true, &lqbuffer2), tc->hops,
+                  tc->next_hop ? olsr_ip_to_string(&nbuf2, &tc->next_hop->neighbor_iface_addr) : "-");
+      mismatch++;
+    }
+    i++;
+  }
+  OLSR_FOR_ALL_TC_ENTRIES_END(tc);
+
+  if (mismatch) {
+    olsr_syslog(OLSR_LOG_ERR, "SPF: incremental result differs from full run for %u of %u nodes", mismatch, i);
+  }
+}
+
+/**
+ * Mark a vertex whose outgoing edges or prefixes have changed.
+ */
+void
+olsr_spf_touch_vertex(struct tc_entry *tc)
+{
+  if (olsr_cnf->spf_mode == SPFM_FULL || list_node_on_list(&tc->spf_dirty_node)) {
+    return;
+  }
+  list_add_before(&spf_dirty_list, &tc->spf_dirty_node);
+}
+
+/**
+ * An edge is about to be added or removed.
+ * Edges from and to ourselves change the neighbor set,
+ * which requires a full run.
+ */
+void
+olsr_spf_touch_edge(struct tc_edge_entry *tc_edge)
+{
+  olsr_spf_touch_vertex(tc_edge->tc);
+  if (tc_edge->tc == tc_myself) {
+    spf_full_pending = true;
+  }
+
+  if (tc_edge->edge_inv) {
+    olsr_spf_touch_vertex(tc_edge->edge_inv->tc);
+    if (tc_edge->edge_inv->tc == tc_myself) {
+      spf_full_pending = true;
+    }
+  }
+}
+
+/**
+ * A vertex is about to be removed from the lsdb.
+ * Drop all references the SPF state holds to it.
+ */
+void
+olsr_spf_forget_vertex(struct tc_entry *tc)
+{
+  if (list_node_on_list(&tc->spf_dirty_node)) {
+    list_remove(&tc->spf_dirty_node);
+  }
+
+  olsr_spf_unlink_parent(tc);
+  while (!list_is_empty(&tc->spf_children)) {
+    olsr_spf_unlink_parent(siblinglist2tc(tc->spf_children.next));
+  }
+
+  spf_full_pending = true;
+}
+
+/**
+ * Throw away the shortest path tree of the last run,
+ * e.g. because a link which is referenced as next-hop went away.
+ */
+void
+olsr_spf_force_full(void)
+{
+  spf_full_pending = true;
+}
+
+/*
+ * olsr_spf_export_vertex
+ *
+ * Walk all prefixes advertised by a vertex.
+ * If the vertex is reachable, insert the prefix into the global RIB.
+ * If the prefix is already in the RIB, refresh the entry such
+ * that olsr_delete_outdated_routes() does not purge it off.
+ * If the vertex is not reachable, mark its prefixes outdated.
+ */
+static void
+olsr_spf_export_vertex(struct tc_entry *tc)
+{
+  struct link_entry *link = tc->next_hop;
+  struct rt_path *rtp;
+
+  if (!link || tc->path_cost >= ROUTE_COST_BROKEN) {
+#ifdef DEBUG
+    /*
+     * Supress the error msg when our own tc_entry
+     * does not contain a next-hop.
+     */
+    if (tc != tc_myself) {
+      struct ipaddr_str buf;
+      OLSR_PRINTF(2, "SPF: %s no next-hop\n", olsr_ip_to_string(&buf, &tc->addr));
+    }
+#endif /* DEBUG */
+
+    OLSR_FOR_ALL_PREFIX_ENTRIES(tc, rtp) {
+      if (rtp->rtp_rt) {
+        rtp->rtp_version = routingtree_version - 1;
+        olsr_journal_rt_entry(rtp->rtp_rt);
+      }
+    } OLSR_FOR_ALL_PREFIX_ENTRIES_END(tc, rtp);
+    return;
+  }
+
+  OLSR_FOR_ALL_PREFIX_ENTRIES(tc, rtp) {
+    if (rtp->rtp_rt) {
+
+      /*
+       * If there is a route entry, the prefix is already in the global RIB.
+       */
+      olsr_update_rt_path(rtp, tc, link);
+
+    } else {
+
+      /*
+       * The prefix is reachable and not yet in the global RIB.
+       * Build a rt_entry for it.
+       */
+      olsr_insert_rt_path(rtp, tc, link);
+    }
+  } OLSR_FOR_ALL_PREFIX_ENTRIES_END(tc, rtp);
+}
+
 /**
  * Callback for the SPF backoff timer.
  */
@@ -335,14 +919,12 @@ olsr_calculate_routing_table(bool force)
 #ifdef SPF_PROFILING
   struct timespec t1, t2, t3, t4, t5, spf_init, spf_run, route, kernel, total;
 #endif /* SPF_PROFILING */
-  struct avl_tree cand_tree;
-  struct avl_node *rtp_tree_node;
   struct list_node path_list;          /* head of the path_list */
-  struct tc_entry *tc;
-  struct rt_path *rtp;
   struct tc_edge_entry *tc_edge;
   struct neighbor_entry *neigh;
   struct link_entry *link;
+  struct spf_check *check = NULL;
+  int mode;                            /* SPFM_* of this run */
   int path_count = 0;
 
   /* We are done if our backoff timer is running */
@@ -360,21 +942,9 @@ olsr_calculate_routing_table(bool force)
 #endif /* SPF_PROFILING */
 
   /*
-   * Prepare the candidate tree and result list.
+   * Prepare the result list.
    */
-  avl_init(&cand_tree, avl_comp_etx);
   list_head_init(&path_list);
-  olsr_bump_routingtree_version();
-
-  /*
-   * Initialize vertices in the lsdb.
-   */
-  OLSR_FOR_ALL_TC_ENTRIES(tc) {
-    tc->next_hop = NULL;
-    tc->path_cost = ROUTE_COST_BROKEN;
-    tc->hops = 0;
-  }
-  OLSR_FOR_ALL_TC_ENTRIES_END(tc);
 
   /*
    * Check if there was a change in the main IP address.
@@ -386,17 +956,12 @@ olsr_calculate_routing_table(bool force)
     /*
      * All gone now. Flush all routes.
      */
+    olsr_bump_routingtree_version();
     olsr_update_rib_routes();
     olsr_update_kernel_routes();
     return;
   }
 
-  /*
-   * zero ourselves and add us to the candidate tree.
-   */
-  tc_myself->path_cost = ZERO_ROUTE_COST;
-  olsr_spf_add_cand_tree(&cand_tree, tc_myself);
-
   /*
    * add edges to and from our neighbours.
    */
@@ -443,8 +1008,9 @@ olsr_calculate_routing_table(bool force)
         olsr_copylq_link_entry_2_tc_edge_entry(tc_edge, link);
         olsr_calc_tc_edge_entry_etx(tc_edge);
       }
-      if (tc_edge->edge_inv) {
-        tc_edge->edge_inv->tc->next_hop = link;
+      if (tc_edge->edge_inv && tc_edge->edge_inv->tc->spf_link != link) {
+        tc_edge->edge_inv->tc->spf_link = link;
+        spf_full_pending = true;
       }
     }
   }
@@ -457,62 +1023,57 @@ olsr_calculate_routing_table(bool force)
   /*
    * Run the SPF calculation.
    */
-  olsr_spf_run_full(&cand_tree, &path_list, &path_count);
+  mode = spf_full_pending ? SPFM_FULL : olsr_cnf->spf_mode;
+  if (mode != SPFM_FULL) {
+    olsr_spf_run_incremental(&cand_heap, &path_list, &path_count);
 
-  OLSR_PRINTF(2, "\n--- %s ------------------------------------------------- DIJKSTRA\n\n", olsr_wallclock_string());
+    if (mode == SPFM_CHECK) {
 
-#ifdef SPF_PROFILING
-  clock_gettime(CLOCK_MONOTONIC, &t3);
-#endif /* SPF_PROFILING */
-
-  /*
-   * In the path list we have all the reachable nodes in our topology.
-   */
-  for (; !list_is_empty(&path_list); list_remove(path_list.next)) {
-
-    tc = pathlist2tc(path_list.next);
-    link = tc->next_hop;
-
-    if (!link) {
-#ifdef DEBUG
       /*
-       * Supress the error msg when our own tc_entry
-       * does not contain a next-hop.
+       * Keep the incremental result for comparison and
+       * continue with the full run.
        */
-      if (tc != tc_myself) {
-        struct ipaddr_str buf;
-        OLSR_PRINTF(2, "SPF: %s no next-hop\n", olsr_ip_to_string(&buf, &tc->addr));
+      check = olsr_spf_snapshot();
+      while (!list_is_empty(&path_list)) {
+        list_remove(path_list.next);
       }
-#endif /* DEBUG */
-      continue;
     }
+  }
+
+  if (mode != SPFM_INCREMENTAL) {
+    olsr_bump_routingtree_version();
 
     /*
-     * Now walk all prefixes advertised by that node.
-     * Since the node is reachable, insert the prefix into the global RIB.
-     * If the prefix is already in the RIB, refresh the entry such
-     * that olsr_delete_outdated_routes() does not purge it off.
+     * Initialize vertices in the lsdb.
      */
-    for (rtp_tree_node = avl_walk_first(&tc->prefix_tree); rtp_tree_node; rtp_tree_node = avl_walk_next(rtp_tree_node)) {
+    olsr_spf_reset();
 
-      rtp = rtp_prefix_tree2rtp(rtp_tree_node);
+    /*
+     * zero ourselves and add us to the candidate heap.
+     */
+    tc_myself->path_cost = ZERO_ROUTE_COST;
+    olsr_spf_add_cand_heap(&cand_heap, tc_myself);
 
-      if (rtp->rtp_rt) {
+    olsr_spf_run_full(&cand_heap, &path_list, &path_count);
 
-        /*
-         * If there is a route entry, the prefix is already in the global RIB.
-         */
-        olsr_update_rt_path(rtp, tc, link);
+    if (check) {
+      olsr_spf_compare(check);
+      free(check);
+    }
+  }
 
-      } else {
+  OLSR_PRINTF(2, "\n--- %s ------------------------------------------------- DIJKSTRA\n\n", olsr_wallclock_string());
 
-        /*
-         * The prefix is reachable and not yet in the global RIB.
-         * Build a rt_entry for it.
-         */
-        olsr_insert_rt_path(rtp, tc, link);
-      }
-    }
+#ifdef SPF_PROFILING
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+#endif /* SPF_PROFILING */
+
+  /*
+   * In the path list we have all the reachable nodes in our topology,
+   * or all changed nodes after an incremental run.
+   */
+  for (; !list_is_empty(&path_list); list_remove(path_list.next)) {
+    olsr_spf_export_vertex(pathlist2tc(path_list.next));
   }
 #ifdef __linux__
   /* check gateway tunnels */
@@ -541,7 +1102,8 @@ olsr_calculate_routing_table(bool force)
   timer_sub(&t4, &t3, &route);
   timer_sub(&t5, &t4, &kernel);
   timer_sub(&t5, &t1, &total);
-  OLSR_PRINTF(1, "\n--- SPF-stats for %d nodes, %d routes (total/init/run/route/kern): %ld, %ld, %ld, %ld, %ld (nsec)\n", //
+  OLSR_PRINTF(1, "\n--- SPF-stats (%s) for %d nodes, %d routes (total/init/run/route/kern): %ld, %ld, %ld, %ld, %ld (nsec)\n", //
+      SPF_MODE_TXT[mode], //
       path_count, //
       routingtree.count, //
       (long int) total.tv_nsec, //
@@ -552,6 +1114,295 @@ olsr_calculate_routing_table(bool force)
 #endif /* SPF_PROFILING */
 }
 
+#ifdef SPF_PROFILING
+/*
+ * Synthetic benchmark of the candidate heap against the AVL
+ * candidate tree which has been used by earlier versions.
+ * Both run Dijkstra on the same generated mesh topologies,
+ * which are not linked into the lsdb.
+ */
+
+struct spf_bench_vertex {
+  struct tc_entry tc;
+  struct avl_node cand_tree_node;      /* legacy candidate tree, keyed by path_cost */
+  struct spf_bench_vertex *avl_parent; /* predecessor of the AVL run */
+  olsr_linkcost heap_cost;             /* results of the heap run */
+  unsigned int heap_hops;
+  struct spf_bench_vertex *heap_first; /* first hop, stands in for the next-hop */
+};
+
+#define SPF_BENCH_VERTEX(tc) ((struct spf_bench_vertex *)(void *)(tc))
+#define SPF_BENCH_CAND(node) ((struct spf_bench_vertex *)(void *)((char *)(node) - offsetof(struct spf_bench_vertex, cand_tree_node)))
+
+/*
+ * avl_comp_etx
+ *
+ * compare two etx metrics.
+ * return 0 if there is an exact match and
+ * -1 / +1 depending on being smaller or bigger.
+ */
+static int
+avl_comp_etx(const void *etx1, const void *etx2)
+{
+  if (*(const olsr_linkcost *)etx1 < *(const olsr_linkcost *)etx2) {
+    return -1;
+  }
+
+  if (*(const olsr_linkcost *)etx1 > *(const olsr_linkcost *)etx2) {
+    return +1;
+  }
+
+  return 0;
+}
+
+/*
+ * olsr_spf_bench_random
+ *
+ * Small LCG, the topologies need to be reproducible.
+ */
+static uint32_t
+olsr_spf_bench_random(uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/*
+ * olsr_spf_bench_link
+ *
+ * Add a symmetric pair of edges between two vertices.
+ */
+static void
+olsr_spf_bench_link(struct tc_edge_entry **edges, struct spf_bench_vertex *v1, struct spf_bench_vertex *v2, bool hopcount,
+                    uint32_t *seed)
+{
+  struct tc_edge_entry *e1, *e2;
+
+  /* no duplicate links */
+  if (avl_find(&v1->tc.edge_tree, &v2->tc.addr)) {
+    return;
+  }
+
+  e1 = (*edges)++;
+  e2 = (*edges)++;
+  e1->T_dest_addr = v2->tc.addr;
+  e1->edge_node.key = &e1->T_dest_addr;
+  e1->tc = &v1->tc;
+  e2->T_dest_addr = v1->tc.addr;
+  e2->edge_node.key = &e2->T_dest_addr;
+  e2->tc = &v2->tc;
+
+  avl_insert(&v1->tc.edge_tree, &e1->edge_node, AVL_DUP_NO);
+  avl_insert(&v2->tc.edge_tree, &e2->edge_node, AVL_DUP_NO);
+
+  if (hopcount) {
+    /* all edges are equal without link quality */
+    e1->cost = 0;
+    e2->cost = 0;
+  } else {
+    e1->cost = LINK_COST_BROKEN / 4096 + olsr_spf_bench_random(seed) % (3 * LINK_COST_BROKEN / 4096);
+    e2->cost = LINK_COST_BROKEN / 4096 + olsr_spf_bench_random(seed) % (3 * LINK_COST_BROKEN / 4096);
+  }
+  e1->edge_inv = e2;
+  e2->edge_inv = e1;
+}
+
+/*
+ * olsr_spf_bench_avl
+ *
+ * Dijkstra on top of the legacy AVL candidate tree, re-keying
+ * a vertex costs an avl_delete() and an avl_insert().
+ */
+static void
+olsr_spf_bench_avl(struct spf_bench_vertex *root)
+{
+  struct avl_tree cand_tree;
+  struct avl_node *node;
+
+  avl_init(&cand_tree, avl_comp_etx);
+
+  root->tc.path_cost = ZERO_ROUTE_COST;
+  root->tc.hops = 0;
+  root->avl_parent = NULL;
+  root->cand_tree_node.key = &root->tc.path_cost;
+  avl_insert(&cand_tree, &root->cand_tree_node, AVL_DUP);
+
+  while ((node = avl_walk_first(&cand_tree))) {
+    struct spf_bench_vertex *v = SPF_BENCH_CAND(node);
+    struct avl_node *edge_node;
+
+    avl_delete(&cand_tree, node);
+    v->cand_tree_node.key = NULL;
+
+    for (edge_node = avl_walk_first(&v->tc.edge_tree); edge_node; edge_node = avl_walk_next(edge_node)) {
+      struct tc_edge_entry *tc_edge = edge_tree2tc_edge(edge_node);
+      struct spf_bench_vertex *new_v;
+      olsr_linkcost new_cost;
+
+      if (!tc_edge->edge_inv || tc_edge->cost >= LINK_COST_BROKEN) {
+        continue;
+      }
+
+      new_cost = v->tc.path_cost + tc_edge->cost;
+      new_v = SPF_BENCH_VERTEX(tc_edge->edge_inv->tc);
+
+      if (olsr_spf_better_path(&new_v->tc, new_cost, v->tc.hops + 1)) {
+        if (new_v->cand_tree_node.key) {
+          avl_delete(&cand_tree, &new_v->cand_tree_node);
+        }
+        new_v->tc.path_cost = new_cost;
+        new_v->tc.hops = v->tc.hops + 1;
+        new_v->avl_parent = v;
+        new_v->cand_tree_node.key = &new_v->tc.path_cost;
+        avl_insert(&cand_tree, &new_v->cand_tree_node, AVL_DUP);
+      }
+    }
+  }
+}
+
+/*
+ * olsr_spf_bench_first_hop
+ *
+ * Follow the predecessors of a vertex up to the first hop.
+ */
+static struct spf_bench_vertex *
+olsr_spf_bench_first_hop(struct spf_bench_vertex *v, bool heap)
+{
+  struct spf_bench_vertex *pred;
+
+  while ((pred = heap ? SPF_BENCH_VERTEX(v->tc.spf_parent) : v->avl_parent) != NULL) {
+    if ((heap ? SPF_BENCH_VERTEX(pred->tc.spf_parent) : pred->avl_parent) == NULL) {
+      return v;
+    }
+    v = pred;
+  }
+  return NULL;
+}
+
+/*
+ * olsr_spf_bench_topology
+ *
+ * Generate a mesh of a given size, a jittered grid with a few
+ * long distance links, and time both SPF implementations on it.
+ * Both have to agree on cost, hop count and first hop of all paths.
+ */
+static void
+olsr_spf_bench_topology(unsigned int count, bool hopcount, uint32_t seed)
+{
+  struct spf_bench_vertex *vertices;
+  struct tc_edge_entry *edges, *edge_cursor;
+  struct list_node path_list;
+  struct timespec t1, t2, t3, t4, heap_time, avl_time;
+  unsigned int side, i, mismatch = 0;
+  int path_count;
+
+  side = 1;
+  while (side * side < count) {
+    side++;
+  }
+
+  vertices = olsr_malloc(count * sizeof(*vertices), "SPF benchmark vertices");
+  edges = olsr_malloc(count * 8 * sizeof(*edges), "SPF benchmark edges");
+
+  for (i = 0; i < count; i++) {
+    struct spf_bench_vertex *v = &vertices[i];
+
+    v->tc.addr.v4.s_addr = htonl(0x0a000000 | i);
+    v->tc.vertex_node.key = &v->tc.addr;
+    avl_init(&v->tc.edge_tree, avl_comp_default);
+    avl_init(&v->tc.prefix_tree, avl_comp_prefix_default);
+    list_head_init(&v->tc.spf_children);
+  }
+
+  edge_cursor = edges;
+  for (i = 0; i < count; i++) {
+    /* grid neighbors, some of them missing */
+    if ((i + 1) % side && i + 1 < count && olsr_spf_bench_random(&seed) % 8) {
+      olsr_spf_bench_link(&edge_cursor, &vertices[i], &vertices[i + 1], hopcount, &seed);
+    }
+    if (i + side < count && olsr_spf_bench_random(&seed) % 8) {
+      olsr_spf_bench_link(&edge_cursor, &vertices[i], &vertices[i + side], hopcount, &seed);
+    }
+    if ((i + 1) % side && i + side + 1 < count && olsr_spf_bench_random(&seed) % 2) {
+      olsr_spf_bench_link(&edge_cursor, &vertices[i], &vertices[i + side + 1], hopcount, &seed);
+    }
+    /* long distance link */
+    if (olsr_spf_bench_random(&seed) % 16 == 0) {
+      unsigned int j = olsr_spf_bench_random(&seed) % count;
+
+      if (j != i) {
+        olsr_spf_bench_link(&edge_cursor, &vertices[i], &vertices[j], hopcount, &seed);
+      }
+    }
+  }
+
+  /* indexed heap */
+  for (i = 0; i < count; i++) {
+    vertices[i].tc.path_cost = ROUTE_COST_BROKEN;
+  }
+  list_head_init(&path_list);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  vertices[0].tc.path_cost = ZERO_ROUTE_COST;
+  olsr_spf_add_cand_heap(&cand_heap, &vertices[0].tc);
+  olsr_spf_run_full(&cand_heap, &path_list, &path_count);
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  for (i = 0; i < count; i++) {
+    vertices[i].heap_cost = vertices[i].tc.path_cost;
+    vertices[i].heap_hops = vertices[i].tc.hops;
+    vertices[i].heap_first = olsr_spf_bench_first_hop(&vertices[i], true);
+  }
+  for (i = 0; i < count; i++) {
+    vertices[i].tc.path_cost = ROUTE_COST_BROKEN;
+  }
+
+  /* legacy AVL tree */
+  clock_gettime(CLOCK_MONOTONIC, &t3);
+  olsr_spf_bench_avl(&vertices[0]);
+  clock_gettime(CLOCK_MONOTONIC, &t4);
+
+  for (i = 0; i < count; i++) {
+    if (vertices[i].heap_cost != vertices[i].tc.path_cost
+        || (vertices[i].heap_cost != ROUTE_COST_BROKEN
+            && (vertices[i].heap_hops != vertices[i].tc.hops
+                || vertices[i].heap_first != olsr_spf_bench_first_hop(&vertices[i], false)))) {
+      mismatch++;
+    }
+  }
+
+  timer_sub(&t2, &t1, &heap_time);
+  timer_sub(&t4, &t3, &avl_time);
+  OLSR_PRINTF(1, "--- SPF-benchmark for %u nodes%s, %u edges, %d reachable (heap/avl): %ld, %ld (usec)%s\n", //
+      count, //
+      hopcount ? " (hop count)" : "", //
+      (unsigned int)(edge_cursor - edges), //
+      path_count, //
+      (long int) (heap_time.tv_sec * 1000000 + heap_time.tv_nsec / 1000), //
+      (long int) (avl_time.tv_sec * 1000000 + avl_time.tv_nsec / 1000), //
+      mismatch ? ", RESULT MISMATCH" : "");
+  if (mismatch) {
+    OLSR_PRINTF(1, "--- SPF-benchmark: %u paths differ in cost, hop count or first hop\n", mismatch);
+  }
+
+  free(edges);
+  free(vertices);
+}
+
+/**
+ * Compare the candidate heap against the AVL candidate
+ * tree on synthetic topologies of growing size.
+ */
+void
+olsr_spf_benchmark(void)
+{
+  olsr_spf_bench_topology(500, false, 500);
+  olsr_spf_bench_topology(5000, false, 5000);
+  olsr_spf_bench_topology(50000, false, 50000);
+  olsr_spf_bench_topology(5000, true, 5000);
+}
+#endif /* SPF_PROFILING */
+
 /*
  * Local Variables:
  * c-basic-offset: 2
@@ -46,8 +46,21 @@
 #ifndef _OLSR_SPF_H
 #define _OLSR_SPF_H
 
+struct tc_entry;
+struct tc_edge_entry;
+
 void olsr_calculate_routing_table(bool force);
 
+/* change notifications for the incremental SPF */
+void olsr_spf_touch_vertex(struct tc_entry *);
+void olsr_spf_touch_edge(struct tc_edge_entry *);
+void olsr_spf_forget_vertex(struct tc_entry *);
+void olsr_spf_force_full(void);
+
+#ifdef SPF_PROFILING
+void olsr_spf_benchmark(void);
+#endif /* SPF_PROFILING */
+
 #endif /* _OLSR_SPF_H */
 
 /*
@@ -67,8 +67,16 @@ static const struct ohs_command ohs_commands[] = {
    ohs_cmd_list},
   {"link", "link <bi> [srcIP|*] [dstIP|*] [0-100]",
    "Manipulate links",
-   "This command is used for manipulating olsr links. The link quality is a number between 0-100 representing the chance in percentage for a packet to be forwarded on the link.\nTo make the link between 10.0.0.1 and 10.0.0.2 have 50% packet loss do:\nlink 10.0.0.1 10.0.0.2 50\nNote that this will only effect the unidirectional link 10.0.0.1 -> 10.0.0.2.\nTo make the changes affect traffic in both directions do:\nlink bi 10.0.0.1 10.0.0.2 50\nTo completely block a link do:\nlink 10.0.0.1 10.0.0.2 0\nTo make all traffic pass(delete the entry) do:\nlink 10.0.0.1 10.0.0.2 100\nNote that \"bi\" can be used in all these examples.\nWildcard source and/or destinations are also supported.\nTo block all traffic from a node do:\nlink 10.0.0.1 * 0\nTo set 50% packet loss on all links to 10.0.0.2 do:\nlink * 10.0.0.2 50\nTo delete all links do:\nlink * * 100\nWildcards can also be used in combination with 'bi'.\nTo list all manipulated links use 'list links'.\n",
+   "This command is used for manipulating olsr links. The link quality is a number between 0-100 representing the chance in percentage for a packet to be forwarded on the link. Links without an entry use the default quality, which is 100 unless a topology was generated, see 'help topology'.\nTo make the link between 10.0.0.1 and 10.0.0.2 have 50% packet loss do:\nlink 10.0.0.1 10.0.0.2 50\nNote that this will only effect the unidirectional link 10.0.0.1 -> 10.0.0.2.\nTo make the changes affect traffic in both directions do:\nlink bi 10.0.0.1 10.0.0.2 50\nTo completely block a link do:\nlink 10.0.0.1 10.0.0.2 0\nTo make all traffic pass(delete the entry) do:\nlink 10.0.0.1 10.0.0.2 100\nSetting a link to the default quality deletes the entry as well.\nNote that \"bi\" can be used in all these examples.\nWildcard source and/or destinations are also supported.\nTo block all traffic from a node do:\nlink 10.0.0.1 * 0\nTo set 50% packet loss on all links to 10.0.0.2 do:\nlink * 10.0.0.2 50\nTo delete all links do:\nlink * * 100\nWildcards can also be used in combination with 'bi'.\nTo list all manipulated links use 'list links'.\n",
    ohs_cmd_link},
+  {"topology", "topology <grid|geo|sf|open> [param] [1-100] [seed]",
+   "Generate a topology between the connected clients",
+   "This command replaces all links with a generated topology between the currently connected clients. Clients are numbered by ascending IP address and every link not part of the topology is blocked, so start all olsrd instances first.\nA grid with 10 nodes per row:\ntopology grid 10\nA random geometric graph in the unit square, nodes closer than 0.05 are linked:\ntopology geo 0.05\nA scale-free graph where each node attaches to 2 others by preferential attachment:\ntopology sf 2\nThe optional quality is applied to all generated links, the optional seed makes geo and sf repeatable.\nA param of 0 picks a square grid, about 8 neighbours for geo and 2 for sf.\nTo remove the topology and let every client reach every other client again do:\ntopology open\n",
+   ohs_cmd_topology},
+  {"script", "script <file>",
+   "Run commands from a file",
+   "This command reads olsr_switch commands from a file, one per line. Empty lines and lines starting with '#' are skipped.\n",
+   ohs_cmd_script},
   {"olsrd", "olsrd [start|stop|show|setb|seta] [IP|path|args]",
    "Start or stop local olsrd processes. Also used to set the olsrd binary path and arguments",
    "This command is used for managing local olsrd instances from within olsr_switch.\nThe command can be configured in runtime using the setb and seta sub-commands.\nTo show the current olsrd command-configuration do:\nolsrd show\nTo set the olsrd binary path do:\nolsrd setb /full/path/to/olsrd\nTo start a olsrd instance with a IP address of 10.0.0.1, do:\nolsrd start 10.0.0.1\nTo stop that same instance do:\nolsrd stop 10.0.0.1\nseta would set arguments but is currently not implemented\n",
@@ -46,40 +46,83 @@
 #include "link_rules.h"
 #include "olsr_host_switch.h"
 #include "ipcalc.h"
-#include "olsr_random.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+/* buckets of the link table, must be a power of two */
+#define OHS_LINK_HASHSIZE 65536
+
+static struct ohs_ip_link *link_table[OHS_LINK_HASHSIZE];
+
+uint8_t ohs_link_default = 100;
+
+uint32_t
+ohs_ip_hash(const union olsr_ip_addr *addr)
+{
+  uint32_t h = 0;
+  unsigned int i;
+
+  for (i = 0; i < olsr_cnf->ipsize; i++) {
+    h = h * 31 + addr->v6.s6_addr[i];
+  }
+
+  /* murmur3 finalizer, spreads the host part over all bits */
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+static uint32_t
+link_hash(const struct ohs_connection *src, const union olsr_ip_addr *dst)
+{
+  return (ohs_ip_hash(&src->ip_addr) ^ (ohs_ip_hash(dst) * 0x9e3779b1)) & (OHS_LINK_HASHSIZE - 1);
+}
+
 int
 ohs_check_link(struct ohs_connection *oc, union olsr_ip_addr *dst)
 {
-  struct ohs_ip_link *links;
-  for (links = oc->links; links != NULL; links = links->next) {
-    int r;
-    if (!ipequal(&links->dst, dst)) {
-      continue;
-    }
-    if (links->quality == 0) {
-      if (logbits & LOG_LINK) {
-        struct ipaddr_str addrstr, dststr;
-        printf("%s -> %s Q: %d\n", olsr_ip_to_string(&addrstr, &oc->ip_addr), olsr_ip_to_string(&dststr, dst), links->quality);
-      }
-      return 0;
+  struct ohs_ip_link *link = get_link(oc, dst);
+  int quality = link ? link->quality : ohs_link_default;
+  int r;
+
+  if (quality == 0) {
+    if (link && (logbits & LOG_LINK)) {
+      struct ipaddr_str addrstr, dststr;
+      printf("%s -> %s Q: %d\n", olsr_ip_to_string(&addrstr, &oc->ip_addr), olsr_ip_to_string(&dststr, dst), quality);
     }
+    return 0;
+  }
+  if (quality >= 100) {
+    return 1;
+  }
 
-    r = 1 + (int)(100.0 / (RAND_MAX + 1.0) * olsr_random());
+  r = 1 + (int)(100.0 / (RAND_MAX + 1.0) * rand());
 
-    if (logbits & LOG_LINK) {
-      struct ipaddr_str addrstr, dststr;
-      printf("%s -> %s Q: %d R: %d\n", olsr_ip_to_string(&addrstr, &oc->ip_addr), olsr_ip_to_string(&dststr, dst), links->quality,
-             r);
+  if (logbits & LOG_LINK) {
+    struct ipaddr_str addrstr, dststr;
+    printf("%s -> %s Q: %d R: %d\n", olsr_ip_to_string(&addrstr, &oc->ip_addr), olsr_ip_to_string(&dststr, dst), quality, r);
+  }
+  /* Random - quality is the chance of a packet getting through */
+  return r <= quality;
+}
+
+static void
+unhash_link(struct ohs_ip_link *lnk)
+{
+  struct ohs_ip_link **pp = &link_table[link_hash(lnk->src, &lnk->dst)];
+
+  while (*pp) {
+    if (*pp == lnk) {
+      *pp = lnk->hnext;
+      return;
     }
-    /* Random - based on quality */
-    return links->quality > r ? 0 : 1;
+    pp = &(*pp)->hnext;
   }
-  return 1;
 }
 
 int
@@ -92,14 +135,30 @@ ohs_delete_all_related_links(struct ohs_connection *oc)
   while (links) {
     struct ohs_ip_link *tmp_link = links;
     links = links->next;
+    unhash_link(tmp_link);
     free(tmp_link);
     cnt++;
   }
+  oc->links = NULL;
+  oc->linkcnt = 0;
 
-  /* Delete links to this node */
+  /*
+   * Links to this node are kept, they are stored by address and
+   * apply again when the node reconnects
+   */
 
-  // XXX - ToDo
+  return cnt;
+}
+
+int
+ohs_delete_all_links(void)
+{
+  struct ohs_connection *oc;
+  int cnt = 0;
 
+  for (oc = ohs_conns; oc != NULL; oc = oc->next) {
+    cnt += ohs_delete_all_related_links(oc);
+  }
   return cnt;
 }
 
@@ -107,6 +166,7 @@ struct ohs_ip_link *
 add_link(struct ohs_connection *src, struct ohs_connection *dst)
 {
   struct ohs_ip_link *link;
+  uint32_t hash;
 
   /* Create new link */
   link = malloc(sizeof(struct ohs_ip_link));
@@ -115,9 +175,15 @@ add_link(struct ohs_connection *src, struct ohs_connection *dst)
   /* Queue */
   link->next = src->links;
   src->links = link;
+  link->src = src;
   link->dst = dst->ip_addr;
+  link->quality = ohs_link_default;
   src->linkcnt++;
 
+  hash = link_hash(src, &link->dst);
+  link->hnext = link_table[hash];
+  link_table[hash] = link;
+
   return link;
 }
 
@@ -135,6 +201,7 @@ remove_link(struct ohs_connection *oc, struct ohs_ip_link *lnk)
       else
         oc->links = links->next;
 
+      unhash_link(lnk);
       free(lnk);
       oc->linkcnt--;
       return 1;
@@ -149,8 +216,8 @@ struct ohs_ip_link *
 get_link(struct ohs_connection *oc, union olsr_ip_addr *dst)
 {
   struct ohs_ip_link *links;
-  for (links = oc->links; links != NULL; links = links->next) {
-    if (ipequal(&links->dst, dst)) {
+  for (links = link_table[link_hash(oc, dst)]; links != NULL; links = links->hnext) {
+    if (links->src == oc && ipequal(&links->dst, dst)) {
       return links;
     }
   }
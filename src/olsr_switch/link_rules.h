@@ -48,6 +48,9 @@
 
 #include "olsr_types.h"
 #include "olsr_host_switch.h"
+
+uint32_t ohs_ip_hash(const union olsr_ip_addr *);
+
 int ohs_check_link(struct ohs_connection *, union olsr_ip_addr *);
 
 struct ohs_ip_link *get_link(struct ohs_connection *, union olsr_ip_addr *);
@@ -58,6 +61,8 @@ int remove_link(struct ohs_connection *, struct ohs_ip_link *);
 
 int ohs_delete_all_related_links(struct ohs_connection *);
 
+int ohs_delete_all_links(void);
+
 #endif /* _OLSR_SWITCH_LINK_RULES */
 
 /*
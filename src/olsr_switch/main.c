@@ -62,6 +62,10 @@
 #include <unistd.h>
 #include <time.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif /* __linux__ */
+
 #ifdef _WIN32
 #undef errno
 #define errno WSAGetLastError()
@@ -70,15 +74,23 @@
 #define close(x) closesocket(x)
 #else /* _WIN32 */
 #include <sys/wait.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <fcntl.h>
 #endif /* _WIN32 */
 
 static int srv_socket;
 
-#define OHS_BUFSIZE 1500
-static uint8_t data_buffer[OHS_BUFSIZE];
+#ifdef __linux__
+static int epoll_fd = -1;
+
+#define OHS_MAX_EVENTS 256
+#endif /* __linux__ */
 
 struct ohs_connection *ohs_conns;
 
+static struct ohs_connection *conn_table[OHS_CONN_HASHSIZE];
+
 //static int ip_version;
 //int ipsize;
 static struct olsrd_config olsr_cnf_data;
@@ -89,7 +101,11 @@ uint32_t logbits;
 /* local functions */
 static int ohs_init_new_connection(int);
 
-static int ohs_route_data(struct ohs_connection *);
+static int ohs_route_data(struct ohs_connection *, uint8_t *, uint16_t);
+
+static int ohs_receive_data(struct ohs_connection *);
+
+static int ohs_flush_output(struct ohs_connection *);
 
 static int ohs_init_connect_sockets(void);
 
@@ -124,7 +140,7 @@ struct ohs_connection *
 get_client_by_addr(const union olsr_ip_addr *adr)
 {
   struct ohs_connection *oc;
-  for (oc = ohs_conns; oc != NULL; oc = oc->next) {
+  for (oc = conn_table[ohs_ip_hash(adr) & (OHS_CONN_HASHSIZE - 1)]; oc != NULL; oc = oc->hnext) {
     if (ipequal(adr, &oc->ip_addr)) {
       return oc;
     }
@@ -132,10 +148,29 @@ get_client_by_addr(const union olsr_ip_addr *adr)
   return NULL;
 }
 
+#ifdef __linux__
+static void
+ohs_set_write_interest(struct ohs_connection *oc, int enable)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | (enable ? EPOLLOUT : 0);
+  ev.data.ptr = oc;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, oc->socket, &ev) < 0) {
+    printf("epoll_ctl failed: %s\n", strerror(errno));
+  }
+}
+#else /* __linux__ */
+/* select() and WSAEventSelect() pick up the queue state on every loop */
+#define ohs_set_write_interest(oc, enable) do { } while (0)
+#endif /* __linux__ */
+
 static int
 ohs_init_new_connection(int s)
 {
   struct ohs_connection *oc;
+  uint32_t hash;
   int i;
   uint32_t addr[4];
 
@@ -195,19 +230,48 @@ ohs_init_new_connection(int s)
     return -1;
   }
 
+#ifndef _WIN32
+  /* a slow client must not stall the switch, see ohs_send_frame() */
+  if (fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) < 0) {
+    printf("Failed to set client socket non-blocking! (%s)\n", strerror(errno));
+  }
+#endif /* _WIN32 */
+
+#ifdef __linux__
+  {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = oc;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s, &ev) < 0) {
+      printf("epoll_ctl failed: %s\n", strerror(errno));
+      close(s);
+      free(oc);
+      return -1;
+    }
+  }
+#endif /* __linux__ */
+
   /* Queue */
   oc->next = ohs_conns;
   ohs_conns = oc;
+
+  hash = ohs_ip_hash(&oc->ip_addr) & (OHS_CONN_HASHSIZE - 1);
+  oc->hnext = conn_table[hash];
+  conn_table[hash] = oc;
   return 1;
 }
 
 int
 ohs_delete_connection(struct ohs_connection *oc)
 {
+  struct ohs_connection **pp;
+
   if (!oc) {
     return -1;
   }
-  /* Close the socket */
+  /* Close the socket, this also removes it from the epoll set */
   close(oc->socket);
 
   if (logbits & LOG_CONNECT) {
@@ -230,49 +294,180 @@ ohs_delete_connection(struct ohs_connection *oc)
       curr_entry = curr_entry->next;
     }
   }
+  for (pp = &conn_table[ohs_ip_hash(&oc->ip_addr) & (OHS_CONN_HASHSIZE - 1)]; *pp != NULL; pp = &(*pp)->hnext) {
+    if (*pp == oc) {
+      *pp = oc->hnext;
+      break;
+    }
+  }
   ohs_delete_all_related_links(oc);
 
+  free(oc->outbuf);
   free(oc);
   return 0;
 }
 
+/*
+ * Appends the unsent tail of a frame to the output queue of a client.
+ * The queue is compacted before it grows and never exceeds OHS_OUTQ_MAX.
+ */
+static void
+ohs_queue_output(struct ohs_connection *oc, const uint8_t *data, uint32_t len)
+{
+  if (oc->outpos > 0) {
+    memmove(oc->outbuf, oc->outbuf + oc->outpos, oc->outlen - oc->outpos);
+    oc->outlen -= oc->outpos;
+    oc->outpos = 0;
+  }
+
+  if (oc->outlen + len > oc->outsize) {
+    uint32_t size = oc->outsize ? oc->outsize : 4096;
+    uint8_t *buf;
+
+    while (size < oc->outlen + len) {
+      size *= 2;
+    }
+    buf = realloc(oc->outbuf, size);
+    if (!buf) {
+      OHS_OUT_OF_MEMORY("Output queue");
+    }
+    oc->outbuf = buf;
+    oc->outsize = size;
+  }
+
+  memcpy(oc->outbuf + oc->outlen, data, len);
+  oc->outlen += len;
+}
+
+/*
+ * Sends the link address followed by the packet as one frame. What the
+ * socket does not take is queued. Whole frames are dropped if the queue
+ * is full, like a congested wireless link would.
+ */
 static int
-ohs_route_data(struct ohs_connection *oc)
+ohs_send_frame(struct ohs_connection *oc, union olsr_ip_addr *from, uint8_t *data, uint16_t len)
+{
+  uint32_t framelen = olsr_cnf->ipsize + len;
+  ssize_t sent = 0;
+
+  if (oc->outlen == oc->outpos) {
+#ifdef _WIN32
+    uint8_t frame[sizeof(union olsr_ip_addr) + OHS_BUFSIZE];
+
+    memcpy(frame, from, olsr_cnf->ipsize);
+    memcpy(frame + olsr_cnf->ipsize, data, len);
+    sent = send(oc->socket, (const void *)frame, framelen, 0);
+#else /* _WIN32 */
+    struct iovec iov[2];
+
+    iov[0].iov_base = from;
+    iov[0].iov_len = olsr_cnf->ipsize;
+    iov[1].iov_base = data;
+    iov[1].iov_len = len;
+    sent = writev(oc->socket, iov, 2);
+#endif /* _WIN32 */
+    if (sent == (ssize_t)framelen) {
+      return 0;
+    }
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EINTR) {
+        printf("Error sending to client: %s\n", strerror(errno));
+        return -1;
+      }
+      sent = 0;
+    }
+  }
+
+  /* a partially sent frame must be completed to keep the stream in sync */
+  if (sent == 0 && oc->outlen - oc->outpos + framelen > OHS_OUTQ_MAX) {
+    oc->dropped++;
+    return -1;
+  }
+
+  if (oc->outlen == oc->outpos) {
+    ohs_set_write_interest(oc, 1);
+  }
+  if ((uint32_t)sent < olsr_cnf->ipsize) {
+    ohs_queue_output(oc, (uint8_t *)from + sent, olsr_cnf->ipsize - (uint32_t)sent);
+    sent = olsr_cnf->ipsize;
+  }
+  ohs_queue_output(oc, data + (sent - olsr_cnf->ipsize), framelen - (uint32_t)sent);
+  return 0;
+}
+
+static int
+ohs_flush_output(struct ohs_connection *oc)
+{
+  ssize_t sent;
+
+  if (oc->outlen == oc->outpos) {
+    return 0;
+  }
+
+  sent = send(oc->socket, (const void *)(oc->outbuf + oc->outpos), oc->outlen - oc->outpos, 0);
+  if (sent < 0) {
+    if (errno == EAGAIN || errno == EINTR) {
+      return 0;
+    }
+    printf("Error flushing client queue: %s\n", strerror(errno));
+    return -1;
+  }
+
+  oc->outpos += (uint32_t)sent;
+  if (oc->outpos == oc->outlen) {
+    oc->outpos = 0;
+    oc->outlen = 0;
+    ohs_set_write_interest(oc, 0);
+  }
+  return 0;
+}
+
+static int
+ohs_route_data(struct ohs_connection *oc, uint8_t *data, uint16_t len)
 {
   struct ohs_connection *ohs_cs;
-  ssize_t len;
   int cnt = 0;
 
   oc->tx++;
-  /* Read data */
-  if ((len = recv(oc->socket, (void *)data_buffer, OHS_BUFSIZE, 0)) <= 0)
-    return -1;
 
   if (logbits & LOG_FORWARD) {
     struct ipaddr_str addrstr;
-    printf("Received %ld bytes from %s\n", (long)len, olsr_ip_to_string(&addrstr, &oc->ip_addr));
+    printf("Received %d bytes from %s\n", (int)len, olsr_ip_to_string(&addrstr, &oc->ip_addr));
   }
-  /* Loop trough clients */
-  for (ohs_cs = ohs_conns; ohs_cs; ohs_cs = ohs_cs->next) {
-    /* Check that the link is active open */
-    if (ohs_check_link(oc, &ohs_cs->ip_addr) && oc->socket != ohs_cs->socket) {
-      ssize_t sent;
 
-      /* Send link addr */
-      if (send(ohs_cs->socket, (const void *)&oc->ip_addr, olsr_cnf->ipsize, 0) != (int)olsr_cnf->ipsize) {
-        printf("Error sending link address!\n");
+  if (ohs_link_default == 0) {
+    /* Only configured links forward, walk the adjacency of the source */
+    struct ohs_ip_link *link;
+
+    for (link = oc->links; link != NULL; link = link->next) {
+      if (link->quality == 0 || (ohs_cs = get_client_by_addr(&link->dst)) == NULL || ohs_cs == oc) {
+        continue;
+      }
+      if (!ohs_check_link(oc, &ohs_cs->ip_addr)) {
+        continue;
       }
-      /* Send data */
       if (logbits & LOG_FORWARD) {
         struct ipaddr_str addrstr, addrstr2;
         printf("Sending %d bytes %s=>%s\n", (int)len, olsr_ip_to_string(&addrstr, &oc->ip_addr),
                olsr_ip_to_string(&addrstr2, &ohs_cs->ip_addr));
       }
+      ohs_send_frame(ohs_cs, &oc->ip_addr, data, len);
+      ohs_cs->rx++;
+      cnt++;
+    }
+    return cnt;
+  }
 
-      sent = send(ohs_cs->socket, (void*)data_buffer, len, 0);
-      if (sent != len) {
-        printf("Error sending(buf %d != sent %d)\n", (int)len, (int)sent);
+  /* Loop trough clients */
+  for (ohs_cs = ohs_conns; ohs_cs; ohs_cs = ohs_cs->next) {
+    /* Check that the link is active open */
+    if (ohs_cs != oc && ohs_check_link(oc, &ohs_cs->ip_addr)) {
+      if (logbits & LOG_FORWARD) {
+        struct ipaddr_str addrstr, addrstr2;
+        printf("Sending %d bytes %s=>%s\n", (int)len, olsr_ip_to_string(&addrstr, &oc->ip_addr),
+               olsr_ip_to_string(&addrstr2, &ohs_cs->ip_addr));
       }
+      ohs_send_frame(ohs_cs, &oc->ip_addr, data, len);
       ohs_cs->rx++;
       cnt++;
     }
@@ -280,6 +475,47 @@ ohs_route_data(struct ohs_connection *oc)
   return cnt;
 }
 
+/*
+ * Reads from a client and routes every complete packet. Packets are
+ * delimited by the length field of the OLSR header, so several packets
+ * arriving in one read are no longer glued together.
+ */
+static int
+ohs_receive_data(struct ohs_connection *oc)
+{
+  ssize_t len;
+  uint32_t pos = 0;
+
+  len = recv(oc->socket, (void *)(oc->inbuf + oc->inlen), OHS_BUFSIZE - oc->inlen, 0);
+  if (len < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return 0;
+  }
+  if (len <= 0) {
+    return -1;
+  }
+  oc->inlen += (uint32_t)len;
+
+  while (oc->inlen - pos >= 2) {
+    uint16_t pcklen = (uint16_t)((oc->inbuf[pos] << 8) | oc->inbuf[pos + 1]);
+
+    if (pcklen < 4 || pcklen > OHS_BUFSIZE) {
+      printf("Invalid packet length %d, dropping client!\n", (int)pcklen);
+      return -1;
+    }
+    if (oc->inlen - pos < pcklen) {
+      break;
+    }
+    ohs_route_data(oc, oc->inbuf + pos, pcklen);
+    pos += pcklen;
+  }
+
+  if (pos > 0) {
+    memmove(oc->inbuf, oc->inbuf + pos, oc->inlen - pos);
+    oc->inlen -= pos;
+  }
+  return 1;
+}
+
 static int
 ohs_init_connect_sockets(void)
 {
@@ -313,7 +549,7 @@ ohs_init_connect_sockets(void)
   }
 
   /* show that we are willing to listen */
-  if (listen(srv_socket, 5) == -1) {
+  if (listen(srv_socket, SOMAXCONN) == -1) {
     printf("listen failed for socket: %s\n", strerror(errno));
     close(srv_socket);
     exit(EXIT_FAILURE);
@@ -324,7 +560,24 @@ ohs_init_connect_sockets(void)
 static int
 ohs_configure(void)
 {
+#ifndef _WIN32
+  struct rlimit rl;
+
+  /* every emulated node holds a socket, allow as many as we may */
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0) {
+      printf("Could not raise the open file limit: %s\n", strerror(errno));
+    }
+  }
+#endif /* _WIN32 */
 
+#ifdef __linux__
+  if ((epoll_fd = epoll_create(OHS_MAX_EVENTS)) < 0) {
+    printf("epoll_create failed: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+#endif /* __linux__ */
   return 1;
 }
 
@@ -354,16 +607,73 @@ stdin_handler(void)
 static void
 read_handler(struct ohs_connection *con)
 {
-  if (ohs_route_data(con) < 0)
+  if (ohs_receive_data(con) < 0)
+    ohs_delete_connection(con);
+}
+
+static void
+write_handler(struct ohs_connection *con)
+{
+  if (ohs_flush_output(con) < 0)
     ohs_delete_connection(con);
 }
 
 static void
 ohs_listen_loop(void)
 {
-#if !defined _WIN32
+#if defined __linux__
+  struct epoll_event ev, events[OHS_MAX_EVENTS];
+  int fn_stdin = fileno(stdin);
+  int i, n;
+
+  /* clients carry their connection, stdin NULL and the server socket &srv_socket */
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = &srv_socket;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, srv_socket, &ev) < 0) {
+    printf("epoll_ctl failed: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  ev.data.ptr = NULL;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fn_stdin, &ev) < 0) {
+    printf("epoll_ctl failed: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  while (1) {
+    /* block */
+    n = epoll_wait(epoll_fd, events, OHS_MAX_EVENTS, -1);
+
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+
+      printf("Error epoll_wait: %s", strerror(errno));
+      continue;
+    }
+
+    for (i = 0; i < n; i++) {
+      struct ohs_connection *ohs_cs = events[i].data.ptr;
+
+      if (events[i].data.ptr == NULL) {
+        stdin_handler();
+        continue;
+      }
+      if (events[i].data.ptr == &srv_socket) {
+        accept_handler();
+        continue;
+      }
+      /* a pending flush is retried on the next round, epoll is level triggered */
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        read_handler(ohs_cs);
+      } else if (events[i].events & EPOLLOUT) {
+        write_handler(ohs_cs);
+      }
+    }
+  }
+#elif !defined _WIN32
   int n;
-  fd_set ibits;
+  fd_set ibits, obits;
   int fn_stdin = fileno(stdin);
 
   while (1) {
@@ -373,6 +683,7 @@ ohs_listen_loop(void)
 
     high = 0;
     FD_ZERO(&ibits);
+    FD_ZERO(&obits);
 
     /* Add server socket */
     high = srv_socket;
@@ -389,10 +700,12 @@ ohs_listen_loop(void)
         high = ohs_cs->socket;
 
       FD_SET(ohs_cs->socket, &ibits);
+      if (ohs_cs->outlen != ohs_cs->outpos)
+        FD_SET(ohs_cs->socket, &obits);
     }
 
     /* block */
-    n = select(high + 1, &ibits, 0, 0, NULL);
+    n = select(high + 1, &ibits, &obits, 0, NULL);
 
     if (n == 0)
       continue;
@@ -418,6 +731,8 @@ ohs_listen_loop(void)
 
       if (FD_ISSET(ohs_tmp->socket, &ibits))
         read_handler(ohs_tmp);
+      else if (FD_ISSET(ohs_tmp->socket, &obits))
+        write_handler(ohs_tmp);
     }
 
     if (FD_ISSET(fn_stdin, &ibits))
@@ -440,7 +755,7 @@ ohs_listen_loop(void)
 
   while (1) {
     for (Walker = ohs_conns; Walker != NULL; Walker = Walker->next) {
-      if (WSAEventSelect(Walker->socket, Objects[1], FD_READ | FD_CLOSE) == SOCKET_ERROR) {
+      if (WSAEventSelect(Walker->socket, Objects[1], FD_READ | FD_WRITE | FD_CLOSE) == SOCKET_ERROR) {
         fprintf(stderr, "WSAEventSelect failed (2): %s\n", strerror(errno));
         Sleep(1000);
         continue;
@@ -476,6 +791,8 @@ ohs_listen_loop(void)
         else {
           if ((NetEvents.lNetworkEvents & (FD_READ | FD_CLOSE)) != 0)
             read_handler(Walker);
+          else if ((NetEvents.lNetworkEvents & FD_WRITE) != 0)
+            write_handler(Walker);
         }
       }
     }
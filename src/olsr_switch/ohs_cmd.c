@@ -48,6 +48,7 @@
 #include "olsr_types.h"
 #include "commands.h"
 #include "link_rules.h"
+#include "topology.h"
 #include "ipcalc.h"
 
 #include <string.h>
@@ -310,8 +311,8 @@ ohs_cmd_link(const char *args)
       if (src != dst) {
         my_link = get_link(src, &dst->ip_addr);
         inv_link = bi ? get_link(dst, &src->ip_addr) : NULL;
-        if (qual == 100) {
-          /* Remove link entry */
+        if (qual == ohs_link_default) {
+          /* Remove link entry, the default applies again */
           if (my_link) {
             remove_link(src, my_link);
           }
@@ -334,7 +335,7 @@ ohs_cmd_link(const char *args)
             inv_link->quality = qual;
           }
         }
-        printf("%s %sdirectional link(s) %s %c=> %s quality %d\n", (qual == 100) ? "Removing" : "Setting", bi ? "bi" : "uni",
+        printf("%s %sdirectional link(s) %s %c=> %s quality %d\n", (qual == ohs_link_default) ? "Removing" : "Setting", bi ? "bi" : "uni",
                olsr_ip_to_string(&srcaddrstr, &src->ip_addr), bi ? '<' : '=', olsr_ip_to_string(&dstaddrstr, &dst->ip_addr), qual);
       }
       if (wildc_dst) {
@@ -365,11 +366,12 @@ ohs_cmd_list(const char *args)
 
     while (oc) {
       struct ipaddr_str addrstr;
-      printf("\t%s - Rx: %d Tx: %d LinkCnt: %d\n", olsr_ip_to_string(&addrstr, &oc->ip_addr), oc->rx, oc->tx, oc->linkcnt);
+      printf("\t%s - Rx: %d Tx: %d Dropped: %d Queued: %d LinkCnt: %d\n", olsr_ip_to_string(&addrstr, &oc->ip_addr), oc->rx, oc->tx,
+             oc->dropped, oc->outlen - oc->outpos, oc->linkcnt);
       oc = oc->next;
     }
   } else if (!strncmp(tok_buf, "links", strlen("links"))) {
-    printf("All configured links:\n");
+    printf("All configured links (default quality %d):\n", ohs_link_default);
     while (oc) {
       struct ohs_ip_link *links = oc->links;
       while (links) {
@@ -388,6 +390,98 @@ ohs_cmd_list(const char *args)
   return 1;
 }
 
+int
+ohs_cmd_topology(const char *args)
+{
+  char type[TOK_BUF_SIZE];
+  double param = 0;
+  int qual = 100;
+  uint32_t seed = 1;
+
+  args += get_next_token(args, type, sizeof(type));
+
+  if (!strlen(type)) {
+    goto print_usage;
+  }
+  if (!strcmp(type, "open")) {
+    ohs_topology_open();
+    return 1;
+  }
+
+  args += get_next_token(args, tok_buf, TOK_BUF_SIZE);
+  if (strlen(tok_buf)) {
+    param = atof(tok_buf);
+  }
+  args += get_next_token(args, tok_buf, TOK_BUF_SIZE);
+  if (strlen(tok_buf)) {
+    qual = atoi(tok_buf);
+  }
+  args += get_next_token(args, tok_buf, TOK_BUF_SIZE);
+  if (strlen(tok_buf)) {
+    seed = (uint32_t)strtoul(tok_buf, NULL, 0);
+  }
+
+  if (qual <= 0 || qual > 100) {
+    printf("Link quality out of range(1-100)\n");
+    return -1;
+  }
+
+  if (!strcmp(type, "grid")) {
+    return ohs_topology_grid((int)param, (uint8_t)qual);
+  }
+  if (!strcmp(type, "geo")) {
+    return ohs_topology_geometric(param, (uint8_t)qual, seed);
+  }
+  if (!strcmp(type, "sf")) {
+    return ohs_topology_scalefree((int)param, (uint8_t)qual, seed);
+  }
+
+print_usage:
+  printf("topology <grid|geo|sf|open> [param] [1-100] [seed]\n");
+  return -1;
+}
+
+int
+ohs_cmd_script(const char *args)
+{
+  static int depth = 0;
+  char line[500];
+  FILE *script;
+  int cnt = 0;
+
+  args += get_next_token(args, tok_buf, TOK_BUF_SIZE);
+
+  if (!strlen(tok_buf)) {
+    printf("script <file>\n");
+    return -1;
+  }
+  if (depth > 4) {
+    printf("Scripts nested too deep\n");
+    return -1;
+  }
+  if ((script = fopen(tok_buf, "r")) == NULL) {
+    printf("Could not open %s: %s\n", tok_buf, strerror(errno));
+    return -1;
+  }
+
+  depth++;
+  while (fgets(line, sizeof(line), script) != NULL) {
+    line[strcspn(line, "\r\n")] = 0;
+
+    /* skip empty lines and comments */
+    if (line[strspn(line, " ")] == 0 || line[strspn(line, " ")] == '#') {
+      continue;
+    }
+    printf("> %s\n", line);
+    ohs_exec_command(line);
+    cnt++;
+  }
+  depth--;
+
+  fclose(script);
+  return cnt;
+}
+
 int
 ohs_cmd_help(const char *args)
 {
@@ -481,14 +575,36 @@ ohs_cmd_exit(const char *args __attribute__ ((unused)))
   ohs_close(0);
 }
 
+void
+ohs_exec_command(const char *cmd_line)
+{
+  const char *args;
+  char cmd_token[20];
+  int i;
+
+  args = cmd_line + get_next_token(cmd_line, cmd_token, sizeof(cmd_token));
+
+  for (i = 0; ohs_commands[i].cmd != NULL; i++) {
+    if (strcmp(cmd_token, ohs_commands[i].cmd) == 0) {
+      if (ohs_commands[i].cmd_cb != NULL)
+        ohs_commands[i].cmd_cb(args);
+
+      else
+        printf("No action registered on cmd %s!\n", cmd_token);
+
+      break;
+    }
+  }
+
+  if (ohs_commands[i].cmd == NULL)
+    printf("%s: no such cmd!\n", cmd_token);
+}
+
 void
 ohs_parse_command(void)
 {
   static char cmd_line[500];
   static int cmd_len = 0;
-  char *args;
-  char cmd_token[20];
-  int i;
 #if defined _WIN32
   char c;
   unsigned long Read;
@@ -534,38 +650,46 @@ ohs_parse_command(void)
     cmd_line[cmd_len++] = (char)c;
 
   else
-#else /* defined _WIN32 */
-  if (fgets(cmd_line, sizeof(cmd_line), stdin) == NULL) {
-    ohs_cmd_exit(NULL);
-  }
-
-  for (cmd_len = 0; cmd_line[cmd_len] != 0 && cmd_line[cmd_len] != '\n'; cmd_len++);
-#endif /* defined _WIN32 */
-
   {
     cmd_line[cmd_len] = 0;
     cmd_len = 0;
 
-    args = cmd_line + get_next_token(cmd_line, cmd_token, sizeof(cmd_token));
+    ohs_exec_command(cmd_line);
 
-    for (i = 0; ohs_commands[i].cmd != NULL; i++) {
-      if (strcmp(cmd_token, ohs_commands[i].cmd) == 0) {
-        if (ohs_commands[i].cmd_cb != NULL)
-          ohs_commands[i].cmd_cb(args);
+    printf("\n> ");
+    fflush(stdout);
+  }
+#else /* defined _WIN32 */
+  char *eol;
+  ssize_t len;
+
+  /*
+   * Read the descriptor directly, stdio would buffer lines the event
+   * loop never hears about when commands are piped in
+   */
+  len = read(fileno(stdin), cmd_line + cmd_len, sizeof(cmd_line) - 1 - cmd_len);
+  if (len <= 0) {
+    ohs_cmd_exit(NULL);
+  }
+  cmd_len += (int)len;
+  cmd_line[cmd_len] = 0;
 
-        else
-          printf("No action registered on cmd %s!\n", cmd_token);
+  while ((eol = strchr(cmd_line, '\n')) != NULL || cmd_len == (int)sizeof(cmd_line) - 1) {
+    int used = eol ? (int)(eol - cmd_line) + 1 : cmd_len;
 
-        break;
-      }
+    if (eol) {
+      *eol = 0;
     }
-
-    if (ohs_commands[i].cmd == NULL)
-      printf("%s: no such cmd!\n", cmd_token);
+    ohs_exec_command(cmd_line);
 
     printf("\n> ");
     fflush(stdout);
+
+    cmd_len -= used;
+    memmove(cmd_line, cmd_line + used, cmd_len);
+    cmd_line[cmd_len] = 0;
   }
+#endif /* defined _WIN32 */
 }
 
 /*
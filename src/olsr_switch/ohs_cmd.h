@@ -60,6 +60,8 @@ int ohs_set_olsrd_path(const char *);
 
 void ohs_parse_command(void);
 
+void ohs_exec_command(const char *);
+
 int ohs_cmd_olsrd(const char *);
 
 int ohs_cmd_list(const char *);
@@ -72,6 +74,10 @@ int ohs_cmd_log(const char *);
 
 int ohs_cmd_link(const char *);
 
+int ohs_cmd_topology(const char *);
+
+int ohs_cmd_script(const char *);
+
 #endif /* _OHS_CMD */
 
 /*
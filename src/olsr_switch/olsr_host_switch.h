@@ -54,6 +54,15 @@
 
 #define OHS_DEFAULT_OLSRD_PATH "./olsrd"
 
+/* largest OLSR packet accepted from a client */
+#define OHS_BUFSIZE 1500
+
+/* bytes queued for a slow client before whole frames are dropped */
+#define OHS_OUTQ_MAX (256 * 1024)
+
+/* buckets of the client table, must be a power of two */
+#define OHS_CONN_HASHSIZE 1024
+
 #define OHS_OUT_OF_MEMORY(s) do { printf("ohsd: out of memory \"%s\"!\n", s); ohs_close(0); } while (0)
 
 #ifdef _WIN32
@@ -65,7 +74,9 @@ void ohs_close(int) __attribute__ ((noreturn));
 struct ohs_ip_link {
   union olsr_ip_addr dst;
   uint8_t quality;                     /* 0 - 100 */
-  struct ohs_ip_link *next;
+  struct ohs_connection *src;
+  struct ohs_ip_link *next;            /* links of the same source */
+  struct ohs_ip_link *hnext;           /* link table chain */
 };
 
 struct ohs_connection {
@@ -73,13 +84,29 @@ struct ohs_connection {
   int socket;
   uint32_t rx;
   uint32_t tx;
+  uint32_t dropped;
   uint32_t linkcnt;
   struct ohs_ip_link *links;
+
+  /* partially received packet */
+  uint8_t inbuf[OHS_BUFSIZE];
+  uint32_t inlen;
+
+  /* frames the client socket did not take yet */
+  uint8_t *outbuf;
+  uint32_t outpos;
+  uint32_t outlen;
+  uint32_t outsize;
+
+  struct ohs_connection *hnext;        /* client table chain */
   struct ohs_connection *next;
 };
 
 extern uint32_t logbits;
 
+/* quality of a link without an entry, 100 forwards everything */
+extern uint8_t ohs_link_default;
+
 extern struct ohs_connection *ohs_conns;
 
 #define LOG_DEFAULT 0x0
@@ -0,0 +1,325 @@
+/*
+ * The olsr.org Optimized Link-State Routing daemon (olsrd)
+ *
+ * (c) by the OLSR project
+ *
+ * See our Git repository to find out who worked on this file
+ * and thus is a copyright holder on it.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in
+ *   the documentation and/or other materials provided with the
+ *   distribution.
+ * * Neither the name of olsr.org, olsrd nor the names of its
+ *   contributors may be used to endorse or promote products derived
+ *   from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Visit http://www.olsr.org for more information.
+ *
+ * If you find this software useful feel free to make a donation
+ * to the project. For more information see the website or contact
+ * the copyright holders.
+ *
+ */
+
+#include "topology.h"
+#include "link_rules.h"
+#include "olsr_host_switch.h"
+#include "ipcalc.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+static uint32_t topo_seed;
+
+/* private generator, a given seed always yields the same topology */
+static uint32_t
+topo_random(void)
+{
+  topo_seed ^= topo_seed << 13;
+  topo_seed ^= topo_seed >> 17;
+  topo_seed ^= topo_seed << 5;
+  return topo_seed;
+}
+
+static double
+topo_uniform(void)
+{
+  return topo_random() / 4294967296.0;
+}
+
+static int
+topo_cmp_addr(const void *a, const void *b)
+{
+  const struct ohs_connection *const *ca = a;
+  const struct ohs_connection *const *cb = b;
+
+  return memcmp(&(*ca)->ip_addr, &(*cb)->ip_addr, olsr_cnf->ipsize);
+}
+
+/*
+ * Collects the clients sorted by address, so node i of a generated
+ * topology does not depend on the order the olsrd instances connected
+ */
+static struct ohs_connection **
+topo_get_nodes(int *cnt)
+{
+  struct ohs_connection **nodes, *oc;
+  int n = 0;
+
+  for (oc = ohs_conns; oc != NULL; oc = oc->next) {
+    n++;
+  }
+
+  nodes = calloc(n ? n : 1, sizeof(*nodes));
+  if (!nodes) {
+    OHS_OUT_OF_MEMORY("Topology nodes");
+  }
+
+  n = 0;
+  for (oc = ohs_conns; oc != NULL; oc = oc->next) {
+    nodes[n++] = oc;
+  }
+  qsort(nodes, n, sizeof(*nodes), topo_cmp_addr);
+
+  *cnt = n;
+  return nodes;
+}
+
+static void
+topo_reset(void)
+{
+  ohs_delete_all_links();
+  ohs_link_default = 0;
+}
+
+/* returns 1 if a new bidirectional link was created */
+static int
+topo_connect(struct ohs_connection *a, struct ohs_connection *b, uint8_t quality)
+{
+  struct ohs_ip_link *link;
+
+  if (a == b || get_link(a, &b->ip_addr) != NULL) {
+    return 0;
+  }
+
+  link = add_link(a, b);
+  link->quality = quality;
+  link = add_link(b, a);
+  link->quality = quality;
+  return 1;
+}
+
+static int
+topo_find(int *parent, int i)
+{
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/* prints node and link count and the number of partitions */
+static void
+topo_summary(const char *name, struct ohs_connection **nodes, int n, int edges)
+{
+  int *parent, i, parts = 0;
+
+  parent = calloc(n ? n : 1, sizeof(*parent));
+  if (!parent) {
+    OHS_OUT_OF_MEMORY("Topology summary");
+  }
+
+  for (i = 0; i < n; i++) {
+    parent[i] = i;
+  }
+
+  for (i = 0; i < n; i++) {
+    struct ohs_ip_link *link;
+
+    for (link = nodes[i]->links; link != NULL; link = link->next) {
+      struct ohs_connection *dst = get_client_by_addr(&link->dst), **found;
+
+      if (dst == NULL) {
+        continue;
+      }
+      found = bsearch(&dst, nodes, n, sizeof(*nodes), topo_cmp_addr);
+      if (found) {
+        parent[topo_find(parent, i)] = topo_find(parent, (int)(found - nodes));
+      }
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    if (topo_find(parent, i) == i) {
+      parts++;
+    }
+  }
+  free(parent);
+
+  printf("%s topology: %d nodes, %d links, average degree %.2f, %d partition(s)\n", name, n, edges,
+         n ? 2.0 * edges / n : 0.0, parts);
+}
+
+int
+ohs_topology_grid(int width, uint8_t quality)
+{
+  struct ohs_connection **nodes;
+  int n, i, edges = 0;
+
+  nodes = topo_get_nodes(&n);
+  if (width <= 0) {
+    /* square grid */
+    for (width = 1; width * width < n; width++);
+  }
+
+  topo_reset();
+  for (i = 0; i < n; i++) {
+    /* right and lower neighbour */
+    if ((i + 1) % width != 0 && i + 1 < n) {
+      edges += topo_connect(nodes[i], nodes[i + 1], quality);
+    }
+    if (i + width < n) {
+      edges += topo_connect(nodes[i], nodes[i + width], quality);
+    }
+  }
+
+  topo_summary("Grid", nodes, n, edges);
+  free(nodes);
+  return edges;
+}
+
+int
+ohs_topology_geometric(double radius, uint8_t quality, uint32_t seed)
+{
+  struct ohs_connection **nodes;
+  double *x, *y;
+  int n, i, j, edges = 0;
+
+  nodes = topo_get_nodes(&n);
+  if (radius <= 0) {
+    /* about eight neighbours per node */
+    radius = n ? sqrt(8.0 / (M_PI * n)) : 1;
+  }
+
+  x = calloc(n ? n : 1, sizeof(*x));
+  y = calloc(n ? n : 1, sizeof(*y));
+  if (!x || !y) {
+    OHS_OUT_OF_MEMORY("Topology positions");
+  }
+
+  topo_seed = seed ? seed : 1;
+  for (i = 0; i < n; i++) {
+    x[i] = topo_uniform();
+    y[i] = topo_uniform();
+  }
+
+  topo_reset();
+  for (i = 0; i < n; i++) {
+    for (j = i + 1; j < n; j++) {
+      double dx = x[i] - x[j], dy = y[i] - y[j];
+
+      if (dx * dx + dy * dy <= radius * radius) {
+        edges += topo_connect(nodes[i], nodes[j], quality);
+      }
+    }
+  }
+  free(x);
+  free(y);
+
+  topo_summary("Random geometric", nodes, n, edges);
+  free(nodes);
+  return edges;
+}
+
+/*
+ * Barabasi-Albert preferential attachment: every new node links to m
+ * existing nodes, picked with a chance proportional to their degree
+ */
+int
+ohs_topology_scalefree(int m, uint8_t quality, uint32_t seed)
+{
+  struct ohs_connection **nodes;
+  int *ends, nends = 0, n, i, j, edges = 0;
+
+  nodes = topo_get_nodes(&n);
+  if (m <= 0) {
+    m = 2;
+  }
+
+  /* every link adds both of its ends */
+  ends = calloc((size_t)(n ? n : 1) * m * 2 + (size_t)(m + 1) * m, sizeof(*ends));
+  if (!ends) {
+    OHS_OUT_OF_MEMORY("Topology degrees");
+  }
+
+  topo_seed = seed ? seed : 1;
+  topo_reset();
+
+  /* start with a full mesh of m + 1 nodes */
+  for (i = 0; i <= m && i < n; i++) {
+    for (j = 0; j < i; j++) {
+      edges += topo_connect(nodes[i], nodes[j], quality);
+      ends[nends++] = i;
+      ends[nends++] = j;
+    }
+  }
+
+  for (; i < n; i++) {
+    int added = 0, tries = 0;
+
+    while (added < m && tries++ < 100 * m) {
+      j = ends[topo_random() % (uint32_t)nends];
+      if (topo_connect(nodes[i], nodes[j], quality)) {
+        ends[nends++] = i;
+        ends[nends++] = j;
+        added++;
+      }
+    }
+    edges += added;
+  }
+  free(ends);
+
+  topo_summary("Scale-free", nodes, n, edges);
+  free(nodes);
+  return edges;
+}
+
+void
+ohs_topology_open(void)
+{
+  ohs_delete_all_links();
+  ohs_link_default = 100;
+  printf("All links removed, every client reaches every other client\n");
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -43,6 +43,11 @@
  *
  */
 
+#ifdef __linux__
+/* needed for recvmmsg() and sendmmsg() */
+#define _GNU_SOURCE 1
+#endif /* __linux__ */
+
 #include "parser.h"
 #include "ipcalc.h"
 #include "defs.h"
@@ -83,6 +88,17 @@ struct packetparser_function_entry *packetparser_functions;
 static uint32_t inbuf_aligned[MAXMESSAGESIZE/sizeof(uint32_t) + 1];
 static char *inbuf = (char *)inbuf_aligned;
 
+/* maximum number of packets read per olsr_input() call */
+#define INPUT_MAX_PACKETS 32
+
+#ifdef __linux__
+/* ring of receive buffers for recvmmsg() */
+static uint32_t inbuf_ring[NET_BATCH_SIZE][MAXMESSAGESIZE/sizeof(uint32_t) + 1];
+static struct sockaddr_storage inbuf_from[NET_BATCH_SIZE];
+static struct iovec inbuf_iov[NET_BATCH_SIZE];
+static struct mmsghdr inbuf_msgs[NET_BATCH_SIZE];
+#endif /* __linux__ */
+
 /**
  *Initialize the parser.
  *
@@ -406,6 +422,156 @@ parse_packet(struct olsr *olsr, int size, struct interface_olsr *in_if, union ol
   }                             /* for olsr_msg */
 }
 
+/**
+ *Processing a single OLSR packet read from a socket. Setting
+ *wich interface received the message, calling the preprocessors
+ *and passing the packet on to parse_packet().
+ *
+ *@param fd the filedescriptor the packet was read from.
+ *@param packet the received packet
+ *@param cc the number of bytes read
+ *@param from the sender address
+ *@param fromlen the length of the sender address
+ *
+ *@return false if reading from the socket should stop
+ */
+static bool
+olsr_input_packet(int fd, char *packet, int cc, struct sockaddr_storage *from, socklen_t fromlen)
+{
+  struct ipaddr_str buf;
+  struct interface_olsr *olsr_in_if;
+  union olsr_ip_addr from_addr;
+  struct preprocessor_function_entry *entry;
+
+  {
+    void * src;
+    void * dst;
+    size_t size;
+    if (olsr_cnf->ip_version == AF_INET) {
+      /* IPv4 sender address */
+      struct sockaddr_in * x = (struct sockaddr_in *) from;
+      src = &x->sin_addr;
+      dst = &from_addr.v4;
+      size = sizeof(from_addr.v4);
+    } else {
+      /* IPv6 sender address */
+      struct sockaddr_in6 * x = (struct sockaddr_in6 *) from;
+      src = &x->sin6_addr;
+      dst = &from_addr.v6;
+      size = sizeof(from_addr.v6);
+    }
+    memcpy(dst, src, size);
+  }
+
+#ifdef DEBUG
+  OLSR_PRINTF(5, "Received a packet from %s\n",
+      olsr_ip_to_string(&buf, &from_addr));
+#endif /* DEBUG */
+
+  if ((olsr_cnf->ip_version == AF_INET) && (fromlen != sizeof(struct sockaddr_in)))
+    return false;
+  else if ((olsr_cnf->ip_version == AF_INET6) && (fromlen != sizeof(struct sockaddr_in6)))
+    return false;
+
+  /* are we talking to ourselves? */
+  if (if_ifwithaddr(&from_addr) != NULL)
+    return false;
+
+  if ((olsr_in_if = if_ifwithsock(fd)) == NULL) {
+    OLSR_PRINTF(1, "Could not find input interface for message from %s size %d\n", olsr_ip_to_string(&buf, &from_addr), cc);
+    olsr_syslog(OLSR_LOG_ERR, "Could not find input interface for message from %s size %d\n", olsr_ip_to_string(&buf, &from_addr),
+                cc);
+    return false;
+  }
+  // call preprocessors
+  entry = preprocessor_functions;
+
+  while (entry) {
+    packet = entry->function(packet, olsr_in_if, &from_addr, &cc);
+    // discard package ?
+    if (packet == NULL) {
+      return false;
+    }
+    entry = entry->next;
+  }
+
+  /*
+   * &from - sender
+   * packet - the olsr packet
+   * cc - bytes read
+   */
+  parse_packet((struct olsr *)packet, cc, olsr_in_if, &from_addr);
+  return true;
+}
+
+#ifdef __linux__
+/**
+ *Batched variant of olsr_input(), reads up to NET_BATCH_SIZE
+ *packets per system call with recvmmsg(2).
+ *
+ *@param fd the filedescriptor that data should be read from.
+ *
+ *@return false if recvmmsg(2) is not supported
+ */
+static bool
+olsr_input_batched(int fd)
+{
+  unsigned int packets = 0;
+
+  while (packets < INPUT_MAX_PACKETS) {
+    bool more = true;
+    int i, n;
+
+    for (i = 0; i < NET_BATCH_SIZE; i++) {
+      inbuf_iov[i].iov_base = inbuf_ring[i];
+      inbuf_iov[i].iov_len = sizeof(inbuf_ring[i]);
+      memset(&inbuf_msgs[i].msg_hdr, 0, sizeof(inbuf_msgs[i].msg_hdr));
+      inbuf_msgs[i].msg_hdr.msg_name = &inbuf_from[i];
+      inbuf_msgs[i].msg_hdr.msg_namelen = sizeof(inbuf_from[i]);
+      inbuf_msgs[i].msg_hdr.msg_iov = &inbuf_iov[i];
+      inbuf_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    n = recvmmsg(fd, inbuf_msgs, NET_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+      if (errno == ENOSYS) {
+        return false;
+      }
+      if (errno != EWOULDBLOCK) {
+        OLSR_PRINTF(1, "error recvmmsg: %s", strerror(errno));
+        olsr_syslog(OLSR_LOG_ERR, "error recvmmsg: %m");
+      }
+      break;
+    }
+    if (n == 0) {
+      break;
+    }
+    net_batch_account(&net_rx_batch_stats, n);
+
+    /* the packets have been read already, so all of them get processed */
+    for (i = 0; i < n; i++) {
+      if (inbuf_msgs[i].msg_len == 0) {
+        continue;
+      }
+      if (!olsr_input_packet(fd, (char *)inbuf_ring[i], inbuf_msgs[i].msg_len,
+                             &inbuf_from[i], inbuf_msgs[i].msg_hdr.msg_namelen)) {
+        more = false;
+      }
+    }
+    packets += n;
+
+    if (!more || n < NET_BATCH_SIZE) {
+      break;
+    }
+  }
+
+  if (packets >= INPUT_MAX_PACKETS) {
+    OLSR_PRINTF(1, "CPU overload detected, ending olsr_input() loop\n");
+  }
+  return true;
+}
+#endif /* __linux__ */
+
 /**
  *Processing OLSR data from socket. Reading data, setting
  *wich interface received the message, Sends IPC(if used)
@@ -418,21 +584,27 @@ parse_packet(struct olsr *olsr, int size, struct interface_olsr *in_if, union ol
 void
 olsr_input(int fd, void *data __attribute__ ((unused)), unsigned int flags __attribute__ ((unused)))
 {
-  struct interface_olsr *olsr_in_if;
-  union olsr_ip_addr from_addr;
-  struct preprocessor_function_entry *entry;
-  char *packet;
+#ifdef __linux__
+  static bool recvmmsg_unsupported = false;
+
+  if (!recvmmsg_unsupported) {
+    if (olsr_input_batched(fd)) {
+      return;
+    }
+    OLSR_PRINTF(1, "recvmmsg not supported, reading packets one by one\n");
+    recvmmsg_unsupported = true;
+  }
+#endif /* __linux__ */
 
   cpu_overload_exit = 0;
 
   for (;;) {
-    struct ipaddr_str buf;
     /* sockaddr_in6 is bigger than sockaddr !!!! */
     struct sockaddr_storage from;
     socklen_t fromlen;
     int cc;
 
-    if (32 < ++cpu_overload_exit) {
+    if (INPUT_MAX_PACKETS < ++cpu_overload_exit) {
       OLSR_PRINTF(1, "CPU overload detected, ending olsr_input() loop\n");
       break;
     }
@@ -449,67 +621,11 @@ olsr_input(int fd, void *data __attribute__ ((unused)), unsigned int flags __att
       }
       break;
     }
+    net_batch_account(&net_rx_batch_stats, 1);
 
-    {
-      void * src;
-      void * dst;
-      size_t size;
-      if (olsr_cnf->ip_version == AF_INET) {
-        /* IPv4 sender address */
-        struct sockaddr_in * x = (struct sockaddr_in *) &from;
-        src = &x->sin_addr;
-        dst = &from_addr.v4;
-        size = sizeof(from_addr.v4);
-      } else {
-        /* IPv6 sender address */
-        struct sockaddr_in6 * x = (struct sockaddr_in6 *) &from;
-        src = &x->sin6_addr;
-        dst = &from_addr.v6;
-        size = sizeof(from_addr.v6);
-      }
-      memcpy(dst, src, size);
-    }
-
-#ifdef DEBUG
-    OLSR_PRINTF(5, "Received a packet from %s\n",
-        olsr_ip_to_string(&buf, &from_addr));
-#endif /* DEBUG */
-
-    if ((olsr_cnf->ip_version == AF_INET) && (fromlen != sizeof(struct sockaddr_in)))
-      break;
-    else if ((olsr_cnf->ip_version == AF_INET6) && (fromlen != sizeof(struct sockaddr_in6)))
+    if (!olsr_input_packet(fd, inbuf, cc, &from, fromlen)) {
       break;
-
-    /* are we talking to ourselves? */
-    if (if_ifwithaddr(&from_addr) != NULL)
-      return;
-
-    if ((olsr_in_if = if_ifwithsock(fd)) == NULL) {
-      OLSR_PRINTF(1, "Could not find input interface for message from %s size %d\n", olsr_ip_to_string(&buf, &from_addr), cc);
-      olsr_syslog(OLSR_LOG_ERR, "Could not find input interface for message from %s size %d\n", olsr_ip_to_string(&buf, &from_addr),
-                  cc);
-      return;
-    }
-    // call preprocessors
-    entry = preprocessor_functions;
-    packet = &inbuf[0];
-
-    while (entry) {
-      packet = entry->function(packet, olsr_in_if, &from_addr, &cc);
-      // discard package ?
-      if (packet == NULL) {
-        return;
-      }
-      entry = entry->next;
     }
-
-    /*
-     * &from - sender
-     * &inbuf.olsr
-     * cc - bytes read
-     */
-    parse_packet((struct olsr *)packet, cc, olsr_in_if, &from_addr);
-
   }
 }
 
@@ -52,6 +52,7 @@
 #include "tc_set.h"
 #include "mpr_selector_set.h"
 #include "mid_set.h"
+#include "mpr.h"
 #include "olsr.h"
 #include "parser.h"
 #include "duplicate_set.h"
@@ -150,6 +151,8 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
 
           two_hop_neighbor->neighbor_2_addr = message_neighbors->address;
 
+          list_node_init(&two_hop_neighbor->mpr_dirty_node);
+
           olsr_insert_two_hop_neighbor_table(two_hop_neighbor);
 
           linking_this_2_entries(neighbor, two_hop_neighbor, message->vtime);
@@ -173,8 +176,11 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
     olsr_linkcost first_hop_pathcost;
     struct link_entry *lnk = get_best_link_to_neighbor(&neighbor->neighbor_main_addr);
 
-    if (!lnk)
+    if (!lnk) {
+      /* the path costs reset above stay broken */
+      olsr_mpr_touch_neighbor(neighbor);
       return;
+    }
 
     /* calculate first hop path quality */
     first_hop_pathcost = lnk->linkcost;
@@ -230,6 +236,9 @@ process_message_neighbors(struct neighbor_entry *neighbor, const struct hello_me
             // Only copy the link quality if it is better than what we have
             // for this 2-hop neighbor
             if (new_path_linkcost < walker->path_linkcost) {
+              if (new_path_linkcost != walker->saved_path_linkcost)
+                olsr_mpr_touch_two_hop(two_hop_neighbor);
+
               walker->second_hop_linkcost = new_second_hop_linkcost;
               walker->path_linkcost = new_path_linkcost;
 
@@ -263,6 +272,7 @@ linking_this_2_entries(struct neighbor_entry *neighbor, struct neighbor_2_entry
   list_of_1_neighbors->path_linkcost = LINK_COST_BROKEN;
   list_of_1_neighbors->saved_path_linkcost = LINK_COST_BROKEN;
   list_of_1_neighbors->second_hop_linkcost = LINK_COST_BROKEN;
+  list_of_1_neighbors->mpr_selected = false;
 
   /* Queue */
   two_hop_neighbor->neighbor_2_nblist.next->prev = list_of_1_neighbors;
@@ -283,6 +293,8 @@ linking_this_2_entries(struct neighbor_entry *neighbor, struct neighbor_2_entry
 
   /*increment the pointer counter */
   two_hop_neighbor->neighbor_2_pointer++;
+
+  olsr_mpr_touch_two_hop(two_hop_neighbor);
 }
 
 /**
@@ -400,6 +412,7 @@ olsr_init_package_process(void)
   } else {
     olsr_parser_add_function(&olsr_input_hello, LQ_HELLO_MESSAGE);
     olsr_parser_add_function(&olsr_input_tc, LQ_TC_MESSAGE);
+    olsr_parser_add_function(&olsr_input_tc_delta, LQ_TC_DELTA_MESSAGE);
   }
 
   olsr_parser_add_function(&olsr_input_mid, MID_MESSAGE);
@@ -483,6 +496,7 @@ olsr_hello_tap(struct hello_message *message, struct interface_olsr *in_if, cons
      *If willingness changed - recalculate
      */
     neighbor->willingness = message->willingness;
+    olsr_mpr_touch_neighbor(neighbor);
     changes_neighborhood = true;
     changes_topology = true;
   }
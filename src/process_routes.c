@@ -62,6 +62,9 @@ char *StrError(unsigned int ErrNo);
 
 static struct list_node chg_kernel_list;
 
+/* route heads whose kernel deletion failed during a RIB update */
+static struct list_node rt_retry_list;
+
 /**
  *
  * Calculate the kernel route flags.
@@ -100,6 +103,7 @@ olsr_init_export_route(void)
   /* the add/chg/del kernel queues */
   //list_head_init(&add_kernel_list);
   list_head_init(&chg_kernel_list);
+  list_head_init(&rt_retry_list);
 
   olsr_addroute_function = olsr_ioctl_add_route;
   olsr_addroute6_function = olsr_ioctl_add_route6;
@@ -151,13 +155,86 @@ olsr_enqueue_rt(struct list_node *head_node, struct rt_entry *rt)
   }
 }
 
+#ifdef __linux__
 /**
- * Process a route from the kernel deletion list.
+ * Check if route changes can be batched, which is only possible
+ * if the builtin netlink route functions are in place.
+ */
+static bool
+olsr_kernel_routes_batched(void)
+{
+  return !olsr_cnf->host_emul
+      && olsr_addroute_function == olsr_ioctl_add_route && olsr_addroute6_function == olsr_ioctl_add_route6
+      && olsr_delroute_function == olsr_ioctl_del_route && olsr_delroute6_function == olsr_ioctl_del_route6;
+}
+#endif /* __linux__ */
+
+/**
+ * Keep a route head for a retry with the next RIB update.
+ * It must not go back into the journal while the journal is drained.
+ */
+static void
+olsr_retry_rt_entry(struct rt_entry *rt)
+{
+  if (!list_node_on_list(&rt->rt_journal_node)) {
+    list_add_before(&rt_retry_list, &rt->rt_journal_node);
+  }
+}
+
+/**
+ * Handle the result of a route deletion.
  *
  *@return -1 on error, else 0
  */
 static int
-olsr_delete_kernel_route(struct rt_entry *rt)
+olsr_delete_kernel_route_result(struct rt_entry *rt, int error)
+{
+  if (error != 0) {
+    const char *const err_msg = strerror(errno);
+    const char *const routestr = olsr_rt_to_string(rt);
+    OLSR_PRINTF(1, "KERN: ERROR deleting %s: %s\n", routestr, err_msg);
+
+    olsr_syslog(OLSR_LOG_ERR, "Delete route %s: %s", routestr, err_msg);
+    return -1;
+  }
+#ifdef __linux__
+  /* call NIIT handler (always)*/
+  if (olsr_cnf->use_niit) {
+    olsr_niit_handle_route(rt, false);
+  }
+#endif /* __linux__ */
+  return 0;
+}
+
+#ifdef __linux__
+static void
+olsr_delete_kernel_route_done(struct rt_entry *rt, int error)
+{
+  olsr_delete_kernel_route_result(rt, error);
+}
+
+/* the route head has no paths left, drop it once the kernel route is gone */
+static void
+olsr_flush_kernel_route_done(struct rt_entry *rt, int error)
+{
+  if (olsr_delete_kernel_route_result(rt, error) != 0) {
+    /* retry with the next RIB update */
+    olsr_retry_rt_entry(rt);
+  } else if (rt->rt_path_tree.count == 0) {
+    olsr_remove_rt_entry(rt);
+    olsr_cookie_free(rt_mem_cookie, rt);
+  }
+}
+#endif /* __linux__ */
+
+/**
+ * Process a route from the kernel deletion list.
+ * If the deletion is batched the result is reported to the done callback.
+ *
+ *@return -1 on error, 1 if the deletion was queued, else 0
+ */
+static int
+olsr_delete_kernel_route(struct rt_entry *rt, olsr_route_done_function done __attribute__ ((unused)))
 {
   if (rt->rt_metric.hops > 1) {
     /* multihop route */
@@ -168,24 +245,50 @@ olsr_delete_kernel_route(struct rt_entry *rt)
   }
 
   if (!olsr_cnf->host_emul) {
-    int16_t error = olsr_cnf->ip_version == AF_INET ? olsr_delroute_function(rt) : olsr_delroute6_function(rt);
+    int16_t error;
 
-    if (error != 0) {
-      const char *const err_msg = strerror(errno);
-      const char *const routestr = olsr_rt_to_string(rt);
-      OLSR_PRINTF(1, "KERN: ERROR deleting %s: %s\n", routestr, err_msg);
-
-      olsr_syslog(OLSR_LOG_ERR, "Delete route %s: %s", routestr, err_msg);
-      return -1;
+#ifdef __linux__
+    if (olsr_kernel_routes_batched()) {
+      olsr_os_route_batch_add(rt, false, done);
+      return 1;
     }
+#endif /* __linux__ */
+
+    error = olsr_cnf->ip_version == AF_INET ? olsr_delroute_function(rt) : olsr_delroute6_function(rt);
+    return olsr_delete_kernel_route_result(rt, error);
+  }
+  return 0;
+}
+
+/**
+ * Handle the result of a route addition.
+ */
+static void
+olsr_add_kernel_route_done(struct rt_entry *rt, int error)
+{
+  if (error != 0) {
+    const char *const err_msg = strerror(errno);
+    const char *const routestr = olsr_rtp_to_string(rt->rt_best);
+    OLSR_PRINTF(1, "KERN: ERROR adding %s: %s\n", routestr, err_msg);
+
+    olsr_syslog(OLSR_LOG_ERR, "Add route %s: %s", routestr, err_msg);
+
+    /* retry with the next RIB update */
+    olsr_journal_rt_entry(rt);
+  } else {
+    /* route addition has suceeded */
+
+    /* save the nexthop and metric in the route entry */
+    rt->rt_nexthop = rt->rt_best->rtp_nexthop;
+    rt->rt_metric = rt->rt_best->rtp_metric;
+
 #ifdef __linux__
-    /* call NIIT handler (always)*/
+    /* call NIIT handler */
     if (olsr_cnf->use_niit) {
-      olsr_niit_handle_route(rt, false);
+      olsr_niit_handle_route(rt, true);
     }
 #endif /* __linux__ */
   }
-  return 0;
 }
 
 /**
@@ -204,28 +307,17 @@ olsr_add_kernel_route(struct rt_entry *rt)
     }
   }
   if (!olsr_cnf->host_emul) {
-    int16_t error = (olsr_cnf->ip_version == AF_INET) ? olsr_addroute_function(rt) : olsr_addroute6_function(rt);
-
-    if (error != 0) {
-      const char *const err_msg = strerror(errno);
-      const char *const routestr = olsr_rtp_to_string(rt->rt_best);
-      OLSR_PRINTF(1, "KERN: ERROR adding %s: %s\n", routestr, err_msg);
-
-      olsr_syslog(OLSR_LOG_ERR, "Add route %s: %s", routestr, err_msg);
-    } else {
-      /* route addition has suceeded */
-
-      /* save the nexthop and metric in the route entry */
-      rt->rt_nexthop = rt->rt_best->rtp_nexthop;
-      rt->rt_metric = rt->rt_best->rtp_metric;
+    int16_t error;
 
 #ifdef __linux__
-      /* call NIIT handler */
-      if (olsr_cnf->use_niit) {
-        olsr_niit_handle_route(rt, true);
-      }
-#endif /* __linux__ */
+    if (olsr_kernel_routes_batched()) {
+      olsr_os_route_batch_add(rt, true, &olsr_add_kernel_route_done);
+      return;
     }
+#endif /* __linux__ */
+
+    error = (olsr_cnf->ip_version == AF_INET) ? olsr_addroute_function(rt) : olsr_addroute6_function(rt);
+    olsr_add_kernel_route_done(rt, error);
   }
 }
 
@@ -264,17 +356,22 @@ olsr_chg_kernel_routes(struct list_node *head_node)
          || (olsr_addroute_function != olsr_ioctl_add_route) || (olsr_addroute6_function != olsr_ioctl_add_route6)
          || (olsr_delroute_function != olsr_ioctl_del_route) || (olsr_delroute6_function != olsr_ioctl_del_route6))
         && (rt->rt_nexthop.iif_index > -1)) {
-      olsr_delete_kernel_route(rt);
+      olsr_delete_kernel_route(rt, &olsr_delete_kernel_route_done);
     }
 #else /* __linux__ */
     /*no rtnetlink we have to delete routes*/
-    if (rt->rt_nexthop.iif_index > -1) olsr_delete_kernel_route(rt);
+    if (rt->rt_nexthop.iif_index > -1) olsr_delete_kernel_route(rt, NULL);
 #endif /* __linux__ */
 
     olsr_add_kernel_route(rt);
 
     list_remove(&rt->rt_change_node);
   }
+
+#ifdef __linux__
+  /* send the remaining batched changes */
+  olsr_os_route_batch_flush();
+#endif /* __linux__ */
 }
 
 /**
@@ -303,8 +400,7 @@ olsr_delete_outdated_routes(struct rt_entry *rt)
      */
     if (routingtree_version != rtp->rtp_version) {
       /* remove from the originator tree */
-      avl_delete(&rt->rt_path_tree, rtp_tree_node);
-      rtp->rtp_rt = NULL;
+      olsr_detach_rt_path(rtp);
 
       if (rt->rt_best == rtp) {
         rt->rt_best = NULL;
@@ -314,21 +410,29 @@ olsr_delete_outdated_routes(struct rt_entry *rt)
 }
 
 /**
- * Walk all the routes, remove outdated routes and run
+ * Walk the routes in the journal, remove outdated routes and run
  * best path selection on the remaining set.
  * Finally compare the nexthop of the route head and the best
  * path and enqueue an add/chg operation.
+ *
+ * Routes which are not in the journal did not change
+ * since the last update and are skipped.
  */
 void
 olsr_update_rib_routes(void)
 {
   struct rt_entry *rt;
 
-  OLSR_PRINTF(3, "Updating kernel routes...\n");
+  /* routes with paths which were not refreshed by the SPF run */
+  olsr_journal_outdated_rt_paths();
 
-  /* walk all routes in the RIB. */
+  OLSR_PRINTF(3, "Updating kernel routes (%u changed since version %u)...\n", rt_journal.count, rt_journal.version);
 
-  OLSR_FOR_ALL_RT_ENTRIES(rt) {
+  while (!list_is_empty(&rt_journal.head)) {
+    int error;
+
+    rt = journal2rt(rt_journal.head.next);
+    olsr_unjournal_rt_entry(rt);
 
     /* eliminate first unused routes */
     olsr_delete_outdated_routes(rt);
@@ -336,11 +440,19 @@ olsr_update_rib_routes(void)
     if (!rt->rt_path_tree.count) {
 
       /* oops, all routes are gone - flush the route head */
-  
-      if (olsr_delete_kernel_route(rt) == 0) {
+
+#ifdef __linux__
+      error = olsr_delete_kernel_route(rt, &olsr_flush_kernel_route_done);
+#else /* __linux__ */
+      error = olsr_delete_kernel_route(rt, NULL);
+#endif /* __linux__ */
+      if (error == 0) {
         /*only remove if deletion was successful*/
-        avl_delete(&routingtree, &rt->rt_tree_node);
+        olsr_remove_rt_entry(rt);
         olsr_cookie_free(rt_mem_cookie, rt);
+      } else if (error < 0) {
+        /* retry with the next RIB update */
+        olsr_retry_rt_entry(rt);
       }
 
       continue;
@@ -357,7 +469,18 @@ olsr_update_rib_routes(void)
         olsr_enqueue_rt(&chg_kernel_list, rt);
     }
   }
-  OLSR_FOR_ALL_RT_ENTRIES_END(rt);
+
+#ifdef __linux__
+  /* send the batched deletions, route heads are freed on success */
+  olsr_os_route_batch_flush();
+#endif /* __linux__ */
+
+  /* failed deletions go into the journal of the next RIB update */
+  while (!list_is_empty(&rt_retry_list)) {
+    rt = journal2rt(rt_retry_list.next);
+    list_remove(&rt->rt_journal_node);
+    olsr_journal_rt_entry(rt);
+  }
 }
 
 void
@@ -382,8 +505,7 @@ olsr_delete_interface_routes(int if_index) {
       /* nexthop use lost interface ? */
       if (rtp->rtp_nexthop.iif_index == if_index) {
         /* remove from the originator tree */
-        avl_delete(&rt->rt_path_tree, rtp_tree_node);
-        rtp->rtp_rt = NULL;
+        olsr_detach_rt_path(rtp);
 
         if (rt->rt_best == rtp) {
           rt->rt_best = NULL;
@@ -395,9 +517,12 @@ olsr_delete_interface_routes(int if_index) {
     if (mightTrigger) {
       if (!rt->rt_path_tree.count) {
         /* oops, all routes are gone - flush the route head */
-        avl_delete(&routingtree, rt_tree_node);
+        olsr_remove_rt_entry(rt);
+        olsr_unjournal_rt_entry(rt);
 
         /* do not dequeue route because they are already gone */
+      } else {
+        olsr_journal_rt_entry(rt);
       }
       triggerUpdate = true;
     }
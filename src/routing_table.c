@@ -74,12 +74,21 @@ static struct rt_path *current_inetgw = NULL;
 /* Root of our RIB */
 struct avl_tree routingtree;
 
+/* longest prefix match index of the routingtree entries */
+static struct radix_tree routingtree_lpm;
+
 /*
  * Keep a version number for detecting outdated elements
  * in the per rt_entry rt_path subtree.
  */
 unsigned int routingtree_version;
 
+/* route entries with changed paths */
+struct rt_journal rt_journal;
+
+/* all rt_paths in the RIB, least recently updated first */
+static struct list_node rtp_version_list;
+
 /**
  * Bump the version number of the routing tree.
  *
@@ -94,6 +103,79 @@ olsr_bump_routingtree_version(void)
   return routingtree_version++;
 }
 
+/**
+ * Queue a route entry for the next RIB update.
+ */
+void
+olsr_journal_rt_entry(struct rt_entry *rt)
+{
+  if (list_node_on_list(&rt->rt_journal_node)) {
+    return;
+  }
+  if (list_is_empty(&rt_journal.head)) {
+    rt_journal.version = routingtree_version;
+  }
+  list_add_before(&rt_journal.head, &rt->rt_journal_node);
+  rt_journal.count++;
+}
+
+/**
+ * Remove a route entry from the journal.
+ */
+void
+olsr_unjournal_rt_entry(struct rt_entry *rt)
+{
+  if (list_node_on_list(&rt->rt_journal_node)) {
+    list_remove(&rt->rt_journal_node);
+    rt_journal.count--;
+  }
+}
+
+/**
+ * Unlink a route entry from the routingtree and its
+ * longest prefix match index, the caller frees it.
+ */
+void
+olsr_remove_rt_entry(struct rt_entry *rt)
+{
+  avl_delete(&routingtree, &rt->rt_tree_node);
+  radix_delete(&routingtree_lpm, &rt->rt_lpm_node);
+}
+
+/**
+ * Queue the route entries of all rt_paths which were not updated
+ * since the last bump of the routingtree version.
+ *
+ * Updated paths move to the tail of the version list, so the
+ * outdated ones are found at its head.
+ */
+void
+olsr_journal_outdated_rt_paths(void)
+{
+  struct list_node *node;
+
+  for (node = rtp_version_list.next; node != &rtp_version_list; node = node->next) {
+    struct rt_path *rtp = versionlist2rtp(node);
+
+    if (rtp->rtp_version == routingtree_version) {
+      break;
+    }
+    olsr_journal_rt_entry(rtp->rtp_rt);
+  }
+}
+
+/**
+ * Remove a rt_path from its route entry, the caller
+ * takes care of the best path of the route entry.
+ */
+void
+olsr_detach_rt_path(struct rt_path *rtp)
+{
+  avl_delete(&rtp->rtp_rt->rt_path_tree, &rtp->rtp_tree_node);
+  list_remove(&rtp->rtp_version_node);
+  rtp->rtp_rt = NULL;
+}
+
 /**
  * avl_comp_ipv4_prefix
  *
@@ -174,16 +256,23 @@ olsr_init_routing_table(void)
 
   /* the routing tree */
   avl_init(&routingtree, avl_comp_prefix_default);
+  radix_init(&routingtree_lpm, olsr_cnf->ipsize);
   routingtree_version = 0;
 
+  list_head_init(&rt_journal.head);
+  rt_journal.count = 0;
+  list_head_init(&rtp_version_list);
+
   /*
    * Get some cookies for memory stats and memory recycling.
    */
   rt_mem_cookie = olsr_alloc_cookie("rt_entry", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(rt_mem_cookie, sizeof(struct rt_entry));
+  olsr_cookie_set_slab(rt_mem_cookie, 0, true);
 
   rtp_mem_cookie = olsr_alloc_cookie("rt_path", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(rtp_mem_cookie, sizeof(struct rt_path));
+  olsr_cookie_set_slab(rtp_mem_cookie, 0, true);
 }
 
 /**
@@ -208,20 +297,49 @@ olsr_lookup_routing_table(const union olsr_ip_addr *dst)
   return rt_tree_node ? rt_tree2rt(rt_tree_node) : NULL;
 }
 
+/**
+ * Look up the most specific entry of the routing table
+ * which contains an address.
+ *
+ * @param dst the address
+ *
+ * @return a pointer to the rt_entry with the longest
+ * matching prefix or NULL if there is none.
+ */
+struct rt_entry *
+olsr_lookup_routing_table_lpm(const union olsr_ip_addr *dst)
+{
+  return rt_lpm2rt(radix_lookup(&routingtree_lpm, dst));
+}
+
 /**
  * Update gateway/interface/etx/hopcount and the version for a route path.
  */
 void
 olsr_update_rt_path(struct rt_path *rtp, struct tc_entry *tc, struct link_entry *link)
 {
+  struct rt_nexthop nexthop;
 
   rtp->rtp_version = routingtree_version;
 
+  /* keep the version list ordered by the last update */
+  if (list_node_on_list(&rtp->rtp_version_node)) {
+    list_remove(&rtp->rtp_version_node);
+  }
+  list_add_before(&rtp_version_list, &rtp->rtp_version_node);
+
   /* gateway */
-  rtp->rtp_nexthop.gateway = link->neighbor_iface_addr;
+  nexthop.gateway = link->neighbor_iface_addr;
 
   /* interface */
-  rtp->rtp_nexthop.iif_index = link->inter->if_index;
+  nexthop.iif_index = link->inter->if_index;
+
+  /* the route entry needs a new best path election on any change */
+  if (olsr_nh_change(&nexthop, &rtp->rtp_nexthop)
+      || rtp->rtp_metric.hops != tc->hops || rtp->rtp_metric.cost != tc->path_cost) {
+    olsr_journal_rt_entry(rtp->rtp_rt);
+  }
+  rtp->rtp_nexthop = nexthop;
 
   /* metric/etx */
   rtp->rtp_metric.hops = tc->hops;
@@ -250,6 +368,10 @@ olsr_alloc_rt_entry(struct olsr_ip_prefix *prefix)
   rt->rt_tree_node.key = &rt->rt_dst;
   avl_insert(&routingtree, &rt->rt_tree_node, AVL_DUP_NO);
 
+  rt->rt_lpm_node.key = &rt->rt_dst.prefix;
+  rt->rt_lpm_node.prefix_len = rt->rt_dst.prefix_len;
+  radix_insert(&routingtree_lpm, &rt->rt_lpm_node);
+
   /* init the originator subtree */
   avl_init(&rt->rt_path_tree, avl_comp_default);
 
@@ -341,6 +463,7 @@ olsr_insert_rt_path(struct rt_path *rtp, struct tc_entry *tc, struct link_entry
 
   /* backlink to the owning route entry */
   rtp->rtp_rt = rt;
+  olsr_journal_rt_entry(rt);
 
   /* update the version field and relevant parameters */
   olsr_update_rt_path(rtp, tc, link);
@@ -355,8 +478,8 @@ olsr_delete_rt_path(struct rt_path *rtp)
 
   /* remove from the originator tree */
   if (rtp->rtp_rt) {
-    avl_delete(&rtp->rtp_rt->rt_path_tree, &rtp->rtp_tree_node);
-    rtp->rtp_rt = NULL;
+    olsr_journal_rt_entry(rtp->rtp_rt);
+    olsr_detach_rt_path(rtp);
   }
 
   /* remove from the tc prefix tree */
@@ -572,6 +695,7 @@ olsr_insert_routing_table(union olsr_ip_addr *dst, int plen, union olsr_ip_addr
 
     /* overload the hna change bit for flagging a prefix change */
     changes_hna = true;
+    olsr_spf_touch_vertex(tc);
 
   } else {
     rtp = rtp_prefix_tree2rtp(node);
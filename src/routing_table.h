@@ -56,6 +56,7 @@
 #include "olsr_cookie.h"
 #include "common/avl.h"
 #include "common/list.h"
+#include "common/radix.h"
 
 #define NETMASK_HOST 0xffffffff
 #define NETMASK_DEFAULT 0x0
@@ -82,15 +83,19 @@ struct rt_nexthop {
 struct rt_entry {
   struct olsr_ip_prefix rt_dst;
   struct avl_node rt_tree_node;
+  struct radix_node rt_lpm_node;       /* longest prefix match index */
   struct rt_path *rt_best;             /* shortcut to the best path */
   struct rt_nexthop rt_nexthop;        /* nexthop of FIB route */
   struct rt_metric rt_metric;          /* metric of FIB route */
   struct avl_tree rt_path_tree;
   struct list_node rt_change_node;     /* queue for kernel FIB add/chg/del */
+  struct list_node rt_journal_node;    /* queue for the next RIB update */
 };
 
 AVLNODE2STRUCT(rt_tree2rt, struct rt_entry, rt_tree_node);
+RADIXNODE2STRUCT(rt_lpm2rt, struct rt_entry, rt_lpm_node);
 LISTNODE2STRUCT(changelist2rt, struct rt_entry, rt_change_node);
+LISTNODE2STRUCT(journal2rt, struct rt_entry, rt_journal_node);
 
 /*
  * For every received route a rt_path is added to the RIB.
@@ -110,11 +115,13 @@ struct rt_path {
   struct avl_node rtp_prefix_tree_node; /* tc entry rtp node */
   struct olsr_ip_prefix rtp_dst;       /* the prefix */
   uint32_t rtp_version;                /* for detection of outdated rt_paths */
+  struct list_node rtp_version_node;   /* RIB paths in order of their last update */
   uint8_t rtp_origin;                  /* internal, MID or HNA */
 };
 
 AVLNODE2STRUCT(rtp_tree2rtp, struct rt_path, rtp_tree_node);
 AVLNODE2STRUCT(rtp_prefix_tree2rtp, struct rt_path, rtp_prefix_tree_node);
+LISTNODE2STRUCT(versionlist2rtp, struct rt_path, rtp_version_node);
 
 /*
  * In olsrd we have three different route types.
@@ -190,14 +197,32 @@ union olsr_kernel_route {
   } v6;
 };
 
+/*
+ * The route journal collects the route entries whose set of paths
+ * changed since the last RIB update, such that the update does not
+ * need to walk the whole routing tree.
+ */
+struct rt_journal {
+  struct list_node head;
+  unsigned int version;                /* routingtree_version of the first entry */
+  unsigned int count;
+};
+
 extern struct avl_tree routingtree;
 extern unsigned int routingtree_version;
+extern struct rt_journal rt_journal;
 extern struct olsr_cookie_info *rt_mem_cookie;
 
 void olsr_init_routing_table(void);
 
 unsigned int olsr_bump_routingtree_version(void);
 
+void olsr_journal_rt_entry(struct rt_entry *);
+void olsr_unjournal_rt_entry(struct rt_entry *);
+void olsr_remove_rt_entry(struct rt_entry *);
+void olsr_journal_outdated_rt_paths(void);
+void olsr_detach_rt_path(struct rt_path *);
+
 int avl_comp_ipv4_prefix(const void *, const void *);
 int avl_comp_ipv6_prefix(const void *, const void *);
 
@@ -225,6 +250,7 @@ void olsr_update_rt_path(struct rt_path *, struct tc_entry *, struct link_entry
 void olsr_delete_rt_path(struct rt_path *);
 
 struct rt_entry *olsr_lookup_routing_table(const union olsr_ip_addr *);
+struct rt_entry *olsr_lookup_routing_table_lpm(const union olsr_ip_addr *);
 
 #endif /* _OLSR_ROUTING_TABLE */
 
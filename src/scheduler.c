@@ -49,6 +49,7 @@
 #include "olsr.h"
 #include "olsr_cookie.h"
 #include "net_os.h"
+#include "net_olsr.h"
 #include "mpr_selector_set.h"
 #include "olsr_random.h"
 #include "common/avl.h"
@@ -59,6 +60,11 @@
 #include <assert.h>
 #include <time.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <poll.h>
+#endif /* __linux__ */
+
 #ifdef _WIN32
 #define close(x) closesocket(x)
 #endif /* _WIN32 */
@@ -69,8 +75,9 @@ struct timespec first_tv;              /* timevalue during startup */
 struct timespec last_tv;               /* timevalue used for last olsr_times() calculation */
 
 /* Hashed root of all timers */
-static struct list_node timer_wheel[TIMER_WHEEL_SLOTS];
-static uint32_t timer_last_run;        /* remember the last timeslot walk */
+static struct list_node timer_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static unsigned int timer_wheel_count[TIMER_WHEEL_LEVELS];      /* timers hashed per level */
+static uint32_t timer_last_run;        /* next clocktick to be walked */
 
 /* Memory cookie for the block based memory manager */
 static struct olsr_cookie_info *timer_mem_cookie = NULL;
@@ -78,9 +85,56 @@ static struct olsr_cookie_info *timer_mem_cookie = NULL;
 /* Head of all OLSR used sockets */
 static struct list_node socket_head = { &socket_head, &socket_head };
 
+#ifdef __linux__
+/*
+ * The epoll backend keeps the socket registration in the kernel, so
+ * the main loop does not have to rebuild fd sets on every iteration.
+ * There is one epoll set for the pollrate handlers and one for the
+ * immediate handlers, each registered edge triggered.
+ * Socket handlers are not required to drain their socket, so an entry
+ * stays on the ready list of its set after it has been processed
+ * and gets re-checked with poll(2) before the next wait.
+ */
+#define SOCKET_EPOLL_POLLRATE  0
+#define SOCKET_EPOLL_IMMEDIATE 1
+#define SOCKET_EPOLL_SETS      2
+
+#define SOCKET_EPOLL_EVENTS   64
+
+struct socket_epoll_set {
+  int epoll_fd;                        /* -1 if the select(2) backend is used */
+  unsigned int mask;                   /* SP_* flags handled by this set */
+  struct olsr_socket_entry **ready;    /* entries with pending readiness */
+  unsigned int ready_count;
+  unsigned int ready_size;
+};
+
+struct socket_fd_slot {
+  struct olsr_socket_entry *head;      /* all socket entries using this fd */
+  uint32_t events[SOCKET_EPOLL_SETS];  /* registered epoll events per set */
+};
+
+static struct socket_epoll_set socket_epoll[SOCKET_EPOLL_SETS] = {
+  { -1, SP_PR_READ | SP_PR_WRITE, NULL, 0, 0 },
+  { -1, SP_IMM_READ | SP_IMM_WRITE, NULL, 0, 0 }
+};
+
+/* epoll registration indexed by fd */
+static struct socket_fd_slot *socket_fd_table = NULL;
+static int socket_fd_table_size = 0;
+
+/* scratch array for re-checking the ready lists */
+static struct pollfd *socket_probe = NULL;
+static unsigned int socket_probe_size = 0;
+
+/* epoll is not available, stay with select(2) */
+static bool socket_epoll_failed = false;
+#endif /* __linux__ */
+
 /* Prototypes */
 static void walk_timers(uint32_t *);
 static void walk_timers_cleanup(void);
+static bool olsr_timer_next_deadline(uint32_t *);
 static void poll_sockets(void);
 static uint32_t calc_jitter(unsigned int rel_time, uint8_t jitter_pct, unsigned int random_val);
 static void olsr_cleanup_timer(struct timer_entry *timer);
@@ -212,6 +266,350 @@ olsr_isTimedOut(uint32_t s)
   return now_times - s <= (1u << 31);
 }
 
+#ifdef __linux__
+/**
+ * Create the epoll sets on first use.
+ *
+ * @return true if the epoll backend is available
+ */
+static bool
+olsr_socket_epoll_init(void)
+{
+  int i;
+
+  if (socket_epoll[0].epoll_fd != -1) {
+    return true;
+  }
+  if (socket_epoll_failed) {
+    return false;
+  }
+
+  for (i = 0; i < SOCKET_EPOLL_SETS; i++) {
+    socket_epoll[i].epoll_fd = epoll_create(SOCKET_EPOLL_EVENTS);
+    if (socket_epoll[i].epoll_fd == -1) {
+      OLSR_PRINTF(1, "epoll not available (%s), using select\n", strerror(errno));
+      while (i-- > 0) {
+        close(socket_epoll[i].epoll_fd);
+        socket_epoll[i].epoll_fd = -1;
+      }
+      socket_epoll_failed = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @return the epoll registration of a fd, grows the table if necessary
+ */
+static struct socket_fd_slot *
+olsr_socket_epoll_slot(int fd)
+{
+  if (fd >= socket_fd_table_size) {
+    int size = socket_fd_table_size ? socket_fd_table_size : 64;
+
+    while (size <= fd) {
+      size *= 2;
+    }
+    socket_fd_table = olsr_realloc(socket_fd_table, size * sizeof(*socket_fd_table), "Socket fd table");
+    memset(&socket_fd_table[socket_fd_table_size], 0, (size - socket_fd_table_size) * sizeof(*socket_fd_table));
+    socket_fd_table_size = size;
+  }
+  return &socket_fd_table[fd];
+}
+
+/**
+ * @return the socket handler of an entry for an epoll set
+ */
+static socket_handler_func
+olsr_socket_epoll_handler(struct olsr_socket_entry *entry, int set)
+{
+  return set == SOCKET_EPOLL_POLLRATE ? entry->process_pollrate : entry->process_immediate;
+}
+
+/**
+ * Push the interest of all entries of a fd into the epoll sets.
+ *
+ * @param fd the socket
+ * @param rearm force a re-check of the readiness even if the
+ *   registered events did not change
+ */
+static void
+olsr_socket_epoll_update(int fd, bool rearm)
+{
+  struct socket_fd_slot *slot = olsr_socket_epoll_slot(fd);
+  int set;
+
+  for (set = 0; set < SOCKET_EPOLL_SETS; set++) {
+    struct olsr_socket_entry *entry;
+    struct epoll_event event;
+    uint32_t events = 0;
+    int op;
+
+    for (entry = slot->head; entry; entry = entry->fd_next) {
+      if (olsr_socket_epoll_handler(entry, set) == NULL) {
+        continue;
+      }
+      if ((entry->flags & socket_epoll[set].mask & (SP_PR_READ | SP_IMM_READ)) != 0) {
+        events |= EPOLLIN;
+      }
+      if ((entry->flags & socket_epoll[set].mask & (SP_PR_WRITE | SP_IMM_WRITE)) != 0) {
+        events |= EPOLLOUT;
+      }
+    }
+
+    if (events == slot->events[set] && (!rearm || events == 0)) {
+      continue;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = events | EPOLLET;
+    event.data.fd = fd;
+
+    if (events == 0) {
+      /* the fd might be closed already, nothing to report then */
+      epoll_ctl(socket_epoll[set].epoll_fd, EPOLL_CTL_DEL, fd, &event);
+      slot->events[set] = 0;
+      continue;
+    }
+
+    op = slot->events[set] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(socket_epoll[set].epoll_fd, op, fd, &event) == -1) {
+      /* the fd might have been closed and reused behind our back */
+      if ((errno != ENOENT && errno != EEXIST)
+          || epoll_ctl(socket_epoll[set].epoll_fd, op == EPOLL_CTL_ADD ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) == -1) {
+        OLSR_PRINTF(1, "epoll_ctl error for socket %d: %s\n", fd, strerror(errno));
+        slot->events[set] = 0;
+        continue;
+      }
+    }
+    slot->events[set] = events;
+  }
+}
+
+/**
+ * Drop a socket entry from the epoll registration
+ * and from the ready lists.
+ */
+static void
+olsr_socket_epoll_remove(struct olsr_socket_entry *entry)
+{
+  struct olsr_socket_entry **prev;
+  int set;
+
+  for (set = 0; set < SOCKET_EPOLL_SETS; set++) {
+    struct socket_epoll_set *eset = &socket_epoll[set];
+    unsigned int i;
+
+    if ((entry->ready & eset->mask) == 0) {
+      continue;
+    }
+    for (i = 0; i < eset->ready_count; i++) {
+      if (eset->ready[i] == entry) {
+        eset->ready[i] = eset->ready[--eset->ready_count];
+        break;
+      }
+    }
+  }
+  entry->ready = 0;
+
+  for (prev = &olsr_socket_epoll_slot(entry->fd)->head; *prev; prev = &(*prev)->fd_next) {
+    if (*prev == entry) {
+      *prev = entry->fd_next;
+      break;
+    }
+  }
+  olsr_socket_epoll_update(entry->fd, false);
+}
+
+/**
+ * Wait for events of an epoll set and move the signalled
+ * entries to its ready list.
+ *
+ * @param set the epoll set
+ * @param timeout in milliseconds
+ * @return number of events, -1 on error
+ */
+static int
+olsr_socket_epoll_wait(int set, int timeout)
+{
+  struct socket_epoll_set *eset = &socket_epoll[set];
+  struct epoll_event events[SOCKET_EPOLL_EVENTS];
+  int n, i;
+
+  do {
+    n = epoll_wait(eset->epoll_fd, events, SOCKET_EPOLL_EVENTS, timeout);
+  } while (n == -1 && errno == EINTR);
+
+  if (n == -1) {
+    OLSR_PRINTF(1, "epoll_wait error: %s", strerror(errno));
+    return -1;
+  }
+
+  for (i = 0; i < n; i++) {
+    struct olsr_socket_entry *entry;
+    unsigned int ready = 0;
+
+    if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+      ready |= SP_PR_READ | SP_IMM_READ;
+    }
+    if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+      ready |= SP_PR_WRITE | SP_IMM_WRITE;
+    }
+    ready &= eset->mask;
+
+    for (entry = olsr_socket_epoll_slot(events[i].data.fd)->head; entry; entry = entry->fd_next) {
+      if ((entry->flags & ready) == 0 || olsr_socket_epoll_handler(entry, set) == NULL) {
+        continue;
+      }
+      if ((entry->ready & eset->mask) == 0) {
+        if (eset->ready_count == eset->ready_size) {
+          eset->ready_size = eset->ready_size ? eset->ready_size * 2 : 16;
+          eset->ready = olsr_realloc(eset->ready, eset->ready_size * sizeof(*eset->ready), "Socket ready list");
+        }
+        eset->ready[eset->ready_count++] = entry;
+      }
+      entry->ready |= ready;
+    }
+  }
+  return n;
+}
+
+/**
+ * Re-check all entries which are left on the ready list of an
+ * epoll set from the last run and drop the ones which are drained.
+ *
+ * @param set the epoll set
+ * @return true if there are entries ready for processing
+ */
+static bool
+olsr_socket_epoll_probe(int set)
+{
+  struct socket_epoll_set *eset = &socket_epoll[set];
+  unsigned int i, count;
+  int n;
+
+  if (eset->ready_count == 0) {
+    return false;
+  }
+
+  if (eset->ready_count > socket_probe_size) {
+    socket_probe_size = eset->ready_size;
+    socket_probe = olsr_realloc(socket_probe, socket_probe_size * sizeof(*socket_probe), "Socket probe list");
+  }
+
+  for (i = 0; i < eset->ready_count; i++) {
+    struct olsr_socket_entry *entry = eset->ready[i];
+
+    socket_probe[i].fd = entry->fd;
+    socket_probe[i].events = 0;
+    socket_probe[i].revents = 0;
+    if ((entry->flags & eset->mask & (SP_PR_READ | SP_IMM_READ)) != 0) {
+      socket_probe[i].events |= POLLIN;
+    }
+    if ((entry->flags & eset->mask & (SP_PR_WRITE | SP_IMM_WRITE)) != 0) {
+      socket_probe[i].events |= POLLOUT;
+    }
+  }
+
+  do {
+    n = poll(socket_probe, eset->ready_count, 0);
+  } while (n == -1 && errno == EINTR);
+
+  if (n == -1) {
+    OLSR_PRINTF(1, "poll error: %s", strerror(errno));
+  }
+
+  /* compact the ready list, socket_probe stays in sync as we only move entries down */
+  count = 0;
+  for (i = 0; i < eset->ready_count; i++) {
+    struct olsr_socket_entry *entry = eset->ready[i];
+    short revents = n > 0 ? socket_probe[i].revents : 0;
+    unsigned int ready = 0;
+
+    if ((revents & POLLNVAL) == 0) {
+      if (revents & (POLLIN | POLLERR | POLLHUP)) {
+        ready |= SP_PR_READ | SP_IMM_READ;
+      }
+      if (revents & (POLLOUT | POLLERR | POLLHUP)) {
+        ready |= SP_PR_WRITE | SP_IMM_WRITE;
+      }
+    }
+    entry->ready = (entry->ready & ~eset->mask) | (ready & eset->mask);
+
+    if ((entry->ready & eset->mask) != 0) {
+      eset->ready[count++] = entry;
+    }
+  }
+  eset->ready_count = count;
+  return count > 0;
+}
+
+/**
+ * Call the handlers of all entries on the ready list of an epoll set.
+ */
+static void
+olsr_socket_epoll_dispatch(int set)
+{
+  struct socket_epoll_set *eset = &socket_epoll[set];
+  unsigned int i;
+
+  /* handlers may add sockets, but entries are only dropped from the list in handle_fds() */
+  for (i = 0; i < eset->ready_count; i++) {
+    struct olsr_socket_entry *entry = eset->ready[i];
+    socket_handler_func handler = olsr_socket_epoll_handler(entry, set);
+    unsigned int flags = entry->ready & entry->flags & eset->mask;
+
+    if (handler != NULL && flags != 0) {
+      handler(entry->fd, entry->data, flags);
+    }
+  }
+}
+
+/**
+ * The poll interval is over: sleep until the next timer expires instead
+ * of waking up for another empty interval. Both epoll fds are watched with
+ * poll(2), so pollrate sockets end the sleep and get processed by the
+ * next scheduler round.
+ */
+static void
+olsr_socket_epoll_idle(void)
+{
+  struct pollfd pfd[SOCKET_EPOLL_SETS];
+  uint32_t deadline;
+  int32_t idle;
+  int set;
+
+  if (socket_epoll[0].epoll_fd == -1 || !olsr_timer_next_deadline(&deadline)) {
+    return;
+  }
+
+  for (set = 0; set < SOCKET_EPOLL_SETS; set++) {
+    if (socket_epoll[set].ready_count > 0) {
+      /* still something left from the last round */
+      return;
+    }
+    pfd[set].fd = socket_epoll[set].epoll_fd;
+    pfd[set].events = POLLIN;
+    pfd[set].revents = 0;
+  }
+
+  now_times = olsr_times();
+  idle = TIME_DUE(deadline);
+  if (idle <= 0) {
+    return;
+  }
+
+  OLSR_PRINTF(7, "SCHED: idle for %d ms\n", idle);
+
+  if (poll(pfd, SOCKET_EPOLL_SETS, idle) > 0 && (pfd[SOCKET_EPOLL_IMMEDIATE].revents & POLLIN) != 0
+      && olsr_socket_epoll_wait(SOCKET_EPOLL_IMMEDIATE, 0) > 0) {
+    now_times = olsr_times();
+    olsr_socket_epoll_dispatch(SOCKET_EPOLL_IMMEDIATE);
+  }
+}
+#endif /* __linux__ */
+
 /**
  * Add a socket and handler to the socketset
  * beeing used in the main select(2) loop
@@ -242,9 +640,22 @@ add_olsr_socket(int fd, socket_handler_func pf_pr, socket_handler_func pf_imm, v
   new_entry->data = data;
   new_entry->flags = flags;
 
+  new_entry->ready = 0;
+  new_entry->fd_next = NULL;
+
   /* Queue */
   list_node_init(&new_entry->socket_node);
   list_add_before(&socket_head, &new_entry->socket_node);
+
+#ifdef __linux__
+  if (olsr_socket_epoll_init()) {
+    struct socket_fd_slot *slot = olsr_socket_epoll_slot(fd);
+
+    new_entry->fd_next = slot->head;
+    slot->head = new_entry;
+    olsr_socket_epoll_update(fd, false);
+  }
+#endif /* __linux__ */
 }
 
 /**
@@ -273,6 +684,11 @@ remove_olsr_socket(int fd, socket_handler_func pf_pr, socket_handler_func pf_imm
       entry->process_immediate = NULL;
       entry->process_pollrate = NULL;
       entry->flags = 0;
+#ifdef __linux__
+      if (socket_epoll[0].epoll_fd != -1) {
+        olsr_socket_epoll_update(fd, false);
+      }
+#endif /* __linux__ */
       return 1;
     }
   }
@@ -291,6 +707,13 @@ enable_olsr_socket(int fd, socket_handler_func pf_pr, socket_handler_func pf_imm
     }
   }
   OLSR_FOR_ALL_SOCKETS_END(entry);
+
+#ifdef __linux__
+  /* re-arm, the socket might have become ready while it was disabled */
+  if (socket_epoll[0].epoll_fd != -1) {
+    olsr_socket_epoll_update(fd, true);
+  }
+#endif /* __linux__ */
 }
 
 void
@@ -304,6 +727,12 @@ disable_olsr_socket(int fd, socket_handler_func pf_pr, socket_handler_func pf_im
     }
   }
   OLSR_FOR_ALL_SOCKETS_END(entry);
+
+#ifdef __linux__
+  if (socket_epoll[0].epoll_fd != -1) {
+    olsr_socket_epoll_update(fd, false);
+  }
+#endif /* __linux__ */
 }
 
 /**
@@ -319,6 +748,29 @@ olsr_flush_sockets(void)
     list_remove(&entry->socket_node);
     free(entry);
   } OLSR_FOR_ALL_SOCKETS_END(entry);
+
+#ifdef __linux__
+  {
+    int set;
+
+    for (set = 0; set < SOCKET_EPOLL_SETS; set++) {
+      if (socket_epoll[set].epoll_fd != -1) {
+        close(socket_epoll[set].epoll_fd);
+        socket_epoll[set].epoll_fd = -1;
+      }
+      free(socket_epoll[set].ready);
+      socket_epoll[set].ready = NULL;
+      socket_epoll[set].ready_count = 0;
+      socket_epoll[set].ready_size = 0;
+    }
+  }
+  free(socket_fd_table);
+  socket_fd_table = NULL;
+  socket_fd_table_size = 0;
+  free(socket_probe);
+  socket_probe = NULL;
+  socket_probe_size = 0;
+#endif /* __linux__ */
 }
 
 static void
@@ -337,6 +789,26 @@ poll_sockets(void)
     return;
   }
 
+#ifdef __linux__
+  if (socket_epoll[SOCKET_EPOLL_POLLRATE].epoll_fd != -1) {
+    bool ready = olsr_socket_epoll_probe(SOCKET_EPOLL_POLLRATE);
+
+    /* fetch everything that is pending, the wait does not block */
+    do {
+      n = olsr_socket_epoll_wait(SOCKET_EPOLL_POLLRATE, 0);
+    } while (n == SOCKET_EPOLL_EVENTS);
+
+    if (n <= 0 && !ready) {
+      return;
+    }
+
+    /* Update time since this is much used by the parsing functions */
+    now_times = olsr_times();
+    olsr_socket_epoll_dispatch(SOCKET_EPOLL_POLLRATE);
+    return;
+  }
+#endif /* __linux__ */
+
   FD_ZERO(&ibits);
   FD_ZERO(&obits);
 
@@ -393,6 +865,29 @@ poll_sockets(void)
   OLSR_FOR_ALL_SOCKETS_END(entry);
 }
 
+/**
+ * Free all socket entries which have been removed
+ * with remove_olsr_socket().
+ */
+static void
+olsr_cleanup_sockets(void)
+{
+  struct olsr_socket_entry *entry;
+
+  OLSR_FOR_ALL_SOCKETS(entry) {
+    if (entry->process_immediate == NULL && entry->process_pollrate == NULL) {
+      /* clean up socket handler */
+#ifdef __linux__
+      if (socket_epoll[0].epoll_fd != -1) {
+        olsr_socket_epoll_remove(entry);
+      }
+#endif /* __linux__ */
+      list_remove(&entry->socket_node);
+      free(entry);
+    }
+  } OLSR_FOR_ALL_SOCKETS_END(entry);
+}
+
 static void
 handle_fds(uint32_t next_interval)
 {
@@ -418,6 +913,39 @@ handle_fds(uint32_t next_interval)
     tvp.tv_usec = (remaining % MSEC_PER_SEC) * USEC_PER_MSEC;
   }
 
+#ifdef __linux__
+  if (socket_epoll[SOCKET_EPOLL_IMMEDIATE].epoll_fd != -1) {
+    /* do at least one epoll_wait */
+    for (;;) {
+      bool ready;
+      int n;
+
+      /* send what the handlers queued before we block */
+      net_output_flush();
+
+      ready = olsr_socket_epoll_probe(SOCKET_EPOLL_IMMEDIATE);
+      n = olsr_socket_epoll_wait(SOCKET_EPOLL_IMMEDIATE, (ready || remaining <= 0) ? 0 : remaining);
+
+      if (n == -1 || (n == 0 && !ready)) {
+        break;
+      }
+
+      /* Update time since this is much used by the parsing functions */
+      now_times = olsr_times();
+      olsr_socket_epoll_dispatch(SOCKET_EPOLL_IMMEDIATE);
+
+      /* calculate the next timeout */
+      remaining = TIME_DUE(next_interval);
+      if (remaining <= 0) {
+        /* we are already over the interval */
+        break;
+      }
+    }
+    olsr_cleanup_sockets();
+    return;
+  }
+#endif /* __linux__ */
+
   /* do at least one select */
   for (;;) {
     fd_set ibits, obits;
@@ -449,6 +977,9 @@ handle_fds(uint32_t next_interval)
       break;
     }
 
+    /* send what the handlers queued before we block */
+    net_output_flush();
+
     do {
       n = olsr_select(hfd, fdsets & SP_IMM_READ ? &ibits : NULL, fdsets & SP_IMM_WRITE ? &obits : NULL, NULL, &tvp);
     } while (n == -1 && errno == EINTR);
@@ -492,13 +1023,7 @@ handle_fds(uint32_t next_interval)
     tvp.tv_usec = (remaining % MSEC_PER_SEC) * USEC_PER_MSEC;
   }
 
-  OLSR_FOR_ALL_SOCKETS(entry) {
-    if (entry->process_immediate == NULL && entry->process_pollrate == NULL) {
-      /* clean up socket handler */
-      list_remove(&entry->socket_node);
-      free(entry);
-    }
-  } OLSR_FOR_ALL_SOCKETS_END(entry);
+  olsr_cleanup_sockets();
 }
 
 typedef enum {
@@ -579,12 +1104,47 @@ void olsr_scheduler(void)
 
     /* Read incoming data and handle it immediiately */
     handle_fds(next_interval);
+    net_output_flush();
+
+#ifdef __linux__
+    /* Sleep until the next timer if nothing is pending */
+    if (state == RUNNING && !link_changes && !changes_neighborhood && !changes_topology && !changes_hna && !changes_force) {
+      olsr_socket_epoll_idle();
+    }
+#endif /* __linux__ */
   }
   walk_timers_cleanup();
 
   state = ENDED;
 }
 
+/**
+ * Does one round of the scheduler loop without any socket: runs the
+ * expired timers, processes the changes and flushes the output. The
+ * caller advances now_times, so a simulator can drive the daemon from
+ * a virtual clock.
+ *
+ * @param deadline pointer to store the expiry time of the next timer
+ * @return false if no timer is running
+ */
+bool
+olsr_scheduler_step(uint32_t *deadline)
+{
+  walk_timers(&timer_last_run);
+  walk_timers_cleanup();
+
+  olsr_process_changes();
+
+  if (link_changes) {
+    increase_local_ansn();
+    link_changes = false;
+  }
+
+  net_output_flush();
+
+  return olsr_timer_next_deadline(deadline);
+}
+
 /**
  * Decrement a relative timer by a random number range.
  *
@@ -623,7 +1183,7 @@ calc_jitter(unsigned int rel_time, uint8_t jitter_pct, unsigned int random_val)
 void
 olsr_init_timers(void)
 {
-  int idx;
+  int level, idx;
 
   OLSR_PRINTF(3, "Initializing scheduler.\n");
 
@@ -636,8 +1196,11 @@ olsr_init_timers(void)
 
   avl_init(&timer_cleanup_tree, avl_comp_timer);
 
-  for (idx = 0; idx < TIMER_WHEEL_SLOTS; idx++) {
-    list_head_init(&timer_wheel[idx]);
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (idx = 0; idx < TIMER_WHEEL_SLOTS; idx++) {
+      list_head_init(&timer_wheel[level][idx]);
+    }
+    timer_wheel_count[level] = 0;
   }
 
   /*
@@ -648,6 +1211,61 @@ olsr_init_timers(void)
   /* Allocate a cookie for the block based memory manager. */
   timer_mem_cookie = olsr_alloc_cookie("timer_entry", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(timer_mem_cookie, sizeof(struct timer_entry));
+  olsr_cookie_set_slab(timer_mem_cookie, 0, true);
+}
+
+/**
+ * Hash a timer into the timer wheel, relative to the next clocktick to be walked.
+ * Overdue timers go into the slot that gets walked next.
+ */
+static void
+olsr_timer_wheel_insert(struct timer_entry *timer)
+{
+  uint32_t delta = timer->timer_clock - timer_last_run;
+  unsigned int level = 0, slot;
+
+  if (delta > (1u << 31)) {
+    slot = timer_last_run & TIMER_WHEEL_MASK;
+  } else {
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1u << (TIMER_WHEEL_BITS * (level + 1)))) {
+      level++;
+    }
+    slot = (timer->timer_clock >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+  }
+
+  timer->timer_level = level;
+  timer_wheel_count[level]++;
+  list_add_before(&timer_wheel[level][slot], &timer->timer_list);
+}
+
+/**
+ * Carve a timer out of its timer wheel slot.
+ */
+static void
+olsr_timer_wheel_remove(struct timer_entry *timer)
+{
+  timer_wheel_count[timer->timer_level]--;
+  list_remove(&timer->timer_list);
+}
+
+/**
+ * Move all timers of the current slot of a wheel level one level down.
+ *
+ * @return the index of the cascaded slot
+ */
+static unsigned int
+olsr_timer_wheel_cascade(unsigned int level)
+{
+  unsigned int idx = (timer_last_run >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+  struct list_node *const timer_head_node = &timer_wheel[level][idx];
+
+  while (!list_is_empty(timer_head_node)) {
+    struct timer_entry *const timer = list2timer(timer_head_node->next);
+
+    olsr_timer_wheel_remove(timer);
+    olsr_timer_wheel_insert(timer);
+  }
+  return idx;
 }
 
 /**
@@ -661,17 +1279,34 @@ walk_timers(uint32_t * last_run)
   unsigned int wheel_slot_walks = 0;
 
   /*
-   * Check the required wheel slots since the last time a timer walk was invoked,
-   * or check *all* the wheel slots, whatever is less work.
-   * The latter is meant as a safety belt if the scheduler falls behind.
+   * Check every clocktick since the last time a timer walk was invoked.
+   * Runs of empty level 0 slots are skipped, such that falling behind
+   * costs at most one iteration per level 0 revolution.
    */
-  while ((*last_run <= now_times) && (wheel_slot_walks < TIMER_WHEEL_SLOTS)) {
+  while (TIMED_OUT(*last_run)) {
     struct list_node tmp_head_node;
     /* keep some statistics */
     unsigned int timers_walked = 0, timers_fired = 0;
+    unsigned int idx = *last_run & TIMER_WHEEL_MASK;
+    struct list_node *timer_head_node;
+
+    if (idx == 0) {
+      /* level 0 has wrapped, pull the timers of the next period down */
+      unsigned int level = 1;
+
+      while (level < TIMER_WHEEL_LEVELS && olsr_timer_wheel_cascade(level) == 0) {
+        level++;
+      }
+    } else if (timer_wheel_count[0] == 0) {
+      /* nothing to do until level 0 wraps */
+      uint32_t wrap = (*last_run | TIMER_WHEEL_MASK) + 1;
+
+      *last_run = TIMED_OUT(wrap) ? wrap : now_times + 1;
+      continue;
+    }
 
     /* Get the hash slot for this clocktick */
-    struct list_node *const timer_head_node = &timer_wheel[*last_run & TIMER_WHEEL_MASK];
+    timer_head_node = &timer_wheel[0][idx];
 
     /* Walk all entries hanging off this hash bucket. We treat this basically as a stack
      * so that we always know if and where the next element is.
@@ -703,6 +1338,8 @@ walk_timers(uint32_t * last_run)
                    timer->timer_cookie->ci_name,
                    timer, timer->timer_cb_context, (unsigned int)*last_run, olsr_wallclock_string());
 
+        olsr_cookie_timer_fired(timer->timer_cookie, now_times - timer->timer_clock);
+
         /* This timer is expired, call into the provided callback function */
         timer->timer_cb(timer->timer_cb_context);
 
@@ -740,15 +1377,72 @@ walk_timers(uint32_t * last_run)
     wheel_slot_walks++;
   }
 
-  OLSR_PRINTF(7, "TIMER: processed %4u/%d clockwheel slots, "
+  OLSR_PRINTF(7, "TIMER: processed %4u clockwheel slots, "
              "timers walked %4u/%u, timers fired %u\n",
-             wheel_slot_walks, TIMER_WHEEL_SLOTS, total_timers_walked, timer_mem_cookie->ci_usage, total_timers_fired);
+             wheel_slot_walks, total_timers_walked, timer_mem_cookie->ci_usage, total_timers_fired);
+}
 
-  /*
-   * If the scheduler has slipped and we have walked all wheel slots,
-   * reset the last timer run.
-   */
-  *last_run = now_times;
+/**
+ * Find the earliest running timer in a timer wheel slot.
+ */
+static bool
+olsr_timer_slot_deadline(struct list_node *timer_head_node, uint32_t *deadline)
+{
+  struct list_node *timer_node;
+  bool found = false;
+
+  for (timer_node = timer_head_node->next; timer_node != timer_head_node; timer_node = timer_node->next) {
+    struct timer_entry *const timer = list2timer(timer_node);
+
+    if (timer->timer_flags & OLSR_TIMER_REMOVED) {
+      continue;
+    }
+    if (!found || olsr_getTimeDue(timer->timer_clock) < olsr_getTimeDue(*deadline)) {
+      *deadline = timer->timer_clock;
+      found = true;
+    }
+  }
+  return found;
+}
+
+/**
+ * Compute the exact expiry time of the next timer.
+ * Within each level the slots are ordered by time, starting with the
+ * current slot (level 0) or the slot after the current one (upper levels,
+ * unless the current slot still waits for its cascade). So the first used
+ * slot of every level holds the earliest timer of that level.
+ *
+ * @param deadline pointer to store the expiry time
+ * @return false if no timer is running
+ */
+static bool
+olsr_timer_next_deadline(uint32_t *deadline)
+{
+  unsigned int level, i;
+  bool found = false;
+
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    unsigned int idx = (timer_last_run >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+
+    if (timer_wheel_count[level] == 0) {
+      continue;
+    }
+
+    /* the current slot is still pending if the next walk starts by cascading it */
+    i = (timer_last_run & ((1u << (TIMER_WHEEL_BITS * level)) - 1)) ? 1 : 0;
+    for (; i <= TIMER_WHEEL_SLOTS; i++) {
+      uint32_t clock;
+
+      if (olsr_timer_slot_deadline(&timer_wheel[level][(idx + i) & TIMER_WHEEL_MASK], &clock)) {
+        if (!found || olsr_getTimeDue(clock) < olsr_getTimeDue(*deadline)) {
+          *deadline = clock;
+          found = true;
+        }
+        break;
+      }
+    }
+  }
+  return found;
 }
 
 static void walk_timers_cleanup(void) {
@@ -767,40 +1461,22 @@ static void walk_timers_cleanup(void) {
 void
 olsr_flush_timers(void)
 {
-  struct list_node *timer_head_node;
-  struct list_node tmp_head_node;
-  unsigned int wheel_slot = 0;
-
-  list_head_init(&tmp_head_node);
+  unsigned int level, wheel_slot;
 
   walk_timers_cleanup();
 
-  for (wheel_slot = 0; wheel_slot < TIMER_WHEEL_SLOTS; wheel_slot++) {
-    timer_head_node = &timer_wheel[wheel_slot & TIMER_WHEEL_MASK];
-
-    /* stop all entries hanging off this hash bucket. */
-    while (!list_is_empty(timer_head_node)) {
-      /* the top element */
-      struct list_node *const timer_node = timer_head_node->next;
-      struct timer_entry *const timer = list2timer(timer_node);
-
-      /*
-       * Dequeue and insert to a temporary list.
-       * We do this to avoid losing our walking context when
-       * multiple timers fire.
-       */
-      list_remove(timer_node);
-      list_add_after(&tmp_head_node, timer_node);
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (wheel_slot = 0; wheel_slot < TIMER_WHEEL_SLOTS; wheel_slot++) {
+      struct list_node *const timer_head_node = &timer_wheel[level][wheel_slot];
+      struct list_node *timer_node;
 
-      olsr_stop_timer(timer);
+      /* stop all entries hanging off this hash bucket, they stay on the wheel until the cleanup */
+      for (timer_node = timer_head_node->next; timer_node != timer_head_node; timer_node = timer_node->next) {
+        olsr_stop_timer(list2timer(timer_node));
+      }
     }
   }
 
-  /*
-   * Now merge the temporary list back to the old bucket.
-   */
-  list_merge(timer_head_node, &tmp_head_node);
-
   walk_timers_cleanup();
 }
 
@@ -932,7 +1608,7 @@ olsr_start_timer(unsigned int rel_time,
   /*
    * Now insert in the respective timer_wheel slot.
    */
-  list_add_before(&timer_wheel[timer->timer_clock & TIMER_WHEEL_MASK], &timer->timer_list);
+  olsr_timer_wheel_insert(timer);
 
   OLSR_PRINTF(7, "TIMER: start %s timer %p firing in %s, ctx %p\n",
              ci->ci_name, timer, olsr_clock_string(timer->timer_clock), context);
@@ -997,7 +1673,7 @@ olsr_cleanup_timer(struct timer_entry *timer)
   /*
    * Carve out of the existing wheel_slot and free.
    */
-  list_remove(&timer->timer_list);
+  olsr_timer_wheel_remove(timer);
   timer->timer_flags &= ~OLSR_TIMER_REMOVED;
   olsr_cookie_usage_decr(timer->timer_cookie->ci_id);
 
@@ -1032,8 +1708,8 @@ olsr_change_timer(struct timer_entry *timer, unsigned int rel_time, uint8_t jitt
    * Changes are easy: Remove timer from the exisiting timer_wheel slot
    * and reinsert into the new slot.
    */
-  list_remove(&timer->timer_list);
-  list_add_before(&timer_wheel[timer->timer_clock & TIMER_WHEEL_MASK], &timer->timer_list);
+  olsr_timer_wheel_remove(timer);
+  olsr_timer_wheel_insert(timer);
 
   OLSR_PRINTF(7, "TIMER: change %s timer %p, firing to %s, ctx %p\n",
              timer->timer_cookie->ci_name, timer, olsr_clock_string(timer->timer_clock), timer->timer_cb_context);
@@ -59,14 +59,19 @@
 #define NSEC_PER_USEC 1000
 #define USEC_PER_MSEC 1000
 
-#define TIMER_WHEEL_SLOTS 1024
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
 #define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4           /* covers the full 32 bit clock */
 
 typedef void (*timer_cb_func) (void *); /* callback function */
 
 /*
  * Our timer implementation is a based on individual timers arranged in
  * a double linked list hanging of hash containers called a timer wheel slot.
+ * The wheel is hierarchical: level 0 has one slot per clocktick, every
+ * further level covers the full range of the level below in each slot.
+ * Timers on the upper levels get cascaded down when the level below wraps.
  * For every timer a timer_entry is created and attached to the timer wheel slot.
  * When the timer fires, the timer_cb function is called with the
  * context pointer.
@@ -81,6 +86,7 @@ struct timer_entry {
   struct olsr_cookie_info *timer_cookie;       /* used for diag stuff */
   uint8_t timer_jitter_pct;            /* the jitter expressed in percent */
   uint8_t timer_flags;                 /* misc flags */
+  uint8_t timer_level;                 /* timer wheel level */
   unsigned int timer_random;           /* cache random() result for performance reasons */
   timer_cb_func timer_cb;              /* callback function */
   void *timer_cb_context;              /* context pointer */
@@ -111,6 +117,7 @@ const char *olsr_wallclock_string(void);
 /* Main scheduler loop */
 void olsr_scheduler(void);
 void olsr_scheduler_stop(void);
+bool olsr_scheduler_step(uint32_t *);
 
 /*
  * Provides a timestamp s1 milliseconds in the future
@@ -144,6 +151,8 @@ struct olsr_socket_entry {
   void *data;
   unsigned int flags;
   struct list_node socket_node;
+  unsigned int ready;                  /* epoll backend, pending readiness (SP_* flags) */
+  struct olsr_socket_entry *fd_next;   /* epoll backend, next entry with the same fd */
 };
 
 LISTNODE2STRUCT(list2socket, struct olsr_socket_entry, socket_node);
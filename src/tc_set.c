@@ -64,6 +64,8 @@
 struct avl_tree tc_tree;
 struct tc_entry *tc_myself;            /* Shortcut to ourselves */
 
+struct tc_flood_stats tc_flood_stats;
+
 /* Some cookies for stats keeping */
 struct olsr_cookie_info *tc_edge_gc_timer_cookie = NULL;
 struct olsr_cookie_info *tc_validity_timer_cookie = NULL;
@@ -173,6 +175,7 @@ olsr_add_tc_entry(union olsr_ip_addr *adr)
    */
   avl_init(&tc->edge_tree, avl_comp_default);
   avl_init(&tc->prefix_tree, avl_comp_prefix_default);
+  list_head_init(&tc->spf_children);
 
   /*
    * Add a rt_path for ourselves.
@@ -201,9 +204,11 @@ olsr_init_tc(void)
 
   tc_edge_mem_cookie = olsr_alloc_cookie("tc_edge_entry", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(tc_edge_mem_cookie, sizeof(struct tc_edge_entry) + active_lq_handler->tc_lq_size);
+  olsr_cookie_set_slab(tc_edge_mem_cookie, 0, true);
 
   tc_mem_cookie = olsr_alloc_cookie("tc_entry", OLSR_COOKIE_TYPE_MEMORY);
   olsr_cookie_set_memory_size(tc_mem_cookie, sizeof(struct tc_entry));
+  olsr_cookie_set_slab(tc_mem_cookie, 0, true);
 
   /*
    * Add a TC entry for ourselves.
@@ -308,6 +313,8 @@ olsr_delete_tc_entry(struct tc_entry *tc)
   olsr_stop_timer(tc->validity_timer);
   tc->validity_timer = NULL;
 
+  olsr_spf_forget_vertex(tc);
+
   avl_delete(&tc_tree, &tc->vertex_node);
   olsr_unlock_tc_entry(tc);
 }
@@ -413,6 +420,8 @@ olsr_expire_tc_edge_gc(void *context)
 bool
 olsr_calc_tc_edge_entry_etx(struct tc_edge_entry *tc_edge)
 {
+  olsr_linkcost cost;
+
   /*
    * Some sanity check before recalculating the etx.
    */
@@ -420,7 +429,11 @@ olsr_calc_tc_edge_entry_etx(struct tc_edge_entry *tc_edge)
     return false;
   }
 
-  tc_edge->cost = olsr_calc_tc_cost(tc_edge);
+  cost = olsr_calc_tc_cost(tc_edge);
+  if (cost != tc_edge->cost) {
+    tc_edge->cost = cost;
+    olsr_spf_touch_vertex(tc_edge->tc);
+  }
   return true;
 }
 
@@ -487,6 +500,8 @@ olsr_add_tc_edge_entry(struct tc_entry *tc, union olsr_ip_addr *addr, uint16_t a
     }
   }
 
+  olsr_spf_touch_edge(tc_edge);
+
   /*
    * Update the etx.
    */
@@ -514,6 +529,8 @@ olsr_delete_tc_edge_entry(struct tc_edge_entry *tc_edge)
   OLSR_PRINTF(1, "TC: del edge entry %s\n", olsr_tc_edge_to_string(tc_edge));
 #endif /* DEBUG */
 
+  olsr_spf_touch_edge(tc_edge);
+
   tc = tc_edge->tc;
   avl_delete(&tc->edge_tree, &tc_edge->edge_node);
   olsr_unlock_tc_entry(tc);
@@ -631,12 +648,17 @@ olsr_tc_update_edge(struct tc_entry *tc, uint16_t ansn, const unsigned char **cu
      * Check if the address is allowed.
      */
     if (!olsr_validate_address(neighbor)) {
+      /* skip the link quality of the edge */
+      *curr += olsr_sizeof_tc_lqdata();
       return 0;
     }
 
     tc_edge = olsr_add_tc_edge_entry(tc, neighbor, ansn);
 
     olsr_deserialize_tc_lq_pair(curr, tc_edge);
+
+    /* the cost of a new edge depends on the link quality just read */
+    olsr_calc_tc_edge_entry_etx(tc_edge);
     edge_change = 1;
 
   } else {
@@ -716,6 +738,22 @@ olsr_print_tc_table(void)
 }
 #endif /* NODEBUG */
 
+/**
+ * Print the TC flooding counters
+ */
+void
+olsr_print_tc_flood_stats(void)
+{
+#ifndef NODEBUG
+  OLSR_PRINTF(0, "\n--- %s ------------------------------------------------- TC FLOODING\n\n",
+              olsr_wallclock_string());
+  OLSR_PRINTF(0, "Sent     %10u (%u bytes, %u scoped, %u delta)\n", tc_flood_stats.sent, tc_flood_stats.sent_bytes,
+              tc_flood_stats.sent_scoped, tc_flood_stats.sent_delta);
+  OLSR_PRINTF(0, "Received %10u (%u changed the topology)\n", tc_flood_stats.received, tc_flood_stats.changed);
+  OLSR_PRINTF(0, "Forward  %10u (%u at the end of their scope)\n", tc_flood_stats.forwarded, tc_flood_stats.scope_end);
+#endif /* NODEBUG */
+}
+
 /*
  * calculate the border IPs of a tc edge set according to the border flags
  *
@@ -781,7 +819,7 @@ olsr_input_tc(union olsr_message * msg, struct interface_olsr * input_if __attri
   union olsr_ip_addr originator;
   const unsigned char *limit, *curr;
   struct tc_entry *tc;
-  bool emptyTC;
+  bool emptyTC, edges_changed = false;
 
   union olsr_ip_addr lower_border_ip, upper_border_ip;
   int borderSet = 0;
@@ -888,6 +926,7 @@ olsr_input_tc(union olsr_message * msg, struct interface_olsr * input_if __attri
   while (curr < limit) {
     if (olsr_tc_update_edge(tc, ansn, &curr, &upper_border_ip)) {
       changes_topology = true;
+      edges_changed = true;
     }
 
     if (!borderSet) {
@@ -921,7 +960,9 @@ olsr_input_tc(union olsr_message * msg, struct interface_olsr * input_if __attri
     /*
      * Delete all old tc edges within borders.
      */
-    olsr_delete_revoked_tc_edges(tc, ansn, &lower_border_ip, &upper_border_ip);
+    if (olsr_delete_revoked_tc_edges(tc, ansn, &lower_border_ip, &upper_border_ip)) {
+      edges_changed = true;
+    }
   } else {
 
     /*
@@ -942,6 +983,133 @@ olsr_input_tc(union olsr_message * msg, struct interface_olsr * input_if __attri
 
     olsr_delete_tc_entry(tc);
   }
+
+  tc_flood_stats.received++;
+  if (edges_changed) {
+    tc_flood_stats.changed++;
+  }
+
+  /* Forward the message */
+  return true;
+}
+
+/*
+ * Process an incoming LQ_TC delta message.
+ *
+ * A delta carries the edges which were added or changed and the
+ * edges which were removed since the ANSN of its base. It is only
+ * applied if our edges of the originator are at that ANSN, otherwise
+ * they are updated by the next full TC. This keeps the work in
+ * O(changes) instead of touching every edge of the originator.
+ */
+bool
+olsr_input_tc_delta(union olsr_message * msg, struct interface_olsr * input_if __attribute__ ((unused)), union olsr_ip_addr * from_addr)
+{
+  struct ipaddr_str buf;
+  uint16_t size, msg_seq, ansn, base_ansn, changed, reserved;
+  uint8_t type, ttl, msg_hops;
+  olsr_reltime vtime;
+  union olsr_ip_addr originator, neighbor;
+  const unsigned char *limit, *curr;
+  struct tc_entry *tc;
+  struct tc_edge_entry *tc_edge;
+  bool edges_changed = false;
+
+  curr = (void *)msg;
+  if (!msg) {
+    return false;
+  }
+
+  pkt_get_u8(&curr, &type);
+  if (type != LQ_TC_DELTA_MESSAGE) {
+    return false;
+  }
+
+  if (check_neighbor_link(from_addr) != SYM_LINK) {
+    OLSR_PRINTF(2, "Received TC delta from NON SYM neighbor %s\n", olsr_ip_to_string(&buf, from_addr));
+    return false;
+  }
+
+  pkt_get_reltime(&curr, &vtime);
+  pkt_get_u16(&curr, &size);
+
+  pkt_get_ipaddress(&curr, &originator);
+
+  pkt_get_u8(&curr, &ttl);
+  pkt_get_u8(&curr, &msg_hops);
+  pkt_get_u16(&curr, &msg_seq);
+
+  pkt_get_u16(&curr, &ansn);
+  pkt_get_u16(&curr, &base_ansn);
+  pkt_get_u16(&curr, &changed);
+  pkt_get_u16(&curr, &reserved);
+
+  tc = olsr_lookup_tc_entry(&originator);
+
+  /*
+   * Without the full TC of the base we cannot apply the delta,
+   * but other nodes might, so forward it anyway.
+   */
+  if (!tc || !tc->validity_timer || tc->ansn != base_ansn || !SEQNO_GREATER_THAN(msg_seq, tc->msg_seq)) {
+    OLSR_PRINTF(3, "Ignoring TC delta from %s, ansn %u -> %u\n", olsr_ip_to_string(&buf, &originator), base_ansn, ansn);
+    return true;
+  }
+
+  if (vtime < (olsr_reltime)(olsr_cnf->min_tc_vtime*1000)) {
+    vtime = (olsr_reltime)(olsr_cnf->min_tc_vtime*1000);
+  }
+
+  /*
+   * The delta was sent after the last full TC, so all parts of a
+   * multipart TC have arrived. Collect its outdated edges now as the
+   * delta moves the ANSN on.
+   */
+  if (tc->edge_gc_timer) {
+    olsr_stop_timer(tc->edge_gc_timer);
+    tc->edge_gc_timer = NULL;
+    if (olsr_delete_outdated_tc_edges(tc)) {
+      changes_topology = true;
+    }
+  }
+
+  tc->msg_hops = msg_hops;
+  tc->msg_seq = msg_seq;
+  tc->ansn = ansn;
+  tc->ignored = 0;
+  tc->err_seq_valid = false;
+
+  OLSR_PRINTF(1, "Processing TC delta from %s, seq 0x%04x\n", olsr_ip_to_string(&buf, &originator), tc->msg_seq);
+
+  limit = (unsigned char *)msg + size;
+
+  /* added or changed edges */
+  for (; changed > 0 && curr < limit; changed--) {
+    if (olsr_tc_update_edge(tc, ansn, &curr, &neighbor)) {
+      changes_topology = true;
+      edges_changed = true;
+    }
+  }
+
+  /* removed edges */
+  while (curr < limit) {
+    pkt_get_ipaddress(&curr, &neighbor);
+
+    tc_edge = olsr_lookup_tc_edge(tc, &neighbor);
+    if (tc_edge) {
+      olsr_delete_tc_edge_entry(tc_edge);
+      changes_topology = true;
+      edges_changed = true;
+    }
+  }
+
+  tc_flood_stats.received++;
+  if (edges_changed) {
+    tc_flood_stats.changed++;
+  }
+
+  olsr_set_timer(&tc->validity_timer, vtime, OLSR_TC_VTIME_JITTER, OLSR_TIMER_ONESHOT, &olsr_expire_tc_entry, tc,
+                 tc_validity_timer_cookie);
+
   /* Forward the message */
   return true;
 }
@@ -74,12 +74,17 @@ AVLNODE2STRUCT(edge_tree2tc_edge, struct tc_edge_entry, edge_node);
 struct tc_entry {
   struct avl_node vertex_node;         /* node keyed by ip address */
   union olsr_ip_addr addr;             /* vertex_node key */
-  struct avl_node cand_tree_node;      /* SPF candidate heap, node keyed by path_etx */
-  olsr_linkcost path_cost;             /* SPF calculated distance, cand_tree_node key */
+  olsr_linkcost path_cost;             /* SPF calculated distance, candidate heap key */
+  uint32_t spf_heap_pos;               /* SPF candidate heap position + 1, 0 if not on the heap */
   struct list_node path_list_node;     /* SPF result list */
   struct avl_tree edge_tree;           /* subtree for edges */
   struct avl_tree prefix_tree;         /* subtree for prefixes */
   struct link_entry *next_hop;         /* SPF calculated link to the 1st hop neighbor */
+  struct link_entry *spf_link;         /* SPF link to this vertex if it is a 1st hop neighbor */
+  struct tc_entry *spf_parent;         /* SPF calculated predecessor */
+  struct list_node spf_children;       /* SPF tree, vertices having us as predecessor */
+  struct list_node spf_sibling_node;   /* SPF tree, node on the children list of our predecessor */
+  struct list_node spf_dirty_node;     /* incremental SPF, edges of this vertex have changed */
   struct timer_entry *edge_gc_timer;   /* used for edge garbage collection */
   struct timer_entry *validity_timer;  /* tc validity time */
   uint32_t refcount;                   /* reference counter */
@@ -91,6 +96,7 @@ struct tc_entry {
                                           (kindof emergency brake) */
   uint16_t err_seq;                    /* sequence number of an unplausible TC */
   bool err_seq_valid;                  /* do we have an error (unplauible seq/ansn) */
+  bool spf_affected;                   /* incremental SPF, vertex lost its predecessor */
 };
 
 /*
@@ -102,9 +108,25 @@ struct tc_entry {
 
 #define OLSR_TC_VTIME_JITTER 5          /* percent */
 
+/*
+ * Counters of the TC flooding, to see what the fisheye scope
+ * and the delta TCs save.
+ */
+struct tc_flood_stats {
+  uint32_t sent;                       /* TC messages generated */
+  uint32_t sent_bytes;
+  uint32_t sent_scoped;                /* ... with a TTL below MAX_TTL */
+  uint32_t sent_delta;                 /* ... as a delta TC */
+  uint32_t received;                   /* TC messages processed */
+  uint32_t changed;                    /* ... which changed the topology */
+  uint32_t forwarded;                  /* TC messages retransmitted */
+  uint32_t scope_end;                  /* ... not forwarded beyond the TTL */
+};
+
 AVLNODE2STRUCT(vertex_tree2tc, struct tc_entry, vertex_node);
-AVLNODE2STRUCT(cand_tree2tc, struct tc_entry, cand_tree_node);
 LISTNODE2STRUCT(pathlist2tc, struct tc_entry, path_list_node);
+LISTNODE2STRUCT(siblinglist2tc, struct tc_entry, spf_sibling_node);
+LISTNODE2STRUCT(dirtylist2tc, struct tc_entry, spf_dirty_node);
 
 /*
  * macros for traversing vertices, edges and prefixes in the link state database.
@@ -143,6 +165,7 @@ LISTNODE2STRUCT(pathlist2tc, struct tc_entry, path_list_node);
 
 extern struct avl_tree tc_tree;
 extern struct tc_entry *tc_myself;
+extern struct tc_flood_stats tc_flood_stats;
 
 void olsr_init_tc(void);
 void olsr_delete_all_tc_entries(void);
@@ -152,10 +175,12 @@ void olsr_print_tc_table(void);
 #else
 #define olsr_print_tc_table() do { } while(0)
 #endif
+void olsr_print_tc_flood_stats(void);
 void olsr_time_out_tc_set(void);
 
 /* tc msg input parser */
 bool olsr_input_tc(union olsr_message *, struct interface_olsr *, union olsr_ip_addr *from);
+bool olsr_input_tc_delta(union olsr_message *, struct interface_olsr *, union olsr_ip_addr *from);
 
 /* tc_entry manipulation */
 struct tc_entry *olsr_lookup_tc_entry(union olsr_ip_addr *);
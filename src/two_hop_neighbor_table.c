@@ -47,12 +47,17 @@
 #include "ipcalc.h"
 #include "defs.h"
 #include "mid_set.h"
+#include "mpr.h"
 #include "neighbor_table.h"
 #include "net_olsr.h"
 #include "scheduler.h"
+#include "common/hashtable.h"
 
 struct neighbor_2_entry two_hop_neighbortable[HASHSIZE];
 
+/* lookup index of two_hop_neighbortable by address */
+static struct hashtable two_hop_index;
+
 /**
  *Initialize 2 hop neighbor table
  */
@@ -64,6 +69,8 @@ olsr_init_two_hop_table(void)
     two_hop_neighbortable[idx].next = &two_hop_neighbortable[idx];
     two_hop_neighbortable[idx].prev = &two_hop_neighbortable[idx];
   }
+
+  hashtable_init(&two_hop_index, offsetof(struct neighbor_2_entry, neighbor_2_addr), olsr_cnf->ipsize);
 }
 
 /**
@@ -86,6 +93,12 @@ olsr_delete_neighbor_pointer(struct neighbor_2_entry *two_hop_entry, struct neig
       struct neighbor_list_entry *entry_to_delete = entry;
       entry = entry->next;
 
+      if (entry_to_delete->mpr_selected) {
+        neigh->mpr_selected_count--;
+      }
+      olsr_mpr_touch_neighbor(neigh);
+      olsr_mpr_touch_two_hop(two_hop_entry);
+
       /* dequeue */
       DEQUEUE_ELEM(entry_to_delete);
 
@@ -108,6 +121,8 @@ olsr_delete_two_hop_neighbor_table(struct neighbor_2_entry *two_hop_neighbor)
 {
   struct neighbor_list_entry *one_hop_list;
 
+  olsr_mpr_forget_two_hop(two_hop_neighbor);
+
   one_hop_list = two_hop_neighbor->neighbor_2_nblist.next;
 
   /* Delete one hop links */
@@ -121,11 +136,35 @@ olsr_delete_two_hop_neighbor_table(struct neighbor_2_entry *two_hop_neighbor)
     free(entry_to_delete);
   }
 
-  /* dequeue */
-  DEQUEUE_ELEM(two_hop_neighbor);
+  olsr_dequeue_two_hop_neighbor_table(two_hop_neighbor);
   free(two_hop_neighbor);
 }
 
+/**
+ * Dequeue an entry from the two hop neighbor table. If there is
+ * another entry with the same address the newest one is indexed
+ * instead, like a walk of the hash chain would find it.
+ * An entry must not be freed before it is dequeued here.
+ */
+void
+olsr_dequeue_two_hop_neighbor_table(struct neighbor_2_entry *two_hop_neighbor)
+{
+  uint32_t hash = olsr_ip_hashing(&two_hop_neighbor->neighbor_2_addr);
+  struct neighbor_2_entry *dup;
+
+  DEQUEUE_ELEM(two_hop_neighbor);
+
+  if (!hashtable_remove(&two_hop_index, two_hop_neighbor)) {
+    return;
+  }
+  for (dup = two_hop_neighbortable[hash].next; dup != &two_hop_neighbortable[hash]; dup = dup->next) {
+    if (ipequal(&dup->neighbor_2_addr, &two_hop_neighbor->neighbor_2_addr)) {
+      hashtable_insert(&two_hop_index, dup);
+      break;
+    }
+  }
+}
+
 /**
  *Insert a new entry to the two hop neighbor table.
  *
@@ -140,6 +179,7 @@ olsr_insert_two_hop_neighbor_table(struct neighbor_2_entry *two_hop_neighbor)
 
   /* Queue */
   QUEUE_ELEM(two_hop_neighbortable[hash], two_hop_neighbor);
+  hashtable_insert(&two_hop_index, two_hop_neighbor);
 }
 
 /**
@@ -153,28 +193,19 @@ olsr_insert_two_hop_neighbor_table(struct neighbor_2_entry *two_hop_neighbor)
 struct neighbor_2_entry *
 olsr_lookup_two_hop_neighbor_table(const union olsr_ip_addr *dest)
 {
-
   struct neighbor_2_entry *neighbor_2;
-  uint32_t hash = olsr_ip_hashing(dest);
-
-  /* printf("LOOKING FOR %s\n", olsr_ip_to_string(&buf, dest)); */
-  for (neighbor_2 = two_hop_neighbortable[hash].next; neighbor_2 != &two_hop_neighbortable[hash]; neighbor_2 = neighbor_2->next) {
-    struct mid_address *adr;
-
-    /* printf("Checking %s\n", olsr_ip_to_string(&buf, dest)); */
-    if (ipequal(&neighbor_2->neighbor_2_addr, dest))
-      return neighbor_2;
+  union olsr_ip_addr *main_addr;
 
-    adr = mid_lookup_aliases(&neighbor_2->neighbor_2_addr);
+  neighbor_2 = hashtable_find(&two_hop_index, dest);
+  if (neighbor_2 != NULL)
+    return neighbor_2;
 
-    while (adr) {
-      if (ipequal(&adr->alias, dest))
-        return neighbor_2;
-      adr = adr->next_alias;
-    }
-  }
+  /* dest may be an alias of a two hop neighbor */
+  main_addr = mid_lookup_main_addr(dest);
+  if (main_addr == NULL)
+    return NULL;
 
-  return NULL;
+  return hashtable_find(&two_hop_index, main_addr);
 }
 
 /**
@@ -189,18 +220,7 @@ olsr_lookup_two_hop_neighbor_table(const union olsr_ip_addr *dest)
 struct neighbor_2_entry *
 olsr_lookup_two_hop_neighbor_table_mid(const union olsr_ip_addr *dest)
 {
-  struct neighbor_2_entry *neighbor_2;
-  uint32_t hash;
-
-  /* printf("LOOKING FOR %s\n", olsr_ip_to_string(&buf, dest)); */
-  hash = olsr_ip_hashing(dest);
-
-  for (neighbor_2 = two_hop_neighbortable[hash].next; neighbor_2 != &two_hop_neighbortable[hash]; neighbor_2 = neighbor_2->next) {
-    if (ipequal(&neighbor_2->neighbor_2_addr, dest))
-      return neighbor_2;
-  }
-
-  return NULL;
+  return hashtable_find(&two_hop_index, dest);
 }
 
 /**
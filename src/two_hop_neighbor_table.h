@@ -50,6 +50,7 @@
 #include "hashing.h"
 #include "lq_plugin.h"
 #include "olsr_types.h"
+#include "common/list.h"
 
 #define	NB2S_COVERED 	0x1     /* node has been covered by a MPR */
 
@@ -58,6 +59,7 @@ struct neighbor_list_entry {
   olsr_linkcost second_hop_linkcost;
   olsr_linkcost path_linkcost;
   olsr_linkcost saved_path_linkcost;
+  bool mpr_selected;                   /* LQ MPR: neighbor selected for this 2-hop */
   struct neighbor_list_entry *next;
   struct neighbor_list_entry *prev;
 };
@@ -68,10 +70,13 @@ struct neighbor_2_entry {
   uint8_t processed;                   /*used in mpr calculation */
   int16_t neighbor_2_pointer;          /* Neighbor count */
   struct neighbor_list_entry neighbor_2_nblist;
+  struct list_node mpr_dirty_node;     /* changed since the last MPR calculation */
   struct neighbor_2_entry *prev;
   struct neighbor_2_entry *next;
 };
 
+LISTNODE2STRUCT(mprdirty2nbr2, struct neighbor_2_entry, mpr_dirty_node);
+
 extern struct neighbor_2_entry two_hop_neighbortable[HASHSIZE];
 
 void olsr_init_two_hop_table(void);
@@ -82,6 +87,8 @@ void olsr_delete_two_hop_neighbor_table(struct neighbor_2_entry *);
 
 void olsr_insert_two_hop_neighbor_table(struct neighbor_2_entry *);
 
+void olsr_dequeue_two_hop_neighbor_table(struct neighbor_2_entry *);
+
 struct neighbor_2_entry *olsr_lookup_two_hop_neighbor_table(const union olsr_ip_addr *);
 
 struct neighbor_2_entry *olsr_lookup_two_hop_neighbor_table_mid(const union olsr_ip_addr *);
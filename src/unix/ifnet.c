@@ -204,6 +204,7 @@ chk_if_changed(struct olsr_if *iface)
     ifp->int_metric = iface->cnf->weight.value;
   else
     ifp->int_metric = calculate_if_metric(ifr.ifr_name);
+  olsr_invalidate_best_links();
 
   /* Get MTU */
   if (ioctl(olsr_cnf->ioctl_s, SIOCGIFMTU, &ifr) < 0)
@@ -773,6 +774,7 @@ chk_if_up(struct olsr_if *iface, int debuglvl __attribute__ ((unused)))
   ifp->gen_properties = NULL;
   ifp->int_next = ifnet;
   ifnet = ifp;
+  olsr_invalidate_best_links();
 
   set_buffer_timer(ifp);
 
@@ -59,6 +59,7 @@
 #include "lq_packet.h"
 #include "net_olsr.h"
 #include "olsr_random.h"
+#include "link_set.h"
 
 #include <iphlpapi.h>
 #include <iprtrmib.h>
@@ -647,6 +648,7 @@ chk_if_changed(struct olsr_if *iface)
     else
       Int->int_metric = Info.Metric;
 
+    olsr_invalidate_best_links();
     Res = 1;
   }
 
@@ -852,6 +854,7 @@ chk_if_up(struct olsr_if *iface, int debuglvl __attribute__ ((unused)))
 
   New->int_next = ifnet;
   ifnet = New;
+  olsr_invalidate_best_links();
 
   iface->interf = New;
   iface->configured = 1;